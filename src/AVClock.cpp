@@ -19,9 +19,13 @@
     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ******************************************************************************/
 #include <QtAV/AVClock.h>
+#include <QtCore/QMutex>
 #include <QtCore/QTimer>
 #include <QtCore/QTimerEvent>
 #include <QtCore/QDateTime>
+#include <QtCore/QWaitCondition>
+#include <limits>
+#include "utils/SPSCQueue.h"
 #include "utils/Logger.h"
 
 namespace QtAV {
@@ -30,6 +34,21 @@ enum {
     kPaused,
     kStopped
 };
+
+class AVClock::Private
+{
+public:
+    Private()
+        : wake_id(0)
+        , waiters(0)
+        , free_running(false)
+    {}
+    QMutex wait_mutex;
+    QWaitCondition wait_cond;
+    int wake_id; // changed by wakeUp()
+    QAtomicInt waiters; // threads in waitUntil()
+    volatile bool free_running;
+};
 AVClock::AVClock(AVClock::ClockType c, QObject *parent):
     QObject(parent)
   , auto_clock(true)
@@ -41,6 +60,7 @@ AVClock::AVClock(AVClock::ClockType c, QObject *parent):
   , nb_restarted(0)
   , nb_sync(0)
   , sync_id(0)
+  , d(new Private())
 {
     last_pts = pts_ = pts_v = delay_ = 0;
 }
@@ -56,10 +76,15 @@ AVClock::AVClock(QObject *parent):
   , nb_restarted(0)
   , nb_sync(0)
   , sync_id(0)
+  , d(new Private())
 {
     last_pts = pts_ = pts_v = delay_ = 0;
 }
 
+AVClock::~AVClock()
+{
+}
+
 void AVClock::setClockType(ClockType ct)
 {
     if (clock_type == ct)
@@ -112,6 +137,7 @@ void AVClock::updateExternalClock(qint64 msecs)
     t = QDateTime::currentMSecsSinceEpoch();
     if (clockType() == VideoClock)
         pts_v = pts_;
+    wakeUp();
 }
 
 void AVClock::updateExternalClock(const AVClock &clock)
@@ -125,11 +151,13 @@ void AVClock::updateExternalClock(const AVClock &clock)
 
     last_pts = pts_;
     t = QDateTime::currentMSecsSinceEpoch();
+    wakeUp();
 }
 
 void AVClock::setSpeed(qreal speed)
 {
     mSpeed = speed;
+    wakeUp();
 }
 
 bool AVClock::isPaused() const
@@ -137,6 +165,19 @@ bool AVClock::isPaused() const
     return m_state == kPaused;
 }
 
+void AVClock::setFreeRunning(bool value)
+{
+    if (d->free_running == value)
+        return;
+    d->free_running = value;
+    wakeUp();
+}
+
+bool AVClock::isFreeRunning() const
+{
+    return d->free_running;
+}
+
 int AVClock::syncStart(int count)
 {
     static int sId = 0;
@@ -153,11 +194,58 @@ bool AVClock::syncEndOnce(int id)
         qWarning("bad sync id: %d, current: %d", id, sync_id);
         return true;
     }
-    if (!nb_sync.deref())
+    if (!nb_sync.deref()) {
         sync_id = 0;
+        wakeUp();
+    }
     return sync_id;
 }
 
+bool AVClock::waitUntil(double pts, qint64 msecs)
+{
+    QElapsedTimer et;
+    et.start();
+    if (pts > 0 && d->free_running)
+        return true;
+    QMutexLocker lock(&d->wait_mutex);
+    Q_UNUSED(lock);
+    // value() is read after waiters is increased. a missed notifyValueChanged() only delays the check to the estimated time
+    d->waiters.ref();
+    const int id = d->wake_id;
+    bool reached = false;
+    while (id == d->wake_id) {
+        qint64 left = msecs < 0 ? qint64(std::numeric_limits<int>::max()) : msecs - qint64(et.elapsed());
+        // audio clock value changes only when the audio thread updates it, then notifyValueChanged() wakes us
+        if (pts > 0 && !isPaused() && speed() > 0)
+            left = qMin(left, qint64((pts - value())*1000.0/speed() + 0.5));
+        if (left <= 0) {
+            reached = true;
+            break;
+        }
+        d->wait_cond.wait(&d->wait_mutex, (unsigned long)left);
+    }
+    d->waiters.deref();
+    return reached;
+}
+
+void AVClock::wakeUp()
+{
+    QMutexLocker lock(&d->wait_mutex);
+    Q_UNUSED(lock);
+    ++d->wake_id;
+    d->wait_cond.wakeAll();
+}
+
+void AVClock::notifyValueChanged()
+{
+    // called for every audio chunk. no lock if nobody waits
+    if (!spsc::loadAcquire(d->waiters))
+        return;
+    QMutexLocker lock(&d->wait_mutex);
+    Q_UNUSED(lock);
+    d->wait_cond.wakeAll();
+}
+
 void AVClock::start()
 {
     m_state = kRunning;
@@ -188,6 +276,7 @@ void AVClock::pause(bool p)
         Q_EMIT resumed();
     }
     t = QDateTime::currentMSecsSinceEpoch();
+    wakeUp();
     Q_EMIT paused(p);
 }
 
@@ -206,6 +295,7 @@ void AVClock::reset()
     timer.stop();
 #endif //QT_VERSION >= QT_VERSION_CHECK(4, 7, 0)
     t = QDateTime::currentMSecsSinceEpoch();
+    wakeUp();
     Q_EMIT resetted();
 }
 
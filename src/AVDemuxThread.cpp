@@ -24,7 +24,10 @@
 #include "QtAV/AVClock.h"
 #include "QtAV/AVDemuxer.h"
 #include "QtAV/AVDecoder.h"
+#include "QtAV/Statistics.h"
 #include "VideoThread.h"
+#include "VideoFrameCache.h"
+#include <QtCore/QFileInfo>
 #include <QtCore/QTime>
 #include "utils/Logger.h"
 
@@ -32,6 +35,26 @@
 
 namespace QtAV {
 
+// no packet is read. fits AtomicInt64 without 64bit atomic integer
+static const qint64 kNoPts = std::numeric_limits<int>::min();
+// ms. max pts distance between external audio and video packets read
+static const qint64 kPtsWindow = 1000;
+
+class ExternalAudioReader : public QThread
+{
+public:
+    ExternalAudioReader(AVDemuxThread *thread) :
+        QThread(thread)
+      , mDemuxThread(thread)
+    {}
+protected:
+    void run() Q_DECL_OVERRIDE {
+        mDemuxThread->readExternalAudio();
+    }
+private:
+    AVDemuxThread *mDemuxThread;
+};
+
 class AutoSem {
     QSemaphore *s;
 public:
@@ -42,6 +65,21 @@ public:
     }
 };
 
+// audio_reader does not block on a full audio queue. wake it up when the audio thread takes a packet
+class QueueNotFullCall : public PacketBuffer::StateChangeCallback
+{
+public:
+    QueueNotFullCall(AVDemuxThread* thread):
+        mDemuxThread(thread)
+    {}
+    virtual void call() {
+        if (mDemuxThread && mDemuxThread->ademuxer)
+            mDemuxThread->wakeUp();
+    }
+private:
+    AVDemuxThread *mDemuxThread;
+};
+
 class QueueEmptyCall : public PacketBuffer::StateChangeCallback
 {
 public:
@@ -53,8 +91,12 @@ public:
             return;
         if (mDemuxThread->isEnd())
             return;
-        if (mDemuxThread->atEndOfMedia())
+        if (mDemuxThread->atEndOfMedia()) {
+            mDemuxThread->wakeUp(); // waiting for a/v threads to finish
             return;
+        }
+        if (mDemuxThread->ademuxer)
+            mDemuxThread->wakeUp(); // audio_reader may wait for buffering
         mDemuxThread->updateBufferState(); // ensure detect buffering immediately
         AVThread *thread = mDemuxThread->videoThread();
         //qDebug("try wake up video queue");
@@ -82,6 +124,16 @@ AVDemuxThread::AVDemuxThread(QObject *parent) :
   , audio_thread(0)
   , video_thread(0)
   , clock_type(-1)
+  , cached_step(false)
+  , statistics(0)
+  , edge_pts(0)
+  , edge_time(0)
+  , audio_reader(new ExternalAudioReader(this))
+  , ademuxer_end(false)
+  , audio_buffer_value(1)
+  , read_apts(kNoPts)
+  , read_vpts(kNoPts)
+  , wake_count(0)
 {
     seek_tasks.setCapacity(1);
     seek_tasks.blockFull(false);
@@ -93,8 +145,19 @@ AVDemuxThread::AVDemuxThread(AVDemuxer *dmx, QObject *parent) :
   , end(false)
   , m_buffering(false)
   , m_buffer(0)
+  , ademuxer(0)
   , audio_thread(0)
   , video_thread(0)
+  , cached_step(false)
+  , statistics(0)
+  , edge_pts(0)
+  , edge_time(0)
+  , audio_reader(new ExternalAudioReader(this))
+  , ademuxer_end(false)
+  , audio_buffer_value(1)
+  , read_apts(kNoPts)
+  , read_vpts(kNoPts)
+  , wake_count(0)
 {
     setDemuxer(dmx);
     seek_tasks.setCapacity(1);
@@ -108,9 +171,15 @@ void AVDemuxThread::setDemuxer(AVDemuxer *dmx)
 
 void AVDemuxThread::setAudioDemuxer(AVDemuxer *demuxer)
 {
-    //QMutexLocker locker(&buffer_mutex);
-    //Q_UNUSED(locker);
-    ademuxer = demuxer;
+    {
+        // wait for audio_reader finishing the current read
+        QMutexLocker locker(&ademuxer_mutex);
+        Q_UNUSED(locker);
+        ademuxer = demuxer;
+        ademuxer_end = false;
+        read_apts.fetchAndStoreOrdered(kNoPts);
+    }
+    wakeUp();
 }
 
 void AVDemuxThread::setAVThread(AVThread*& pOld, AVThread *pNew)
@@ -131,7 +200,11 @@ void AVDemuxThread::setAVThread(AVThread*& pOld, AVThread *pNew)
 
 void AVDemuxThread::setAudioThread(AVThread *thread)
 {
+    if (audio_thread == thread)
+        return;
     setAVThread(audio_thread, thread);
+    if (audio_thread)
+        audio_thread->packetQueue()->setNotFullCallback(new QueueNotFullCall(this));
 }
 
 void AVDemuxThread::setVideoThread(AVThread *thread)
@@ -144,6 +217,11 @@ AVThread* AVDemuxThread::videoThread()
     return video_thread;
 }
 
+void AVDemuxThread::setStatistics(Statistics *statistics)
+{
+    this->statistics = statistics;
+}
+
 AVThread* AVDemuxThread::audioThread()
 {
     return audio_thread;
@@ -154,6 +232,8 @@ void AVDemuxThread::stepBackward()
     if (!video_thread)
         return;
     AVThread *t = video_thread;
+    if (stepFromCache(true))
+        return;
     const qreal pre_pts = video_thread->previousHistoryPts();
     if (pre_pts == 0.0) {
         qWarning("can not get previous pts");
@@ -174,7 +254,13 @@ void AVDemuxThread::stepBackward()
         void run() {
             AVThread *avt = demux_thread->videoThread();
             avt->packetQueue()->clear(); // clear here
-            if (pts <= 0) {
+            // exact previous frame once the index is ready
+            demux_thread->demuxer->setIndexEnabled(true);
+            AVDemuxer::IndexEntry prev;
+            if (pts <= 0 && demux_thread->demuxer->findPreviousFrame(qint64(-pts*1000.0), &prev)) {
+                // index pts is rounded to ms
+                pts = qreal(prev.pts - 1LL)/1000.0;
+            } else if (pts <= 0) {
                 demux_thread->demuxer->seek(qint64(-pts*1000.0) - 500LL);
                 QVector<qreal> ts;
                 qreal t = -1.0;
@@ -194,6 +280,7 @@ void AVDemuxThread::stepBackward()
             }
             qDebug("step backward: %lld, %f", qint64(pts*1000.0), pts);
             demux_thread->video_thread->setDropFrameOnSeek(false);
+            demux_thread->setFrameCacheEnabled(true);
             demux_thread->seekInternal(qint64(pts*1000.0), AccurateSeek);
         }
     private:
@@ -211,8 +298,41 @@ void AVDemuxThread::stepBackward()
     newSeekRequest(new stepBackwardTask(this, pre_pts));
 }
 
+bool AVDemuxThread::stepFromCache(bool backward)
+{
+    VideoThread *vt = static_cast<VideoThread*>(video_thread);
+    if (!vt || demuxer->hasAttacedPicture() || !vt->stepFromCache(backward))
+        return false;
+    // demuxer and decoder are still at the last decoded frame. resync them if playback resumes
+    VideoFrameCache *cache = vt->frameCache();
+    cached_step = !cache->isLast(cache->current());
+    pause(true);
+    video_thread->pause(true);
+    if (audio_thread)
+        audio_thread->pause(true);
+    if (!backward)
+        return true;
+    // prefetch the previous gop before it's stepped into
+    const QString url(demuxer->fileName());
+    if (cache->framesBefore(cache->current()) >= 8 || cache->isPrefetching()
+            || url.isEmpty() || !QFileInfo(url).isFile())
+        return true;
+    AVDemuxer::IndexEntry key;
+    const bool indexed = demuxer->findKeyFrame(qint64(cache->first()*1000.0) - 1LL, &key);
+    cache->prefetch(url, demuxer->videoStream(), indexed ? key.pts : -1LL);
+    return true;
+}
+
+void AVDemuxThread::setFrameCacheEnabled(bool value)
+{
+    VideoThread *vt = static_cast<VideoThread*>(video_thread);
+    if (vt)
+        vt->setFrameCacheEnabled(value);
+}
+
 void AVDemuxThread::seek(qint64 pos, SeekType type)
 {
+    cached_step = false;
     end = false;
     // queue maybe blocked by put()
     if (audio_thread) {
@@ -231,6 +351,8 @@ void AVDemuxThread::seek(qint64 pos, SeekType type)
         void run() {
             if (demux_thread->video_thread)
                 demux_thread->video_thread->setDropFrameOnSeek(true);
+            // frames decoded by a seek on pause can be stepped back to
+            demux_thread->setFrameCacheEnabled(demux_thread->user_paused);
             demux_thread->seekInternal(position, type);
         }
     private:
@@ -245,12 +367,21 @@ void AVDemuxThread::seekInternal(qint64 pos, SeekType type)
 {
     AVThread* av[] = { audio_thread, video_thread};
     qDebug("seek to %s %lld ms (%f%%)", QTime(0, 0, 0).addMSecs(pos).toString().toUtf8().constData(), pos, double(pos - demuxer->startTime())/double(demuxer->duration())*100.0);
+    // audio_reader must not put packets read before seek after the seek packet
+    QMutexLocker locker(&ademuxer_mutex);
+    Q_UNUSED(locker);
+    // build the index lazily. it's used by later seeks to find the exact key frame
+    if (type == AccurateSeek)
+        demuxer->setIndexEnabled(true);
     demuxer->setSeekType(type);
     demuxer->seek(pos);
     if (ademuxer) {
         ademuxer->setSeekType(type);
         ademuxer->seek(pos);
     }
+    ademuxer_end = false;
+    read_apts.fetchAndStoreOrdered(kNoPts);
+    read_vpts.fetchAndStoreOrdered(kNoPts);
 
     AVThread *watch_thread = 0;
     // TODO: why queue may not empty?
@@ -279,6 +410,7 @@ void AVDemuxThread::seekInternal(qint64 pos, SeekType type)
             watch_thread = t;
         }
     }
+    locker.unlock();
     if (watch_thread) {
         pauseInternal(false);
         Q_EMIT requestClockPause(false); // need direct connection
@@ -295,6 +427,7 @@ void AVDemuxThread::newSeekRequest(QRunnable *r)
             delete r;
     }
     seek_tasks.put(r);
+    wakeUp();
 }
 
 void AVDemuxThread::processNextSeekTask()
@@ -370,24 +503,34 @@ void AVDemuxThread::stop()
         }
     }
     pause(false);
-    cond.wakeAll();
-    qDebug("all avthread finished. try to exit demux thread<<<<<<");
     end = true;
+    wakeUp();
+    qDebug("all avthread finished. try to exit demux thread<<<<<<");
 }
 
 void AVDemuxThread::pause(bool p, bool wait)
 {
+    if (!p && cached_step) {
+        cached_step = false;
+        // the displayed frame is not the last decoded one
+        seek(qint64(static_cast<VideoThread*>(video_thread)->frameCache()->current()*1000.0), AccurateSeek);
+    }
     user_paused = p;
+    // frames decoded in playback are not cached
+    if (!p)
+        setFrameCacheEnabled(false);
     if (paused == p)
         return;
     paused = p;
     if (!paused)
-        cond.wakeAll();
+        wakeUp();
     else {
         if (wait) {
             // block until current loop finished
             buffer_mutex.lock();
             buffer_mutex.unlock();
+            ademuxer_mutex.lock();
+            ademuxer_mutex.unlock();
         }
     }
 }
@@ -404,12 +547,16 @@ MediaEndAction AVDemuxThread::mediaEndAction() const
 
 void AVDemuxThread::stepForward()
 {
+    if (cached_step && stepFromCache(false))
+        return;
+    cached_step = false;
     if (end)
         return;
     // clock type will be wrong if no lock because slot frameDeliveredOnStepForward() is in video thread
     QMutexLocker locker(&next_frame_mutex);
     Q_UNUSED(locker);
     pause(true); // must pause AVDemuxThread (set user_paused true)
+    setFrameCacheEnabled(true);
     AVThread* av[] = {video_thread, audio_thread};
     bool connected = false;
     for (size_t i = 0; i < sizeof(av)/sizeof(av[0]); ++i) {
@@ -513,10 +660,20 @@ bool AVDemuxThread::waitForStarted(int msec)
     return true;
 }
 
+void AVDemuxThread::liveEdge(qint64 *pts, qint64 *time) const
+{
+    // time is stored last in run(), so pts is not older than time
+    if (time)
+        *time = spsc::loadAcquire(edge_time);
+    if (pts)
+        *pts = spsc::loadAcquire(edge_pts);
+}
+
 void AVDemuxThread::run()
 {
     m_buffering = false;
     end = false;
+    edge_time.fetchAndStoreOrdered(0);
     if (audio_thread && !audio_thread->isRunning())
         audio_thread->start(QThread::HighPriority);
     if (video_thread && !video_thread->isRunning())
@@ -543,24 +700,43 @@ void AVDemuxThread::run()
     connect(thread, SIGNAL(seekFinished(qint64)), this, SIGNAL(seekFinished(qint64)), Qt::DirectConnection);
     seek_tasks.clear();
     int was_end = 0;
-    if (ademuxer) {
-        ademuxer->seek(0LL);
+    int a_was_end = 0;
+    {
+        QMutexLocker locker(&ademuxer_mutex);
+        Q_UNUSED(locker);
+        if (ademuxer)
+            ademuxer->seek(0LL);
+        ademuxer_end = false;
+        audio_buffer_value = buf2;
+        read_apts.fetchAndStoreOrdered(kNoPts);
+        read_vpts.fetchAndStoreOrdered(kNoPts);
     }
+    // external audio is read in audio_reader, slow audio storage will not block video
+    audio_reader->start();
     qreal last_apts = 0;
     qreal last_vpts = 0;
 
     AutoSem as(&sem);
     Q_UNUSED(as);
     while (!end) {
+        // read before checking the states, so a wakeUp() after that is not lost
+        const int wakes = spsc::loadAcquire(wake_count);
         processNextSeekTask();
         //vthread maybe changed by AVPlayer.setPriority() from no dec case
         vqueue = video_thread ? video_thread->packetQueue() : 0;
         if (demuxer->atEnd()) {
+            // audio_reader is not limited by video pts any more
+            if (!was_end && ademuxer)
+                wakeUp();
             // if avthread may skip 1st eof packet because of a/v sync
             const int kMaxEof = 1;//if buffer packet, we can use qMax(aqueue->bufferValue(), vqueue->bufferValue()) and not call blockEmpty(false);
-            if (aqueue && (!was_end || aqueue->isEmpty())) {
-                if (was_end < kMaxEof)
+            // external audio continues until its end or the last video packet
+            const bool a_end = finishExternalAudio(last_vpts);
+            if (aqueue && a_end && (!a_was_end || aqueue->isEmpty())) {
+                if (a_was_end < kMaxEof)
                     aqueue->put(Packet::createEOF());
+                if (ademuxer && !a_was_end && spsc::loadAcquire(read_apts) != kNoPts)
+                    last_apts = qreal(spsc::loadAcquire(read_apts))/1000.0;
                 const qreal dpts = last_vpts - last_apts;
                 if (dpts > 0.1) {
                     Packet fake_apkt;
@@ -569,8 +745,10 @@ void AVDemuxThread::run()
                     last_apts = last_vpts = 0; // if not reset to 0, for example real eof pts, then no fake apkt after seek because dpts < 0
                     aqueue->put(fake_apkt);
                 }
-                aqueue->blockEmpty(was_end >= kMaxEof); // do not block if buffer is not enough. block again on seek
+                aqueue->blockEmpty(a_was_end >= kMaxEof); // do not block if buffer is not enough. block again on seek
             }
+            if (a_end)
+                a_was_end = qMin(a_was_end + 1, kMaxEof);
             if (vqueue && (!was_end || vqueue->isEmpty())) {
                 if (was_end < kMaxEof)
                     vqueue->put(Packet::createEOF());
@@ -581,7 +759,7 @@ void AVDemuxThread::run()
                 Q_EMIT mediaStatusChanged(QtAV::BufferedMedia);
             }
             was_end = qMin(was_end + 1, kMaxEof);
-            bool exit_thread = !user_paused;
+            bool exit_thread = !user_paused && a_end;
             if (aqueue)
                 exit_thread &= aqueue->isEmpty();
             if (vqueue)
@@ -596,8 +774,10 @@ void AVDemuxThread::run()
                 if (vqueue)
                     vqueue->blockEmpty(true);
             }
-            // wait for a/v thread finished
-            msleep(100);
+            // wait for a/v thread finished. waked up on seek, pause, stop, when queues are drained and by audio_reader
+            const bool drained = (!aqueue || aqueue->isEmpty()) && (!vqueue || vqueue->isEmpty());
+            if (user_paused || !drained || !a_end)
+                waitForWakeUp(wakes);
             continue;
         }
         if (demuxer->mediaStatus() == StalledMedia) {
@@ -605,37 +785,27 @@ void AVDemuxThread::run()
             break;
         }
         was_end = 0;
+        a_was_end = 0;
         if (tryPause()) {
             continue; //the queue is empty and will block
         }
         updateBufferState();
+        const qint64 read_begin = statistics ? Statistics::Pipeline::now() : 0;
         if (!demuxer->readFrame()) {
             continue;
         }
         stream = demuxer->stream();
         pkt = demuxer->packet();
-        Packet apkt;
-        bool audio_has_pic = demuxer->hasAttacedPicture();
-        int a_ext = 0;
-        if (ademuxer) {
-            QMutexLocker locker(&buffer_mutex);
-            Q_UNUSED(locker);
-            if (ademuxer) {
-                a_ext = -1;
-                audio_has_pic = ademuxer->hasAttacedPicture();
-                // FIXME: buffer full but buffering!!!
-                // avoid read external track everytime. aqueue may not block full
-                // vqueue will not block if aqueue is not enough
-                if (!aqueue->isFull() || aqueue->isBuffering()) {
-                    if (ademuxer->readFrame()) {
-                        if (ademuxer->stream() == ademuxer->audioStream()) {
-                            a_ext = 1;
-                            apkt = ademuxer->packet();
-                        }
-                    }
-                    // no continue otherwise. ademuxer finished earlier than demuxer
-                }
-            }
+        if (pkt.pts >= 0 && stream == (thread->clock()->clockType() == AVClock::AudioClock || !video_thread ? demuxer->audioStream() : demuxer->videoStream())) {
+            edge_pts.fetchAndStoreOrdered(qint64(pkt.pts*1000.0));
+            edge_time.fetchAndStoreOrdered(Statistics::Pipeline::now()/1000LL);
+        }
+        if (statistics) {
+            pkt.setReadTime(Statistics::Pipeline::now());
+            if (stream == demuxer->videoStream())
+                statistics->pipeline().record(Statistics::Pipeline::Video, Statistics::Pipeline::Read, read_begin, pkt.readTime(), pkt.pts);
+            else if (stream == demuxer->audioStream())
+                statistics->pipeline().record(Statistics::Pipeline::Audio, Statistics::Pipeline::Read, read_begin, pkt.readTime(), pkt.pts);
         }
         //qDebug("vqueue: %d, aqueue: %d/isbuffering %d isfull: %d, buffer: %d/%d", vqueue->size(), aqueue->size(), aqueue->isBuffering(), aqueue->isFull(), aqueue->buffered(), aqueue->bufferValue());
 
@@ -653,11 +823,9 @@ void AVDemuxThread::run()
          * stream data: aavavvavvavavavavavavavavvvaavavavava, it's ok
          */
         //TODO: use cache queue, take from cache queue if not empty?
-        const bool a_internal = stream == demuxer->audioStream();
-        if (a_internal || a_ext > 0) {//apkt.isValid()) {
-            if (a_internal && !a_ext) // internal is always read even if external audio used
-                apkt = demuxer->packet();
-            last_apts = apkt.pts;
+        // internal audio is ignored if external audio is used. it's put by audio_reader
+        if (stream == demuxer->audioStream() && !ademuxer) {
+            last_apts = pkt.pts;
             /* if vqueue if not blocked and full, and aqueue is empty, then put to
              * vqueue will block demuex thread
              */
@@ -671,10 +839,8 @@ void AVDemuxThread::run()
                     aqueue->setBufferValue(m_buffer->isBuffering() ? std::numeric_limits<qint64>::max() : buf2);
                 // always block full if no vqueue because empty callback may set false
                 // attached picture is cover for song, 1 frame
-                aqueue->blockFull(!video_thread || !video_thread->isRunning() || !vqueue || audio_has_pic);
-                // external audio: a_ext < 0, stream = audio_idx=>put invalid packet
-                if (a_ext >= 0)
-                    aqueue->put(apkt); //affect video_thread
+                aqueue->blockFull(!video_thread || !video_thread->isRunning() || !vqueue || demuxer->hasAttacedPicture());
+                aqueue->put(pkt); //affect video_thread
             }
         }
         // always check video stream if use external audio
@@ -684,9 +850,23 @@ void AVDemuxThread::run()
                     vqueue->clear();
                     continue;
                 }
-                vqueue->blockFull(!audio_thread || !audio_thread->isRunning() || !aqueue || aqueue->isEnough());
+                // video can be ahead of external audio at most kPtsWindow if queue is full
+                bool a_behind = false;
+                if (ademuxer) {
+                    const qint64 apts = spsc::loadAcquire(read_apts);
+                    a_behind = apts != kNoPts && qint64(pkt.pts*1000.0) - apts > kPtsWindow;
+                }
+                vqueue->blockFull(!audio_thread || !audio_thread->isRunning() || !aqueue || aqueue->isEnough() || a_behind);
                 vqueue->put(pkt); //affect audio_thread
                 last_vpts = pkt.pts;
+                const qint64 vpts = qint64(pkt.pts*1000.0);
+                const qint64 old_vpts = read_vpts.fetchAndStoreOrdered(vpts);
+                if (ademuxer) {
+                    // wake up audio_reader if video enters its pts window
+                    const qint64 apts = spsc::loadAcquire(read_apts);
+                    if (apts != kNoPts && apts - vpts <= kPtsWindow && (old_vpts == kNoPts || apts - old_vpts > kPtsWindow))
+                        wakeUp();
+                }
             }
         } else if (demuxer->subtitleStreams().contains(stream)) { //subtitle
             Q_EMIT internalSubtitlePacketRead(demuxer->subtitleStreams().indexOf(stream), pkt);
@@ -694,6 +874,9 @@ void AVDemuxThread::run()
             continue;
         }
     }
+    end = true; // stop audio_reader
+    wakeUp();
+    audio_reader->wait();
     m_buffering = false;
     m_buffer = 0;
     while (audio_thread && audio_thread->isRunning()) {
@@ -722,13 +905,108 @@ void AVDemuxThread::run()
         Q_EMIT mediaStatusChanged(QtAV::StalledMedia);
 }
 
+void AVDemuxThread::readExternalAudio()
+{
+    while (!end) {
+        const int wakes = spsc::loadAcquire(wake_count);
+        bool idle = paused || !ademuxer || ademuxer_end || !audio_thread || !audio_thread->isRunning();
+        if (!idle) {
+            PacketBuffer *aqueue = audio_thread->packetQueue();
+            // FIXME: buffer full but buffering!!!
+            // never block on put. seek has to wait for the read
+            idle = aqueue->isFull() && !aqueue->isBuffering();
+            // keep in the pts window of video. no limit if video is finished
+            if (!idle && video_thread && video_thread->isRunning() && !demuxer->atEnd()) {
+                const qint64 apts = spsc::loadAcquire(read_apts);
+                const qint64 vpts = spsc::loadAcquire(read_vpts);
+                idle = apts != kNoPts && vpts != kNoPts && apts - vpts > kPtsWindow;
+            }
+        }
+        if (!idle && readExternalAudioPacket()) {
+            // demux thread may wait for external audio at the end of video
+            if (demuxer->atEnd())
+                wakeUp();
+            continue;
+        }
+        // waked up on pause, seek, stop, audio demuxer change, when the audio queue is not full and when video pts moves
+        waitForWakeUp(wakes);
+    }
+}
+
+bool AVDemuxThread::readExternalAudioPacket()
+{
+    QMutexLocker lock(&ademuxer_mutex);
+    Q_UNUSED(lock);
+    // ademuxer may be changed or paused to change
+    if (!ademuxer || ademuxer_end || paused || !audio_thread)
+        return false;
+    const qint64 read_begin = statistics ? Statistics::Pipeline::now() : 0;
+    if (!ademuxer->readFrame()) {
+        if (!ademuxer->atEnd())
+            return true;
+        // no more packets until seek. demux thread is waked up by audio_reader to put eof
+        ademuxer_end = true;
+        return false;
+    }
+    if (ademuxer->stream() != ademuxer->audioStream())
+        return true;
+    Packet apkt = ademuxer->packet();
+    if (statistics) {
+        apkt.setReadTime(Statistics::Pipeline::now());
+        statistics->pipeline().record(Statistics::Pipeline::Audio, Statistics::Pipeline::Read, read_begin, apkt.readTime(), apkt.pts);
+    }
+    PacketBuffer *aqueue = audio_thread->packetQueue();
+    PacketBuffer *buf = m_buffer;
+    if (buf && buf != aqueue)
+        aqueue->setBufferValue(buf->isBuffering() ? std::numeric_limits<qint64>::max() : audio_buffer_value);
+    aqueue->blockFull(false);
+    aqueue->put(apkt);
+    read_apts.fetchAndStoreOrdered(qint64(apkt.pts*1000.0));
+    return true;
+}
+
+bool AVDemuxThread::finishExternalAudio(qreal vpts)
+{
+    QMutexLocker lock(&ademuxer_mutex);
+    Q_UNUSED(lock);
+    if (!ademuxer || ademuxer_end || !audio_thread)
+        return true;
+    if (!ademuxer->atEnd() && video_thread) {
+        const qint64 apts = spsc::loadAcquire(read_apts);
+        if (apts == kNoPts || apts < qint64(vpts*1000.0))
+            return false;
+    }
+    ademuxer_end = true;
+    return true;
+}
+
 bool AVDemuxThread::tryPause(unsigned long timeout)
 {
     if (!paused)
         return false;
-    QMutexLocker lock(&buffer_mutex);
+    QMutexLocker lock(&wait_mutex);
     Q_UNUSED(lock);
-    cond.wait(&buffer_mutex, timeout);
+    // a seek request wakes up the thread
+    if (paused && seek_tasks.isEmpty())
+        cond.wait(&wait_mutex, timeout);
     return true;
 }
+
+void AVDemuxThread::wakeUp()
+{
+    wake_count.ref();
+    QMutexLocker lock(&wait_mutex);
+    Q_UNUSED(lock);
+    cond.wakeAll();
+}
+
+void AVDemuxThread::waitForWakeUp(int wakes, unsigned long timeout)
+{
+    QMutexLocker lock(&wait_mutex);
+    Q_UNUSED(lock);
+    // the states were checked before a wakeUp()
+    if (end || !seek_tasks.isEmpty() || spsc::loadAcquire(wake_count) != wakes)
+        return;
+    cond.wait(&wait_mutex, timeout);
+}
 } //namespace QtAV
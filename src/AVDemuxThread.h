@@ -32,6 +32,8 @@ namespace QtAV {
 
 class AVDemuxer;
 class AVThread;
+class Statistics;
+class ExternalAudioReader;
 class AVDemuxThread : public QThread
 {
     Q_OBJECT
@@ -39,11 +41,13 @@ public:
     explicit AVDemuxThread(QObject *parent = 0);
     explicit AVDemuxThread(AVDemuxer *dmx, QObject *parent = 0);
     void setDemuxer(AVDemuxer *dmx);
-    void setAudioDemuxer(AVDemuxer *demuxer); //not thread safe
+    void setAudioDemuxer(AVDemuxer *demuxer); // waits for the current external audio read
     void setAudioThread(AVThread *thread);
     AVThread* audioThread();
     void setVideoThread(AVThread *thread);
     AVThread* videoThread();
+    // packet read time is recorded if statistics is set
+    void setStatistics(Statistics* statistics);
     void stepForward(); // show next video frame and pause
     void stepBackward();
     void seek(qint64 pos, SeekType type); //ms
@@ -59,6 +63,13 @@ public:
     MediaEndAction mediaEndAction() const;
     void setMediaEndAction(MediaEndAction value);
     bool waitForStarted(int msec = -1);
+    /*!
+     * \brief liveEdge
+     * The latest packet read from the stream followed by the clock, used to estimate live latency.
+     * \param pts packet pts in ms
+     * \param time Statistics::Pipeline::now() in ms when the packet was read. 0 if nothing is read since start
+     */
+    void liveEdge(qint64 *pts, qint64 *time) const;
 Q_SIGNALS:
     void requestClockPause(bool value);
     void mediaStatusChanged(QtAV::MediaStatus);
@@ -77,15 +88,32 @@ protected:
     /*
      * If the pause state is true setted by pause(true), then block the thread and wait for pause state changed, i.e. pause(false)
      * and return true. Otherwise, return false immediatly.
+     * A seek request also wakes up the thread. The timeout is only a guard
      */
-    bool tryPause(unsigned long timeout = 100);
+    bool tryPause(unsigned long timeout = 1000);
+    // wake up the thread waiting for pause state, seek request or a/v threads at the end, and audio_reader
+    void wakeUp();
 
 private:
     void setAVThread(AVThread *&pOld, AVThread* pNew);
     void newSeekRequest(QRunnable *r);
     void processNextSeekTask();
     void seekInternal(qint64 pos, SeekType type); //must call in AVDemuxThread
+    // step with decoded frames in video thread cache
+    bool stepFromCache(bool backward);
+    // cache decoded video frames only when they may be stepped to
+    void setFrameCacheEnabled(bool value);
     void pauseInternal(bool value);
+    // loop of audio_reader. external audio is read and put into the audio thread queue in parallel with demuxer
+    void readExternalAudio();
+    bool readExternalAudioPacket();
+    // return true if no more external audio will be put, i.e. no external audio, or it reaches the end or video pts vpts
+    bool finishExternalAudio(qreal vpts);
+    /*!
+     * wait until wakeUp() if wake_count is still wakes, i.e. loaded before checking the states. The timeout is only a guard
+     * wakeUp() can be called in a queue callback, so no queue function is called with wait_mutex locked, except seek_tasks
+     */
+    void waitForWakeUp(int wakes, unsigned long timeout = 1000);
 
     bool paused;
     bool user_paused;
@@ -98,12 +126,25 @@ private:
     AVThread *audio_thread, *video_thread;
     int audio_stream, video_stream;
     QMutex buffer_mutex;
+    QMutex wait_mutex; // for cond
     QWaitCondition cond;
     BlockingQueue<QRunnable*> seek_tasks;
 
     QSemaphore sem;
     QMutex next_frame_mutex;
     int clock_type; // change happens in different threads(direct connection)
+    bool cached_step; // displayed frame is from cache and older than the last decoded one
+    Statistics *statistics;
+    spsc::AtomicInt64 edge_pts, edge_time; // ms
+    QMutex ademuxer_mutex; // held by audio_reader while reading and on seek
+    ExternalAudioReader *audio_reader;
+    bool ademuxer_end; // guarded by ademuxer_mutex. reset on seek
+    qint64 audio_buffer_value;
+    spsc::AtomicInt64 read_apts, read_vpts; // ms. the last packet pts put by audio_reader and run()
+    QAtomicInt wake_count; // increased by wakeUp()
+    friend class QueueEmptyCall;
+    friend class QueueNotFullCall;
+    friend class ExternalAudioReader;
     friend class SeekTask;
     friend class stepBackwardTask;
 };
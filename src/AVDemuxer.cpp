@@ -21,6 +21,8 @@
 #include "QtAV/AVDemuxer.h"
 #include "QtAV/MediaIO.h"
 #include "QtAV/private/AVCompat.h"
+#include "PacketPool.h"
+#include "PacketIndex.h"
 #include <QtCore/QMutex>
 #include <QtCore/QStringList>
 #if QT_VERSION >= QT_VERSION_CHECK(4, 7, 0)
@@ -211,8 +213,12 @@ public:
         , seek_type(AccurateSeek)
         , dict(0)
         , interrupt_hanlder(0)
+        , pkt_pool(PacketPool::create())
+        , index_enabled(false)
     {}
     ~Private() {
+        stopIndex();
+        pkt_pool->deref(); // outstanding packets keep the pool alive
         delete interrupt_hanlder;
         if (dict) {
             av_dict_free(&dict);
@@ -269,6 +275,25 @@ public:
         s |= format_ctx->iformat->read_seek || format_ctx->iformat->read_seek2;
         return s;
     }
+    // use the container index if it's complete, otherwise read packets in background
+    void startIndex() {
+        stopIndex();
+        if (!index_enabled || !format_ctx || !seekable || vstream.stream < 0)
+            return;
+        const AVRational tb = format_ctx->streams[vstream.stream]->time_base;
+        index = QSharedPointer<PacketIndex>(new PacketIndex(vstream.stream, tb.num, tb.den));
+        if (index->fromStream(format_ctx))
+            return;
+        // custom io can not be shared by another context
+        if (input || network || file.isEmpty())
+            return;
+        PacketIndex::build(index, file, input_format);
+    }
+    void stopIndex() {
+        if (index)
+            index->abort();
+        index.clear();
+    }
     // set wanted_xx_stream. call openCodecs() to read new stream frames
     // stream < 0 is choose best
     bool setStream(AVDemuxer::StreamType st, int streamValue);
@@ -316,6 +341,9 @@ public:
     StreamInfo astream, vstream, sstream;
 
     AVDemuxer::InterruptHandler *interrupt_hanlder;
+    PacketPool *pkt_pool;
+    bool index_enabled;
+    QSharedPointer<PacketIndex> index;
     QMutex mutex; //TODO: remove if load, read, seek is called in 1 thread
 };
 
@@ -479,7 +507,8 @@ bool AVDemuxer::readFrame()
         return false;
     }
     // TODO: v4l2 copy
-    d->pkt = Packet::fromAVPacket(&packet, av_q2d(d->format_ctx->streams[d->stream]->time_base));
+    // packet data is moved into a recycled shell, packet is blank after that
+    d->pkt_pool->fromAVPacket(&d->pkt, &packet, av_q2d(d->format_ctx->streams[d->stream]->time_base));
     av_packet_unref(&packet); //important!
     d->eof = false;
     if (d->pkt.pts > qreal(duration())/1000.0) {
@@ -493,6 +522,16 @@ Packet AVDemuxer::packet() const
     return d->pkt;
 }
 
+qint64 AVDemuxer::packetPoolHits() const
+{
+    return d->pkt_pool->hits();
+}
+
+qint64 AVDemuxer::packetPoolMisses() const
+{
+    return d->pkt_pool->misses();
+}
+
 int AVDemuxer::stream() const
 {
     return d->stream;
@@ -582,7 +621,22 @@ bool AVDemuxer::seek(qint64 pos)
     }
     //qDebug("seek flag: %d", seek_flag);
     //bool seek_bytes = !!(d->format_ctx->iformat->flags & AVFMT_TS_DISCONT) && strcmp("ogg", d->format_ctx->iformat->name);
-    int ret = av_seek_frame(d->format_ctx, -1, upos, seek_flag);
+    int ret = -1;
+    PacketIndex::Entry key;
+    const bool use_index = (d->seek_type == AccurateSeek || (d->seek_type == KeyFrameSeek && backward))
+            && d->index && d->index->stream() == videoStream() && d->index->findKeyFrame(pos, &key);
+    if (use_index) {
+        // jump to the exact key frame before pos. byte seek if timestamps are not reliable, e.g. mpegts
+        const AVInputFormat *ifmt = d->format_ctx->iformat;
+        if (key.pos >= 0 && (ifmt->flags & AVFMT_TS_DISCONT) && !(ifmt->flags & AVFMT_NO_BYTE_SEEK) && strcmp(ifmt->name, "ogg"))
+            ret = av_seek_frame(d->format_ctx, -1, key.pos, AVSEEK_FLAG_BYTE);
+        else
+            ret = av_seek_frame(d->format_ctx, d->index->stream(), key.dts, AVSEEK_FLAG_BACKWARD);
+        if (ret < 0)
+            qDebug("seek with packet index error: %s", av_err2str(ret));
+    }
+    if (!use_index || ret < 0)
+        ret = av_seek_frame(d->format_ctx, -1, upos, seek_flag);
     //int ret = avformat_seek_file(d->format_ctx, -1, INT64_MIN, upos, upos, seek_flag);
     //avformat_seek_file()
     if (ret < 0 && (seek_flag & AVSEEK_FLAG_BACKWARD)) {
@@ -613,6 +667,86 @@ bool AVDemuxer::seek(qint64 pos)
     return true;
 }
 
+void AVDemuxer::setIndexEnabled(bool value)
+{
+    if (d->index_enabled == value)
+        return;
+    d->index_enabled = value;
+    if (!value)
+        d->stopIndex();
+    else if (isLoaded())
+        d->startIndex();
+}
+
+bool AVDemuxer::isIndexEnabled() const
+{
+    return d->index_enabled;
+}
+
+bool AVDemuxer::isIndexReady() const
+{
+    return d->index && d->index->stream() == videoStream() && d->index->isReady();
+}
+
+QVector<AVDemuxer::IndexEntry> AVDemuxer::indexEntries() const
+{
+    QVector<IndexEntry> entries;
+    if (!isIndexReady())
+        return entries;
+    const QVector<PacketIndex::Entry> e(d->index->entries());
+    entries.reserve(e.size());
+    foreach (const PacketIndex::Entry& i, e) {
+        entries.append(d->index->toIndexEntry(i));
+    }
+    return entries;
+}
+
+bool AVDemuxer::findKeyFrame(qint64 pos, IndexEntry *entry) const
+{
+    PacketIndex::Entry e;
+    if (!isIndexReady() || !d->index->findKeyFrame(pos, &e))
+        return false;
+    if (entry)
+        *entry = d->index->toIndexEntry(e);
+    return true;
+}
+
+bool AVDemuxer::findPreviousFrame(qint64 pos, IndexEntry *entry) const
+{
+    PacketIndex::Entry e;
+    if (!isIndexReady() || !d->index->findPreviousFrame(pos, &e))
+        return false;
+    if (entry)
+        *entry = d->index->toIndexEntry(e);
+    return true;
+}
+
+int AVDemuxer::framesToDecode(qint64 pos) const
+{
+    if (!isIndexReady())
+        return -1;
+    return d->index->framesToDecode(pos);
+}
+
+bool AVDemuxer::saveIndex(const QString &fileName) const
+{
+    if (!isIndexReady())
+        return false;
+    return d->index->save(fileName, d->format_ctx->pb ? avio_size(d->format_ctx->pb) : -1, durationUs());
+}
+
+bool AVDemuxer::loadIndex(const QString &fileName)
+{
+    if (!isLoaded() || videoStream() < 0)
+        return false;
+    QSharedPointer<PacketIndex> index(PacketIndex::load(fileName, videoStream(), d->format_ctx->pb ? avio_size(d->format_ctx->pb) : -1, durationUs()));
+    if (!index)
+        return false;
+    d->stopIndex();
+    d->index = index;
+    return true;
+}
+
 bool AVDemuxer::seek(qreal q)
 {
     if (duration() <= 0) {
@@ -851,6 +985,7 @@ bool AVDemuxer::load()
     d->seekable = d->checkSeekable();
     if (was_seekable != d->seekable)
         Q_EMIT seekableChanged();
+    d->startIndex();
     qDebug("avfmtctx.flags: %d, iformat.flags", d->format_ctx->flags, d->format_ctx->iformat->flags);
     if (getInterruptStatus() < 0) {
         QString msg;
@@ -872,6 +1007,7 @@ bool AVDemuxer::unload()
         Q_EMIT seekableChanged();
     }
     */
+    d->stopIndex();
     d->network = false;
     d->has_attached_pic = false;
     d->eof = false; // true and set false in load()?
@@ -33,6 +33,7 @@
 #include "QtAV/Packet.h"
 #include "QtAV/AudioDecoder.h"
 #include "QtAV/MediaIO.h"
+#include "QtAV/MemoryBudget.h"
 #include "QtAV/VideoRenderer.h"
 #include "QtAV/AVClock.h"
 #include "QtAV/VideoCapture.h"
@@ -88,6 +89,7 @@ AVPlayer::AVPlayer(QObject *parent) :
     connect(&d->demuxer, SIGNAL(seekableChanged()), this, SIGNAL(seekableChanged()));
     d->read_thread = new AVDemuxThread(this);
     d->read_thread->setDemuxer(&d->demuxer);
+    d->read_thread->setStatistics(&d->statistics);
     //direct connection can not sure slot order?
     connect(d->read_thread, SIGNAL(finished()), this, SLOT(stopFromDemuxerThread()), Qt::DirectConnection);
     connect(d->read_thread, SIGNAL(requestClockPause(bool)), masterClock(), SLOT(pause(bool)), Qt::DirectConnection);
@@ -195,6 +197,8 @@ void AVPlayer::setSpeed(qreal speed)
         d->ao->setSpeed(d->speed);
     }
     masterClock()->setSpeed(d->speed);
+    if (d->live_catch_up > 0)
+        d->applyLiveSpeed();
     Q_EMIT speedChanged(d->speed);
 }
 
@@ -247,6 +251,59 @@ qreal AVPlayer::forcedFrameRate() const
     return d->force_fps;
 }
 
+void AVPlayer::setFreeRunning(bool value)
+{
+    if (d->free_running == value)
+        return;
+    d->free_running = value;
+    if (!isPlaying())
+        return;
+    d->applyFrameRate();
+}
+
+bool AVPlayer::isFreeRunning() const
+{
+    return d->free_running;
+}
+
+void AVPlayer::setLiveMode(bool value)
+{
+    if (d->live_mode == value)
+        return;
+    d->live_mode = value;
+    d->applyLiveOptions();
+    d->updateBufferValue();
+    if (!value) {
+        d->setLiveCatchUp(0);
+        d->live_latency = -1;
+    }
+}
+
+bool AVPlayer::isLiveMode() const
+{
+    return d->live_mode;
+}
+
+void AVPlayer::setLiveLatencyTarget(int ms)
+{
+    if (ms <= 0) {
+        qWarning("invalid live latency target: %d", ms);
+        return;
+    }
+    d->live_target = ms;
+    d->updateBufferValue();
+}
+
+int AVPlayer::liveLatencyTarget() const
+{
+    return d->live_target;
+}
+
+int AVPlayer::liveLatency() const
+{
+    return d->live_latency;
+}
+
 const Statistics& AVPlayer::statistics() const
 {
     return d->statistics;
@@ -662,6 +719,8 @@ void AVPlayer::loadInternal()
             d->demuxer.setMedia(d->current_source.value<QtAV::MediaIO*>());
         }
     }
+    // the packet index is built on the first AccurateSeek or stepBackward(), so media that is never sought is read once
+    d->demuxer.setIndexEnabled(false);
     d->loaded = d->demuxer.load();
     d->status = d->demuxer.mediaStatus();
     if (!d->loaded) {
@@ -1191,6 +1250,8 @@ void AVPlayer::playInternal()
     d->stop_position_norm = normalizedPosition(d->stop_position);
     // FIXME: if call play() frequently playInternal may not be called if disconnect here
     disconnect(this, SIGNAL(loaded()), this, SLOT(playInternal()));
+    d->setLiveCatchUp(0);
+    d->live_latency = -1;
     if (!d->setupAudioThread(this)) {
         d->read_thread->setAudioThread(0); //set 0 before delete. ptr is used in demux thread when set 0
         if (d->athread) {
@@ -1349,7 +1410,7 @@ void AVPlayer::stopNotifyTimer()
 
 void AVPlayer::onStarted()
 {
-    if (d->speed != 1.0) {
+    if (d->speed != 1.0 && !d->free_running) {
         //TODO: check clock type?
         if (d->ao && d->ao->isAvailable()) {
             d->ao->setSpeed(d->speed);
@@ -1483,6 +1544,8 @@ void AVPlayer::timerEvent(QTimerEvent *te)
         }
         // active only when playing
         const qint64 t = position();
+        if (d->live_mode && isPlaying() && !isPaused() && d->updateLiveLatency())
+            Q_EMIT liveLatencyChanged(d->live_latency);
         if (d->stop_position_norm == kInvalidPosition) { // or check d->stop_position_norm < 0
             // not seekable. network stream
             Q_EMIT positionChanged(t);
@@ -1638,6 +1701,34 @@ int AVPlayer::bufferValue() const
     return d->buffer_value;
 }
 
+void AVPlayer::setAdaptiveBuffer(bool value)
+{
+    if (d->adaptive_buffer == value)
+        return;
+    d->adaptive_buffer = value;
+    d->updateBufferValue();
+}
+
+bool AVPlayer::isAdaptiveBuffer() const
+{
+    return d->adaptive_buffer;
+}
+
+void AVPlayer::setBufferMemoryLimit(qint64 bytes)
+{
+    MemoryBudget::setLimit(bytes);
+}
+
+qint64 AVPlayer::bufferMemoryLimit()
+{
+    return MemoryBudget::limit();
+}
+
+qint64 AVPlayer::bufferMemoryUsage()
+{
+    return PacketBuffer::memoryUsage();
+}
+
 void AVPlayer::updateClock(qint64 msecs)
 {
     d->clock->updateExternalClock(msecs);
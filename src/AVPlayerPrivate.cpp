@@ -22,6 +22,7 @@
 #include "AVPlayerPrivate.h"
 #include "filter/FilterManager.h"
 #include "output/OutputSet.h"
+#include "VideoFrameCache.h"
 #include "QtAV/AudioDecoder.h"
 #include "QtAV/AudioFormat.h"
 #include "QtAV/AudioResampler.h"
@@ -55,6 +56,9 @@ int computeNotifyPrecision(qint64 duration, qreal fps)
 }
 } // namespace Internal
 
+static const qreal kLiveCatchUpSpeed = 1.05;
+static const int kLiveAudioBuffers = 8;
+
 static bool correct_audio_channels(AVCodecContext *ctx) {
     if (ctx->channels <= 0) {
         if (ctx->channel_layout) {
@@ -88,6 +92,7 @@ AVPlayer::Private::Private()
     , subtitle_track(0)
     , buffer_mode(BufferPackets)
     , buffer_value(-1)
+    , adaptive_buffer(false)
     , read_thread(0)
     , clock(new AVClock(AVClock::AudioClock))
     , vo(0)
@@ -107,6 +112,12 @@ AVPlayer::Private::Private()
     , seek_type(AccurateSeek)
     , interrupt_timeout(30000)
     , force_fps(0)
+    , free_running(false)
+    , live_mode(false)
+    , live_target(500)
+    , live_latency(-1)
+    , live_catch_up(0)
+    , live_audio_buffers(-1)
     , notify_interval(-500)
     , status(NoMedia)
     , state(AVPlayer::StoppedState)
@@ -188,6 +199,17 @@ void AVPlayer::Private::updateNotifyInterval()
 
 void AVPlayer::Private::applyFrameRate()
 {
+    clock->setFreeRunning(free_running);
+    if (free_running) {
+        // clock follows decoded timestamps
+        clock->setClockAuto(false);
+        clock->setClockType(vthread ? AVClock::VideoClock : AVClock::AudioClock);
+        if (vthread)
+            vthread->setFrameRate(0.0);
+        ao->setSpeed(1);
+        clock->setSpeed(1);
+        return;
+    }
     qreal vfps = force_fps;
     bool force = vfps > 0;
     const bool ao_null = ao && ao->backend().toLower() == QLatin1String("null");
@@ -232,6 +254,7 @@ void AVPlayer::Private::initBaseStatistics()
 {
     statistics.reset();
     statistics.url = current_source.type() == QVariant::String ? current_source.toString() : QString();
+    statistics.setNetwork(Statistics::Network(demuxer.mediaIO()));
     statistics.start_time = QTime(0, 0, 0).addMSecs(int(demuxer.startTime()));
     statistics.duration = QTime(0, 0, 0).addMSecs((int)demuxer.duration());
     AVFormatContext *fmt_ctx = demuxer.formatContext();
@@ -389,6 +412,10 @@ bool AVPlayer::Private::setupAudioThread(AVPlayer *player)
     if (af.isValid()) {
         ao->setAudioFormat(af); /// set before close to workaround OpenAL context lost
         ao->close();
+        if (live_mode && live_audio_buffers < 0) {
+            live_audio_buffers = ao->bufferCount();
+            ao->setBufferCount(qMin(live_audio_buffers, kLiveAudioBuffers));
+        }
         qDebug() << "AudioOutput format: " << ao->audioFormat() << "; requested: " << ao->requestedFormat();
         if (!ao->open()) {
             return false;
@@ -423,6 +450,7 @@ bool AVPlayer::Private::setupAudioThread(AVPlayer *player)
     }
     athread->setDecoder(adec);
     setAVOutput(ao, ao, athread);
+    athread->packetQueue()->setMemoryOwner(player, AVDemuxer::AudioStream);
     updateBufferValue(athread->packetQueue());
     initAudioStatistics(ademuxer->audioStream());
     return true;
@@ -603,6 +631,8 @@ bool AVPlayer::Private::setupVideoThread(AVPlayer *player)
     vthread->setBrightness(brightness);
     vthread->setContrast(contrast);
     vthread->setSaturation(saturation);
+    vthread->packetQueue()->setMemoryOwner(player, AVDemuxer::VideoStream);
+    vthread->frameCache()->setMemoryOwner(player);
     updateBufferValue(vthread->packetQueue());
     initVideoStatistics(demuxer.videoStream());
 
@@ -613,6 +643,17 @@ bool AVPlayer::Private::setupVideoThread(AVPlayer *player)
 void AVPlayer::Private::updateBufferValue(PacketBuffer* buf)
 {
     const bool video = vthread && buf == vthread->packetQueue();
+    if (live_mode) {
+        // no buffering state: 1 packet is enough to start. the queue can hold about 2x target latency, and catch up drains it
+        const qreal pps = video ? qMax<qreal>(24.0, statistics.video.frame_rate)
+                                : (statistics.audio.frame_rate > 0 ? statistics.audio.frame_rate : 50.0);
+        buf->setBufferMode(BufferPackets);
+        buf->setAdaptive(false);
+        buf->setBufferValue(1LL);
+        buf->setBufferMax(qMax<qreal>(1.5, pps*qreal(live_target)*2.0/1000.0));
+        return;
+    }
+    buf->setBufferMax(1.5); // default value, may be changed by live mode
     const qreal fps = qMax<qreal>(24.0, statistics.video.frame_rate);
     qint64 bv = 0.5*fps;
     if (!video) {
@@ -630,6 +671,7 @@ void AVPlayer::Private::updateBufferValue(PacketBuffer* buf)
             bv = qMax<qint64>(1LL, statistics.video.frames);
     }
     buf->setBufferMode(buffer_mode);
+    buf->setAdaptive(adaptive_buffer);
     buf->setBufferValue(buffer_value < 0LL ? bv : buffer_value);
 }
 
@@ -641,4 +683,94 @@ void AVPlayer::Private::updateBufferValue()
         updateBufferValue(vthread->packetQueue());
 }
 
+static void mergeLiveOptions(QVariantHash *opt, const QVariantHash &live, QStringList *added, bool add)
+{
+    if (!add) {
+        foreach (const QString& key, *added) {
+            opt->remove(key);
+        }
+        added->clear();
+        return;
+    }
+    for (QVariantHash::const_iterator it = live.constBegin(); it != live.constEnd(); ++it) {
+        if (opt->contains(it.key()) || added->contains(it.key()))
+            continue;
+        opt->insert(it.key(), it.value());
+        added->append(it.key());
+    }
+}
+
+void AVPlayer::Private::applyLiveOptions()
+{
+    QVariantHash fmt_live;
+    fmt_live[QStringLiteral("probesize")] = 32768; // bytes
+    fmt_live[QStringLiteral("analyzeduration")] = 500000; // us
+    fmt_live[QStringLiteral("fflags")] = QStringLiteral("nobuffer");
+    QVariantHash fmt(demuxer.options());
+    // top level keys are ignored if "avformat" exists
+    if (fmt.contains(QStringLiteral("avformat"))) {
+        QVariantHash avformat(fmt.value(QStringLiteral("avformat")).toHash());
+        mergeLiveOptions(&avformat, fmt_live, &live_fmt_keys, live_mode);
+        fmt[QStringLiteral("avformat")] = avformat;
+    } else {
+        mergeLiveOptions(&fmt, fmt_live, &live_fmt_keys, live_mode);
+    }
+    demuxer.setOptions(fmt);
+
+    QVariantHash vc_live;
+    vc_live[QStringLiteral("flags")] = QStringLiteral("+low_delay"); // AV_CODEC_FLAG_LOW_DELAY
+    QVariantHash avcodec(vc_opt.value(QStringLiteral("avcodec")).toHash());
+    mergeLiveOptions(&avcodec, vc_live, &live_vc_keys, live_mode);
+    if (avcodec.isEmpty())
+        vc_opt.remove(QStringLiteral("avcodec"));
+    else
+        vc_opt[QStringLiteral("avcodec")] = avcodec;
+    if (!live_mode && live_audio_buffers >= 0) {
+        ao->setBufferCount(live_audio_buffers);
+        live_audio_buffers = -1;
+    }
+}
+
+void AVPlayer::Private::setLiveCatchUp(int level)
+{
+    if (live_catch_up == level)
+        return;
+    // decoders other than FFmpeg may not support it
+    if (vdec && (level > 1) != (live_catch_up > 1))
+        vdec->setProperty("skip_frame", int(level > 1 ? AVDISCARD_NONREF : AVDISCARD_DEFAULT));
+    qDebug("live catch up level: %d=>%d, latency: %dms", live_catch_up, level, live_latency);
+    live_catch_up = level;
+    applyLiveSpeed();
+}
+
+void AVPlayer::Private::applyLiveSpeed()
+{
+    if (free_running || force_fps > 0)
+        return;
+    const qreal r = live_catch_up > 0 ? speed*kLiveCatchUpSpeed : speed;
+    if (ao && ao->isAvailable())
+        ao->setSpeed(r);
+    clock->setSpeed(r);
+}
+
+bool AVPlayer::Private::updateLiveLatency()
+{
+    qint64 pts = 0, t = 0;
+    read_thread->liveEdge(&pts, &t);
+    if (t <= 0) {
+        live_latency = -1;
+        return false;
+    }
+    // the latest read packet is the live edge. it moves forward in realtime after it is received
+    const qint64 edge = pts + Statistics::Pipeline::now()/1000LL - t;
+    live_latency = int(qMax<qint64>(0LL, edge - qint64(clock->value()*1000.0)));
+    int level = 0;
+    if (live_latency > 2*live_target)
+        level = 2;
+    else if (live_latency > live_target)
+        level = qMax(1, live_catch_up); // keep the level until the target is reached
+    setLiveCatchUp(level);
+    return true;
+}
+
 } //namespace QtAV
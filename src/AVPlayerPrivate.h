@@ -56,6 +56,14 @@ public:
     // TODO: what if buffer mode changed during playback?
     void updateBufferValue(PacketBuffer *buf);
     void updateBufferValue();
+    // add or remove the low delay demuxer and codec options of live mode. options set by user are not touched
+    void applyLiveOptions();
+    // 0: normal, 1: speed up, 2: speed up and skip non-reference frames
+    void setLiveCatchUp(int level);
+    // speed() or a little faster if catching up
+    void applyLiveSpeed();
+    // estimate live latency and catch up if it is larger than the target. returns false if latency is unknown
+    bool updateLiveLatency();
     //TODO: addAVOutput()
     template<class Out>
     void setAVOutput(Out *&pOut, Out *pNew, AVThread *thread) {
@@ -123,6 +131,7 @@ public:
     QVariantList audio_tracks;
     BufferMode buffer_mode;
     qint64 buffer_value;
+    bool adaptive_buffer;
     //the following things are required and must be set not null
     AVDemuxer demuxer;
     AVDemuxThread *read_thread;
@@ -148,6 +157,13 @@ public:
     qint64 interrupt_timeout;
 
     qreal force_fps;
+    bool free_running;
+    bool live_mode;
+    int live_target; // ms
+    int live_latency; // ms. <0: unknown
+    int live_catch_up;
+    int live_audio_buffers; // AudioOutput::bufferCount() set by user. <0: not changed by live mode
+    QStringList live_fmt_keys, live_vc_keys; // options added by live mode
     // timerEvent interval in ms. can divide 1000. depends on media duration, fps etc.
     // <0: auto compute internally, |notify_interval| is the real interval
     int notify_interval;
@@ -38,6 +38,8 @@ AVThreadPrivate::~AVThreadPrivate() {
     stop = true;
     if (!paused) {
         qDebug("~AVThreadPrivate wake up paused thread");
+        QMutexLocker lock(&wait_mutex);
+        Q_UNUSED(lock);
         paused = false;
         next_pause = false;
         cond.wakeAll();
@@ -123,7 +125,16 @@ const QList<Filter*>& AVThread::filters() const
 
 void AVThread::scheduleTask(QRunnable *task)
 {
-    d_func().tasks.put(task);
+    DPTR_D(AVThread);
+    d.tasks.put(task);
+    // run it now if the thread is paused or waiting for the clock
+    {
+        QMutexLocker lock(&d.wait_mutex);
+        Q_UNUSED(lock);
+        d.cond.wakeAll();
+    }
+    if (d.clock)
+        d.clock->wakeUp();
 }
 
 void AVThread::requestSeek()
@@ -201,6 +212,8 @@ void AVThread::stop()
     d.packets.setBlocking(false); //stop blocking take()
     d.packets.clear();
     pause(false);
+    if (d.clock)
+        d.clock->wakeUp(); // stop waiting in waitAndCheck()
     //terminate();
 }
 
@@ -210,6 +223,8 @@ void AVThread::pause(bool p)
     DPTR_D(AVThread);
     if (d.paused == p)
         return;
+    QMutexLocker lock(&d.wait_mutex);
+    Q_UNUSED(lock);
     d.paused = p;
     if (!d.paused) {
         qDebug("wake up paused thread");
@@ -221,6 +236,8 @@ void AVThread::pause(bool p)
 void AVThread::nextAndPause()
 {
     DPTR_D(AVThread);
+    QMutexLocker lock(&d.wait_mutex);
+    Q_UNUSED(lock);
     d.next_pause = true;
     d.paused = true;
     d.cond.wakeAll();
@@ -327,11 +344,16 @@ bool AVThread::tryPause(unsigned long timeout)
     DPTR_D(AVThread);
     if (!isPaused())
         return false;
-    QMutexLocker lock(&d.mutex);
+    QMutexLocker lock(&d.wait_mutex);
     Q_UNUSED(lock);
-    return d.cond.wait(&d.mutex, timeout);
-    qDebug("paused thread waked up!!!");
-    return true;
+    if (!isPaused())
+        return true; // resumed before lock
+    if (!d.tasks.isEmpty())
+        return false; // process the task first
+    if (!d.cond.wait(&d.wait_mutex, timeout))
+        return false;
+    // false if waked up by scheduleTask()
+    return !d.paused || d.next_pause;
 }
 
 bool AVThread::processNextTask()
@@ -364,29 +386,20 @@ bool AVThread::waitForStarted(int msec)
 void AVThread::waitAndCheck(qreal value, qreal pts)
 {
     DPTR_D(AVThread);
-    if (value <= 0)
+    if (value <= 0 || d.clock->isFreeRunning())
         return;
     value += d.wait_err;
     d.wait_timer.restart();
     //qDebug("wating for %lu msecs", value);
-    ulong us = value * 1000UL;
-    const ulong ms = value;
-    static const ulong kWaitSlice = 20 * 1000UL; //20ms
-    while (us > kWaitSlice) {
-        usleep(kWaitSlice);
-        if (d.stop)
-            us = 0;
-        else
-            us -= kWaitSlice;
-        if (pts > 0)
-            us = qMin(us, ulong((double)(qMax<qreal>(0, pts - d.clock->value()))*1000000.0));
-        //qDebug("us: %lu/%lu, pts: %f, clock: %f", us, ms-et.elapsed(), pts, d.clock->value());
+    const qint64 ms = value;
+    // block on the clock until pts reaches or time is up. a new task, seek, pause or stop wakes up the thread
+    while (!d.stop && !d.seek_requested) {
+        const qint64 left = ms - d.wait_timer.elapsed();
+        if (left <= 0 || d.clock->waitUntil(pts, left))
+            break;
         processNextTask();
-        us = qMin<ulong>(us, (ms-d.wait_timer.elapsed())*1000);
     }
-    if (us > 0)
-        usleep(us);
-    //qDebug("wait elapsed: %lu %d/%lld", us, ms, et.elapsed());
+    //qDebug("wait elapsed: %lld/%lld", d.wait_timer.elapsed(), ms);
     const int de = ((ms-d.wait_timer.elapsed()) - d.wait_err);
     if (de > -3 && de < 3)
         d.wait_err += de;
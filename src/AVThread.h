@@ -104,9 +104,9 @@ protected:
     /*
      * If the pause state is true setted by pause(true), then block the thread and wait for pause state changed, i.e. pause(false)
      * and return true. Otherwise, return false immediatly.
+     * Return false if a task is scheduled, so that the pending tasks can be processed. The timeout is only a guard
      */
-    // has timeout so that the pending tasks can be processed
-    bool tryPause(unsigned long timeout = 100);
+    bool tryPause(unsigned long timeout = 1000);
     bool processNextTask(); //in AVThread
     // pts > 0: compare pts and clock when waiting
     void waitAndCheck(qreal value, qreal pts);
@@ -65,6 +65,7 @@ public:
       , render_pts0(-1)
       , drop_frame_seek(true)
       , pts_history(30)
+      , decode_time(0)
       , wait_err(0)
     {
         tasks.blockFull(false);
@@ -84,7 +85,8 @@ public:
     AVDecoder *dec;
     OutputSet *outputSet;
     QMutex mutex;
-    QWaitCondition cond; //pause
+    QMutex wait_mutex; // for cond. mutex may be locked for a long time when decoding
+    QWaitCondition cond; //pause, or a task is scheduled
     qreal delay;
     QList<Filter*> filters;
     Statistics *statistics; //not obj. Statistics is unique for the player, which is in AVPlayer
@@ -97,6 +99,7 @@ public:
     static QVariantHash dec_opt_framedrop, dec_opt_normal;
     bool drop_frame_seek;
     ring<qreal> pts_history;
+    qreal decode_time; // moving average of decoding time of a frame, in s
 
     qint64 wait_err;
     QElapsedTimer wait_timer;
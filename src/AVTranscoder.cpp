@@ -20,14 +20,320 @@
 ******************************************************************************/
 
 #include "QtAV/AVTranscoder.h"
+#include <limits>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
+#include <QtCore/QWaitCondition>
 #include "QtAV/AVPlayer.h"
+#include "QtAV/AVDemuxer.h"
 #include "QtAV/AVMuxer.h"
 #include "QtAV/EncodeFilter.h"
 #include "QtAV/Statistics.h"
+#include "QtAV/VideoDecoder.h"
+#include "QtAV/private/AVCompat.h"
 #include "utils/BlockingQueue.h"
 #include "utils/Logger.h"
 
 namespace QtAV {
+Q_GLOBAL_STATIC(QThreadPool, segmentThreadPool)
+
+namespace {
+static const qreal kPtsEpsilon = 0.0005; // s
+// frames [start, end) of the video stream. start is a key frame
+struct Segment {
+    Segment() : start(0), end(0), first_frame(0), done(false), ok(false) {}
+    qreal start, end;
+    int first_frame; // index of the start frame in the stream. used by TimestampMonotonic
+    QVector<Packet> packets;
+    bool done, ok;
+};
+
+struct SegmentContext {
+    SegmentContext() : stream(-1), tmpl(0), width(0), height(0), frame_rate(0), abort(false) {}
+    QString url;
+    int stream;
+    VideoEncoder *tmpl; // not owner. only properties are read
+    int width, height;
+    qreal frame_rate;
+    volatile bool abort;
+    QVector<Segment> segments;
+    QMutex mutex;
+    QWaitCondition cond;
+};
+
+// an encoder with the same properties as the template
+static VideoEncoder* createEncoder(const SegmentContext& ctx)
+{
+    VideoEncoder *enc = VideoEncoder::create(ctx.tmpl->name().toUtf8().constData());
+    if (!enc)
+        return 0;
+    enc->setCodecName(ctx.tmpl->codecName());
+    enc->setBitRate(ctx.tmpl->bitRate());
+    enc->setWidth(ctx.width);
+    enc->setHeight(ctx.height);
+    enc->setPixelFormat(ctx.tmpl->pixelFormat());
+    enc->setFrameRate(ctx.frame_rate);
+    enc->setOptions(ctx.tmpl->options());
+    // timestamps are computed from the segment if monotonic, so the encoder always copies them
+    enc->setTimestampMode(VideoEncoder::TimestampCopy);
+    return enc;
+}
+
+class SegmentTranscoder : public QRunnable
+{
+public:
+    SegmentTranscoder(const QSharedPointer<SegmentContext>& ctx, int index)
+        : m_ctx(ctx)
+        , m_index(index)
+    {}
+    void run() Q_DECL_OVERRIDE {
+        QVector<Packet> packets;
+        const bool ok = transcode(&packets);
+        QMutexLocker lock(&m_ctx->mutex);
+        Q_UNUSED(lock);
+        Segment &seg = m_ctx->segments[m_index];
+        seg.packets = packets;
+        seg.ok = ok;
+        seg.done = true;
+        m_ctx->cond.wakeAll();
+    }
+private:
+    bool transcode(QVector<Packet>* packets) {
+        const SegmentContext &ctx = *m_ctx;
+        Segment seg;
+        {
+            QMutexLocker lock(&m_ctx->mutex);
+            Q_UNUSED(lock);
+            seg = ctx.segments.at(m_index);
+        }
+        AVDemuxer demuxer;
+        demuxer.setMedia(ctx.url);
+        if (!demuxer.load())
+            return false;
+        const int s = demuxer.videoStreams().indexOf(ctx.stream);
+        if (s < 0 || !demuxer.setStreamIndex(AVDemuxer::VideoStream, s))
+            return false;
+        QScopedPointer<VideoDecoder> dec(VideoDecoder::create(VideoDecoderId_FFmpeg));
+        if (!dec || !demuxer.videoCodecContext())
+            return false;
+        dec->setCodecContext(demuxer.videoCodecContext());
+        if (!dec->open())
+            return false;
+        QScopedPointer<VideoEncoder> enc(createEncoder(ctx));
+        if (!enc || !enc->open()) {
+            qWarning("failed to open video encoder for segment %d", m_index);
+            return false;
+        }
+        demuxer.setSeekType(AccurateSeek); // backward, i.e. the key frame before
+        // +1: pts in ms is truncated
+        if (m_index > 0 && !demuxer.seek(qint64(seg.start*1000.0) + 1LL))
+            return false;
+        const bool monotonic = ctx.tmpl->timestampMode() == VideoEncoder::TimestampMonotonic;
+        int frames = 0;
+        bool key = false;
+        bool eof = false;
+        while (!ctx.abort) {
+            Packet pkt;
+            if (eof || demuxer.atEnd()) {
+                pkt = Packet::createEOF();
+            } else {
+                if (!demuxer.readFrame()) {
+                    eof = demuxer.atEnd() || demuxer.mediaStatus() == InvalidMedia;
+                    continue;
+                }
+                if (demuxer.stream() != ctx.stream)
+                    continue;
+                pkt = demuxer.packet();
+                if (!key && !pkt.hasKeyFrame)
+                    continue;
+                // closed gop: frames before the next key frame are all read
+                if (key && pkt.hasKeyFrame && pkt.pts >= seg.end - kPtsEpsilon) {
+                    eof = true;
+                    continue;
+                }
+                key = true;
+            }
+            if (!dec->decode(pkt)) {
+                if (pkt.isEOF())
+                    break;
+                continue;
+            }
+            VideoFrame frame(dec->frame());
+            if (!frame.isValid())
+                continue;
+            if (frame.timestamp() < seg.start - kPtsEpsilon || frame.timestamp() >= seg.end - kPtsEpsilon)
+                continue;
+            if (monotonic)
+                frame.setTimestamp(qreal(seg.first_frame + frames + 1)/ctx.frame_rate);
+            if (frame.pixelFormat() != enc->pixelFormat() || frame.width() != enc->width() || frame.height() != enc->height())
+                frame = frame.to(enc->pixelFormat(), QSize(enc->width(), enc->height()));
+            frames++;
+            if (enc->encode(frame) && enc->encoded().isValid())
+                packets->append(enc->encoded());
+        }
+        // delayed frames
+        while (!ctx.abort && enc->encode()) {
+            if (enc->encoded().isValid())
+                packets->append(enc->encoded());
+        }
+        enc->close();
+        dec->close();
+        return !ctx.abort;
+    }
+
+    QSharedPointer<SegmentContext> m_ctx;
+    int m_index;
+};
+} //namespace
+
+/*
+ * split the input at key frames, run SegmentTranscoder for the segments concurrently and write packets in order.
+ * at most 2*threads segments are decoded or waiting to be written
+ */
+class OfflineTranscoder : public QThread
+{
+public:
+    OfflineTranscoder(AVTranscoder* transcoder, AVMuxer* muxer, const QString& url, int threads)
+        : m_transcoder(transcoder)
+        , m_muxer(muxer)
+        , m_threads(threads)
+        , m_ctx(new SegmentContext())
+    {
+        m_ctx->url = url;
+    }
+    void abort() {
+        m_ctx->abort = true;
+    }
+protected:
+    void run() Q_DECL_OVERRIDE {
+        VideoEncoder *tmpl = m_transcoder->videoEncoder();
+        if (!tmpl)
+            return;
+        m_ctx->tmpl = tmpl;
+        if (!split())
+            return;
+        // properties are read by muxer, and the encoder is opened to get the real pixel format
+        QScopedPointer<VideoEncoder> header_enc(createEncoder(*m_ctx));
+        if (!header_enc || !header_enc->open()) {
+            qWarning("Failed to open video encoder");
+            return;
+        }
+        m_muxer->copyProperties((VideoEncoder*)0);
+        m_muxer->copyProperties((AudioEncoder*)0);
+        m_muxer->copyProperties(header_enc.data());
+        if (!m_muxer->open()) {
+            qWarning("Failed to open muxer");
+            return;
+        }
+        const int nb_segs = m_ctx->segments.size();
+        qDebug("offline transcode %d segments with %d threads", nb_segs, m_threads);
+        segmentThreadPool()->setMaxThreadCount(m_threads);
+        int submitted = 0;
+        qreal last_dts = -1;
+        for (int i = 0; i < nb_segs; ++i) {
+            while (!m_ctx->abort && submitted < nb_segs && submitted < i + 2*m_threads)
+                segmentThreadPool()->start(new SegmentTranscoder(m_ctx, submitted++));
+            QVector<Packet> packets;
+            {
+                QMutexLocker lock(&m_ctx->mutex);
+                Q_UNUSED(lock);
+                Segment &seg = m_ctx->segments[i];
+                while (!seg.done && i < submitted)
+                    m_ctx->cond.wait(&m_ctx->mutex);
+                if (m_ctx->abort || !seg.ok) {
+                    if (!m_ctx->abort)
+                        qWarning("Failed to transcode segment %d [%.3f, %.3f)", i, seg.start, seg.end);
+                    m_ctx->abort = true;
+                    // wait for running segments, they use m_ctx->tmpl
+                    for (int k = i; k < submitted; ++k) {
+                        while (!m_ctx->segments[k].done)
+                            m_ctx->cond.wait(&m_ctx->mutex);
+                    }
+                    break;
+                }
+                packets.swap(seg.packets);
+            }
+            foreach (Packet pkt, packets) {
+                if (m_ctx->abort)
+                    break;
+                // each encoder starts its own dts sequence
+                if (pkt.dts <= last_dts) {
+                    pkt.dts = last_dts + 0.001;
+                    pkt.skip(0); // AVPacket is rebuilt from the new values
+                }
+                last_dts = pkt.dts;
+                m_muxer->writeVideo(pkt);
+                QMetaObject::invokeMethod(m_transcoder, "videoFrameEncoded", Qt::DirectConnection, Q_ARG(qreal, pkt.pts));
+            }
+        }
+        m_muxer->close();
+        m_muxer->copyProperties((VideoEncoder*)0);
+        header_enc->close();
+    }
+private:
+    // read video packets to find key frames. segments are at least 1/(4*threads) of the stream
+    bool split() {
+        AVDemuxer demuxer;
+        demuxer.setMedia(m_ctx->url);
+        if (!demuxer.load()) {
+            qWarning("Failed to load %s", m_ctx->url.toUtf8().constData());
+            return false;
+        }
+        m_ctx->stream = demuxer.videoStream();
+        AVCodecContext *avctx = demuxer.videoCodecContext();
+        if (m_ctx->stream < 0 || !avctx) {
+            qWarning("No video stream in %s", m_ctx->url.toUtf8().constData());
+            return false;
+        }
+        VideoEncoder *tmpl = m_ctx->tmpl;
+        m_ctx->width = tmpl->width() > 0 ? tmpl->width() : avctx->width;
+        m_ctx->height = tmpl->height() > 0 ? tmpl->height() : avctx->height;
+        m_ctx->frame_rate = tmpl->frameRate();
+        if (m_ctx->frame_rate <= 0) {
+            const AVStream *st = demuxer.formatContext()->streams[m_ctx->stream];
+            m_ctx->frame_rate = st->avg_frame_rate.den && st->avg_frame_rate.num ? av_q2d(st->avg_frame_rate) : VideoEncoder::defaultFrameRate();
+        }
+        QVector<qreal> keys;
+        QVector<int> key_frames;
+        int frames = 0;
+        while (!m_ctx->abort) {
+            if (!demuxer.readFrame()) {
+                if (demuxer.atEnd() || demuxer.mediaStatus() == InvalidMedia)
+                    break;
+                continue;
+            }
+            if (demuxer.stream() != m_ctx->stream)
+                continue;
+            const Packet& pkt = demuxer.packet();
+            if (pkt.hasKeyFrame && (keys.isEmpty() || pkt.pts > keys.last() + kPtsEpsilon)) {
+                keys.append(pkt.pts);
+                key_frames.append(frames);
+            }
+            frames++;
+        }
+        if (m_ctx->abort || keys.isEmpty())
+            return false;
+        const int min_frames = qMax(1, frames/(4*m_threads));
+        for (int i = 0; i < keys.size(); ++i) {
+            if (!m_ctx->segments.isEmpty() && key_frames.at(i) - m_ctx->segments.last().first_frame < min_frames)
+                continue;
+            if (!m_ctx->segments.isEmpty())
+                m_ctx->segments.last().end = keys.at(i);
+            Segment seg;
+            seg.start = keys.at(i);
+            seg.first_frame = key_frames.at(i);
+            m_ctx->segments.append(seg);
+        }
+        m_ctx->segments.last().end = std::numeric_limits<qreal>::max();
+        return true;
+    }
+
+    AVTranscoder *m_transcoder;
+    AVMuxer *m_muxer;
+    int m_threads;
+    QSharedPointer<SegmentContext> m_ctx;
+};
 
 class AVTranscoder::Private
 {
@@ -40,9 +346,16 @@ public:
         , source_player(0)
         , afilter(0)
         , vfilter(0)
+        , threads(0)
+        , offline(0)
     {}
 
     ~Private() {
+        if (offline) {
+            offline->abort();
+            offline->wait();
+            delete offline;
+        }
         muxer.close();
         if (afilter) {
             delete afilter;
@@ -63,6 +376,9 @@ public:
     AVMuxer muxer;
     QString format;
     QVector<Filter*> filters;
+    QString source_file;
+    int threads;
+    OfflineTranscoder *offline;
 };
 
 AVTranscoder::AVTranscoder(QObject *parent)
@@ -106,6 +422,9 @@ void AVTranscoder::setMediaSource(AVPlayer *player)
         disconnect(d->source_player, SIGNAL(started()), this, SLOT(onSourceStarted()));
     }
     d->source_player = player;
+    d->source_file.clear();
+    if (!player)
+        return;
     // direct connect to ensure it's called before encoders open in filters
     connect(d->source_player, SIGNAL(started()), this, SLOT(onSourceStarted()), Qt::DirectConnection);
 }
@@ -115,6 +434,28 @@ AVPlayer* AVTranscoder::sourcePlayer() const
     return d->source_player;
 }
 
+void AVTranscoder::setMediaSource(const QString &fileName)
+{
+    if (d->source_player)
+        setMediaSource((AVPlayer*)0);
+    d->source_file = fileName;
+}
+
+QString AVTranscoder::sourceFile() const
+{
+    return d->source_file;
+}
+
+void AVTranscoder::setThreads(int value)
+{
+    d->threads = qMax(0, value);
+}
+
+int AVTranscoder::threads() const
+{
+    return d->threads;
+}
+
 QString AVTranscoder::outputFile() const
 {
     return d->muxer.fileName();
@@ -215,6 +556,8 @@ bool AVTranscoder::isRunning() const
 
 bool AVTranscoder::isPaused() const
 {
+    if (d->offline && d->offline->isRunning())
+        return false;
     if (d->vfilter) {
         if (d->vfilter->isEnabled())
             return false;
@@ -249,6 +592,22 @@ void AVTranscoder::start()
 {
     if (!videoEncoder())
         return;
+    if (!sourceFile().isEmpty()) {
+        if (d->offline) {
+            if (d->offline->isRunning())
+                return;
+            delete d->offline;
+        }
+        d->encoded_frames = 0;
+        d->started = true;
+        d->offline = new OfflineTranscoder(this, &d->muxer, sourceFile(), threads() > 0 ? threads() : QThread::idealThreadCount());
+        connect(d->offline, SIGNAL(finished()), SLOT(onOfflineFinished()));
+        if (!d->format.isEmpty())
+            d->muxer.setFormat(d->format);
+        d->offline->start();
+        Q_EMIT started();
+        return;
+    }
     if (!sourcePlayer())
         return;
     d->encoded_frames = 0;
@@ -281,6 +640,10 @@ void AVTranscoder::stop()
 {
     if (!isRunning())
         return;
+    if (d->offline && d->offline->isRunning()) {
+        d->offline->abort(); // onOfflineFinished() will be called
+        return;
+    }
     if (!d->muxer.isOpen())
         return;
     // uninstall encoder filters first then encoders can be closed safely
@@ -374,6 +737,13 @@ void AVTranscoder::writeVideo(const QtAV::Packet &packet)
     printf("encoded frames: %d, @%.3f pos: %lld\r", d->encoded_frames, packet.pts, packet.position);fflush(0);
 }
 
+void AVTranscoder::onOfflineFinished()
+{
+    if (!d->offline || d->offline->isRunning())
+        return;
+    stopInternal();
+}
+
 void AVTranscoder::tryFinish()
 {
     Filter* f = qobject_cast<Filter*>(sender());
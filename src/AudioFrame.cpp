@@ -23,6 +23,7 @@
 #include "QtAV/private/Frame_p.h"
 #include "QtAV/AudioResampler.h"
 #include "QtAV/private/AVCompat.h"
+#include "utils/AudioMix.h"
 #include "utils/Logger.h"
 
 namespace QtAV {
@@ -278,4 +279,42 @@ AudioFrame AudioFrame::to(const AudioFormat &fmt) const
     f.d_ptr->metadata = d->metadata; // need metadata?
     return f;
 }
+AudioFrame AudioFrame::mix(const QVector<AudioFrame> &frames, const QVector<qreal> &gains)
+{
+    if (frames.isEmpty())
+        return AudioFrame();
+    const AudioFormat fmt(frames.first().format());
+    AudioScaleFunc mix_samples = audioMixFunc(fmt.sampleFormat());
+    if (!mix_samples) {
+        qWarning() << "AudioFrame::mix: unsupported format " << fmt;
+        return AudioFrame();
+    }
+    int samples = 0;
+    foreach (const AudioFrame& f, frames) {
+        if (f.format() != fmt) {
+            qWarning() << "To mix frames they must have the same audio format";
+            return AudioFrame();
+        }
+        samples = qMax(samples, f.samplesPerChannel());
+    }
+    if (samples <= 0)
+        return AudioFrame(fmt);
+    const int nb_planes = fmt.planeCount();
+    const int channels_per_plane = fmt.isPlanar() ? 1 : fmt.channels();
+    const int plane_size = samples*channels_per_plane*fmt.bytesPerSample();
+    QByteArray buf(plane_size*nb_planes, fmt.isUnsigned() && !fmt.isFloat() ? 0x80 : 0);
+    quint8 *dst = (quint8*)buf.data();
+    for (int i = 0; i < frames.size(); ++i) {
+        const AudioFrame& f = frames.at(i);
+        if (!f.isValid() || !f.constBits(0))
+            continue;
+        const float gain = i < gains.size() ? gains.at(i) : 1.0f;
+        const int nb_samples = f.samplesPerChannel()*channels_per_plane;
+        for (int p = 0; p < nb_planes; ++p)
+            mix_samples(dst + p*plane_size, f.constBits(p), nb_samples, gain, 0);
+    }
+    AudioFrame out(fmt, buf);
+    out.setTimestamp(frames.first().timestamp());
+    return out;
+}
 } //namespace QtAV
@@ -28,6 +28,7 @@
 #include "QtAV/AudioResampler.h"
 #include "QtAV/AVClock.h"
 #include "QtAV/Filter.h"
+#include "QtAV/Statistics.h"
 #include "output/OutputSet.h"
 #include "QtAV/private/AVCompat.h"
 #include <QtCore/QCoreApplication>
@@ -100,13 +101,12 @@ void AudioThread::run()
             d.seek_requested = false;
             qDebug("request seek audio thread");
             pkt = Packet(); // last decode failed and pkt is valid, reset pkt to force take the next packet if seek is requested
-            msleep(1);
         } else {
             // d.render_pts0 < 0 means seek finished here
             if (d.clock->syncId() > 0) {
                 qDebug("audio thread wait to sync end for sync id: %d", d.clock->syncId());
                 if (d.render_pts0 < 0 && sync_id > 0) {
-                    msleep(10);
+                    d.clock->waitUntil(-1, 10); // waked up when sync ends
                     continue;
                 }
             } else {
@@ -120,6 +120,9 @@ void AudioThread::run()
             if (!pkt.isEOF() && (fake_duration <= 0 || !d.packets.isEmpty())) {
                 d.packets.setBlocking(false);
                 pkt = d.packets.take(); //wait to dequeue
+                if (pkt.readTime() > 0)
+                    d.statistics->pipeline().record(Statistics::Pipeline::Audio, Statistics::Pipeline::Queue, pkt.readTime(), Statistics::Pipeline::now(), pkt.pts);
+                d.statistics->pipeline().recordQueue(Statistics::Pipeline::Audio, d.packets.size(), d.packets.buffered());
             }
             if (pkt.isEOF()) {
                 fake_duration = 0; //avoid endless wait
@@ -160,7 +163,8 @@ void AudioThread::run()
                 fake_pts += ms;
                 //qDebug("fake_wait: %ul, fake_duration: %lld, delay: %.3f", ms, fake_duration, d.clock->delay());
                 d.clock->updateDelay(d.clock->delay() + qreal(ms)/1000.0);
-                msleep(ms);
+                if (!d.clock->isFreeRunning())
+                    msleep(ms);
                 continue;
             }
         }
@@ -183,7 +187,7 @@ void AudioThread::run()
             qreal a_v = dts - d.clock->videoTime();
             qDebug("skip audio decode at %f/%f v=%f a-v=%fms", dts, d.render_pts0, d.clock->videoTime(), a_v*1000.0);
             if (a_v > 0) {
-                msleep(qMin((ulong)20, ulong(a_v*1000.0)));
+                d.clock->waitUntil(-1, qMin<qint64>(20, a_v*1000.0));
             } else {
                 // audio maybe too late compared with video packet before seeking backword. so just ignore
                 msleep(0); //wait video seek done if audio done early
@@ -192,7 +196,8 @@ void AudioThread::run()
             continue;
         }
         const bool is_external_clock = d.clock->clockType() == AVClock::ExternalClock || d.clock->clockType() == AVClock::VideoClock;
-        if (is_external_clock && !pkt.isEOF()) {
+        // free running: no wait and no drop
+        if (is_external_clock && !pkt.isEOF() && !d.clock->isFreeRunning()) {
             d.delay = dts - d.clock->value();
             /*
              *after seeking forward, a packet may be the old, v packet may be
@@ -203,6 +208,7 @@ void AudioThread::run()
             if (qAbs(d.delay) < 2.0) {
                 if (d.delay < -kSyncThreshold) { //Speed up. drop frame? resample?
                     qDebug("audio is late compared with external clock. skip decoding. %.3f-%.3f=%.3f", dts, d.clock->value(), d.delay);
+                    d.statistics->pipeline().frameDropped(Statistics::Pipeline::Audio);
                     pkt = Packet(); //mark invalid to take next
                     continue;
                 }
@@ -213,10 +219,11 @@ void AudioThread::run()
                 }
             } else { //when to drop off?
                 if (d.delay > 0) {
-                    msleep(64);
+                    d.clock->waitUntil(dts, 64);
                 } else {
                     //audio packet not cleaned up?
                     qDebug("audio is too late compared with external clock. skip decoding. %.3f-%.3f=%.3f", dts, d.clock->value(), d.delay);
+                    d.statistics->pipeline().frameDropped(Statistics::Pipeline::Audio);
                     pkt = Packet(); //mark invalid to take next
                     continue;
                 }
@@ -275,6 +282,7 @@ void AudioThread::run()
             break;
         }
         //qDebug("apkt: %.3f, %lld %p", pkt.pts, pkt.asAVPacket()->pts, pkt.asAVPacket()->data);
+        const qint64 decode_begin = Statistics::Pipeline::now();
         if (!dec->decode(pkt)) {
             qWarning("Decode audio failed. undecoded: %d", dec->undecodedSize());
             if (pkt.isEOF()) {
@@ -293,7 +301,7 @@ void AudioThread::run()
             if (dt > 0.5 || dt < 0) {
                 dt = 0;
             }
-            if (!qFuzzyIsNull(dt)) {
+            if (!qFuzzyIsNull(dt) && !d.clock->isFreeRunning()) {
                 msleep((unsigned long)(dt*1000.0));
             }
             pkt = Packet();
@@ -327,6 +335,7 @@ void AudioThread::run()
         AudioFrame frame(dec->frame());
         if (!frame)
             continue; //pkt data is updated after decode, no reset here
+        d.statistics->pipeline().record(Statistics::Pipeline::Audio, Statistics::Pipeline::Decode, decode_begin, Statistics::Pipeline::now(), frame.timestamp());
         if (frame.timestamp() <= 0)
             frame.setTimestamp(pkt.pts); // pkt.pts is wrong. >= real timestamp
         if (d.render_pts0 >= 0.0) { // seeking
@@ -344,7 +353,9 @@ void AudioThread::run()
             }
         }
         if (has_ao) {
+            const qint64 filter_begin = Statistics::Pipeline::now();
             applyFilters(frame);
+            d.statistics->pipeline().record(Statistics::Pipeline::Audio, Statistics::Pipeline::Filter, filter_begin, Statistics::Pipeline::now(), frame.timestamp());
             frame.setAudioResampler(dec->resampler()); //!!!
             // FIXME: resample ONCE is required for audio frames from ffmpeg
             //if (ao->audioFormat() != frame.format()) {
@@ -355,6 +366,7 @@ void AudioThread::run()
 #else
         QByteArray decoded(dec->data());
 #endif
+        const qint64 deliver_begin = Statistics::Pipeline::now();
         int decodedSize = decoded.size();
         int decodedPos = 0;
         qreal delay = 0;
@@ -369,7 +381,11 @@ void AudioThread::run()
             const int chunk = qMin(decodedSize, has_ao ? ao->bufferSize() : 512*frame.format().bytesPerFrame());//int(max_len*byte_rate));
             //AudioFormat.bytesForDuration
             const qreal chunk_delay = (qreal)chunk/(qreal)byte_rate;
-            if (has_ao && ao->isOpen()) {
+            if (d.clock->isFreeRunning()) {
+                // null sink
+                d.clock->updateValue(pts);
+                d.clock->updateDelay(chunk_delay);
+            } else if (has_ao && ao->isOpen()) {
                 QByteArray decodedChunk = QByteArray::fromRawData(decoded.constData() + decodedPos, chunk);
                 //qDebug("ao.timestamp: %.3f, pts: %.3f, pktpts: %.3f", ao->timestamp(), pts, pkt.pts);
                 ao->play(decodedChunk, pts);
@@ -398,8 +414,10 @@ void AudioThread::run()
                pkt.dts += chunk_delay;
             }
         }
-        if (has_ao)
+        if (has_ao) {
+            d.statistics->pipeline().record(Statistics::Pipeline::Audio, Statistics::Pipeline::Deliver, deliver_begin, Statistics::Pipeline::now(), frame.timestamp());
             emit frameDelivered();
+        }
         d.last_pts = d.clock->value(); //not pkt.pts! the delay is updated!
     }
     d.packets.clear();
@@ -24,12 +24,33 @@
 #include "QtAV/private/AVCompat.h"
 #include "QtAV/private/factory.h"
 #include "ImageConverter.h"
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
 #include "utils/Logger.h"
 
 namespace QtAV {
 
 FACTORY_DEFINE(ImageConverter)
 
+Q_GLOBAL_STATIC(QThreadPool, imageConverterThreadPool)
+
+QThreadPool* ImageConverterPrivate::threadPool(int threads)
+{
+    QThreadPool *pool = imageConverterThreadPool();
+    if (pool->maxThreadCount() < threads)
+        pool->setMaxThreadCount(threads);
+    return pool;
+}
+
+int ImageConverterPrivate::defaultThreads()
+{
+    static const QByteArray env(qgetenv("QTAV_SWS_THREADS"));
+    if (env.isEmpty())
+        return 1;
+    const int n = env.toInt();
+    return n > 0 ? n : qMax(1, QThread::idealThreadCount());
+}
+
 ImageConverter::ImageConverter()
 {
 }
@@ -73,8 +94,6 @@ void ImageConverter::setOutSize(int width, int height)
     d.w_out = width;
     d.h_out = height;
     d.update_data = true;
-    prepareData();
-    d.update_data = false;
 }
 
 void ImageConverter::setInFormat(const VideoFormat& format)
@@ -109,8 +128,6 @@ void ImageConverter::setOutFormat(int format)
         return;
     d.fmt_out = (AVPixelFormat)format;
     d.update_data = true;
-    prepareData();
-    d.update_data = false;
 }
 
 void ImageConverter::setInRange(ColorRange range)
@@ -142,6 +159,20 @@ ColorRange ImageConverter::outRange() const
     return d_func().range_out;
 }
 
+void ImageConverter::setInColorSpace(ColorSpace cs)
+{
+    DPTR_D(ImageConverter);
+    if (d.cs_in == cs)
+        return;
+    d.cs_in = cs;
+    d.setupColorspaceDetails();
+}
+
+ColorSpace ImageConverter::inColorSpace() const
+{
+    return d_func().cs_in;
+}
+
 void ImageConverter::setBrightness(int value)
 {
     DPTR_D(ImageConverter);
@@ -184,6 +215,17 @@ int ImageConverter::saturation() const
     return d_func().saturation;
 }
 
+void ImageConverter::setThreads(int value)
+{
+    DPTR_D(ImageConverter);
+    d.threads = value > 0 ? value : qMax(1, QThread::idealThreadCount());
+}
+
+int ImageConverter::threads() const
+{
+    return d_func().threads;
+}
+
 QVector<quint8*> ImageConverter::outPlanes() const
 {
     return d_func().bits;
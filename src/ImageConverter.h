@@ -31,7 +31,7 @@ namespace QtAV {
 
 typedef int ImageConverterId;
 class ImageConverterPrivate;
-class ImageConverter //export is not needed
+class Q_AV_PRIVATE_EXPORT ImageConverter // exported for tests
 {
     DPTR_DECLARE_PRIVATE(ImageConverter)
 public:
@@ -56,6 +56,9 @@ public:
     // default is full range
     void setOutRange(ColorRange range);
     ColorRange outRange() const;
+    // yuv input color space. default is unknown, i.e. bt601
+    void setInColorSpace(ColorSpace cs);
+    ColorSpace inColorSpace() const;
     /*!
      * brightness, contrast, saturation: -100~100
      * If value changes, setup sws
@@ -66,6 +69,13 @@ public:
     int contrast() const;
     void setSaturation(int value);
     int saturation() const;
+    /*!
+     * \brief setThreads
+     * Number of threads used by a conversion if supported. The frame is split into horizontal bands.
+     * 0: QThread::idealThreadCount(). Default is QTAV_SWS_THREADS env value or 1.
+     */
+    void setThreads(int value);
+    int threads() const;
     QVector<quint8*> outPlanes() const;
     QVector<int> outLineSizes() const;
     virtual bool convert(const quint8 *const src[], const int srcStride[]);
@@ -88,7 +98,7 @@ private:
     static bool Register(ImageConverterId id, ImageConverterCreator, const char *name);
 protected:
     ImageConverter(ImageConverterPrivate& d);
-    //Allocate memory for out data. Called in setOutFormat()
+    //Allocate memory for out data. Called in convert(src, srcStride) if output format or size changed
     virtual bool prepareData(); //Allocate memory for out data
     DPTR_DECLARE(ImageConverter)
 };
@@ -98,7 +108,7 @@ class ImageConverterFFPrivate;
  * \brief The ImageConverterFF class
  * based on libswscale
  */
-class ImageConverterFF Q_DECL_FINAL: public ImageConverter //Q_AV_EXPORT is not needed
+class Q_AV_PRIVATE_EXPORT ImageConverterFF Q_DECL_FINAL: public ImageConverter
 {
     DPTR_DECLARE_PRIVATE(ImageConverterFF)
 public:
@@ -110,9 +120,29 @@ public:
 };
 typedef ImageConverterFF ImageConverterSWS;
 
+class ImageConverterSIMDPrivate;
+/*!
+ * \brief The ImageConverterSIMD class
+ * SSE2/AVX2 NV12, YUV420P and P010 to BGRA/RGBA without scaling. Instruction set is selected at runtime.
+ * Rows are converted in horizontal bands if threads() > 1.
+ * Other conversions, and all conversions if isAvailable() is false, are forwarded to ImageConverterFF.
+ */
+class Q_AV_PRIVATE_EXPORT ImageConverterSIMD Q_DECL_FINAL: public ImageConverter
+{
+    DPTR_DECLARE_PRIVATE(ImageConverterSIMD)
+public:
+    // true if a vector kernel is built and supported by the cpu
+    static bool isAvailable();
+    ImageConverterSIMD();
+    bool check() const Q_DECL_OVERRIDE;
+    bool convert(const quint8 *const src[], const int srcStride[]) Q_DECL_OVERRIDE { return ImageConverter::convert(src, srcStride);}
+    bool convert(const quint8 *const src[], const int srcStride[], quint8 *const dst[], const int dstStride[]) Q_DECL_OVERRIDE;
+};
+
 //ImageConverter* c = ImageConverter::create(ImageConverterId_FF);
 extern ImageConverterId ImageConverterId_FF;
 extern ImageConverterId ImageConverterId_IPP;
+extern ImageConverterId ImageConverterId_SIMD;
 
 } //namespace QtAV
 #endif // QTAV_IMAGECONVERTER_H
@@ -24,6 +24,9 @@
 #include "QtAV/private/AVCompat.h"
 #include "QtAV/private/mkid.h"
 #include "QtAV/private/factory.h"
+#include <QtCore/QRunnable>
+#include <QtCore/QSemaphore>
+#include <QtCore/QThreadPool>
 #include "utils/Logger.h"
 
 namespace QtAV {
@@ -33,20 +36,54 @@ FACTORY_REGISTER(ImageConverter, FF, "FFmpeg")
 class ImageConverterFFPrivate Q_DECL_FINAL: public ImageConverterPrivate
 {
 public:
+    // a horizontal band converted by it's own SwsContext
+    struct Slice {
+        Slice() : ctx(0), h(0), result(0) {}
+        SwsContext *ctx;
+        const quint8 *src[4];
+        int src_stride[4];
+        quint8 *dst[4];
+        int dst_stride[4];
+        int h;
+        int result;
+    };
+    class SliceTask : public QRunnable {
+    public:
+        SliceTask(Slice *s, QSemaphore *sem) : slice(s), done(sem) {}
+        void run() Q_DECL_OVERRIDE {
+            slice->result = sws_scale(slice->ctx, slice->src, slice->src_stride, 0, slice->h, slice->dst, slice->dst_stride);
+            done->release();
+        }
+    private:
+        Slice *slice;
+        QSemaphore *done;
+    };
+
     ImageConverterFFPrivate()
         : sws_ctx(0)
         , update_eq(true)
+        , update_slices_eq(true)
     {}
     ~ImageConverterFFPrivate() {
         if (sws_ctx) {
             sws_freeContext(sws_ctx);
             sws_ctx = 0;
         }
+        for (int i = 0; i < slices.size(); ++i)
+            sws_freeContext(slices[i].ctx);
     }
     virtual bool setupColorspaceDetails(bool force = true) Q_DECL_FINAL;
+    bool applyColorspaceDetails(SwsContext *ctx);
+    int swsFlags() const {
+        return (w_in == w_out && h_in == h_out) ? SWS_POINT : SWS_FAST_BILINEAR; //SWS_BICUBIC
+    }
+    // return false if slice conversion is not supported. then convert in 1 sws_scale call
+    bool convertSlices(const quint8 *const src[], const int srcStride[], quint8 *const dst[], const int dstStride[], bool *ok);
 
     SwsContext *sws_ctx;
     bool update_eq;
+    bool update_slices_eq;
+    QVector<Slice> slices;
 };
 
 ImageConverterFF::ImageConverterFF()
@@ -79,11 +116,21 @@ bool ImageConverterFF::convert(const quint8 *const src[], const int srcStride[],
             return false;
         setOutSize(d.w_in, d.h_in);
     }
+    bool ok = false;
+    if (d.threads > 1 && d.convertSlices(src, srcStride, dst, dstStride, &ok)) {
+        if (!ok)
+            return false;
+        for (int i = 0; i < d.pitchs.size(); ++i) {
+            d.bits[i] = dst[i];
+            d.pitchs[i] = dstStride[i];
+        }
+        return true;
+    }
 //TODO: move those code to prepare()
     d.sws_ctx = sws_getCachedContext(d.sws_ctx
             , d.w_in, d.h_in, (AVPixelFormat)d.fmt_in
             , d.w_out, d.h_out, (AVPixelFormat)d.fmt_out
-            , (d.w_in == d.w_out && d.h_in == d.h_out) ? SWS_POINT : SWS_FAST_BILINEAR //SWS_BICUBIC
+            , d.swsFlags()
             , NULL, NULL, NULL
             );
     //int64_t flags = SWS_CPU_CAPS_SSE2 | SWS_CPU_CAPS_MMX | SWS_CPU_CAPS_MMX2;
@@ -104,8 +151,80 @@ bool ImageConverterFF::convert(const quint8 *const src[], const int srcStride[],
     return true;
 }
 
+bool ImageConverterFFPrivate::convertSlices(const quint8 *const src[], const int srcStride[], quint8 *const dst[], const int dstStride[], bool *ok)
+{
+    // vertical scaling can not be split exactly
+    if (h_in != h_out)
+        return false;
+    const AVPixFmtDescriptor *din = av_pix_fmt_desc_get(fmt_in);
+    const AVPixFmtDescriptor *dout = av_pix_fmt_desc_get(fmt_out);
+    if (!din || !dout)
+        return false;
+    int no_slice = AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_BITSTREAM | AV_PIX_FMT_FLAG_HWACCEL;
+#ifdef AV_PIX_FMT_FLAG_PSEUDOPAL
+    no_slice |= AV_PIX_FMT_FLAG_PSEUDOPAL;
+#endif
+    if ((din->flags & no_slice) || (dout->flags & no_slice))
+        return false;
+    // band height is a multiple of chroma subsampling, and at least 16 chroma rows
+    const int align = 1 << qMax<int>(1, qMax(din->log2_chroma_h, dout->log2_chroma_h));
+    const int n = qMin(threads, h_in/(16*align));
+    if (n <= 1)
+        return false;
+    const int nb_planes_in = av_pix_fmt_count_planes(fmt_in);
+    const int nb_planes_out = av_pix_fmt_count_planes(fmt_out);
+    const int rows = FFALIGN((h_in + n - 1)/n, align);
+    const int nb_slices = (h_in + rows - 1)/rows;
+    if (slices.size() < nb_slices)
+        slices.resize(nb_slices);
+    for (int i = 0; i < nb_slices; ++i) {
+        Slice &s = slices[i];
+        const int y = i*rows;
+        s.h = qMin(rows, h_in - y);
+        SwsContext *ctx = sws_getCachedContext(s.ctx
+                , w_in, s.h, fmt_in
+                , w_out, s.h, fmt_out
+                , swsFlags()
+                , NULL, NULL, NULL);
+        if (!ctx) {
+            *ok = false;
+            return true;
+        }
+        if (ctx != s.ctx || update_slices_eq)
+            applyColorspaceDetails(ctx);
+        s.ctx = ctx;
+        // chroma planes are 1 and 2, alpha plane is not subsampled
+        for (int p = 0; p < 4; ++p) {
+            const int yin = (p == 1 || p == 2) ? y >> din->log2_chroma_h : y;
+            const int yout = (p == 1 || p == 2) ? y >> dout->log2_chroma_h : y;
+            s.src[p] = p < nb_planes_in ? src[p] + yin*srcStride[p] : 0;
+            s.src_stride[p] = p < nb_planes_in ? srcStride[p] : 0;
+            s.dst[p] = p < nb_planes_out ? dst[p] + yout*dstStride[p] : 0;
+            s.dst_stride[p] = p < nb_planes_out ? dstStride[p] : 0;
+        }
+    }
+    update_slices_eq = false;
+    QThreadPool *pool = threadPool(threads);
+    // the caller converts the 1st band
+    QSemaphore done;
+    for (int i = 1; i < nb_slices; ++i)
+        pool->start(new SliceTask(&slices[i], &done));
+    SliceTask(&slices[0], &done).run();
+    done.acquire(nb_slices);
+    *ok = true;
+    for (int i = 0; i < nb_slices; ++i) {
+        if (slices[i].result != slices[i].h) {
+            qDebug("convert slice %d failed: %d, %d", i, slices[i].result, slices[i].h);
+            *ok = false;
+        }
+    }
+    return true;
+}
+
 bool ImageConverterFFPrivate::setupColorspaceDetails(bool force)
 {
+    if (force)
+        update_slices_eq = true;
     if (!sws_ctx) {
         update_eq = true;
         return false;
@@ -115,19 +234,24 @@ bool ImageConverterFFPrivate::setupColorspaceDetails(bool force)
     if (!update_eq) {
         return true;
     }
+    const bool supported = applyColorspaceDetails(sws_ctx);
+    //sws_init_context(d.sws_ctx, NULL, NULL);
+    update_eq = false;
+    return supported;
+}
+
+bool ImageConverterFFPrivate::applyColorspaceDetails(SwsContext *ctx)
+{
     const int srcRange = range_in == ColorRange_Limited ? 0 : 1;
     int dstRange = range_out == ColorRange_Limited ? 0 : 1;
-    // TODO: color space
-    bool supported = sws_setColorspaceDetails(sws_ctx, sws_getCoefficients(SWS_CS_DEFAULT)
+    const int srcCs = cs_in == ColorSpace_BT709 ? SWS_CS_ITU709 : SWS_CS_DEFAULT;
+    return sws_setColorspaceDetails(ctx, sws_getCoefficients(srcCs)
                              , srcRange, sws_getCoefficients(SWS_CS_DEFAULT)
                              , dstRange
                              , ((brightness << 16) + 50)/100
                              , (((contrast + 100) << 16) + 50)/100
                              , (((saturation + 100) << 16) + 50)/100
                              ) >= 0;
-    //sws_init_context(d.sws_ctx, NULL, NULL);
-    update_eq = false;
-    return supported;
 }
 
 } //namespace QtAV
@@ -63,6 +63,9 @@ bool ImageConverterIPP::convert(const quint8 *const srcSlice[], const int srcStr
     DPTR_D(ImageConverterIPP);
     //color convertion, no scale
 #if QTAV_HAVE(IPP)
+    if (d.update_data && !prepareData())
+        return false;
+    d.update_data = false;
     struct {
         const quint8 *data[3];
         int linesize[3];
@@ -0,0 +1,291 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#include "ImageConverter.h"
+#include "ImageConverter_p.h"
+#include "ColorTransform.h"
+#include "utils/YUV2RGB.h"
+#include "QtAV/private/AVCompat.h"
+#include "QtAV/private/factory.h"
+#include "QtAV/private/mkid.h"
+#include <libavutil/cpu.h>
+#include <QtCore/QRunnable>
+#include <QtCore/QSemaphore>
+#include <QtCore/QThreadPool>
+#include "utils/Logger.h"
+
+namespace QtAV {
+
+ImageConverterId ImageConverterId_SIMD = mkid::id32base36_4<'S', 'I', 'M', 'D'>::value;
+FACTORY_REGISTER(ImageConverter, SIMD, "SIMD")
+
+#if QTAV_HAVE(SSE2) && defined(Q_PROCESSOR_X86)
+static bool detect_sse2()
+{
+    static bool is_sse2 = !!(av_get_cpu_flags() & AV_CPU_FLAG_SSE2);
+    return is_sse2;
+}
+#endif
+#if QTAV_HAVE(AVX2) && defined(Q_PROCESSOR_X86)
+static bool detect_avx2()
+{
+#ifdef AV_CPU_FLAG_AVX2
+    static bool is_avx2 = !!(av_get_cpu_flags() & AV_CPU_FLAG_AVX2);
+    return is_avx2;
+#else
+    return false;
+#endif
+}
+#endif
+
+template<int Depth>
+static inline int sample(const quint8* p, int i)
+{
+    if (Depth == 8)
+        return p[i];
+    // msb aligned little endian, e.g. p010le
+    return (p[2*i] | (p[2*i+1] << 8)) >> (16 - Depth);
+}
+
+// convert pixels [x, width)
+template<int Depth, bool Interleaved>
+static void yuv2rgbx_c(const quint8* y, const quint8* u, const quint8* v, quint8* dst, int x, int width, const YUV2RGBCoeffs& c)
+{
+    const int shift = 12 + Depth - 8;
+    const int k = 128 << (Depth - 8);
+    for (; x < width; ++x) {
+        const int Y = sample<Depth>(y, x);
+        const int U = Interleaved ? sample<Depth>(u, x & ~1) : sample<Depth>(u, x >> 1);
+        const int V = Interleaved ? sample<Depth>(u, x | 1) : sample<Depth>(v, x >> 1);
+        for (int i = 0; i < 3; ++i)
+            dst[4*x + i] = qBound(0, (c.yu[i][0]*Y + c.yu[i][1]*U + c.vk[i][0]*V + c.vk[i][1]*k) >> shift, 255);
+        dst[4*x + 3] = 255;
+    }
+}
+typedef void (*YUV2RGBRowFuncC)(const quint8* y, const quint8* u, const quint8* v, quint8* dst, int x, int width, const YUV2RGBCoeffs& c);
+
+static YUV2RGBRowFuncC rowFuncC(AVPixelFormat fmt)
+{
+    switch (fmt) {
+    case QTAV_PIX_FMT_C(YUV420P): return yuv2rgbx_c<8, false>;
+    case QTAV_PIX_FMT_C(NV12): return yuv2rgbx_c<8, true>;
+#ifdef AV_PIX_FMT_P010
+    case AV_PIX_FMT_P010LE: return yuv2rgbx_c<10, true>;
+#endif
+    default: return 0;
+    }
+}
+
+static YUV2RGBRowFunc rowFuncSIMD(AVPixelFormat fmt)
+{
+    Q_UNUSED(fmt);
+#if QTAV_HAVE(AVX2) && defined(Q_PROCESSOR_X86)
+    if (detect_avx2()) {
+        switch (fmt) {
+        case QTAV_PIX_FMT_C(YUV420P): return yuv420p_to_rgbx_avx2;
+        case QTAV_PIX_FMT_C(NV12): return nv12_to_rgbx_avx2;
+#ifdef AV_PIX_FMT_P010
+        case AV_PIX_FMT_P010LE: return p010_to_rgbx_avx2;
+#endif
+        default: return 0;
+        }
+    }
+#endif
+#if QTAV_HAVE(SSE2) && defined(Q_PROCESSOR_X86)
+    if (detect_sse2()) {
+        switch (fmt) {
+        case QTAV_PIX_FMT_C(YUV420P): return yuv420p_to_rgbx_sse2;
+        case QTAV_PIX_FMT_C(NV12): return nv12_to_rgbx_sse2;
+#ifdef AV_PIX_FMT_P010
+        case AV_PIX_FMT_P010LE: return p010_to_rgbx_sse2;
+#endif
+        default: return 0;
+        }
+    }
+#endif
+    return 0;
+}
+
+static qint16 toInt16(qreal v)
+{
+    return (qint16)qBound(-32768, qRound(v), 32767);
+}
+
+class ImageConverterSIMDPrivate Q_DECL_FINAL : public ImageConverterPrivate
+{
+public:
+    class BandTask : public QRunnable {
+    public:
+        BandTask(const ImageConverterSIMDPrivate *d, const quint8 *const src[], const int srcStride[], quint8 *const dst[], const int dstStride[], int y0, int y1, QSemaphore *sem)
+            : priv(d), src(src), src_stride(srcStride), dst(dst), dst_stride(dstStride), y_begin(y0), y_end(y1), done(sem)
+        {}
+        void run() Q_DECL_OVERRIDE {
+            priv->convertRows(src, src_stride, dst, dst_stride, y_begin, y_end);
+            done->release();
+        }
+    private:
+        const ImageConverterSIMDPrivate *priv;
+        const quint8 *const *src;
+        const int *src_stride;
+        quint8 *const *dst;
+        const int *dst_stride;
+        int y_begin, y_end;
+        QSemaphore *done;
+    };
+
+    ImageConverterSIMDPrivate() : update_coeffs(true) {}
+    bool setupColorspaceDetails(bool force = true) Q_DECL_OVERRIDE {
+        Q_UNUSED(force);
+        update_coeffs = true;
+        return true;
+    }
+    bool isSupported() const {
+        if (w_in != w_out || h_in != h_out)
+            return false;
+        if (fmt_out != QTAV_PIX_FMT_C(BGRA) && fmt_out != QTAV_PIX_FMT_C(RGBA))
+            return false;
+        // the c row function is only used for the tails. it's much slower than swscale
+        return !!rowFuncSIMD(fmt_in);
+    }
+    // convert rows [y0, y1). y0 is even
+    void convertRows(const quint8 *const src[], const int srcStride[], quint8 *const dst[], const int dstStride[], int y0, int y1) const;
+    void updateCoeffs();
+    void setupFallback();
+
+    bool update_coeffs;
+    YUV2RGBCoeffs coeffs;
+    ImageConverterFF sws; // scaling and other formats
+};
+
+void ImageConverterSIMDPrivate::updateCoeffs()
+{
+    update_coeffs = false;
+    ColorTransform ct;
+    // the same as ImageConverterFF: unknown color space is bt601, unknown input range is full
+    ct.setInputColorSpace(cs_in == ColorSpace_BT709 ? ColorSpace_BT709 : ColorSpace_BT601);
+    ct.setInputColorRange(range_in == ColorRange_Limited ? ColorRange_Limited : ColorRange_Full);
+    ct.setOutputColorRange(range_out == ColorRange_Limited ? ColorRange_Limited : ColorRange_Full);
+    ct.setBrightness(qreal(brightness)/100.0);
+    ct.setContrast(qreal(contrast)/100.0);
+    ct.setSaturation(qreal(saturation)/100.0);
+    // m * (y, u, v, 1) is normalized rgb. Q12 coefficients for 8 bit values. the offset term is multiplied by 128 in kernels
+    const QMatrix4x4 m(ct.matrix());
+    for (int i = 0; i < 3; ++i) {
+        const int r = fmt_out == QTAV_PIX_FMT_C(RGBA) ? i : 2 - i;
+        coeffs.yu[i][0] = toInt16(m(r, 0)*4096.0);
+        coeffs.yu[i][1] = toInt16(m(r, 1)*4096.0);
+        coeffs.vk[i][0] = toInt16(m(r, 2)*4096.0);
+        coeffs.vk[i][1] = toInt16(m(r, 3)*255.0*32.0 + 16.0); // + 16*128: rounding
+    }
+}
+
+void ImageConverterSIMDPrivate::setupFallback()
+{
+    sws.setInFormat(fmt_in);
+    sws.setOutFormat(fmt_out);
+    sws.setInSize(w_in, h_in);
+    sws.setOutSize(w_out, h_out);
+    sws.setInRange(range_in);
+    sws.setOutRange(range_out);
+    sws.setInColorSpace(cs_in);
+    sws.setBrightness(brightness);
+    sws.setContrast(contrast);
+    sws.setSaturation(saturation);
+    sws.setThreads(threads);
+}
+
+void ImageConverterSIMDPrivate::convertRows(const quint8 *const src[], const int srcStride[], quint8 *const dst[], const int dstStride[], int y0, int y1) const
+{
+    const YUV2RGBRowFunc simd = rowFuncSIMD(fmt_in);
+    const YUV2RGBRowFuncC c = rowFuncC(fmt_in);
+    const bool interleaved = fmt_in != QTAV_PIX_FMT_C(YUV420P);
+    // bytes per sample
+    const int bps = fmt_in == QTAV_PIX_FMT_C(YUV420P) || fmt_in == QTAV_PIX_FMT_C(NV12) ? 1 : 2;
+    for (int j = y0; j < y1; ++j) {
+        const quint8 *y = src[0] + j*srcStride[0];
+        const quint8 *u = src[1] + (j >> 1)*srcStride[1];
+        const quint8 *v = interleaved ? 0 : src[2] + (j >> 1)*srcStride[2];
+        quint8 *rgb = dst[0] + j*dstStride[0];
+        const int x = simd(y, u, v, rgb, w_in, coeffs);
+        if (x >= w_in)
+            continue;
+        // x is even. chroma plane offsets are in samples of the converted pixels
+        c(y + x*bps, u + (interleaved ? x : x/2)*bps, interleaved ? 0 : v + x/2, rgb + 4*x, 0, w_in - x, coeffs);
+    }
+}
+
+bool ImageConverterSIMD::isAvailable()
+{
+    return !!rowFuncSIMD(QTAV_PIX_FMT_C(YUV420P));
+}
+
+ImageConverterSIMD::ImageConverterSIMD()
+    : ImageConverter(*new ImageConverterSIMDPrivate())
+{
+}
+
+bool ImageConverterSIMD::check() const
+{
+    DPTR_D(const ImageConverterSIMD);
+    if (d.isSupported())
+        return ImageConverter::check();
+    const_cast<ImageConverterSIMDPrivate&>(d).setupFallback();
+    return d.sws.check();
+}
+
+bool ImageConverterSIMD::convert(const quint8 *const src[], const int srcStride[], quint8 *const dst[], const int dstStride[])
+{
+    DPTR_D(ImageConverterSIMD);
+    if (d.w_out == 0 || d.h_out == 0) {
+        if (d.w_in == 0 || d.h_in == 0)
+            return false;
+        setOutSize(d.w_in, d.h_in);
+    }
+    if (!d.isSupported()) {
+        d.setupFallback();
+        if (!d.sws.convert(src, srcStride, dst, dstStride))
+            return false;
+    } else {
+        if (d.update_coeffs)
+            d.updateCoeffs();
+        // bands of even rows, at least 32 rows like ImageConverterFF
+        const int n = qMin(d.threads, d.h_in/32);
+        if (n <= 1) {
+            d.convertRows(src, srcStride, dst, dstStride, 0, d.h_in);
+        } else {
+            const int rows = FFALIGN((d.h_in + n - 1)/n, 2);
+            QThreadPool *pool = ImageConverterPrivate::threadPool(d.threads);
+            QSemaphore done;
+            int nb_tasks = 0;
+            for (int y = rows; y < d.h_in; y += rows, ++nb_tasks)
+                pool->start(new ImageConverterSIMDPrivate::BandTask(&d, src, srcStride, dst, dstStride, y, qMin(y + rows, d.h_in), &done));
+            // the caller converts the 1st band
+            d.convertRows(src, srcStride, dst, dstStride, 0, qMin(rows, d.h_in));
+            done.acquire(nb_tasks);
+        }
+    }
+    for (int i = 0; i < d.pitchs.size(); ++i) {
+        d.bits[i] = dst[i];
+        d.pitchs[i] = dstStride[i];
+    }
+    return true;
+}
+} //namespace QtAV
@@ -26,6 +26,9 @@
 #include <QtAV/private/AVCompat.h>
 #include <QtCore/QVector>
 
+QT_BEGIN_NAMESPACE
+class QThreadPool;
+QT_END_NAMESPACE
 namespace QtAV {
 
 class ImageConverter;
@@ -39,14 +42,20 @@ public:
         , fmt_out(QTAV_PIX_FMT_C(RGB32))
         , range_in(ColorRange_Unknown)
         , range_out(ColorRange_Unknown)
+        , cs_in(ColorSpace_Unknown)
         , brightness(0)
         , contrast(0)
         , saturation(0)
+        , threads(defaultThreads())
         , update_data(true)
     {
         bits.reserve(8);
         pitchs.reserve(8);
     }
+    // QTAV_SWS_THREADS env. default is 1, 0 is QThread::idealThreadCount()
+    static int defaultThreads();
+    // shared by all converters to convert bands. max thread count is at least threads
+    static QThreadPool* threadPool(int threads);
     virtual bool setupColorspaceDetails(bool force = true) {
         Q_UNUSED(force);
         return true;
@@ -55,7 +64,9 @@ public:
     int w_in, h_in, w_out, h_out;
     AVPixelFormat fmt_in, fmt_out;
     ColorRange range_in, range_out;
+    ColorSpace cs_in;
     int brightness, contrast, saturation;
+    int threads;
     bool update_data;
     QByteArray data_out;
     QVector<quint8*> bits;
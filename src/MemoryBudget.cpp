@@ -0,0 +1,236 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#include "QtAV/MemoryBudget.h"
+#include <QtCore/QMutex>
+#include "QtAV/VideoFrame.h"
+#include "utils/SPSCQueue.h"
+#include "utils/Logger.h"
+
+namespace QtAV {
+
+class MemoryBudget::Account::Private
+{
+public:
+    Private(Stage s, const void* o, int st)
+        : stage(s)
+        , owner(o)
+        , stream(st)
+        , bytes(0)
+        , peak(0)
+    {}
+    // a queue account is increased by the producer and decreased by the consumer
+    void updatePeak(qint64 value) {
+        qint64 p = spsc::loadAcquire(peak);
+        while (value > p && !peak.testAndSetOrdered(p, value))
+            p = spsc::loadAcquire(peak);
+    }
+    Stage stage;
+    const void* owner; // guarded by registry mutex
+    int stream;
+    spsc::AtomicInt64 bytes;
+    spsc::AtomicInt64 peak;
+};
+
+namespace {
+static const qint64 kDefaultLimitMB = 512;
+
+static qint64 defaultLimit()
+{
+    const QByteArray mb(qgetenv("QTAV_MEMORY_BUDGET_MB"));
+    return (mb.isEmpty() ? kDefaultLimitMB : mb.toLongLong())*1024LL*1024LL;
+}
+
+class Registry
+{
+public:
+    Registry()
+        : limit(defaultLimit())
+        , total(0)
+    {
+        for (int i = 0; i < MemoryBudget::StageCount; ++i)
+            stage_total[i].fetchAndStoreRelaxed(0);
+    }
+    QMutex mutex;
+    QList<MemoryBudget::Account::Private*> accounts;
+    // updated without lock
+    spsc::AtomicInt64 limit;
+    spsc::AtomicInt64 total;
+    spsc::AtomicInt64 stage_total[MemoryBudget::StageCount];
+};
+Q_GLOBAL_STATIC(Registry, registry)
+} //namespace
+
+void MemoryBudget::setLimit(qint64 bytes)
+{
+    Registry *r = registry();
+    if (!r)
+        return;
+    r->limit.fetchAndStoreOrdered(qMax<qint64>(0LL, bytes));
+}
+
+qint64 MemoryBudget::limit()
+{
+    Registry *r = registry();
+    return r ? spsc::loadAcquire(r->limit) : 0;
+}
+
+MemoryBudget::Pressure MemoryBudget::pressure()
+{
+    Registry *r = registry();
+    if (!r)
+        return Normal;
+    const qint64 max = spsc::loadAcquire(r->limit);
+    if (max <= 0)
+        return Normal;
+    const qint64 t = spsc::loadAcquire(r->total);
+    if (t >= max)
+        return Critical;
+    if (t >= max/5LL*4LL)
+        return High;
+    return Normal;
+}
+
+qint64 MemoryBudget::total()
+{
+    Registry *r = registry();
+    return r ? spsc::loadAcquire(r->total) : 0;
+}
+
+qint64 MemoryBudget::total(Stage stage)
+{
+    Registry *r = registry();
+    if (!r || stage < 0 || stage >= StageCount)
+        return 0;
+    return spsc::loadAcquire(r->stage_total[stage]);
+}
+
+qint64 MemoryBudget::total(const void *owner)
+{
+    Registry *r = registry();
+    if (!r)
+        return 0;
+    qint64 bytes = 0;
+    QMutexLocker lock(&r->mutex);
+    Q_UNUSED(lock);
+    foreach (const Account::Private* a, r->accounts) {
+        if (a->owner == owner)
+            bytes += spsc::loadAcquire(a->bytes);
+    }
+    return bytes;
+}
+
+QList<MemoryBudget::Usage> MemoryBudget::usage()
+{
+    QList<Usage> u;
+    Registry *r = registry();
+    if (!r)
+        return u;
+    QMutexLocker lock(&r->mutex);
+    Q_UNUSED(lock);
+    foreach (const Account::Private* a, r->accounts) {
+        Usage au;
+        au.owner = a->owner;
+        au.stream = a->stream;
+        au.stage = a->stage;
+        au.bytes = spsc::loadAcquire(a->bytes);
+        au.peak = spsc::loadAcquire(a->peak);
+        u.append(au);
+    }
+    return u;
+}
+
+qint64 MemoryBudget::frameBytes(const VideoFrame &frame)
+{
+    if (!frame.isValid() || !frame.constBits(0))
+        return 0;
+    qint64 bytes = 0;
+    for (int i = 0; i < frame.planeCount(); ++i)
+        bytes += qint64(frame.bytesPerLine(i))*qint64(frame.planeHeight(i));
+    return bytes;
+}
+
+MemoryBudget::Account::Account(Stage stage, const void *owner, int stream)
+    : d(new Private(stage, owner, stream))
+{
+    Registry *r = registry();
+    if (!r)
+        return;
+    QMutexLocker lock(&r->mutex);
+    Q_UNUSED(lock);
+    r->accounts.append(d);
+}
+
+MemoryBudget::Account::~Account()
+{
+    set(0);
+    Registry *r = registry();
+    if (r) {
+        QMutexLocker lock(&r->mutex);
+        Q_UNUSED(lock);
+        r->accounts.removeOne(d);
+    }
+    delete d;
+}
+
+void MemoryBudget::Account::setOwner(const void *owner, int stream)
+{
+    Registry *r = registry();
+    if (!r) {
+        d->owner = owner;
+        d->stream = stream;
+        return;
+    }
+    QMutexLocker lock(&r->mutex);
+    Q_UNUSED(lock);
+    d->owner = owner;
+    d->stream = stream;
+}
+
+void MemoryBudget::Account::add(qint64 bytes)
+{
+    if (!bytes)
+        return;
+    d->updatePeak(d->bytes.fetchAndAddOrdered(bytes) + bytes);
+    Registry *r = registry();
+    if (!r)
+        return;
+    r->total.fetchAndAddOrdered(bytes);
+    r->stage_total[d->stage].fetchAndAddOrdered(bytes);
+}
+
+void MemoryBudget::Account::set(qint64 bytes)
+{
+    const qint64 old = d->bytes.fetchAndStoreOrdered(bytes);
+    d->updatePeak(bytes);
+    Registry *r = registry();
+    if (!r || old == bytes)
+        return;
+    r->total.fetchAndAddOrdered(bytes - old);
+    r->stage_total[d->stage].fetchAndAddOrdered(bytes - old);
+}
+
+qint64 MemoryBudget::Account::bytes() const
+{
+    return spsc::loadAcquire(d->bytes);
+}
+
+} //namespace QtAV
@@ -20,6 +20,7 @@
 ******************************************************************************/
 
 #include "QtAV/Packet.h"
+#include "PacketPool.h"
 #include "QtAV/private/AVCompat.h"
 #include "utils/Logger.h"
 
@@ -32,18 +33,41 @@ static const struct RegisterMetaTypes {
 } _registerMetaTypes;
 } //namespace
 
+struct PacketPool::Block {
+    PacketPool *pool;
+    Block *next;
+    // raw data header of the last packet in this block. reused by setRawData() if the packet's data is released
+    QByteArray data;
+    void *reserved; // keep sizeof(Block) a multiple of 8 for AVPacket
+    static Block* create(size_t size) {
+        return new (::operator new(sizeof(Block) + size)) Block();
+    }
+    static void destroy(Block* b) {
+        b->~Block();
+        ::operator delete(b);
+    }
+    static Block* of(void* ptr) {
+        return static_cast<Block*>(ptr) - 1;
+    }
+private:
+    Block() : pool(0), next(0), reserved(0) {}
+    ~Block() {}
+};
+
 class PacketPrivate : public QSharedData
 {
 public:
     PacketPrivate()
         : QSharedData()
         , initialized(false)
+        , read_time(0)
     {
         av_init_packet(&avpkt);
     }
     PacketPrivate(const PacketPrivate& o)
         : QSharedData(o)
         , initialized(o.initialized)
+        , read_time(o.read_time)
     { //used by QSharedDataPointer.detach()
         av_init_packet(&avpkt);
         av_packet_ref(&avpkt, (AVPacket*)&o.avpkt);
@@ -51,10 +75,118 @@ public:
      ~PacketPrivate() {
         av_packet_unref(&avpkt);
     }
+    // every PacketPrivate has a block header. pool is 0 if not allocated from a PacketPool
+    static void* operator new(size_t size) {
+        return PacketPool::Block::create(size) + 1;
+    }
+    static void* operator new(size_t size, PacketPool* pool) {
+        return pool->alloc(size);
+    }
+    static void operator delete(void* ptr) {
+        if (!ptr)
+            return;
+        PacketPool::Block *b = PacketPool::Block::of(ptr);
+        if (b->pool)
+            b->pool->recycle(b);
+        else
+            PacketPool::Block::destroy(b);
+    }
+    static void operator delete(void* ptr, PacketPool*) { // called if ctor throws
+        operator delete(ptr);
+    }
     bool initialized;
+    qint64 read_time;
     AVPacket avpkt;
 };
 
+PacketPool* PacketPool::create(int maxFree)
+{
+    return new PacketPool(maxFree);
+}
+
+PacketPool::PacketPool(int maxFree)
+    : m_ref(1)
+    , m_free(0)
+    , m_nb_free(0)
+    , m_max_free(maxFree)
+    , m_hits(0)
+    , m_misses(0)
+{}
+
+PacketPool::~PacketPool()
+{
+    while (m_free) {
+        Block *b = m_free;
+        m_free = b->next;
+        Block::destroy(b);
+    }
+}
+
+void PacketPool::ref()
+{
+    m_ref.ref();
+}
+
+void PacketPool::deref()
+{
+    if (!m_ref.deref())
+        delete this;
+}
+
+qint64 PacketPool::hits() const
+{
+    QMutexLocker lock(&m_mutex);
+    Q_UNUSED(lock);
+    return m_hits;
+}
+
+qint64 PacketPool::misses() const
+{
+    QMutexLocker lock(&m_mutex);
+    Q_UNUSED(lock);
+    return m_misses;
+}
+
+void* PacketPool::alloc(size_t size)
+{
+    Block *b = 0;
+    {
+        QMutexLocker lock(&m_mutex);
+        Q_UNUSED(lock);
+        if (m_free) {
+            b = m_free;
+            m_free = b->next;
+            --m_nb_free;
+            ++m_hits;
+        } else {
+            ++m_misses;
+        }
+    }
+    if (!b)
+        b = Block::create(size);
+    b->pool = this;
+    b->next = 0;
+    ref(); // released in recycle()
+    return b + 1;
+}
+
+void PacketPool::recycle(Block *b)
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        Q_UNUSED(lock);
+        if (m_nb_free < m_max_free) {
+            b->next = m_free;
+            m_free = b;
+            ++m_nb_free;
+            b = 0;
+        }
+    }
+    if (b)
+        Block::destroy(b);
+    deref(); // may delete this if owner is gone
+}
+
 Packet Packet::createEOF()
 {
     Packet pkt;
@@ -76,11 +208,8 @@ Packet Packet::fromAVPacket(const AVPacket *avpkt, double time_base)
 }
 
 // time_base: av_q2d(format_context->streams[stream_idx]->time_base)
-bool Packet::fromAVPacket(Packet* pkt, const AVPacket *avpkt, double time_base)
+static void setPacketProperties(Packet* pkt, const AVPacket *avpkt, double time_base)
 {
-    if (!pkt || !avpkt)
-        return false;
-
     pkt->position = avpkt->pos;
     pkt->hasKeyFrame = !!(avpkt->flags & AV_PKT_FLAG_KEY);
     // what about marking avpkt as invalid and do not use isCorrupt?
@@ -120,6 +249,13 @@ bool Packet::fromAVPacket(Packet* pkt, const AVPacket *avpkt, double time_base)
         pkt->duration = avpkt->convergence_duration * time_base;
 #endif
     //qDebug("AVPacket.pts=%f, duration=%f, dts=%lld", pkt->pts, pkt->duration, packet.dts);
+}
+
+bool Packet::fromAVPacket(Packet* pkt, const AVPacket *avpkt, double time_base)
+{
+    if (!pkt || !avpkt)
+        return false;
+    setPacketProperties(pkt, avpkt, time_base);
     pkt->data.clear();
     // TODO: pkt->avpkt. data is not necessary now. see mpv new_demux_packet_from_avpacket
     // copy properties and side data. does not touch data, size and ref
@@ -136,6 +272,31 @@ bool Packet::fromAVPacket(Packet* pkt, const AVPacket *avpkt, double time_base)
     return true;
 }
 
+bool PacketPool::fromAVPacket(Packet *pkt, AVPacket *avpkt, double time_base)
+{
+    if (!pkt || !avpkt)
+        return false;
+    setPacketProperties(pkt, avpkt, time_base);
+    pkt->data.clear();
+    pkt->d = QSharedDataPointer<PacketPrivate>(new (this) PacketPrivate());
+    pkt->d->initialized = true;
+    AVPacket *p = &pkt->d->avpkt;
+#if AV_MODULE_CHECK(LIBAVCODEC, 57, 8, 0, 12, 100)
+    av_packet_move_ref(p, avpkt); // no AVBufferRef and side data copy
+#else
+    av_packet_ref(p, avpkt);
+    av_packet_unref(avpkt);
+#endif
+    // Packet.data of the previous packet in this block is usually destroyed with it, then the header is not shared and is reused
+    QByteArray &data = Block::of(pkt->d.data())->data;
+    data.setRawData((const char*)p->data, p->size);
+    pkt->data = data;
+    p->pts = pkt->pts * 1000.0;
+    p->dts = pkt->dts * 1000.0;
+    p->duration = pkt->duration * 1000.0;
+    return true;
+}
+
 Packet::Packet()
     : hasKeyFrame(false)
     , isCorrupt(false)
@@ -219,6 +380,20 @@ void Packet::skip(int bytes)
     // TODO: if duration is valid, compute pts/dts and no manually update outside?
 }
 
+void Packet::setReadTime(qint64 value)
+{
+    if (!d.constData()) { //not constructed from AVPacket
+        d = QSharedDataPointer<PacketPrivate>(new PacketPrivate());
+    }
+    // no detach. the packet is usually shared with AVDemuxer, a copy of avpkt would bypass PacketPool
+    const_cast<PacketPrivate*>(d.constData())->read_time = value;
+}
+
+qint64 Packet::readTime() const
+{
+    return d.constData() ? d.constData()->read_time : 0;
+}
+
 #ifndef QT_NO_DEBUG_STREAM
 QDebug operator<<(QDebug dbg, const Packet &pkt)
 {
@@ -20,18 +20,35 @@
 ******************************************************************************/
 
 #include "PacketBuffer.h"
+#include <limits>
+#include <QtCore/qmath.h>
 #include <QtCore/QDateTime>
 
 namespace QtAV {
 static const int kAvgSize = 16;
+static const qint64 kWindow = 500; // ms
+static const int kRateSize = 16;
+static const int kCriticalPackets = 4; // full if memory budget is exhausted
 PacketBuffer::PacketBuffer()
     : m_mode(BufferTime)
-    , m_buffering(true) // in buffering state at the beginning
+    , m_buffering(1) // in buffering state at the beginning
     , m_max(1.5)
     , m_buffer(0)
     , m_value0(0)
     , m_value1(0)
+    , m_bytes(0)
     , m_history(kAvgSize)
+    , m_adaptive(false)
+    , m_factor(1000)
+    , m_underruns(0)
+    , m_underruns_seen(0)
+    , m_boost(1.0)
+    , m_decode_ratio(0)
+    , m_window_t(0)
+    , m_window_bytes(0)
+    , m_window_full(false)
+    , m_rates(kRateSize)
+    , m_memory(MemoryBudget::Packets)
 {
 }
 
@@ -39,18 +56,14 @@ PacketBuffer::~PacketBuffer()
 {
 }
 
+void PacketBuffer::setMemoryOwner(const void *owner, int stream)
+{
+    m_memory.setOwner(owner, stream);
+}
+
 void PacketBuffer::setBufferMode(BufferMode mode)
 {
     m_mode = mode;
-    if (queue.isEmpty()) {
-        m_value0 = m_value1 = 0;
-        return;
-    }
-    if (m_mode == BufferTime) {
-        m_value0 = qint64(queue[0].pts*1000.0);
-    } else {
-        m_value0 = 0;
-    }
 }
 
 BufferMode PacketBuffer::bufferMode() const
@@ -84,18 +97,24 @@ qreal PacketBuffer::bufferMax() const
 
 qint64 PacketBuffer::buffered() const
 {
-    Q_ASSERT(m_value1 >= m_value0);
-    return m_value1 - m_value0;
+    if (m_mode == BufferPackets)
+        return qMax(0, size());
+    if (m_mode == BufferBytes)
+        return qMax<qint64>(0, spsc::loadAcquire(m_bytes));
+    if (checkEmpty())
+        return 0;
+    // head and tail are updated in different threads. pts can also be out of order
+    return qMax<qint64>(0, spsc::loadAcquire(m_value1) - spsc::loadAcquire(m_value0));
 }
 
 bool PacketBuffer::isBuffering() const
 {
-    return m_buffering;
+    return spsc::loadAcquire(m_buffering);
 }
 
 qreal PacketBuffer::bufferProgress() const
 {
-    const qreal p = qreal(buffered())/qreal(bufferValue());
+    const qreal p = qreal(buffered())/qreal(targetValue());
     return qMax<qreal>(qMin<qreal>(p, 1.0), 0.0);
 }
 
@@ -109,34 +128,75 @@ qreal PacketBuffer::bufferSpeedInBytes() const
     return calc_speed(true);
 }
 
+void PacketBuffer::setAdaptive(bool value)
+{
+    if (m_adaptive == value)
+        return;
+    m_adaptive = value;
+    m_factor.fetchAndStoreOrdered(1000);
+    m_boost = 1.0;
+    m_window_t = 0;
+    m_rates = ring<qint64>(kRateSize);
+}
+
+bool PacketBuffer::isAdaptive() const
+{
+    return m_adaptive;
+}
+
+qint64 PacketBuffer::targetValue() const
+{
+    if (!m_adaptive || m_buffer == std::numeric_limits<qint64>::max())
+        return m_buffer;
+    return qMax<qint64>(1LL, qint64(qreal(m_buffer)*qreal(spsc::loadAcquire(m_factor))/1000.0));
+}
+
+void PacketBuffer::setDecodeRatio(qreal value)
+{
+    m_decode_ratio = value;
+}
+
+qint64 PacketBuffer::memoryUsage()
+{
+    return MemoryBudget::total(MemoryBudget::Packets);
+}
+
 bool PacketBuffer::checkEnough() const
 {
-    return buffered() >= bufferValue();
+    // the lowest buffering level if memory budget is exhausted
+    if (MemoryBudget::pressure() == MemoryBudget::Critical)
+        return !checkEmpty();
+    return buffered() >= targetValue();
 }
 
 bool PacketBuffer::checkFull() const
 {
-    return buffered() >= qint64(qreal(bufferValue())*bufferMax());
+    const MemoryBudget::Pressure pressure = MemoryBudget::pressure();
+    if (pressure == MemoryBudget::Critical)
+        return size() >= kCriticalPackets;
+    // no headroom over the buffer value if memory budget is nearly exhausted
+    const qint64 full = pressure == MemoryBudget::High ? targetValue() : qint64(qreal(targetValue())*bufferMax());
+    return buffered() >= full;
 }
 
 void PacketBuffer::onPut(const Packet &p)
 {
-    if (m_mode == BufferTime) {
-        m_value1 = qint64(p.pts*1000.0); // FIXME: what if no pts
-        m_value0 = qint64(queue[0].pts*1000.0); // must compute here because it is reset to 0 if take from empty
-        //if (isBuffering())
-          //  qDebug("+buffering progress: %.1f%%=%.1f/%.1f~%.1fs %d-%d", bufferProgress()*100.0, (qreal)buffered()/1000.0, (qreal)bufferValue()/1000.0, qreal(bufferValue())*bufferMax()/1000.0, m_value1, m_value0);
-    } else if (m_mode == BufferBytes) {
-        m_value1 += p.data.size();
-    } else {
-        m_value1++;
-    }
-    if (!m_buffering)
+    m_bytes.fetchAndAddOrdered(p.data.size());
+    m_memory.add(p.data.size());
+    if (m_adaptive)
+        updateAdaptive(p);
+    m_value1.fetchAndStoreOrdered(qint64(p.pts*1000.0)); // FIXME: what if no pts
+    // p is the head if queue was empty. otherwise head is updated by consumer in onTake()
+    if (size() <= 1)
+        m_value0.fetchAndStoreOrdered(qint64(p.pts*1000.0));
+    //if (isBuffering())
+      //  qDebug("+buffering progress: %.1f%%=%.1f/%.1f~%.1fs", bufferProgress()*100.0, (qreal)buffered()/1000.0, (qreal)bufferValue()/1000.0, qreal(bufferValue())*bufferMax()/1000.0);
+    if (!isBuffering())
         return;
     if (checkEnough()) {
-        m_buffering = false;
+        m_buffering.fetchAndStoreOrdered(0);
     }
-    if (!m_buffering) { //buffering=>buffered
+    if (!isBuffering()) { //buffering=>buffered
         m_history = ring<BufferInfo>(kAvgSize);
         return;
     }
@@ -144,7 +204,7 @@ void PacketBuffer::onPut(const Packet &p)
     bi.bytes = p.data.size();
     if (!m_history.empty())
         bi.bytes += m_history.back().bytes;
-    bi.v = m_value1;
+    bi.v = m_mode == BufferTime ? spsc::loadAcquire(m_value1) : buffered();
     bi.t = QDateTime::currentMSecsSinceEpoch();
     m_history.push_back(bi);
 }
@@ -152,23 +212,17 @@ void PacketBuffer::onPut(const Packet &p)
 void PacketBuffer::onTake(const Packet &p)
 {
     if (checkEmpty()) {
-        m_buffering = true;
-    }
-    if (queue.isEmpty()) {
-        m_value0 = 0;
-        m_value1 = 0;
-        return;
-    }
-    if (m_mode == BufferTime) {
-        m_value0 = qint64(queue[0].pts*1000.0);
-        //if (isBuffering())
-          //  qDebug("-buffering progress: %.1f=%.1f/%.1fs", bufferProgress(), (qreal)buffered()/1000.0, (qreal)bufferValue()/1000.0);
-    } else if (m_mode == BufferBytes) {
-        m_value1 -= p.data.size();
-        m_value1 = qMax<qint64>(0LL, m_value1);
-    } else {
-        m_value1--;
+        if (!m_buffering.fetchAndStoreOrdered(1))
+            m_underruns.ref(); // including seek and eof
     }
+    // the counter can be negative for a while if producer has not added p.data.size()
+    m_bytes.fetchAndAddOrdered(-p.data.size());
+    m_memory.add(-p.data.size());
+    const Packet *next = head();
+    if (next)
+        m_value0.fetchAndStoreOrdered(qint64(next->pts*1000.0));
+    //if (isBuffering())
+      //  qDebug("-buffering progress: %.1f=%.1f/%.1fs", bufferProgress(), (qreal)buffered()/1000.0, (qreal)bufferValue()/1000.0);
 }
 
 qreal PacketBuffer::calc_speed(bool use_bytes) const
@@ -186,4 +240,63 @@ qreal PacketBuffer::calc_speed(bool use_bytes) const
     }
     return (qreal)delta/dt;
 }
+
+void PacketBuffer::updateAdaptive(const Packet &p)
+{
+    const qint64 t = QDateTime::currentMSecsSinceEpoch();
+    m_window_bytes += p.data.size();
+    // producer may be blocked by a full queue, then the rate is not the input rate
+    m_window_full |= checkFull();
+    if (m_window_t <= 0) {
+        m_window_t = t;
+        return;
+    }
+    if (t - m_window_t < kWindow)
+        return;
+    if (!m_window_full)
+        m_rates.push_back(m_window_bytes*1000LL/(t - m_window_t));
+    m_window_t = t;
+    m_window_bytes = 0;
+    m_window_full = false;
+    // a jittery input needs more headroom
+    qreal jitter = 1.0;
+    if (m_rates.size() >= 3) {
+        qreal mean = 0;
+        for (size_t i = 0; i < m_rates.size(); ++i)
+            mean += m_rates.at(i);
+        mean /= qreal(m_rates.size());
+        qreal var = 0;
+        for (size_t i = 0; i < m_rates.size(); ++i)
+            var += (m_rates.at(i) - mean)*(m_rates.at(i) - mean);
+        var /= qreal(m_rates.size());
+        if (mean > 0)
+            jitter = qBound<qreal>(1.0, 1.0 + 2.0*qSqrt(var)/mean, 3.0);
+    }
+    // grow on underrun, and shrink back slowly
+    const int underruns = spsc::loadAcquire(m_underruns);
+    for (; m_underruns_seen != underruns; ++m_underruns_seen)
+        m_boost = qMin<qreal>(m_boost*1.5, 4.0);
+    m_boost = qMax<qreal>(1.0, m_boost*0.98);
+    // a slow decoder can not refill the output quickly after a stall, a fast one needs less
+    qreal dec = 1.0;
+    const qreal r = m_decode_ratio;
+    if (r > 0 && r < 1.2)
+        dec = 1.5;
+    else if (r > 4.0)
+        dec = 0.75;
+    qreal f = qBound<qreal>(0.5, jitter*m_boost*dec, 4.0);
+    // bytes of a full queue must fit in the rest of the memory limit. a high bitrate stream gets a smaller target
+    const qint64 bytes = spsc::loadAcquire(m_bytes);
+    const qint64 value = buffered();
+    qreal avail = -1;
+    if (MemoryBudget::limit() > 0)
+        avail = qreal(bytes + MemoryBudget::limit() - MemoryBudget::total());
+    if (avail >= 0 && bytes > 0 && value > 0 && m_buffer > 0 && m_buffer != std::numeric_limits<qint64>::max()) {
+        const qreal bytes_per_value = qreal(bytes)/qreal(value);
+        f = qMin(f, avail/(bytes_per_value*qreal(m_buffer)*m_max));
+        f = qMax(f, 1.0/qreal(m_buffer)); // at least 1
+    }
+    m_factor.fetchAndStoreOrdered(int(f*1000.0));
+}
+
 } //namespace QtAV
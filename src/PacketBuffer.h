@@ -22,9 +22,9 @@
 #ifndef QTAV_PACKETBUFFER_H
 #define QTAV_PACKETBUFFER_H
 
-#include <QtCore/QQueue>
+#include <QtAV/MemoryBudget.h>
 #include <QtAV/Packet.h>
-#include "utils/BlockingQueue.h"
+#include "utils/SPSCQueue.h"
 #include "utils/ring.h"
 
 namespace QtAV {
@@ -34,8 +34,10 @@ namespace QtAV {
  * take enough: start to put more packets
  * put enough: end buffering, end take block
  * put full: stop putting more packets
+ * packets are put by demux thread and taken by a/v thread, so a single producer single consumer queue is used.
+ * buffered values are atomic because they are updated in both threads.
  */
-class PacketBuffer : public BlockingQueue<Packet, QQueue>
+class PacketBuffer : public SPSCQueue<Packet>
 {
 public:
     PacketBuffer();
@@ -77,13 +79,35 @@ public:
      */
     qreal bufferSpeed() const;
     qreal bufferSpeedInBytes() const;
+    /*!
+     * \brief setAdaptive
+     * Scale bufferValue() in [0.5, 4] by input throughput variance, underruns and decode speed, and keep the bytes
+     * the queue can hold within MemoryBudget::limit(). The scale is updated by the producer every 500ms.
+     * Default is false
+     */
+    void setAdaptive(bool value);
+    bool isAdaptive() const;
+    /*!
+     * \brief targetValue
+     * The real buffer value used to check enough and full. bufferValue() scaled if isAdaptive()
+     */
+    qint64 targetValue() const;
+    /*!
+     * \brief setDecodeRatio
+     * Decoding speed of the consumer. <1.0 means slower than realtime. <=0: unknown
+     */
+    void setDecodeRatio(qreal value);
+    /// bytes of packets in all PacketBuffers
+    static qint64 memoryUsage();
+    /// tag the packets in MemoryBudget. owner is usually the player
+    void setMemoryOwner(const void* owner, int stream);
 protected:
     bool checkEnough() const Q_DECL_OVERRIDE;
     bool checkFull() const Q_DECL_OVERRIDE;
     void onTake(const Packet &) Q_DECL_OVERRIDE;
     void onPut(const Packet &) Q_DECL_OVERRIDE;
 protected:
-    typedef BlockingQueue<Packet, QQueue> PQ;
+    typedef SPSCQueue<Packet> PQ;
     using PQ::setCapacity;
     using PQ::setThreshold;
     using PQ::capacity;
@@ -91,19 +115,32 @@ protected:
 
 private:
     qreal calc_speed(bool use_bytes) const;
+    void updateAdaptive(const Packet &p);
 
     BufferMode m_mode;
-    bool m_buffering;
+    QAtomicInt m_buffering;
     qreal m_max;
     // bytes or count
     qint64 m_buffer;
-    qint64 m_value0, m_value1;
+    // head and tail pts in ms, and queued bytes. always updated so that buffer mode can be changed at any time
+    spsc::AtomicInt64 m_value0, m_value1, m_bytes;
     typedef struct {
         qint64 v; //pts, total packes or total bytes
         qint64 bytes; //total bytes
         qint64 t;
     } BufferInfo;
     ring<BufferInfo> m_history;
+    // adaptive. m_factor is read by both threads, others are updated by producer except underruns and decode ratio
+    bool m_adaptive;
+    QAtomicInt m_factor; // 1/1000
+    QAtomicInt m_underruns;
+    int m_underruns_seen;
+    qreal m_boost;
+    volatile qreal m_decode_ratio;
+    qint64 m_window_t, m_window_bytes;
+    bool m_window_full;
+    ring<qint64> m_rates; // input bytes/s of the windows the producer was not blocked
+    MemoryBudget::Account m_memory;
 };
 
 } //namespace QtAV
@@ -0,0 +1,374 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#include "PacketIndex.h"
+#include <algorithm>
+#include <string.h>
+#include <QtCore/QDataStream>
+#include <QtCore/QFile>
+#include <QtCore/QRunnable>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
+#include "QtAV/private/AVCompat.h"
+#include "utils/Logger.h"
+
+namespace QtAV {
+
+Q_GLOBAL_STATIC(QThreadPool, indexThreadPool)
+
+static const quint32 kIndexMagic = 0x51415649; // QAVI
+static const quint32 kIndexVersion = 1;
+
+const qint64 PacketIndex::kNoTimestamp = AV_NOPTS_VALUE;
+
+static int interruptCallback(void* opaque)
+{
+    return static_cast<PacketIndex*>(opaque)->isAborted();
+}
+
+class PacketIndexBuilder : public QRunnable
+{
+public:
+    PacketIndexBuilder(const QSharedPointer<PacketIndex>& index, const QString& url, AVInputFormat* fmt)
+        : m_index(index)
+        , m_url(url)
+        , m_fmt(fmt)
+    {}
+    void run() Q_DECL_OVERRIDE {
+        // do not compete with playback
+        QThread::currentThread()->setPriority(QThread::LowPriority);
+        AVFormatContext *ctx = avformat_alloc_context();
+        ctx->interrupt_callback.callback = interruptCallback;
+        ctx->interrupt_callback.opaque = m_index.data();
+        if (avformat_open_input(&ctx, m_url.toUtf8().constData(), m_fmt, NULL) < 0) {
+            qWarning("PacketIndex: failed to open %s", m_url.toUtf8().constData());
+            return;
+        }
+        const int s = m_index->stream();
+        for (int i = 0; i < (int)ctx->nb_streams; ++i) {
+            if (i != s)
+                ctx->streams[i]->discard = AVDISCARD_ALL;
+        }
+        const AVRational tb = { m_index->timeBaseNum(), m_index->timeBaseDen() };
+        QVector<PacketIndex::Entry> entries;
+        entries.reserve(1024);
+        AVPacket pkt;
+        av_init_packet(&pkt);
+        pkt.data = NULL;
+        pkt.size = 0;
+        bool eof = false;
+        while (!m_index->isAborted()) {
+            const int ret = av_read_frame(ctx, &pkt);
+            if (ret == AVERROR(EAGAIN))
+                continue;
+            if (ret < 0) {
+                eof = ret == AVERROR_EOF || avio_feof(ctx->pb);
+                break;
+            }
+            if (pkt.stream_index == s && (pkt.dts != (int64_t)AV_NOPTS_VALUE || pkt.pts != (int64_t)AV_NOPTS_VALUE)) {
+                const AVRational stb = ctx->streams[s]->time_base;
+                PacketIndex::Entry e;
+                e.dts = pkt.dts != (int64_t)AV_NOPTS_VALUE ? pkt.dts : pkt.pts;
+                e.pts = pkt.pts;
+                if (av_cmp_q(stb, tb)) {
+                    e.dts = av_rescale_q(e.dts, stb, tb);
+                    if (e.pts != kNoTimestamp)
+                        e.pts = av_rescale_q(e.pts, stb, tb);
+                }
+                e.pos = pkt.pos;
+                e.size = pkt.size;
+                e.key = !!(pkt.flags & AV_PKT_FLAG_KEY);
+                entries.append(e);
+                if (entries.size() >= 1024) {
+                    m_index->append(entries);
+                    entries.clear();
+                }
+            }
+            av_packet_unref(&pkt);
+        }
+        m_index->append(entries);
+        if (eof && !m_index->isAborted())
+            m_index->setReady();
+        avformat_close_input(&ctx);
+    }
+private:
+    QSharedPointer<PacketIndex> m_index;
+    QString m_url;
+    AVInputFormat *m_fmt;
+};
+
+// sort entries by pts
+class PtsLess
+{
+public:
+    PtsLess(const QVector<PacketIndex::Entry>& e) : entries(e) {}
+    bool operator()(int a, int b) const { return entries[a].pts < entries[b].pts;}
+private:
+    const QVector<PacketIndex::Entry>& entries;
+};
+
+PacketIndex::PacketIndex(int stream, int tbNum, int tbDen)
+    : m_stream(stream)
+    , m_tb_num(tbNum)
+    , m_tb_den(tbDen)
+    , m_abort(false)
+    , m_ready(false)
+{}
+
+bool PacketIndex::fromStream(AVFormatContext *ctx)
+{
+    // only mov index has every sample. indexes of other formats are built while reading or contain key frames only
+    if (!ctx || !ctx->iformat || !strstr(ctx->iformat->name, "mov") || m_stream < 0 || m_stream >= (int)ctx->nb_streams)
+        return false;
+    AVStream *st = ctx->streams[m_stream];
+    // pts = dts + composition offset (ctts), which is not exported by libavformat. read packets if frames are reordered
+    if (st->codec && st->codec->has_b_frames > 0) {
+        qDebug("PacketIndex: stream %d has reordered frames. container index has no pts", m_stream);
+        return false;
+    }
+#if FFMPEG_MODULE_CHECK(LIBAVFORMAT, 58, 78, 100)
+    const int n = avformat_index_get_entries_count(st);
+#else
+    const int n = st->nb_index_entries;
+#endif
+    if (n <= 0)
+        return false;
+    QVector<Entry> entries(n);
+    for (int i = 0; i < n; ++i) {
+#if FFMPEG_MODULE_CHECK(LIBAVFORMAT, 58, 78, 100)
+        const AVIndexEntry *ie = avformat_index_get_entry(st, i);
+#else
+        const AVIndexEntry *ie = &st->index_entries[i];
+#endif
+        Entry &e = entries[i];
+        e.dts = ie->timestamp;
+        e.pts = kNoTimestamp; // resolved in setReady()
+        e.pos = ie->pos;
+        e.size = ie->size;
+        e.key = !!(ie->flags & AVINDEX_KEYFRAME);
+    }
+    append(entries);
+    setReady();
+    return true;
+}
+
+void PacketIndex::build(const QSharedPointer<PacketIndex> &index, const QString &url, AVInputFormat *fmt)
+{
+    indexThreadPool()->start(new PacketIndexBuilder(index, url, fmt));
+}
+
+void PacketIndex::abort()
+{
+    m_abort = true;
+}
+
+bool PacketIndex::isAborted() const
+{
+    return m_abort;
+}
+
+bool PacketIndex::isReady() const
+{
+    return m_ready;
+}
+
+void PacketIndex::append(const QVector<Entry> &entries)
+{
+    if (entries.isEmpty())
+        return;
+    QMutexLocker lock(&m_mutex);
+    Q_UNUSED(lock);
+    for (int i = 0; i < entries.size(); ++i) {
+        if (entries[i].key)
+            m_keys.append(m_entries.size() + i);
+    }
+    m_entries += entries;
+}
+
+void PacketIndex::setReady()
+{
+    QMutexLocker lock(&m_mutex);
+    Q_UNUSED(lock);
+    resolvePts();
+    m_order.resize(m_entries.size());
+    for (int i = 0; i < m_order.size(); ++i)
+        m_order[i] = i;
+    std::sort(m_order.begin(), m_order.end(), PtsLess(m_entries));
+    m_ready = true;
+}
+
+void PacketIndex::resolvePts()
+{
+    // exact if frames are not reordered (fromStream()). packets without pts read by build() are rare (e.g. avi), dts is the best guess
+    for (int i = 0; i < m_entries.size(); ++i) {
+        Entry &e = m_entries[i];
+        if (e.pts == kNoTimestamp)
+            e.pts = e.dts;
+    }
+}
+
+qint64 PacketIndex::toTimeBase(qint64 ms) const
+{
+    return av_rescale(ms, m_tb_den, 1000LL*m_tb_num);
+}
+
+int PacketIndex::keyFrameIndex(qint64 ts) const
+{
+    // key frame pts increases in decoding order
+    int lo = 0, hi = m_keys.size();
+    while (lo < hi) {
+        const int mid = (lo + hi)/2;
+        if (m_entries[m_keys[mid]].pts <= ts)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo > 0 ? m_keys[lo - 1] : -1;
+}
+
+bool PacketIndex::findKeyFrame(qint64 pos, Entry *e) const
+{
+    if (!isReady())
+        return false;
+    QMutexLocker lock(&m_mutex);
+    Q_UNUSED(lock);
+    const int k = keyFrameIndex(toTimeBase(pos));
+    if (k < 0)
+        return false;
+    if (e)
+        *e = m_entries[k];
+    return true;
+}
+
+bool PacketIndex::findPreviousFrame(qint64 pos, Entry *e) const
+{
+    if (!isReady())
+        return false;
+    QMutexLocker lock(&m_mutex);
+    Q_UNUSED(lock);
+    const qint64 ts = toTimeBase(pos);
+    int lo = 0, hi = m_order.size();
+    while (lo < hi) {
+        const int mid = (lo + hi)/2;
+        if (m_entries[m_order[mid]].pts < ts)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == 0)
+        return false;
+    if (e)
+        *e = m_entries[m_order[lo - 1]];
+    return true;
+}
+
+int PacketIndex::framesToDecode(qint64 pos) const
+{
+    if (!isReady())
+        return -1;
+    QMutexLocker lock(&m_mutex);
+    Q_UNUSED(lock);
+    const qint64 ts = toTimeBase(pos);
+    const int k = keyFrameIndex(ts);
+    if (k < 0)
+        return -1;
+    for (int i = k; i < m_entries.size(); ++i) {
+        if (m_entries[i].pts >= ts)
+            return i - k + 1;
+    }
+    return m_entries.size() - k;
+}
+
+QVector<PacketIndex::Entry> PacketIndex::entries() const
+{
+    QMutexLocker lock(&m_mutex);
+    Q_UNUSED(lock);
+    return m_entries;
+}
+
+AVDemuxer::IndexEntry PacketIndex::toIndexEntry(const Entry &e) const
+{
+    AVDemuxer::IndexEntry ie;
+    ie.pts = av_rescale(e.pts, 1000LL*m_tb_num, m_tb_den);
+    ie.dts = av_rescale(e.dts, 1000LL*m_tb_num, m_tb_den);
+    ie.pos = e.pos;
+    ie.size = e.size;
+    ie.key = e.key;
+    return ie;
+}
+
+bool PacketIndex::save(const QString &fileName, qint64 fileSize, qint64 duration) const
+{
+    if (!isReady())
+        return false;
+    QFile f(fileName);
+    if (!f.open(QIODevice::WriteOnly)) {
+        qWarning("PacketIndex: can not open %s to write", fileName.toUtf8().constData());
+        return false;
+    }
+    QMutexLocker lock(&m_mutex);
+    Q_UNUSED(lock);
+    QDataStream ds(&f);
+    ds << kIndexMagic << kIndexVersion << (qint32)m_stream << fileSize << duration
+       << (qint32)m_tb_num << (qint32)m_tb_den << (qint32)m_entries.size();
+    foreach (const Entry& e, m_entries) {
+        ds << e.pts << e.dts << e.pos << (qint32)e.size << (quint8)e.key;
+    }
+    return ds.status() == QDataStream::Ok;
+}
+
+QSharedPointer<PacketIndex> PacketIndex::load(const QString &fileName, int stream, qint64 fileSize, qint64 duration)
+{
+    QFile f(fileName);
+    if (!f.open(QIODevice::ReadOnly))
+        return QSharedPointer<PacketIndex>();
+    QDataStream ds(&f);
+    quint32 magic = 0, version = 0;
+    qint32 s = -1, num = 0, den = 0, n = 0;
+    qint64 size = 0, dur = 0;
+    ds >> magic >> version >> s >> size >> dur >> num >> den >> n;
+    if (magic != kIndexMagic || version != kIndexVersion || ds.status() != QDataStream::Ok) {
+        qWarning("PacketIndex: invalid index file %s", fileName.toUtf8().constData());
+        return QSharedPointer<PacketIndex>();
+    }
+    if (s != stream || size != fileSize || dur != duration || num <= 0 || den <= 0 || n < 0) {
+        qDebug("PacketIndex: index file %s does not match the media", fileName.toUtf8().constData());
+        return QSharedPointer<PacketIndex>();
+    }
+    QVector<Entry> entries(n);
+    for (int i = 0; i < n; ++i) {
+        Entry &e = entries[i];
+        qint32 sz;
+        quint8 key;
+        ds >> e.pts >> e.dts >> e.pos >> sz >> key;
+        e.size = sz;
+        e.key = !!key;
+    }
+    if (ds.status() != QDataStream::Ok) {
+        qWarning("PacketIndex: truncated index file %s", fileName.toUtf8().constData());
+        return QSharedPointer<PacketIndex>();
+    }
+    QSharedPointer<PacketIndex> index(new PacketIndex(stream, num, den));
+    index->append(entries);
+    index->setReady();
+    return index;
+}
+} //namespace QtAV
@@ -0,0 +1,97 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#ifndef QTAV_PACKETINDEX_H
+#define QTAV_PACKETINDEX_H
+
+#include <QtCore/QMutex>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QVector>
+#include <QtAV/AVDemuxer.h>
+
+struct AVFormatContext;
+struct AVInputFormat;
+struct AVStream;
+
+namespace QtAV {
+
+/*!
+ * \brief The PacketIndex class
+ * Packet index of 1 stream in decoding order. Filled from the container index if it has every packet (mov/mp4),
+ * otherwise by reading the input in a background thread with another AVFormatContext.
+ * Timestamps are stored in stream time base so the exact key frame can be sought.
+ */
+class PacketIndex
+{
+public:
+    static const qint64 kNoTimestamp;
+    struct Entry {
+        qint64 pts, dts, pos; // pts, dts: stream time base. pts is kNoTimestamp if unknown, and resolved when the index is ready
+        int size;
+        bool key;
+    };
+    PacketIndex(int stream, int tbNum, int tbDen);
+    int stream() const { return m_stream;}
+    int timeBaseNum() const { return m_tb_num;}
+    int timeBaseDen() const { return m_tb_den;}
+    /*!
+     * \brief fromStream
+     * Use the index of the stream in format context if it's complete, e.g. mov. Its timestamps are dts, so it's used only
+     * if frames are not reordered. Otherwise return false and build() the index to get pts.
+     */
+    bool fromStream(AVFormatContext* ctx);
+    /*!
+     * \brief build
+     * Read packets of the stream in a background thread. The index is ready when all packets are read.
+     */
+    static void build(const QSharedPointer<PacketIndex>& index, const QString& url, AVInputFormat* fmt);
+    void abort();
+    bool isAborted() const;
+    bool isReady() const;
+    // search key frame and previous frame. pos: ms
+    bool findKeyFrame(qint64 pos, Entry* e) const;
+    bool findPreviousFrame(qint64 pos, Entry* e) const;
+    int framesToDecode(qint64 pos) const;
+    QVector<Entry> entries() const;
+    AVDemuxer::IndexEntry toIndexEntry(const Entry& e) const;
+
+    bool save(const QString& fileName, qint64 fileSize, qint64 duration) const;
+    static QSharedPointer<PacketIndex> load(const QString& fileName, int stream, qint64 fileSize, qint64 duration);
+private:
+    void append(const QVector<Entry>& entries);
+    void setReady();
+    void resolvePts();
+    qint64 toTimeBase(qint64 ms) const;
+    // entry in decoding order of the last key frame whose pts <= ts
+    int keyFrameIndex(qint64 ts) const;
+
+    int m_stream;
+    int m_tb_num, m_tb_den;
+    volatile bool m_abort;
+    volatile bool m_ready;
+    mutable QMutex m_mutex;
+    QVector<Entry> m_entries;
+    QVector<int> m_keys; // key frames in m_entries
+    QVector<int> m_order; // m_entries sorted by pts
+    friend class PacketIndexBuilder;
+};
+} //namespace QtAV
+#endif // QTAV_PACKETINDEX_H
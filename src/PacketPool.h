@@ -0,0 +1,70 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#ifndef QTAV_PACKETPOOL_H
+#define QTAV_PACKETPOOL_H
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QMutex>
+#include <QtAV/Packet.h>
+
+struct AVPacket;
+
+namespace QtAV {
+
+/*!
+ * \brief The PacketPool class
+ * Recycles the PacketPrivate (AVPacket shell) storage of demuxed packets. A shell is returned to the pool
+ * when the last Packet referencing it is destroyed, usually in decoder thread after the packet is decoded.
+ * The pool is reference counted: the owner (AVDemuxer) holds 1 ref and every outstanding shell holds 1 ref,
+ * so packets may outlive the demuxer.
+ */
+class PacketPool
+{
+public:
+    struct Block;
+    static PacketPool* create(int maxFree = 256);
+    void ref();
+    void deref();
+    /*!
+     * \brief fromAVPacket
+     * Like Packet::fromAVPacket(), but the shell is taken from the pool and avpkt's buffer and side data
+     * are moved into the result instead of adding refs, so avpkt is blank after return.
+     */
+    bool fromAVPacket(Packet* pkt, AVPacket* avpkt, double time_base);
+    qint64 hits() const;
+    qint64 misses() const;
+    // internal use by PacketPrivate allocation. size must be the same for all blocks
+    void* alloc(size_t size);
+    void recycle(Block* b);
+private:
+    PacketPool(int maxFree);
+    ~PacketPool();
+    Q_DISABLE_COPY(PacketPool)
+
+    QAtomicInt m_ref;
+    mutable QMutex m_mutex;
+    Block *m_free;
+    int m_nb_free, m_max_free;
+    qint64 m_hits, m_misses;
+};
+} //namespace QtAV
+#endif // QTAV_PACKETPOOL_H
@@ -26,6 +26,7 @@
 #include <QtCore/QAtomicInt>
 #include <QtCore/QBasicTimer>
 #include <QtCore/QObject>
+#include <QtCore/QScopedPointer>
 #if QT_VERSION >= QT_VERSION_CHECK(4, 7, 0)
 #include <QtCore/QElapsedTimer>
 #else
@@ -55,6 +56,7 @@ public:
 
     AVClock(ClockType c, QObject* parent = 0);
     AVClock(QObject* parent = 0);
+    ~AVClock();
     void setClockType(ClockType ct);
     ClockType clockType() const;
     bool isActive() const;
@@ -91,6 +93,13 @@ public:
 
     void setSpeed(qreal speed);
     inline qreal speed() const;
+    /*!
+     * \brief setFreeRunning
+     * Non-realtime mode. Playback threads never wait for the clock, waitUntil() a pts returns immediately.
+     * The clock value follows decoded timestamps
+     */
+    void setFreeRunning(bool value);
+    bool isFreeRunning() const;
 
     bool isPaused() const;
 
@@ -109,6 +118,28 @@ public:
      * \return true if sync is end for id or id is not current sync id
      */
     bool syncEndOnce(int id);
+    /*!
+     * \brief waitUntil
+     * For internal use now
+     * Block the calling thread until value() reaches pts, msecs elapsed or wakeUp() is called.
+     * Playback threads wait here instead of sleeping, so seek, pause, stop and new tasks are handled immediately.
+     * \param pts in seconds. Ignored if <= 0 or the clock is paused
+     * \param msecs max time to wait. < 0: no limit
+     * \return false if waked up by wakeUp()
+     */
+    bool waitUntil(double pts, qint64 msecs = -1);
+    /*!
+     * \brief wakeUp
+     * Wake up all threads blocked in waitUntil(). Called on pause, seek, speed change and sync end
+     */
+    void wakeUp();
+    /*!
+     * \brief notifyValueChanged
+     * For internal use now
+     * Threads blocked in waitUntil() check value() again and keep waiting if pts is not reached.
+     * Called when AudioClock is updated by the audio thread
+     */
+    void notifyValueChanged();
 
 Q_SIGNALS:
     void paused(bool);
@@ -156,6 +187,8 @@ private:
     mutable int nb_restarted;
     QAtomicInt nb_sync;
     int sync_id;
+    class Private;
+    QScopedPointer<Private> d;
 };
 
 double AVClock::value() const
@@ -179,8 +212,10 @@ double AVClock::value() const
 
 void AVClock::updateValue(double pts)
 {
-    if (clock_type == AudioClock)
-        pts_ = pts;
+    if (clock_type != AudioClock)
+        return;
+    pts_ = pts;
+    notifyValueChanged();
 }
 
 void AVClock::updateVideoTime(double pts)
@@ -203,6 +238,8 @@ double AVClock::delay() const
 void AVClock::updateDelay(double delay)
 {
     delay_ = delay;
+    if (clock_type == AudioClock)
+        notifyValueChanged();
 }
 
 qreal AVClock::diff() const
@@ -27,6 +27,7 @@
 #include <QtCore/QVariant>
 #include <QtCore/QObject>
 #include <QtCore/QScopedPointer>
+#include <QtCore/QVector>
 
 struct AVFormatContext;
 struct AVCodecContext;
@@ -46,6 +47,17 @@ public:
         VideoStream,
         SubtitleStream,
     };
+    /*!
+     * \brief The IndexEntry struct
+     * A video packet in the packet index. pts and dts are in ms, pos is the byte position in input, -1 if unknown
+     */
+    struct IndexEntry {
+        IndexEntry() : pts(0), dts(0), pos(-1), size(0), key(false) {}
+        qint64 pts, dts;
+        qint64 pos;
+        int size;
+        bool key;
+    };
     static const QStringList& supportedFormats();
     static const QStringList& supportedExtensions();
     /// Supported ffmpeg/libav input protocols(not complete). A static string list
@@ -92,6 +104,16 @@ public:
      * return the packet read by demuxer. packet is invalid if readFrame() returns false.
      */
     Packet packet() const;
+    /*!
+     * \brief packetPoolHits
+     * Demuxed packets reuse the storage of packets already consumed. Number of packets whose storage was recycled.
+     */
+    qint64 packetPoolHits() const;
+    /*!
+     * \brief packetPoolMisses
+     * Number of packets whose storage had to be allocated because no consumed packet could be recycled.
+     */
+    qint64 packetPoolMisses() const;
     /*!
      * \brief stream
      * Current readFrame() readed stream index.
@@ -117,6 +139,39 @@ public:
      * TODO: what if duration() is not valid but size is known?
      */
     bool seek(qreal q);
+    /*!
+     * \brief setIndexEnabled
+     * Build a packet index (pts, dts, byte position, size and key flag) of the video stream after load(). The container
+     * index is used if it contains every packet and frames are not reordered (mov/mp4), otherwise a local file is read in a background thread with
+     * another format context. AccurateSeek and backward KeyFrameSeek jump to the exact key frame before the target if
+     * the index is ready. Default is false.
+     */
+    void setIndexEnabled(bool value);
+    bool isIndexEnabled() const;
+    bool isIndexReady() const;
+    QVector<IndexEntry> indexEntries() const;
+    /*!
+     * \brief findKeyFrame
+     * Find the last key frame whose pts <= pos(ms). Return false if index is not ready or not found
+     */
+    bool findKeyFrame(qint64 pos, IndexEntry* entry) const;
+    /*!
+     * \brief findPreviousFrame
+     * Find the frame whose pts is the largest one < pos(ms)
+     */
+    bool findPreviousFrame(qint64 pos, IndexEntry* entry) const;
+    /*!
+     * \brief framesToDecode
+     * Number of packets to decode from the key frame before pos(ms) to the frame at pos. -1 if unknown
+     */
+    int framesToDecode(qint64 pos) const;
+    /*!
+     * \brief saveIndex
+     * Save the ready index to a file. loadIndex() accepts it if the media size, duration and video stream match.
+     * A loaded index is used until unload().
+     */
+    bool saveIndex(const QString& fileName) const;
+    bool loadIndex(const QString& fileName);
     AVFormatContext* formatContext();
     QString formatName() const;
     QString formatLongName() const;
@@ -334,6 +334,38 @@ public:
      */
     void setFrameRate(qreal value);
     qreal forcedFrameRate() const;
+    /*!
+     * \brief setFreeRunning
+     * Non-realtime mode for analytics and transcoding. Audio and video threads decode, filter and deliver as fast as possible,
+     * blocked only by packet queues. Audio is not written to the audio output, no frame is dropped and timestamps are kept,
+     * so EncodeFilter and AVTranscoder output is the same as realtime playback.
+     * AVClock type follows video timestamps, or audio if no video. speed() and forcedFrameRate() are ignored.
+     * Default is false. Can be changed during playback.
+     */
+    void setFreeRunning(bool value);
+    bool isFreeRunning() const;
+    /*!
+     * \brief setLiveMode
+     * Low latency profile for live network streams, e.g. udp, rtp, rtsp and SatIP.
+     * - Packet queues do not buffer before playback, and hold about 2x liveLatencyTarget() of packets. bufferMode() and bufferValue() are ignored.
+     * - Demuxer and video codec use low delay options(probesize, analyzeduration, fflags nobuffer and flags low_delay) if not set by user.
+     * - Less audio output buffers.
+     * - If liveLatency() is larger than liveLatencyTarget(), playback is a little faster until the target is reached,
+     *   and non-reference video frames are not decoded if it is 2x larger.
+     * Options and audio buffers take effect on the next load(). Default is false
+     */
+    void setLiveMode(bool value);
+    bool isLiveMode() const;
+    /// Target latency in ms for live mode. Default is 500
+    void setLiveLatencyTarget(int ms);
+    int liveLatencyTarget() const;
+    /*!
+     * \brief liveLatency
+     * Achieved latency in ms from a packet is received to it is played. Updated every notifyInterval() in live mode.
+     * Capture, encoding and network delay of the sender are unknown to the player and not included.
+     * \return <0 if unknown
+     */
+    int liveLatency() const;
     //Statistics& statistics();
     const Statistics& statistics() const;
     /*!
@@ -523,6 +555,24 @@ public Q_SLOTS:
      */
     void setBufferValue(qint64 value);
     int bufferValue() const;
+    /*!
+     * \brief setAdaptiveBuffer
+     * Scale bufferValue() by measured input throughput variance, underruns and video decoding speed, so a jittery network stream
+     * gets more headroom. The bytes in queue is also limited by bufferMemoryLimit(), so a high bitrate stream gets less.
+     * Ignored in live mode. Default is false
+     */
+    void setAdaptiveBuffer(bool value);
+    bool isAdaptiveBuffer() const;
+    /*!
+     * \brief setBufferMemoryLimit
+     * Same as MemoryBudget::setLimit(). The process wide limit of packets and frames held by all players. Queues stop growing
+     * over their buffer value when it's nearly reached, and drop to the lowest buffering level when it's reached.
+     * Default is 512MB or $QTAV_MEMORY_BUDGET_MB MB. <=0: no limit
+     */
+    static void setBufferMemoryLimit(qint64 bytes);
+    static qint64 bufferMemoryLimit();
+    /// Bytes of demuxed packets in the queues of all players
+    static qint64 bufferMemoryUsage();
 
     /*!
      * \brief setNotifyInterval
@@ -579,6 +629,7 @@ Q_SIGNALS:
     void interruptTimeoutChanged();
     void interruptOnTimeoutChanged();
     void notifyIntervalChanged();
+    void liveLatencyChanged(int ms);
     void brightnessChanged(int val);
     void contrastChanged(int val);
     void hueChanged(int val);
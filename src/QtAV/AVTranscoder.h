@@ -39,6 +39,24 @@ public:
     // TODO: other source (more operations needed, e.g. seek)?
     void setMediaSource(AVPlayer* player);
     AVPlayer* sourcePlayer() const;
+    /*!
+     * \brief setMediaSource
+     * Offline transcode of the video stream of a local file, without a source player and playback pacing.
+     * The input is split at key frames into segments, then segments are decoded and encoded concurrently by threads()
+     * workers, each with its own decoder and encoder. Encoded packets are written to the muxer in order.
+     * The input must have closed GOPs, otherwise frames referencing the previous segment may be corrupted. Audio is not transcoded.
+     * videoEncoder() is used as a template: codec, bit rate, size, pixel format, frame rate, options and timestamp mode are copied to workers.
+     * pause() and startTime() are not supported in offline mode.
+     * Setting a file clears the source player and vice versa.
+     */
+    void setMediaSource(const QString& fileName);
+    QString sourceFile() const;
+    /*!
+     * \brief setThreads
+     * Number of segments decoded and encoded at the same time in offline mode. 0 (default): ideal thread count
+     */
+    void setThreads(int value);
+    int threads() const;
 
     QString outputFile() const;
     QIODevice* outputDevice() const;
@@ -140,6 +158,7 @@ private Q_SLOTS:
     void prepareMuxer();
     void writeAudio(const QtAV::Packet& packet);
     void writeVideo(const QtAV::Packet& packet);
+    void onOfflineFinished();
     void tryFinish();
 
 private:
@@ -73,6 +73,14 @@ public:
         of the number of bytes per frame.
     */
     qint64 duration() const;
+    /*!
+     * \brief mix
+     * Sum frames into one frame. All frames must have the same format, use to() to convert them first.
+     * Integer samples are saturated. The result has the length of the longest frame and the timestamp of the first frame.
+     * \param gains volume of each frame. 1.0 if not set
+     * \return an invalid frame if formats are different or the sample format is not supported
+     */
+    static AudioFrame mix(const QVector<AudioFrame>& frames, const QVector<qreal>& gains = QVector<qreal>());
 };
 } //namespace QtAV
 Q_DECLARE_METATYPE(QtAV::AudioFrame)
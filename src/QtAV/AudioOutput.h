@@ -222,6 +222,7 @@ private Q_SLOTS:
     void reportMute(bool value);
 private:
     void onCallback();
+    int pull(char* data, int bytes);
     friend class AudioOutputBackend;
     Q_DISABLE_COPY(AudioOutput)
 };
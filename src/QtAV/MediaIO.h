@@ -37,6 +37,24 @@ namespace QtAV {
  *   properties:
  *     device - read only. example: io->device()
  *   protocols: "", "qrc"
+ * "MMap"
+ *   maps a local file and reads from the mapping with read ahead hints. the file must not be truncated while reading
+ *   protocols: "mmap". example: player->play("mmap:/path/to/file.mkv")
+ * "Prefetch"
+ *   reads another io in a thread into a ring buffer ahead of the read position, for slow storage
+ *   properties:
+ *     source - read/write. parameter: MediaIO*, the wrapped io. example: io->setProperty("source", QVariant::fromValue(myio))
+ *     capacity - read/write. ring buffer bytes, default is 8MB
+ *     buffered, fillLevel, throughput - read only. bytes after the read position, buffered/capacity and source bytes per second
+ *   protocols: "prefetch". example: player->play("prefetch:/nfs/file.mkv"), player->play("prefetch:qrc:/test.mkv")
+ * "RTPTS"
+ *   MPEG-TS over RTP or udp, unicast or multicast. RTP packets are reordered, and lost ones are replaced by TS null packets
+ *   url: rtp-ts://[group or local address]:port[?latency=ms&timeout=ms&iface=name], empty or "@" address means any
+ *   properties:
+ *     targetLatency - read/write. max ms to wait for a missing RTP packet, default is 200
+ *     timeout - read/write. ms without data regarded as end of stream, default is 5000
+ *     packetsReceived, packetsLost, packetsReordered, packetsConcealed, jitter(ms), latency(ms) - read only. see Statistics::Network
+ *   protocols: "rtp-ts", "udp-ts". example: player->play("rtp-ts://239.1.1.1:5004?latency=100")
  */
 typedef int MediaIOId;
 class MediaIOPrivate;
@@ -52,7 +70,7 @@ public:
         Write
     };
 
-    /// Registered MediaIO::name(): "QIODevice", "QFile"
+    /// Registered MediaIO::name(): "QIODevice", "QFile", "MMap", "Prefetch", "RTPTS"
     static QStringList builtInNames();
     /*!
      * \brief createForProtocol
@@ -0,0 +1,98 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#ifndef QTAV_MEMORYBUDGET_H
+#define QTAV_MEMORYBUDGET_H
+
+#include <QtAV/QtAV_Global.h>
+#include <QtCore/QList>
+
+namespace QtAV {
+
+class VideoFrame;
+/*!
+ * \brief The MemoryBudget class
+ * Process wide accounting of the memory held by demuxed packets and decoded frames. Every holder, e.g. a packet queue,
+ * the frame cache of a video thread or a video renderer, has an Account tagged with the owner, stream and stage.
+ * If limit() is set, holders use less memory when it is nearly reached (High pressure): packet queues stop growing
+ * once the buffer value is reached and caches shrink. When it is reached (Critical pressure), packet queues drop to
+ * the lowest buffering level(1 packet is enough to play and a few packets are full), caches and idle pools are released.
+ * Functions are thread safe.
+ */
+class Q_AV_EXPORT MemoryBudget
+{
+public:
+    enum Stage {
+        Packets,    ///< demuxed packets in the queues of a/v threads
+        Decoded,    ///< decoded frames kept by a video thread, e.g. for stepBackward()
+        Output,     ///< frames held by video renderers
+        Capture,    ///< frames being saved by VideoCapture
+        Extractor,  ///< frames kept by VideoFrameExtractor
+        FramePool,  ///< idle buffers in the decoder frame pool
+        StageCount
+    };
+    enum Pressure {
+        Normal,
+        High,       ///< >= 80% of limit()
+        Critical    ///< >= limit()
+    };
+    struct Usage {
+        const void* owner;  ///< AVPlayer for packets and decoded frames of a player, or the holder itself. 0 if not owned
+        int stream;         ///< AVDemuxer::StreamType, -1 if unknown
+        Stage stage;
+        qint64 bytes;
+        qint64 peak;
+    };
+    /*!
+     * \brief setLimit
+     * AVPlayer::setBufferMemoryLimit() sets the same limit.
+     * Default is $QTAV_MEMORY_BUDGET_MB MB if the environment var is set, otherwise 512MB. <=0: no limit
+     */
+    static void setLimit(qint64 bytes);
+    static qint64 limit();
+    static Pressure pressure();
+    static qint64 total();
+    static qint64 total(Stage stage);
+    /// total bytes of the given owner, e.g. an AVPlayer
+    static qint64 total(const void* owner);
+    /// a snapshot of all accounts
+    static QList<Usage> usage();
+    /// bytes of host memory in frame planes. 0 for a hardware surface
+    static qint64 frameBytes(const VideoFrame& frame);
+
+    class Q_AV_EXPORT Account {
+    public:
+        explicit Account(Stage stage, const void* owner = 0, int stream = -1);
+        ~Account();
+        void setOwner(const void* owner, int stream = -1);
+        /// bytes can be negative
+        void add(qint64 bytes);
+        void set(qint64 bytes);
+        qint64 bytes() const;
+        class Private; // internal
+    private:
+        Q_DISABLE_COPY(Account)
+        Private *d;
+    };
+};
+
+} //namespace QtAV
+#endif // QTAV_MEMORYBUDGET_H
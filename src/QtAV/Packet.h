@@ -59,6 +59,9 @@ public:
      * Useful for asAVPakcet(). When asAVPakcet() is called, AVPacket->pts/dts will be updated to new values.
      */
     void skip(int bytes);
+    /// Statistics::Pipeline::now() when the packet is read by demux thread. 0 if unknown
+    void setReadTime(qint64 value);
+    qint64 readTime() const;
 
     bool hasKeyFrame;
     bool isCorrupt;
@@ -69,6 +72,7 @@ public:
     qint64 position; // position in source file byte stream
 
 private:
+    friend class PacketPool;
     // we must define  default/copy ctor, dtor and operator= so that we can provide only forward declaration of PacketPrivate
     mutable QSharedDataPointer<PacketPrivate> d;
 };
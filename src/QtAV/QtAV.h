@@ -34,6 +34,7 @@
 #include <QtAV/AVPlayer.h>
 #include <QtAV/Packet.h>
 #include <QtAV/Statistics.h>
+#include <QtAV/MemoryBudget.h>
 
 #include <QtAV/AudioEncoder.h>
 #include <QtAV/AudioDecoder.h>
@@ -24,8 +24,11 @@
 
 #include <QtAV/QtAV_Global.h>
 #include <QtCore/QHash>
+#include <QtCore/QObject>
+#include <QtCore/QPointer>
 #include <QtCore/QTime>
 #include <QtCore/QSharedData>
+#include <QtCore/QVector>
 
 /*!
  * values from functions are dynamically calculated
@@ -36,6 +39,8 @@ class Q_AV_EXPORT Statistics
 {
 public:
     Statistics();
+    Statistics(const Statistics&);
+    Statistics& operator =(const Statistics&);
     ~Statistics();
     void reset();
 
@@ -94,6 +99,13 @@ public:
         // compute from pts history
         qreal currentDisplayFPS() const;
         qreal pts() const; // last pts
+        /*!
+         * Occupancy of the process wide frame pool used by FFmpeg software decoders. Not only for this player.
+         * framePoolBuffers() = framePoolBuffersInUse() + idle buffers
+         */
+        int framePoolBuffersInUse() const;
+        int framePoolBuffers() const;
+        qint64 framePoolBytes() const;
 
         int width, height;
         /**
@@ -113,6 +125,108 @@ public:
         class Private;
         QExplicitlySharedDataPointer<Private> d;
     } video_only;
+    /*!
+     * \brief The Network class
+     * Receiving statistics of a network MediaIO, e.g. "RTPTS" and "SatIP". Values are read from the io properties
+     * "packetsReceived", "packetsLost", "packetsReordered", "jitter" and "latency" when a function is called.
+     */
+    class Q_AV_EXPORT Network {
+    public:
+        explicit Network(QObject* io = 0);
+        /// false if the media is not opened by a network MediaIO
+        bool isAvailable() const;
+        qint64 packetsReceived() const;
+        qint64 packetsLost() const;
+        qint64 packetsReordered() const;
+        qreal jitter() const; ///< ms. RTP interarrival jitter
+        int latency() const; ///< ms. time in the receiving buffer of the latest packet read by demuxer
+    private:
+        QPointer<QObject> m_io;
+    };
+    /*!
+     * \brief The Pipeline class
+     * Per stage latency of the playback pipeline. Values are collected in demux thread, audio/video threads and video renderers,
+     * and can be read as a snapshot from any thread. Pipeline is not reset by reset() or a new media, call clear() if needed.
+     * Time unit is us, and the time source is now().
+     */
+    class Q_AV_EXPORT Pipeline {
+    public:
+        enum Stream {
+            Audio,
+            Video,
+            StreamCount
+        };
+        enum Stage {
+            Read,       ///< time used by demuxer to read a packet
+            Queue,      ///< read -> dequeued by a/v thread. Including the time blocked by a full queue
+            Decode,     ///< dequeued -> decoded
+            Filter,     ///< decoded -> filtered
+            Deliver,    ///< filtered -> delivered to outputs. Including format conversion and waiting for audio output
+            Render,     ///< delivered -> rendered by video renderer
+            StageCount
+        };
+        class Q_AV_EXPORT Histogram {
+        public:
+            Histogram();
+            /// log2 buckets. buckets[i] is the number of values in [2^(i-1), 2^i) us, buckets[0] is for values < 1us
+            enum { BucketCount = 24 };
+            qint64 count; ///< total number of values since clear()
+            int samples; ///< number of the rolling values, i.e. the latest values used by the other members
+            qint64 min, max, p50, p90, p99;
+            qreal mean;
+            QVector<int> buckets;
+        };
+        struct QueueSample {
+            qint64 time;
+            int packets;
+            qint64 buffered; ///< PacketBuffer::buffered(). depends on buffer mode
+        };
+        class Q_AV_EXPORT Snapshot {
+        public:
+            Snapshot();
+            Histogram histogram[StreamCount][StageCount];
+            QVector<QueueSample> queue[StreamCount]; ///< packet queue depth time series, oldest first
+            qint64 dropped[StreamCount]; ///< frames not rendered, or packets not decoded to catch up the clock
+            qint64 late[StreamCount]; ///< frames rendered later than the clock
+        };
+        Pipeline();
+        Pipeline(const Pipeline&);
+        Pipeline& operator =(const Pipeline&);
+        ~Pipeline();
+        /// monotonic process wide time in us
+        static qint64 now();
+        static QString stageName(Stage stage);
+        void record(Stream stream, Stage stage, qint64 begin, qint64 end, qreal pts = -1);
+        /// a sample is added at most every 10ms
+        void recordQueue(Stream stream, int packets, qint64 buffered);
+        void frameDropped(Stream stream);
+        void frameLate(Stream stream);
+        Snapshot snapshot() const;
+        void clear();
+        /*!
+         * \brief setTraceCapacity
+         * The latest n stage events are kept for exportChromeTrace(). 0: disable. Default is 16384,
+         * or the value of environment var QTAV_TRACE_EVENTS
+         */
+        void setTraceCapacity(int n);
+        int traceCapacity() const;
+        /*!
+         * \brief exportChromeTrace
+         * Write the kept events in Chrome trace event format(json). The file can be loaded in chrome://tracing
+         */
+        bool exportChromeTrace(const QString& fileName) const;
+    private:
+        class Private;
+        QExplicitlySharedDataPointer<Private> d;
+    };
+    /// copies of Statistics share network() and pipeline()
+    Network network() const;
+    void setNetwork(const Network& value);
+    Pipeline& pipeline();
+    const Pipeline& pipeline() const;
+private:
+    class Private;
+    QExplicitlySharedDataPointer<Private> d;
 };
 
 } //namespace QtAV
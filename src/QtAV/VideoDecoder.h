@@ -51,6 +51,8 @@ typedef int VideoDecoderId;
       skip_loop_filter, skip_idct, skip_frame: -16 "None", 0: "Default", 8 "NoRef", 16 "Bidir", 32 "NoKey", 64 "All"
       threads: int, 0 is auto
       vismv(motion vector visualization): flag, 0 "NO", 1 "PF", 2 "BF", 4 "BB"
+      frame_pool: bool, decode into QtAV managed aligned buffers. default is true
+      huge_pages: bool, use huge pages for frame pool buffers (linux)
  */
 
 class VideoDecoderPrivate;
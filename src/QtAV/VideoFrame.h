@@ -135,6 +135,13 @@ public:
     ~VideoFrameConverter();
     /// value out of [-100, 100] will be ignored
     void setEq(int brightness, int contrast, int saturation);
+    /*!
+     * \brief setThreads
+     * Convert in horizontal bands in parallel if the frame size is not changed.
+     * 0: ideal thread count. Default is QTAV_SWS_THREADS env value or 1.
+     */
+    void setThreads(int value);
+    int threads() const;
     /*!
      * \brief convert
      * return a frame with a given format from a given source frame. The result frame data is always on host memory.
@@ -146,6 +153,7 @@ public:
 private:
     mutable ImageConverter *m_cvt;
     int m_eq[3];
+    int m_threads;
 };
 } //namespace QtAV
 
@@ -23,6 +23,8 @@
 #define QTAV_VIDEOFRAMEEXTRACTOR_H
 
 #include <QtCore/QObject>
+#include <QtCore/QList>
+#include <QtCore/QSize>
 #include <QtAV/VideoFrame.h>
 
 //TODO: extract all streams
@@ -66,6 +68,25 @@ public:
     int precision() const;
     void setPosition(qint64 value);
     qint64 position() const;
+    /*!
+     * \brief extractBatch
+     * Extract frames at the given positions(ms) in forward passes, e.g. for thumbnail sprite sheets.
+     * Key frames are read once for the batch (from the container index if it's complete). Seek is only performed when
+     * there is a key frame between the last decoded key frame and the next position, otherwise decoding continues from
+     * the current packet. The first frame whose timestamp >= position is used.
+     * batchFrameExtracted() is emitted for every position and batchFinished() at the end, also if the batch is aborted.
+     * Runs in a batch thread if async() is true, batches are queued and never dropped by extract().
+     * A new batch, abortBatch() or setSource() aborts the current and queued batches. No signal is emitted after the
+     * extractor destruction begins.
+     * \param positions in any order. They are extracted in ascending order
+     * \param size output frame size. If only one dimension is > 0, the other one is computed from the aspect ratio.
+     * Invalid size means the decoded size.
+     * \param format output pixel format
+     * \param threads number of demuxer and decoder pairs. The positions are split into contiguous ranges, each range is
+     * extracted in a thread. Default is 1.
+     */
+    void extractBatch(const QList<qint64>& positions, const QSize& size = QSize(), VideoFormat::PixelFormat format = VideoFormat::Format_RGB32, int threads = 1);
+    void abortBatch();
 
 Q_SIGNALS:
     void frameExtracted(const QtAV::VideoFrame& frame); // parameter: VideoFrame, bool changed?
@@ -80,6 +101,16 @@ Q_SIGNALS:
      */
     void positionChanged();
     void precisionChanged();
+    /*!
+     * \brief batchFrameExtracted
+     * \param index index of the position in extractBatch(). Emitted from extraction threads, in ascending position order for a thread
+     */
+    void batchFrameExtracted(int index, const QtAV::VideoFrame& frame);
+    /*!
+     * \brief batchFinished
+     * \param aborted true if the batch is aborted by a new batch, abortBatch() or setSource(), and some positions may not be extracted
+     */
+    void batchFinished(bool aborted);
 
 public Q_SLOTS:
     /*!
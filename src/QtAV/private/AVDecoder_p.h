@@ -31,46 +31,48 @@
 namespace QtAV {
 
 // always define the class to avoid macro check when using it
+/*!
+ * \brief The AVFrameBuffers class
+ * Holds a reference of a decoded AVFrame (av_frame_ref), so the frame data will not be reused by decoder
+ * until the last VideoFrame copy sharing this object is destroyed. No data copy.
+ */
 class AVFrameBuffers {
 #if QTAV_HAVE(AVBUFREF)
-    QVector<AVBufferRef*> buf;
+    AVFrame *ref;
 #endif
 public:
     AVFrameBuffers(AVFrame* frame) {
         Q_UNUSED(frame);
 #if QTAV_HAVE(AVBUFREF)
-        if (!frame->buf[0]) { //not ref counted. duplicate data?
+        ref = 0;
+        if (!frame->buf[0]) //not ref counted. duplicate data?
             return;
-        }
-
-        buf.reserve(frame->nb_extended_buf + FF_ARRAY_ELEMS(frame->buf));
-        buf.resize(frame->nb_extended_buf + FF_ARRAY_ELEMS(frame->buf));
-        for (int i = 0; i < (int)FF_ARRAY_ELEMS(frame->buf); ++i) {
-            if (!frame->buf[i]) //so not use planes + nb_extended_buf!
-                continue;
-            buf[i] = av_buffer_ref(frame->buf[i]);
-            if (!buf[i]) {
-                qWarning("av_buffer_ref(frame->buf[%d]) error", i);
-            }
-        }
-        if (!frame->extended_buf)
-            return;
-        for (int i = 0; i < frame->nb_extended_buf; ++i) {
-            const int k = buf.size() + i - frame->nb_extended_buf;
-            buf[k] = av_buffer_ref(frame->extended_buf[i]);
-            if (!buf[k]) {
-                qWarning("av_buffer_ref(frame->extended_buf[%d]) error", i);
-            }
+        ref = av_frame_alloc();
+        // buffers, extended buffers, side data and hw_frames_ctx are referenced
+        if (av_frame_ref(ref, frame) < 0) {
+            qWarning("av_frame_ref error");
+            av_frame_free(&ref);
         }
 #endif //QTAV_HAVE(AVBUFREF)
     }
     ~AVFrameBuffers() {
 #if QTAV_HAVE(AVBUFREF)
-        foreach (AVBufferRef* b, buf) {
-            av_buffer_unref(&b);
-        }
+        av_frame_free(&ref); //unref and free
+#endif //QTAV_HAVE(AVBUFREF)
+    }
+    /*!
+     * \brief isRef
+     * true if the frame data is reference counted and is owned by this object
+     */
+    bool isRef() const {
+#if QTAV_HAVE(AVBUFREF)
+        return !!ref;
+#else
+        return false;
 #endif //QTAV_HAVE(AVBUFREF)
     }
+private:
+    Q_DISABLE_COPY(AVFrameBuffers)
 };
 typedef QSharedPointer<AVFrameBuffers> AVFrameBuffersRef;
 
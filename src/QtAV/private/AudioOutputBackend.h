@@ -71,6 +71,11 @@ public:
         OffsetIndex = 1 << 5, //current playing offset
         OffsetBytes = 1 << 6, //current playing offset by bytes
         WritableBytes = 1 << 7,
+        /*!
+         * The backend reads data by pull() in its device callback. AudioOutput writes data to a lock free ring of
+         * bufferSize()*bufferCount() bytes instead of calling write(), and timestamp() uses the bytes pulled minus getLatency().
+         */
+        Pull = 1 << 8,
     };
     virtual BufferControl bufferControl() const = 0;
     // called by callback with Callback control
@@ -87,6 +92,18 @@ public:
     virtual int getOffset() {return -1;}        // OffsetIndex
     virtual int getOffsetByBytes()  {return -1;}// OffsetBytes
     virtual int getWritableBytes() {return -1;} //WritableBytes
+    /*!
+     * \brief getLatency
+     * reimplement this if bufferControl() is Pull.
+     * \return duration(us) of the data pulled but not played yet, i.e. queued in the device or server
+     */
+    virtual qint64 getLatency() {return 0;}
+    /*!
+     * \brief pull
+     * Used by Pull backends in the device callback. Never blocks. If less data is available, the rest is filled with silence.
+     * \return the bytes read from AudioOutput
+     */
+    int pull(char* data, int bytes);
     // not virtual. called in ctor
     AudioOutput::DeviceFeatures supportedFeatures() { return m_features;}
     /*!
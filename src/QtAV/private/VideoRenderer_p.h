@@ -28,6 +28,7 @@
 #include <QtCore/QRect>
 #include <QtAV/VideoFrame.h>
 #include <QtGui/QColor>
+#include "QtAV/MemoryBudget.h"
 #include "QtAV/Statistics.h"
 /*TODO:
  * Region of Interest(ROI)
@@ -50,6 +51,8 @@ public:
       , source_aspect_ratio(0)
       , src_width(0)
       , src_height(0)
+      , receive_time(0)
+      , memory(MemoryBudget::Output, 0, 1) // AVDemuxer::VideoStream
       , aspect_ratio_changed(true) //to set the initial parameters
       , out_aspect_ratio_mode(VideoRenderer::VideoAspectRatio)
       , out_aspect_ratio(0)
@@ -115,6 +118,8 @@ public:
     qreal source_aspect_ratio;
     int src_width, src_height; //TODO: in_xxx
     QMutex img_mutex;
+    qint64 receive_time; // Statistics::Pipeline::now() when a new frame is received. 0 if rendered
+    MemoryBudget::Account memory; // the received frame
     //for both source, out aspect ratio. because source change may result in out change if mode is VideoAspectRatio
     bool aspect_ratio_changed;
     VideoRenderer::OutAspectRatioMode out_aspect_ratio_mode;
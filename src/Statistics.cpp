@@ -20,7 +20,14 @@
 ******************************************************************************/
 
 #include "QtAV/Statistics.h"
+#include <algorithm>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QMutex>
+#include <QtCore/QVariant>
+#include "codec/video/VideoFramePool.h"
 #include "utils/ring.h"
+#include "utils/Logger.h"
 
 namespace QtAV {
 
@@ -93,6 +100,56 @@ qreal Statistics::VideoOnly::pts() const
     return d->pts;
 }
 
+int Statistics::VideoOnly::framePoolBuffersInUse() const
+{
+    return VideoFramePool::instance().buffersInUse();
+}
+
+int Statistics::VideoOnly::framePoolBuffers() const
+{
+    return VideoFramePool::instance().buffers();
+}
+
+qint64 Statistics::VideoOnly::framePoolBytes() const
+{
+    return VideoFramePool::instance().bytes();
+}
+
+Statistics::Network::Network(QObject *io)
+    : m_io(io)
+{
+}
+
+bool Statistics::Network::isAvailable() const
+{
+    return m_io && m_io->property("packetsReceived").isValid();
+}
+
+qint64 Statistics::Network::packetsReceived() const
+{
+    return m_io ? m_io->property("packetsReceived").toLongLong() : 0;
+}
+
+qint64 Statistics::Network::packetsLost() const
+{
+    return m_io ? m_io->property("packetsLost").toLongLong() : 0;
+}
+
+qint64 Statistics::Network::packetsReordered() const
+{
+    return m_io ? m_io->property("packetsReordered").toLongLong() : 0;
+}
+
+qreal Statistics::Network::jitter() const
+{
+    return m_io ? m_io->property("jitter").toReal() : 0;
+}
+
+int Statistics::Network::latency() const
+{
+    return m_io ? m_io->property("latency").toInt() : 0;
+}
+
 qint64 Statistics::VideoOnly::frameDisplayed(qreal pts)
 {
     d->pts = pts;
@@ -114,14 +171,360 @@ qreal Statistics::VideoOnly::currentDisplayFPS() const
     return (qreal)d->history.size()/dt;
 }
 
+namespace {
+class PipelineClock : public QElapsedTimer {
+public:
+    PipelineClock() { start();}
+};
+static const int kRollingValues = 512;
+static const int kQueueSamples = 512;
+static const qint64 kQueueSampleInterval = 10000; // us
+} //namespace
+Q_GLOBAL_STATIC(PipelineClock, pipelineClock)
+
+Statistics::Pipeline::Histogram::Histogram()
+    : count(0)
+    , samples(0)
+    , min(0)
+    , max(0)
+    , p50(0)
+    , p90(0)
+    , p99(0)
+    , mean(0)
+    , buckets(BucketCount, 0)
+{
+}
+
+Statistics::Pipeline::Snapshot::Snapshot()
+{
+    for (int i = 0; i < StreamCount; ++i) {
+        dropped[i] = 0;
+        late[i] = 0;
+    }
+}
+
+class Statistics::Pipeline::Private : public QSharedData {
+public:
+    // a stage, queue depth, dropped or late event
+    struct Event {
+        enum Type { StageEvent, QueueEvent, DroppedEvent, LateEvent };
+        qint64 time;
+        qint64 value; // duration of a stage, or buffered value of queue
+        qreal pts;
+        int packets;
+        qint8 type, stream, stage;
+    };
+    Private()
+        : values(StreamCount*StageCount, ring<qint64>(kRollingValues))
+        , queue(StreamCount, ring<QueueSample>(kQueueSamples))
+        , events(0)
+    {
+        bool ok = false;
+        const int n = qgetenv("QTAV_TRACE_EVENTS").toInt(&ok);
+        events = ring<Event>(ok && n >= 0 ? n : 16384);
+        clear();
+    }
+    void clear() {
+        for (int i = 0; i < StreamCount*StageCount; ++i) {
+            values[i] = ring<qint64>(kRollingValues);
+            count[i] = 0;
+        }
+        for (int i = 0; i < StreamCount; ++i) {
+            queue[i] = ring<QueueSample>(kQueueSamples);
+            dropped[i] = 0;
+            late[i] = 0;
+        }
+        events = ring<Event>(events.capacity());
+    }
+    void addEvent(Event::Type type, Stream stream, qint64 time, qint64 value = 0, qreal pts = -1, int stage = 0, int packets = 0) {
+        if (events.capacity() == 0)
+            return;
+        Event e;
+        e.time = time;
+        e.value = value;
+        e.pts = pts;
+        e.packets = packets;
+        e.type = type;
+        e.stream = stream;
+        e.stage = stage;
+        events.push_back(e);
+    }
+
+    mutable QMutex mutex;
+    std::vector<ring<qint64> > values; // stream*StageCount + stage
+    qint64 count[StreamCount*StageCount];
+    std::vector<ring<QueueSample> > queue;
+    qint64 dropped[StreamCount];
+    qint64 late[StreamCount];
+    ring<Event> events;
+};
+
+Statistics::Pipeline::Pipeline()
+    : d(new Private())
+{
+}
+
+Statistics::Pipeline::Pipeline(const Pipeline &other)
+    : d(other.d)
+{
+}
+
+Statistics::Pipeline& Statistics::Pipeline::operator =(const Pipeline& other)
+{
+    d = other.d;
+    return *this;
+}
+
+Statistics::Pipeline::~Pipeline()
+{
+}
+
+qint64 Statistics::Pipeline::now()
+{
+    return pipelineClock()->nsecsElapsed()/1000LL;
+}
+
+QString Statistics::Pipeline::stageName(Stage stage)
+{
+    static const char* const kNames[] = { "read", "queue", "decode", "filter", "deliver", "render" };
+    if (stage < 0 || stage >= StageCount)
+        return QString();
+    return QString::fromLatin1(kNames[stage]);
+}
+
+void Statistics::Pipeline::record(Stream stream, Stage stage, qint64 begin, qint64 end, qreal pts)
+{
+    if (begin <= 0 || end < begin)
+        return;
+    const int i = stream*StageCount + stage;
+    QMutexLocker lock(&d->mutex);
+    Q_UNUSED(lock);
+    d->values[i].push_back(end - begin);
+    d->count[i]++;
+    d->addEvent(Private::Event::StageEvent, stream, begin, end - begin, pts, stage);
+}
+
+void Statistics::Pipeline::recordQueue(Stream stream, int packets, qint64 buffered)
+{
+    const qint64 t = now();
+    QMutexLocker lock(&d->mutex);
+    Q_UNUSED(lock);
+    ring<QueueSample> &q = d->queue[stream];
+    if (!q.empty() && t - q.back().time < kQueueSampleInterval)
+        return;
+    QueueSample s;
+    s.time = t;
+    s.packets = packets;
+    s.buffered = buffered;
+    q.push_back(s);
+    d->addEvent(Private::Event::QueueEvent, stream, t, buffered, -1, 0, packets);
+}
+
+void Statistics::Pipeline::frameDropped(Stream stream)
+{
+    const qint64 t = now();
+    QMutexLocker lock(&d->mutex);
+    Q_UNUSED(lock);
+    d->dropped[stream]++;
+    d->addEvent(Private::Event::DroppedEvent, stream, t);
+}
+
+void Statistics::Pipeline::frameLate(Stream stream)
+{
+    const qint64 t = now();
+    QMutexLocker lock(&d->mutex);
+    Q_UNUSED(lock);
+    d->late[stream]++;
+    d->addEvent(Private::Event::LateEvent, stream, t);
+}
+
+Statistics::Pipeline::Snapshot Statistics::Pipeline::snapshot() const
+{
+    Snapshot s;
+    std::vector<qint64> v;
+    QMutexLocker lock(&d->mutex);
+    Q_UNUSED(lock);
+    for (int i = 0; i < StreamCount; ++i) {
+        s.dropped[i] = d->dropped[i];
+        s.late[i] = d->late[i];
+        const ring<QueueSample> &q = d->queue[i];
+        s.queue[i].reserve(int(q.size()));
+        for (size_t k = 0; k < q.size(); ++k)
+            s.queue[i].append(q.at(k));
+        for (int j = 0; j < StageCount; ++j) {
+            const ring<qint64> &r = d->values[i*StageCount + j];
+            Histogram &h = s.histogram[i][j];
+            h.count = d->count[i*StageCount + j];
+            h.samples = int(r.size());
+            if (r.empty())
+                continue;
+            v.resize(r.size());
+            qint64 sum = 0;
+            for (size_t k = 0; k < r.size(); ++k) {
+                const qint64 x = r.at(k);
+                v[k] = x;
+                sum += x;
+                int b = 0;
+                for (qint64 y = x; y > 0 && b < Histogram::BucketCount - 1; y >>= 1)
+                    ++b;
+                h.buckets[b]++;
+            }
+            std::sort(v.begin(), v.end());
+            const size_t n = v.size();
+            h.min = v.front();
+            h.max = v.back();
+            h.p50 = v[(n - 1)*50/100];
+            h.p90 = v[(n - 1)*90/100];
+            h.p99 = v[(n - 1)*99/100];
+            h.mean = qreal(sum)/qreal(n);
+        }
+    }
+    return s;
+}
+
+void Statistics::Pipeline::clear()
+{
+    QMutexLocker lock(&d->mutex);
+    Q_UNUSED(lock);
+    d->clear();
+}
+
+void Statistics::Pipeline::setTraceCapacity(int n)
+{
+    QMutexLocker lock(&d->mutex);
+    Q_UNUSED(lock);
+    d->events = ring<Private::Event>(qMax(0, n));
+}
+
+int Statistics::Pipeline::traceCapacity() const
+{
+    QMutexLocker lock(&d->mutex);
+    Q_UNUSED(lock);
+    return int(d->events.capacity());
+}
+
+bool Statistics::Pipeline::exportChromeTrace(const QString &fileName) const
+{
+    static const char* const kStreams[] = { "audio", "video" };
+    QByteArray json("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    json.append("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"QtAV\"}}");
+    // 1 track per stream stage, because stages of different packets can overlap
+    for (int i = 0; i < StreamCount; ++i) {
+        for (int j = 0; j < StageCount; ++j) {
+            json.append(",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":")
+                    .append(QByteArray::number(i*StageCount + j + 1))
+                    .append(",\"args\":{\"name\":\"").append(kStreams[i]).append(' ')
+                    .append(stageName(Stage(j)).toLatin1()).append("\"}}");
+        }
+    }
+    {
+        QMutexLocker lock(&d->mutex);
+        Q_UNUSED(lock);
+        for (size_t k = 0; k < d->events.size(); ++k) {
+            const Private::Event &e = d->events.at(k);
+            const QByteArray stream(kStreams[int(e.stream)]);
+            const QByteArray ts(QByteArray::number(e.time));
+            switch (e.type) {
+            case Private::Event::StageEvent:
+                json.append(",\n{\"name\":\"").append(stageName(Stage(e.stage)).toLatin1())
+                        .append("\",\"cat\":\"").append(stream)
+                        .append("\",\"ph\":\"X\",\"pid\":1,\"tid\":").append(QByteArray::number(e.stream*StageCount + e.stage + 1))
+                        .append(",\"ts\":").append(ts)
+                        .append(",\"dur\":").append(QByteArray::number(e.value));
+                if (e.pts >= 0)
+                    json.append(",\"args\":{\"pts\":").append(QByteArray::number(e.pts, 'f', 3)).append('}');
+                json.append('}');
+                break;
+            case Private::Event::QueueEvent:
+                json.append(",\n{\"name\":\"").append(stream).append(" queue\",\"ph\":\"C\",\"pid\":1,\"ts\":").append(ts)
+                        .append(",\"args\":{\"packets\":").append(QByteArray::number(e.packets))
+                        .append(",\"buffered\":").append(QByteArray::number(e.value)).append("}}");
+                break;
+            default:
+                json.append(",\n{\"name\":\"").append(e.type == Private::Event::DroppedEvent ? "dropped" : "late")
+                        .append("\",\"cat\":\"").append(stream)
+                        .append("\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":").append(QByteArray::number(e.stream*StageCount + Deliver + 1))
+                        .append(",\"ts\":").append(ts).append('}');
+                break;
+            }
+        }
+    }
+    json.append("\n]}\n");
+    QFile f(fileName);
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning("Failed to open trace file %s: %s", fileName.toUtf8().constData(), f.errorString().toUtf8().constData());
+        return false;
+    }
+    return f.write(json) == json.size();
+}
+
+class Statistics::Private : public QSharedData {
+public:
+    Network network;
+    Pipeline pipeline;
+};
+
 Statistics::Statistics()
+    : bit_rate(0)
+    , d(new Private())
+{
+}
+
+Statistics::Statistics(const Statistics& s)
+    : url(s.url)
+    , bit_rate(s.bit_rate)
+    , format(s.format)
+    , start_time(s.start_time)
+    , duration(s.duration)
+    , metadata(s.metadata)
+    , audio(s.audio)
+    , video(s.video)
+    , audio_only(s.audio_only)
+    , video_only(s.video_only)
+    , d(s.d)
+{
+}
+
+Statistics& Statistics::operator =(const Statistics& s)
 {
+    url = s.url;
+    bit_rate = s.bit_rate;
+    format = s.format;
+    start_time = s.start_time;
+    duration = s.duration;
+    metadata = s.metadata;
+    audio = s.audio;
+    video = s.video;
+    audio_only = s.audio_only;
+    video_only = s.video_only;
+    d = s.d;
+    return *this;
 }
 
 Statistics::~Statistics()
 {
 }
 
+Statistics::Network Statistics::network() const
+{
+    return d->network;
+}
+
+void Statistics::setNetwork(const Network &value)
+{
+    d->network = value;
+}
+
+Statistics::Pipeline& Statistics::pipeline()
+{
+    return d->pipeline;
+}
+
+const Statistics::Pipeline& Statistics::pipeline() const
+{
+    return d->pipeline;
+}
+
 void Statistics::reset()
 {
     url = QString();
@@ -129,6 +532,7 @@ void Statistics::reset()
     video = Common();
     audio_only = AudioOnly();
     video_only = VideoOnly();
+    d->network = Network();
     metadata.clear();
 }
 
@@ -28,6 +28,8 @@
 #else
 #include <QtCore/QStandardPaths>
 #endif
+#include "QtAV/MemoryBudget.h"
+#include "QtAV/private/AVDecoder_p.h"
 #include "utils/Logger.h"
 
 namespace QtAV {
@@ -45,6 +47,7 @@ public:
         , quality(-1)
         , format(QStringLiteral("PNG"))
         , qfmt(QImage::Format_ARGB32)
+        , memory(MemoryBudget::Capture, c, 1) // AVDemuxer::VideoStream
     {
         setAutoDelete(true);
     }
@@ -75,6 +78,8 @@ public:
         if (original_fmt) {
             if (!frame.constBits(0)) {
                 frame = frame.to(frame.format());
+            } else if (frame.frameData().isEmpty()) { // decoded frame referenced in setVideoFrame(), planes are not contiguous
+                frame = frame.clone();
             }
             path.append(frame.format().name());
             qDebug("Saving capture to %s", qPrintable(path));
@@ -113,6 +118,7 @@ public:
     QString format, dir, name;
     QImage::Format qfmt;
     VideoFrame frame;
+    MemoryBudget::Account memory; // frame is released with the task
 };
 
 VideoCapture::VideoCapture(QObject *parent) :
@@ -206,6 +212,7 @@ void VideoCapture::start()
     task->format = fmt;
     task->qfmt = qfmt;
     task->frame = frame; //copy here and it's safe in capture thread because start() is called immediatly after setVideoFrame
+    task->memory.set(MemoryBudget::frameBytes(frame));
     if (isAsync()) {
         videoCaptureThreadPool()->start(task);
     } else {
@@ -276,7 +283,13 @@ void VideoCapture::setVideoFrame(const VideoFrame &frame)
     /*
      * clone here may block VideoThread. But if not clone here, the frame may be
      * modified outside and is not safe.
+     * A frame holding a reference of the decoded AVFrame will not be reused by decoder, so keep the reference only.
      */
+    const AVFrameBuffersRef ref = frame.metaData(QStringLiteral("avbuf")).value<AVFrameBuffersRef>();
+    if (ref && ref->isRef()) {
+        this->frame = frame;
+        return;
+    }
     this->frame = frame.clone(); // TODO: no clone, use detach()
 }
 
@@ -23,6 +23,7 @@
 #include "QtAV/private/Frame_p.h"
 #include "QtAV/SurfaceInterop.h"
 #include "ImageConverter.h"
+#include <QtCore/QScopedPointer>
 #include <QtCore/QSharedPointer>
 #include <QtGui/QImage>
 #include "QtAV/private/AVCompat.h"
@@ -41,6 +42,14 @@ static const struct RegisterMetaTypes
 } _registerMetaTypes;
 }
 
+// ImageConverterSIMD forwards to swscale if no vector kernel is built or supported by the cpu. skip the wrapper then
+static ImageConverter* createImageConverter()
+{
+    if (ImageConverterSIMD::isAvailable())
+        return new ImageConverterSIMD();
+    return new ImageConverterFF();
+}
+
 VideoFrame VideoFrame::fromGPU(const VideoFormat& fmt, int width, int height, int surface_h, quint8 *src[], int pitch[], bool optimized, bool swapUV)
 {
     Q_ASSERT(src[0] && pitch[0] > 0 && "VideoFrame::fromGPU: src[0] and pitch[0] must be set");
@@ -235,6 +244,7 @@ VideoFrame VideoFrame::clone() const
         dst += plane_size;
     }
     f.d_ptr->metadata = d->metadata; // need metadata?
+    f.d_ptr->metadata.remove(QStringLiteral("avbuf")); // data is copied. do not keep decoded buffers alive
     f.setTimestamp(d->timestamp);
     f.setDisplayAspectRatio(d->displayAspectRatio);
     f.setColorSpace(d->color_space);
@@ -385,19 +395,20 @@ VideoFrame VideoFrame::to(const VideoFormat &fmt, const QSize& dstSize, const QR
             )
         return *this;
     Q_D(const VideoFrame);
-    ImageConverterSWS conv;
-    conv.setInFormat(pixelFormatFFmpeg());
-    conv.setOutFormat(fmt.pixelFormatFFmpeg());
-    conv.setInSize(width(), height());
-    conv.setOutSize(w, h);
-    conv.setInRange(colorRange());
-    if (!conv.convert(d->planes.constData(), d->line_sizes.constData())) {
+    QScopedPointer<ImageConverter> conv(createImageConverter());
+    conv->setInFormat(pixelFormatFFmpeg());
+    conv->setOutFormat(fmt.pixelFormatFFmpeg());
+    conv->setInSize(width(), height());
+    conv->setOutSize(w, h);
+    conv->setInRange(colorRange());
+    conv->setInColorSpace(colorSpace());
+    if (!conv->convert(d->planes.constData(), d->line_sizes.constData())) {
         qWarning() << "VideoFrame::to error: " << format() << "=>" << fmt;
         return VideoFrame();
     }
-    VideoFrame f(w, h, fmt, conv.outData());
-    f.setBits(conv.outPlanes());
-    f.setBytesPerLine(conv.outLineSizes());
+    VideoFrame f(w, h, fmt, conv->outData());
+    f.setBits(conv->outPlanes());
+    f.setBytesPerLine(conv->outLineSizes());
     if (fmt.isRGB()) {
         f.setColorSpace(fmt.isPlanar() ? ColorSpace_GBR : ColorSpace_RGB);
     } else {
@@ -407,6 +418,7 @@ VideoFrame VideoFrame::to(const VideoFormat &fmt, const QSize& dstSize, const QR
     f.setTimestamp(timestamp());
     f.setDisplayAspectRatio(displayAspectRatio());
     f.d_ptr->metadata = d->metadata; // need metadata?
+    f.d_ptr->metadata.remove(QStringLiteral("avbuf")); // data is copied. do not keep decoded buffers alive
     return f;
 }
 
@@ -458,6 +470,7 @@ void* VideoFrame::createInteropHandle(void* handle, SurfaceType type, int plane)
 
 VideoFrameConverter::VideoFrameConverter()
     : m_cvt(0)
+    , m_threads(-1)
 {
     memset(m_eq, 0, sizeof(m_eq));
 }
@@ -480,6 +493,18 @@ void VideoFrameConverter::setEq(int brightness, int contrast, int saturation)
         m_eq[2] = saturation;
 }
 
+void VideoFrameConverter::setThreads(int value)
+{
+    m_threads = qMax(0, value);
+}
+
+int VideoFrameConverter::threads() const
+{
+    if (m_threads < 0) // not set
+        return m_cvt ? m_cvt->threads() : ImageConverterSWS().threads();
+    return m_threads;
+}
+
 VideoFrame VideoFrameConverter::convert(const VideoFrame& frame, const VideoFormat &fmt) const
 {
     return convert(frame, fmt.pixelFormatFFmpeg());
@@ -505,16 +530,19 @@ VideoFrame VideoFrameConverter::convert(const VideoFrame &frame, int fffmt) cons
     //if (fffmt == format.pixelFormatFFmpeg())
       //  return *this;
     if (!m_cvt) {
-        m_cvt = new ImageConverterSWS();
+        m_cvt = createImageConverter();
     }
     m_cvt->setBrightness(m_eq[0]);
     m_cvt->setContrast(m_eq[1]);
     m_cvt->setSaturation(m_eq[2]);
+    if (m_threads >= 0)
+        m_cvt->setThreads(m_threads);
     m_cvt->setInFormat(format.pixelFormatFFmpeg());
     m_cvt->setOutFormat(fffmt);
     m_cvt->setInSize(frame.width(), frame.height());
     m_cvt->setOutSize(frame.width(), frame.height());
     m_cvt->setInRange(frame.colorRange());
+    m_cvt->setInColorSpace(frame.colorSpace());
     const int pal = format.hasPalette();
     QVector<const uchar*> pitch(format.planeCount() + pal);
     QVector<int> stride(format.planeCount() + pal);
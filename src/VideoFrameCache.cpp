@@ -0,0 +1,344 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#include "VideoFrameCache.h"
+#include <QtCore/QRunnable>
+#include <QtCore/QScopedPointer>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
+#include "QtAV/AVDemuxer.h"
+#include "QtAV/Packet.h"
+#include "QtAV/VideoDecoder.h"
+#include "utils/Logger.h"
+
+namespace QtAV {
+
+Q_GLOBAL_STATIC(QThreadPool, prefetchThreadPool)
+
+static qint64 defaultMaxBytes()
+{
+    static const QByteArray env(qgetenv("QTAV_FRAME_CACHE_MB"));
+    if (env.isEmpty())
+        return 128LL << 20;
+    return qMax(0LL, env.toLongLong()) << 20;
+}
+
+class VideoFramePrefetcher : public QRunnable
+{
+public:
+    VideoFramePrefetcher(VideoFrameCache* cache, const QString& url, int stream, qint64 keyPos, qreal endPts, int generation)
+        : m_cache(cache)
+        , m_url(url)
+        , m_stream(stream)
+        , m_key_pos(keyPos)
+        , m_end(endPts)
+        , m_generation(generation)
+    {}
+    void run() Q_DECL_OVERRIDE {
+        // do not compete with playback
+        QThread::currentThread()->setPriority(QThread::LowPriority);
+        QList<VideoFrame> frames;
+        decode(&frames);
+        m_cache->prepend(frames, m_generation);
+    }
+private:
+    // decode [key frame, m_end) and keep the last frames in budget
+    void decode(QList<VideoFrame>* frames) {
+        AVDemuxer demuxer;
+        demuxer.setMedia(m_url);
+        if (!demuxer.load())
+            return;
+        const int s = demuxer.videoStreams().indexOf(m_stream);
+        if (s < 0 || !demuxer.setStreamIndex(AVDemuxer::VideoStream, s))
+            return;
+        QScopedPointer<VideoDecoder> dec(VideoDecoder::create(VideoDecoderId_FFmpeg));
+        if (!dec || !demuxer.videoCodecContext())
+            return;
+        dec->setCodecContext(demuxer.videoCodecContext());
+        if (!dec->open())
+            return;
+        demuxer.setSeekType(AccurateSeek); // backward, i.e. the key frame before
+        if (!demuxer.seek(m_key_pos >= 0 ? m_key_pos : qint64(m_end*1000.0) - 1LL))
+            return;
+        const qint64 max_bytes = m_cache->maxBytes()/2;
+        qint64 bytes = 0;
+        bool key = false;
+        bool done = false;
+        while (!done && !m_cache->m_abort) {
+            Packet pkt;
+            if (demuxer.atEnd()) {
+                pkt = Packet::createEOF();
+            } else {
+                if (!demuxer.readFrame() || demuxer.stream() != m_stream)
+                    continue;
+                pkt = demuxer.packet();
+                if (!key && !pkt.hasKeyFrame)
+                    continue;
+                key = true;
+            }
+            if (!dec->decode(pkt)) {
+                if (pkt.isEOF())
+                    break;
+                continue;
+            }
+            const VideoFrame frame(dec->frame());
+            if (!frame.isValid())
+                continue;
+            if (frame.timestamp() >= m_end) {
+                done = true;
+                break;
+            }
+            if (!VideoFrameCache::isCacheable(frame))
+                return;
+            frames->append(frame);
+            bytes += VideoFrameCache::frameBytes(frame);
+            while (bytes > max_bytes && !frames->isEmpty())
+                bytes -= VideoFrameCache::frameBytes(frames->takeFirst());
+        }
+        if (!done)
+            frames->clear(); // not continuous with cached frames
+    }
+
+    VideoFrameCache *m_cache;
+    QString m_url;
+    int m_stream;
+    qint64 m_key_pos;
+    qreal m_end;
+    int m_generation;
+};
+
+VideoFrameCache::VideoFrameCache()
+    : m_bytes(0)
+    , m_max_bytes(defaultMaxBytes())
+    , m_last(0)
+    , m_current(0)
+    , m_generation(0)
+    , m_prefetching(false)
+    , m_abort(false)
+    , m_memory(MemoryBudget::Decoded, 0, AVDemuxer::VideoStream)
+{}
+
+VideoFrameCache::~VideoFrameCache()
+{
+    stopPrefetch();
+}
+
+void VideoFrameCache::setMaxBytes(qint64 value)
+{
+    QMutexLocker lock(&m_mutex);
+    Q_UNUSED(lock);
+    m_max_bytes = qMax(0LL, value);
+    shrink();
+}
+
+qint64 VideoFrameCache::maxBytes() const
+{
+    return m_max_bytes;
+}
+
+bool VideoFrameCache::isCacheable(const VideoFrame& frame)
+{
+    // hw surfaces are owned by decoder pool. frames from the ffmpeg decoder reference buffers, otherwise data must be owned
+    if (!frame.isValid() || !frame.constBits(0))
+        return false;
+    return frame.metaData(QStringLiteral("avbuf")).isValid() || !frame.frameData().isEmpty();
+}
+
+qint64 VideoFrameCache::frameBytes(const VideoFrame& frame)
+{
+    return MemoryBudget::frameBytes(frame);
+}
+
+void VideoFrameCache::setMemoryOwner(const void *owner)
+{
+    m_memory.setOwner(owner, AVDemuxer::VideoStream);
+}
+
+bool VideoFrameCache::insert(const VideoFrame &frame)
+{
+    if (m_max_bytes <= 0)
+        return false;
+    if (MemoryBudget::pressure() == MemoryBudget::Critical) {
+        clear();
+        return false;
+    }
+    if (!isCacheable(frame)) {
+        clear();
+        return false;
+    }
+    const qint64 k = key(frame.timestamp());
+    QMutexLocker lock(&m_mutex);
+    Q_UNUSED(lock);
+    if (!m_frames.isEmpty() && k <= m_last) {
+        // not continuous, e.g. timestamp wraps
+        m_frames.clear();
+        m_bytes = 0;
+        ++m_generation;
+    }
+    m_frames.insert(k, frame);
+    m_bytes += frameBytes(frame);
+    m_last = m_current = k;
+    shrink();
+    return m_frames.contains(k);
+}
+
+void VideoFrameCache::clear()
+{
+    QMutexLocker lock(&m_mutex);
+    Q_UNUSED(lock);
+    ++m_generation;
+    m_abort = m_prefetching;
+    if (m_frames.isEmpty())
+        return;
+    m_frames.clear();
+    m_bytes = 0;
+    m_memory.set(0);
+}
+
+bool VideoFrameCache::contains(qreal pts) const
+{
+    QMutexLocker lock(&m_mutex);
+    Q_UNUSED(lock);
+    return m_frames.contains(key(pts));
+}
+
+bool VideoFrameCache::isLast(qreal pts) const
+{
+    QMutexLocker lock(&m_mutex);
+    Q_UNUSED(lock);
+    return !m_frames.isEmpty() && m_frames.lastKey() == key(pts);
+}
+
+qreal VideoFrameCache::first() const
+{
+    QMutexLocker lock(&m_mutex);
+    Q_UNUSED(lock);
+    if (m_frames.isEmpty())
+        return -1;
+    return qreal(m_frames.firstKey())/1000000.0;
+}
+
+qreal VideoFrameCache::current() const
+{
+    QMutexLocker lock(&m_mutex);
+    Q_UNUSED(lock);
+    if (m_frames.isEmpty())
+        return -1;
+    return qreal(m_current)/1000000.0;
+}
+
+VideoFrame VideoFrameCache::previous()
+{
+    QMutexLocker lock(&m_mutex);
+    Q_UNUSED(lock);
+    QMap<qint64, VideoFrame>::const_iterator it = m_frames.constFind(m_current);
+    if (it == m_frames.constEnd() || it == m_frames.constBegin())
+        return VideoFrame();
+    --it;
+    m_current = it.key();
+    return it.value();
+}
+
+VideoFrame VideoFrameCache::next()
+{
+    QMutexLocker lock(&m_mutex);
+    Q_UNUSED(lock);
+    QMap<qint64, VideoFrame>::const_iterator it = m_frames.constFind(m_current);
+    if (it == m_frames.constEnd() || ++it == m_frames.constEnd())
+        return VideoFrame();
+    m_current = it.key();
+    return it.value();
+}
+
+int VideoFrameCache::framesBefore(qreal pts) const
+{
+    QMutexLocker lock(&m_mutex);
+    Q_UNUSED(lock);
+    int n = 0;
+    QMap<qint64, VideoFrame>::const_iterator it = m_frames.constBegin();
+    for (const qint64 k = key(pts); it != m_frames.constEnd() && it.key() < k; ++it)
+        ++n;
+    return n;
+}
+
+void VideoFrameCache::prefetch(const QString &url, int stream, qint64 keyPos)
+{
+    QMutexLocker lock(&m_mutex);
+    Q_UNUSED(lock);
+    if (m_prefetching || m_frames.isEmpty() || m_max_bytes <= 0)
+        return;
+    m_prefetching = true;
+    m_abort = false;
+    prefetchThreadPool()->start(new VideoFramePrefetcher(this, url, stream, keyPos, qreal(m_frames.firstKey())/1000000.0, m_generation));
+}
+
+bool VideoFrameCache::isPrefetching() const
+{
+    QMutexLocker lock(&m_mutex);
+    Q_UNUSED(lock);
+    return m_prefetching;
+}
+
+void VideoFrameCache::stopPrefetch()
+{
+    QMutexLocker lock(&m_mutex);
+    Q_UNUSED(lock);
+    m_abort = m_prefetching;
+    while (m_prefetching)
+        m_prefetch_cond.wait(&m_mutex);
+}
+
+void VideoFrameCache::shrink()
+{
+    qint64 max_bytes = m_max_bytes;
+    if (MemoryBudget::pressure() != MemoryBudget::Normal)
+        max_bytes /= 4;
+    while (m_bytes > max_bytes && !m_frames.isEmpty()) {
+        // keep the frames near the current one, and the run continuous
+        QMap<qint64, VideoFrame>::iterator it = m_frames.begin();
+        if (m_current - m_frames.firstKey() < m_frames.lastKey() - m_current)
+            it = --m_frames.end();
+        m_bytes -= frameBytes(it.value());
+        m_frames.erase(it);
+    }
+    m_memory.set(m_bytes);
+}
+
+void VideoFrameCache::prepend(const QList<VideoFrame> &frames, int generation)
+{
+    QMutexLocker lock(&m_mutex);
+    Q_UNUSED(lock);
+    m_prefetching = false;
+    m_abort = false;
+    m_prefetch_cond.wakeAll();
+    if (generation != m_generation || frames.isEmpty() || m_frames.isEmpty())
+        return;
+    if (key(frames.last().timestamp()) >= m_frames.firstKey())
+        return;
+    foreach (const VideoFrame& f, frames) {
+        m_frames.insert(key(f.timestamp()), f);
+        m_bytes += frameBytes(f);
+    }
+    qDebug("VideoFrameCache: %d frames prefetched. %d frames, %lld bytes cached", frames.size(), m_frames.size(), m_bytes);
+    shrink();
+}
+
+} //namespace QtAV
@@ -0,0 +1,100 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#ifndef QTAV_VIDEOFRAMECACHE_H
+#define QTAV_VIDEOFRAMECACHE_H
+
+#include <QtCore/QList>
+#include <QtCore/QMap>
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
+#include <QtAV/MemoryBudget.h>
+#include <QtAV/VideoFrame.h>
+
+namespace QtAV {
+
+/*!
+ * \brief The VideoFrameCache class
+ * Decoded frames of a continuous run of decoding, keyed by pts. A frame next to a cached frame can be found without
+ * decoding again, e.g. stepBackward(). Frames farthest from the last inserted or requested one are removed if the total
+ * size exceeds maxBytes(), or 1/4 of it if MemoryBudget is nearly exhausted. Only frames owning host memory are cached.
+ * Methods are thread safe.
+ */
+class VideoFrameCache
+{
+public:
+    VideoFrameCache();
+    ~VideoFrameCache();
+    /// default is $QTAV_FRAME_CACHE_MB MB or 128MB. 0: disabled
+    void setMaxBytes(qint64 value);
+    qint64 maxBytes() const;
+    static bool isCacheable(const VideoFrame& frame);
+    /*!
+     * \brief insert
+     * Frames must be inserted in presentation order as they are decoded. The run is restarted if the frame is not
+     * next to the last inserted one. Return false and clear the cache if the frame can not be cached.
+     */
+    bool insert(const VideoFrame& frame);
+    /// break the run, e.g. seek or frames dropped by decoder. prefetch is aborted
+    void clear();
+    bool contains(qreal pts) const;
+    /// pts of the earliest cached frame. <0: empty
+    qreal first() const;
+    /// pts of the last inserted frame or the last frame returned by previous()/next(). <0: empty
+    qreal current() const;
+    bool isLast(qreal pts) const;
+    /// the frame before/after current() and make it current. return an invalid frame if not cached
+    VideoFrame previous();
+    VideoFrame next();
+    /// number of cached frames earlier than pts
+    int framesBefore(qreal pts) const;
+    /*!
+     * \brief prefetch
+     * Decode the frames earlier than the first cached one in a background thread with another demuxer and decoder.
+     * \param url local media the frames are decoded from
+     * \param stream the video stream of cached frames
+     * \param keyPos the key frame position(ms) to seek to. <0: unknown
+     */
+    void prefetch(const QString& url, int stream, qint64 keyPos = -1);
+    bool isPrefetching() const;
+    void stopPrefetch();
+    /// tag cached frames in MemoryBudget. owner is usually the player
+    void setMemoryOwner(const void* owner);
+private:
+    static qint64 key(qreal pts) { return qint64(pts*1000000.0 + (pts < 0 ? -0.5 : 0.5));}
+    static qint64 frameBytes(const VideoFrame& frame);
+    void shrink(); // remove frames farthest from m_current
+    void prepend(const QList<VideoFrame>& frames, int generation);
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_prefetch_cond;
+    QMap<qint64, VideoFrame> m_frames;
+    qint64 m_bytes, m_max_bytes;
+    qint64 m_last; // key of the last inserted frame
+    qint64 m_current;
+    int m_generation; // changed by clear(). prefetched frames of an old run are dropped
+    bool m_prefetching;
+    volatile bool m_abort;
+    MemoryBudget::Account m_memory;
+    friend class VideoFramePrefetcher;
+};
+} //namespace QtAV
+#endif // QTAV_VIDEOFRAMECACHE_H
@@ -20,33 +20,45 @@
 ******************************************************************************/
 
 #include "QtAV/VideoFrameExtractor.h"
+#include <algorithm>
 #include <QtCore/QCoreApplication>
 #include <QtCore/QQueue>
 #include <QtCore/QRunnable>
 #include <QtCore/QScopedPointer>
 #include <QtCore/QStringList>
 #include <QtCore/QThread>
+#include <QtCore/QThreadPool>
 #include <QtCore/QMutex>
 #include <QtCore/QMutexLocker>
 #include "QtAV/VideoCapture.h"
 #include "QtAV/VideoDecoder.h"
 #include "QtAV/AVDemuxer.h"
+#include "QtAV/MemoryBudget.h"
 #include "QtAV/Packet.h"
+#include "ImageConverter.h"
 #include "utils/BlockingQueue.h"
+#include "utils/SPSCQueue.h"
 #include "utils/Logger.h"
 
 namespace QtAV {
 
 class ExtractThread : public QThread {
 public:
-    ExtractThread(QObject *parent = 0)
+    /*!
+     * latestOnly: keep only the latest task, queued tasks are dropped by a new one. Otherwise every task runs in order
+     */
+    explicit ExtractThread(bool latestOnly = true, QObject *parent = 0)
         : QThread(parent)
         , timeout_ms(50UL)
         , stop(false)
+        , latest_only(latestOnly)
     {
         // avoid too frequent -- we only care about the latest request
         // whether it be for a frame or to stop thread or whatever else.
-        tasks.setCapacity(1);
+        if (latest_only)
+            tasks.setCapacity(1);
+        else
+            tasks.blockFull(false);
     }
     ~ExtractThread() {
         waitStop();
@@ -61,6 +73,10 @@ public:
     unsigned long timeout_ms;
 
     void addTask(QRunnable* t) {
+        if (!latest_only) {
+            tasks.put(t); // never blocks. the return value only means the queue is larger than capacity
+            return;
+        }
         // Note that while a simpler solution would have been to not use
         // a custom 'Task' mechanism but rather to use signals
         // or QEvent posting to this thread -- the approach here has a very
@@ -110,6 +126,7 @@ protected:
 public:
     volatile bool stop;
 private:
+    bool latest_only;
     BlockingQueue<QRunnable*> tasks;
 };
 
@@ -120,6 +137,8 @@ class VideoFrameExtractorPrivate : public DPtrPrivate<VideoFrameExtractor>
 public:
     VideoFrameExtractorPrivate()
         : abort_seek(false)
+        , batch_id(0)
+        , destroying(false)
         , async(true)
         , has_video(true)
         , auto_extract(true)
@@ -128,6 +147,9 @@ public:
         , position(-2*kDefaultPrecision)
         , precision(kDefaultPrecision)
         , decoder(0)
+        , memory(MemoryBudget::Extractor, 0, AVDemuxer::VideoStream)
+        , batch_mutex(QMutex::Recursive)
+        , batch_thread(false)
     {
         QVariantHash opt;
         opt[QString::fromLatin1("skip_frame")] = 8; // 8 for "avcodec", "NoRef" for "FFmpeg". see AVDiscard
@@ -156,6 +178,14 @@ public:
                    << QStringLiteral("FFmpeg");
     }
     ~VideoFrameExtractorPrivate() {
+        // the extractor is being destroyed. no batch signal from now on
+        {
+            QMutexLocker lock(&batch_mutex);
+            Q_UNUSED(lock);
+            destroying = true;
+        }
+        abortBatches();
+        batch_thread.waitStop();
         // stop first before demuxer and decoder close to avoid running new seek task after demuxer is closed.
         thread.waitStop();
         releaseResourceInternal();
@@ -187,25 +217,29 @@ public:
                 precision = kDefaultPrecision;
         }
         demuxer.setStreamIndex(AVDemuxer::VideoStream, 0);
+        demuxer.setIndexEnabled(true);
+        decoder.reset(openDecoder(demuxer));
+        return !!decoder;
+    }
+    VideoDecoder* openDecoder(AVDemuxer &dmx) const {
         foreach (const QString& c, codecs) {
             VideoDecoder *vd = VideoDecoder::create(c.toUtf8().constData());
             if (!vd)
                 continue;
-            decoder.reset(vd);
-            AVCodecContext *cctx = demuxer.videoCodecContext();
-            if (cctx) decoder->setCodecContext(demuxer.videoCodecContext());
-            if (!cctx || !decoder->open()) {
-                decoder.reset(0);
+            AVCodecContext *cctx = dmx.videoCodecContext();
+            if (cctx) vd->setCodecContext(cctx);
+            if (!cctx || !vd->open()) {
+                delete vd;
                 continue;
             }
             QVariantHash opt, va;
             // FIXME: why QStringLiteral can't be used as key for vs<2015 but somewhere else it can?  error C2958: the left bracket '[' found at qstringliteral
             va[QString::fromLatin1("display")] = QString::fromLatin1("X11"); // to support swscale
             opt[QString::fromLatin1("vaapi")] = va;
-            decoder->setOptions(opt);
-            break;
+            vd->setOptions(opt);
+            return vd;
         }
-        return !!decoder;
+        return 0;
     }
 
     // return the key frame position
@@ -361,13 +395,264 @@ public:
         return true;
     }
     void releaseResourceInternal(bool releaseFrame = true) {
-        if (releaseFrame) frame = VideoFrame();
+        if (releaseFrame) {
+            frame = VideoFrame();
+            memory.set(0);
+        }
         seek_count = 0;
         // close codec context first.
         decoder.reset(0);
         demuxer.unload();
     }
 
+    struct BatchPosition {
+        qint64 t; // ms
+        int index; // index in extractBatch()
+        bool operator<(const BatchPosition& other) const { return t < other.t;}
+    };
+    // abort running and queued batches. return the id of the next batch
+    int abortBatches() {
+        return batch_id.fetchAndAddOrdered(1) + 1;
+    }
+    bool isBatchAborted(int id) const {
+        return spsc::loadAcquire(batch_id) != id;
+    }
+    // batch signals are emitted with batch_mutex locked, so none is emitted once the destructor set destroying
+    void emitBatchFrame(VideoFrameExtractor *q, int id, int index, const VideoFrame& frame) {
+        QMutexLocker lock(&batch_mutex);
+        Q_UNUSED(lock);
+        if (!destroying && !isBatchAborted(id))
+            Q_EMIT q->batchFrameExtracted(index, frame);
+    }
+    void emitBatchFinished(VideoFrameExtractor *q, int id) {
+        QMutexLocker lock(&batch_mutex);
+        Q_UNUSED(lock);
+        if (!destroying)
+            Q_EMIT q->batchFinished(isBatchAborted(id));
+    }
+    // id: abortBatches() value when the batch is requested
+    // positions are sorted and split into contiguous ranges, the first range is extracted in current thread
+    void extractBatch(VideoFrameExtractor *q, const QString& url, const QVector<qint64>& times, const QSize& size, VideoFormat::PixelFormat format, int threads, int id) {
+        class BatchTask : public QRunnable {
+        public:
+            BatchTask(VideoFrameExtractorPrivate *p, VideoFrameExtractor *e, const QString& u, const QVector<BatchPosition>& t, const QVector<qint64>& k, int b, int n, const QSize& s, VideoFormat::PixelFormat f, int i)
+                : d(p), q(e), url(u), positions(t), keys(k), begin(b), end(n), size(s), format(f), id(i)
+            {}
+            void run() { d->extractBatchRange(q, url, positions, keys, begin, end, size, format, id); }
+        private:
+            VideoFrameExtractorPrivate *d;
+            VideoFrameExtractor *q;
+            QString url;
+            QVector<BatchPosition> positions;
+            QVector<qint64> keys;
+            int begin, end;
+            QSize size;
+            VideoFormat::PixelFormat format;
+            int id;
+        };
+        if (isBatchAborted(id)) {
+            emitBatchFinished(q, id);
+            return;
+        }
+        const int n = times.size();
+        QVector<BatchPosition> positions(n);
+        for (int i = 0; i < n; ++i) {
+            positions[i].t = times[i];
+            positions[i].index = i;
+        }
+        std::stable_sort(positions.begin(), positions.end());
+        const QVector<qint64> keys(batchKeyFrames(url, id));
+        if (isBatchAborted(id)) {
+            emitBatchFinished(q, id);
+            return;
+        }
+        threads = qBound(1, threads, qMax(1, n));
+        QThreadPool pool;
+        pool.setMaxThreadCount(threads);
+        for (int i = 1; i < threads; ++i)
+            pool.start(new BatchTask(this, q, url, positions, keys, i*n/threads, (i+1)*n/threads, size, format, id));
+        extractBatchRange(q, url, positions, keys, 0, n/threads, size, format, id);
+        pool.waitForDone();
+        emitBatchFinished(q, id);
+    }
+    // key frame pts(ms) of the video stream in ascending order, shared by all ranges of a batch.
+    // the container index is used if it's complete, otherwise the packets are read once here
+    QVector<qint64> batchKeyFrames(const QString& url, int id) const {
+        QVector<qint64> keys;
+        AVDemuxer dmx;
+        dmx.setMedia(url);
+        dmx.setIndexEnabled(true);
+        if (!dmx.load() || dmx.videoStreams().isEmpty())
+            return keys;
+        dmx.setStreamIndex(AVDemuxer::VideoStream, 0);
+        if (dmx.isIndexReady()) {
+            foreach (const AVDemuxer::IndexEntry& e, dmx.indexEntries()) {
+                if (e.key)
+                    keys.append(e.pts);
+            }
+        } else {
+            dmx.setIndexEnabled(false); // stop the background builder, it's faster to read the packets here
+            const int vstream = dmx.videoStream();
+            while (!isBatchAborted(id) && !dmx.atEnd()) {
+                if (!dmx.readFrame())
+                    continue;
+                if (dmx.stream() != vstream)
+                    continue;
+                const Packet& pkt = dmx.packet();
+                if (pkt.isValid() && pkt.hasKeyFrame)
+                    keys.append(qint64(pkt.pts*1000.0));
+            }
+        }
+        std::sort(keys.begin(), keys.end());
+        return keys;
+    }
+    // whether a key frame after the key frame at key_pts is at or before t, i.e. seeking to t skips decoding.
+    // keys is empty if the key frames are unknown, then gop (max distance between key frames read) is used to estimate
+    static bool hasKeyFrameBetween(const QVector<qint64>& keys, qint64 gop, qint64 key_pts, qint64 t) {
+        if (keys.isEmpty())
+            return gop > 0 && t > key_pts + gop;
+        QVector<qint64>::const_iterator it = std::upper_bound(keys.constBegin(), keys.constEnd(), key_pts);
+        return it != keys.constEnd() && *it <= t;
+    }
+    // extract positions [begin, end) in forward passes using a new demuxer and decoder
+    void extractBatchRange(VideoFrameExtractor *q, const QString& url, const QVector<BatchPosition>& positions, const QVector<qint64>& keys, int begin, int end, const QSize& size, VideoFormat::PixelFormat format, int id) {
+        if (begin >= end)
+            return;
+        AVDemuxer dmx;
+        dmx.setMedia(url);
+        if (!dmx.load() || dmx.videoStreams().isEmpty()) {
+            qWarning("VideoFrameExtractor: failed to load video for batch extraction");
+            return;
+        }
+        dmx.setStreamIndex(AVDemuxer::VideoStream, 0);
+        QScopedPointer<VideoDecoder> dec(openDecoder(dmx));
+        if (!dec)
+            return;
+        const int vstream = dmx.videoStream();
+        const qint64 t0 = dmx.startTime();
+        ImageConverterSIMD conv;
+        QVariantHash *dec_opt = 0;
+        qint64 key_pts = -1; // last key frame read since seek
+        qint64 gop = 0; // max distance between key frames read
+        int seek_index = -1; // the position index last seek was performed for
+        VideoFrame frame; // last decoded frame
+        VideoFrame out; // converted frame
+        int i = begin;
+        while (i < end && !isBatchAborted(id)) {
+            const qint64 t = positions[i].t + t0;
+            if (frame.isValid() && qint64(frame.timestamp()*1000.0) >= t) {
+                if (!out.isValid())
+                    out = convertBatchFrame(conv, frame, size, format);
+                emitBatchFrame(q, id, positions[i++].index, out);
+                continue;
+            }
+            // seek if a key frame is before t. otherwise keep decoding
+            if (seek_index != i && (seek_index < 0 || (key_pts >= 0 && hasKeyFrameBetween(keys, gop, key_pts, t)))) {
+                dmx.seek(t);
+                dec->flush();
+                key_pts = -1;
+                seek_index = i;
+            }
+            bool got = false;
+            while (!got && !isBatchAborted(id) && !dmx.atEnd()) {
+                if (!dmx.readFrame())
+                    continue;
+                if (dmx.stream() != vstream)
+                    continue;
+                const Packet pkt(dmx.packet());
+                if (!pkt.isValid())
+                    continue;
+                const qint64 pts = qint64(pkt.pts*1000.0);
+                if (pkt.hasKeyFrame) {
+                    if (key_pts >= 0 && pts > key_pts)
+                        gop = qMax(gop, pts - key_pts);
+                    key_pts = pts;
+                    // another key frame is still before t
+                    if (seek_index != i && hasKeyFrameBetween(keys, gop, pts, t)) {
+                        dmx.seek(t);
+                        dec->flush();
+                        key_pts = -1;
+                        seek_index = i;
+                        continue;
+                    }
+                } else if (key_pts < 0) {
+                    continue; // can not be decoded after seek
+                }
+                QVariantHash *opt = pts < t - precision ? &dec_opt_framedrop : &dec_opt_normal;
+                if (opt != dec_opt) {
+                    dec->setOptions(*opt);
+                    dec_opt = opt;
+                }
+                if (!dec->decode(pkt))
+                    continue;
+                const VideoFrame f(dec->frame());
+                if (!f.isValid())
+                    continue;
+                frame = f;
+                out = VideoFrame();
+                got = qint64(frame.timestamp()*1000.0) >= t;
+            }
+            if (got || isBatchAborted(id))
+                continue;
+            // eof. get the delayed frames
+            while (!got && dec->decode(Packet::createEOF())) {
+                const VideoFrame f(dec->frame());
+                if (!f.isValid())
+                    break;
+                frame = f;
+                out = VideoFrame();
+                got = qint64(frame.timestamp()*1000.0) >= t;
+            }
+            if (got)
+                continue;
+            // no more frames. use the last one for the rest positions
+            if (!frame.isValid())
+                break;
+            if (!out.isValid())
+                out = convertBatchFrame(conv, frame, size, format);
+            while (i < end && !isBatchAborted(id))
+                emitBatchFrame(q, id, positions[i++].index, out);
+        }
+    }
+    static VideoFrame convertBatchFrame(ImageConverter& conv, const VideoFrame& frame, const QSize& size, VideoFormat::PixelFormat format) {
+        int w = size.width(), h = size.height();
+        const qreal dar = frame.displayAspectRatio() > 0 ? frame.displayAspectRatio() : qreal(frame.width())/qreal(frame.height());
+        if (w <= 0 && h <= 0) {
+            w = frame.width();
+            h = frame.height();
+        } else if (w <= 0) {
+            w = qMax(1, qRound(qreal(h)*dar));
+        } else if (h <= 0) {
+            h = qMax(1, qRound(qreal(w)/dar));
+        }
+        const VideoFormat fmt(format);
+        const VideoFormat fmt_in(frame.format());
+        conv.setInFormat(fmt_in.pixelFormatFFmpeg());
+        conv.setOutFormat(fmt.pixelFormatFFmpeg());
+        conv.setInSize(frame.width(), frame.height());
+        conv.setOutSize(w, h);
+        conv.setInRange(frame.colorRange());
+        conv.setInColorSpace(frame.colorSpace());
+        QVector<const uchar*> planes(fmt_in.planeCount());
+        QVector<int> pitches(fmt_in.planeCount());
+        for (int i = 0; i < fmt_in.planeCount(); ++i) {
+            planes[i] = frame.constBits(i);
+            pitches[i] = frame.bytesPerLine(i);
+        }
+        if (!conv.convert(planes.constData(), pitches.constData())) {
+            qWarning() << "VideoFrameExtractor: failed to convert " << fmt_in << "=>" << fmt;
+            return VideoFrame();
+        }
+        VideoFrame f(w, h, fmt, conv.outData());
+        f.setBits(conv.outPlanes());
+        f.setBytesPerLine(conv.outLineSizes());
+        f.setTimestamp(frame.timestamp());
+        if (fmt.isRGB())
+            f.setColorSpace(fmt.isPlanar() ? ColorSpace_GBR : ColorSpace_RGB);
+        // the converter writes the next frame into the same buffer
+        return f.clone();
+    }
+
     void safeReleaseResource() {
         class Cleaner : public QRunnable {
             VideoFrameExtractorPrivate *p;
@@ -381,6 +666,8 @@ public:
     }
 
     volatile bool abort_seek;
+    QAtomicInt batch_id; // increased by a new batch, abortBatch() and setSource(). a batch runs while it equals the batch's id
+    bool destroying; // guarded by batch_mutex
     bool async;
     bool has_video;
     bool loading;
@@ -393,8 +680,11 @@ public:
     AVDemuxer demuxer;
     QScopedPointer<VideoDecoder> decoder;
     VideoFrame frame; ///< important: we only allow the extract thread to modify this value
+    MemoryBudget::Account memory; ///< frame
     QStringList codecs;
     ExtractThread thread;
+    QMutex batch_mutex;
+    ExtractThread batch_thread; // batches are queued here so extract() and setSource() can not drop them
     static QVariantHash dec_opt_framedrop, dec_opt_normal;
 };
 
@@ -405,6 +695,7 @@ VideoFrameExtractor::VideoFrameExtractor(QObject *parent) :
     QObject(parent)
 {
     DPTR_D(VideoFrameExtractor);
+    d.memory.setOwner(this, AVDemuxer::VideoStream);
     d.thread.start();
 }
 
@@ -415,6 +706,7 @@ void VideoFrameExtractor::setSource(const QString url)
         return;
     d.source = url;
     d.has_video = true;
+    d.abortBatches();
     Q_EMIT sourceChanged();
     d.safeReleaseResource();
 }
@@ -521,6 +813,42 @@ void VideoFrameExtractor::extract()
     d.thread.addTask(new ExtractTask(this, position()));
 }
 
+void VideoFrameExtractor::extractBatch(const QList<qint64> &positions, const QSize &size, VideoFormat::PixelFormat format, int threads)
+{
+    DPTR_D(VideoFrameExtractor);
+    // abort the previous batch. this one is aborted if another abortBatches() is called before or while it runs
+    const int id = d.abortBatches();
+    if (!d.async) {
+        d.extractBatch(this, d.source, positions.toVector(), size, format, threads, id);
+        return;
+    }
+    class BatchTask : public QRunnable {
+    public:
+        BatchTask(VideoFrameExtractor *e, const QString& u, const QVector<qint64>& t, const QSize& s, VideoFormat::PixelFormat f, int n, int i)
+            : extractor(e), url(u), positions(t), size(s), format(f), threads(n), id(i)
+        {}
+        void run() {
+            extractor->d_func().extractBatch(extractor, url, positions, size, format, threads, id);
+        }
+    private:
+        VideoFrameExtractor *extractor;
+        QString url;
+        QVector<qint64> positions;
+        QSize size;
+        VideoFormat::PixelFormat format;
+        int threads;
+        int id;
+    };
+    if (!d.batch_thread.isRunning())
+        d.batch_thread.start();
+    d.batch_thread.addTask(new BatchTask(this, d.source, positions.toVector(), size, format, threads, id));
+}
+
+void VideoFrameExtractor::abortBatch()
+{
+    d_func().abortBatches();
+}
+
 void VideoFrameExtractor::extractInternal(qint64 pos)
 {
     DPTR_D(VideoFrameExtractor);
@@ -536,6 +864,7 @@ void VideoFrameExtractor::extractInternal(qint64 pos)
     bool extractOk = false, isAborted = true;
     QString err;
     extractOk = d.extractInPrecision(pos, precision(), err, isAborted);
+    d.memory.set(MemoryBudget::frameBytes(d.frame));
     if (!extractOk) {
         if (isAborted)
             Q_EMIT aborted(QString().sprintf("Abort at position %lld: %s",pos,err.toLatin1().constData()));
@@ -544,6 +873,11 @@ void VideoFrameExtractor::extractInternal(qint64 pos)
         return;
     }
     Q_EMIT frameExtracted(d.frame);
+    // receivers have their copies
+    if (MemoryBudget::pressure() == MemoryBudget::Critical) {
+        d.frame = VideoFrame();
+        d.memory.set(0);
+    }
 }
 
 } //namespace QtAV
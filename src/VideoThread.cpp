@@ -21,6 +21,7 @@
 
 #include "VideoThread.h"
 #include "AVThread_p.h"
+#include "VideoFrameCache.h"
 #include "QtAV/Packet.h"
 #include "QtAV/AVClock.h"
 #include "QtAV/VideoCapture.h"
@@ -45,6 +46,7 @@ public:
       , force_dt(0)
       , capture(0)
       , filter_context(0)
+      , cache_frames(false)
     {
     }
     ~VideoThreadPrivate() {
@@ -64,6 +66,8 @@ public:
     VideoCapture *capture;
     VideoFilterContext *filter_context;//TODO: use own smart ptr. QSharedPointer "=" is ugly
     VideoFrame displayed_frame;
+    VideoFrameCache frame_cache; // decoded frames for stepping
+    volatile bool cache_frames;
 };
 
 VideoThread::VideoThread(QObject *parent) :
@@ -185,17 +189,82 @@ void VideoThread::setEQ(int b, int c, int s)
     }
 }
 
+VideoFrameCache* VideoThread::frameCache()
+{
+    return &d_func().frame_cache;
+}
+
+void VideoThread::setFrameCacheEnabled(bool value)
+{
+    DPTR_D(VideoThread);
+    d.cache_frames = value;
+    if (!value)
+        d.frame_cache.clear();
+}
+
+bool VideoThread::isFrameCacheEnabled() const
+{
+    return d_func().cache_frames;
+}
+
+bool VideoThread::stepFromCache(bool backward)
+{
+    DPTR_D(VideoThread);
+    if (!isPaused())
+        return false;
+    const VideoFrame frame(backward ? d.frame_cache.previous() : d.frame_cache.next());
+    if (!frame.isValid())
+        return false;
+    class CachedFrameTask : public QRunnable {
+    public:
+        CachedFrameTask(VideoThread *vt, const VideoFrame& f, bool seek)
+            : vthread(vt)
+            , frame(f)
+            , seek_finished(seek)
+        {}
+        void run() {
+            VideoThreadPrivate &d = vthread->d_func();
+            const qreal pts = frame.timestamp();
+            d.pts_history.push_back(pts);
+            d.clock->updateVideoTime(pts);
+            d.clock->updateValue(pts);
+            if (d.clock->clockType() == AVClock::ExternalClock)
+                d.clock->updateExternalClock((pts - d.clock->initialValue())*1000.0);
+            d.statistics->video.current_time = QTime(0, 0, 0).addMSecs(int(pts * 1000.0));
+            vthread->applyFilters(frame);
+            if (!vthread->deliverVideoFrame(frame))
+                return;
+            d.displayed_frame = frame;
+            if (seek_finished)
+                Q_EMIT vthread->seekFinished(qint64(pts*1000.0));
+        }
+    private:
+        VideoThread *vthread;
+        VideoFrame frame;
+        bool seek_finished;
+    };
+    scheduleTask(new CachedFrameTask(this, frame, backward));
+    return true;
+}
+
 void VideoThread::applyFilters(VideoFrame &frame)
 {
     DPTR_D(VideoThread);
     QMutexLocker locker(&d.mutex);
     Q_UNUSED(locker);
     if (!d.filters.isEmpty()) {
+        bool detached = false;
         //sort filters by format. vo->defaultFormat() is the last
         foreach (Filter *filter, d.filters) {
             VideoFilter *vf = static_cast<VideoFilter*>(filter);
             if (!vf->isEnabled())
                 continue;
+            // filters may draw on the frame. copy once if it's shared with the cache
+            if (!detached) {
+                detached = true;
+                if (d.cache_frames && d.frame_cache.contains(frame.timestamp()))
+                    frame = frame.clone();
+            }
             if (vf->prepareContext(d.filter_context, d.statistics, &frame))
                 vf->apply(d.statistics, &frame);
         }
@@ -286,20 +355,19 @@ void VideoThread::run()
 
             } else {
                 if (isPaused())
-                    continue; //timeout. process pending tasks
+                    continue; //timeout or a task is scheduled. process pending tasks
             }
         }
         if (d.seek_requested) {
             d.seek_requested = false;
             qDebug("request seek video thread");
             pkt = Packet(); // last decode failed and pkt is valid, reset pkt to force take the next packet if seek is requested
-            msleep(1);
         } else {
             // d.render_pts0 < 0 means seek finished here
             if (d.clock->syncId() > 0) {
                 qDebug("video thread wait to sync end for sync id: %d", d.clock->syncId());
                 if (d.render_pts0 < 0 && sync_id > 0) {
-                    msleep(10);
+                    d.clock->waitUntil(-1, 10); // waked up when sync ends
                     v_a = 0;
                     continue;
                 }
@@ -310,6 +378,9 @@ void VideoThread::run()
         if(!pkt.isValid() && !pkt.isEOF()) { // can't seek back if eof packet is read
             pkt = d.packets.take(); //wait to dequeue
            // TODO: push pts history here and reorder
+            if (pkt.readTime() > 0)
+                d.statistics->pipeline().record(Statistics::Pipeline::Video, Statistics::Pipeline::Queue, pkt.readTime(), Statistics::Pipeline::now(), pkt.pts);
+            d.statistics->pipeline().recordQueue(Statistics::Pipeline::Video, d.packets.size(), d.packets.buffered());
         }
         if (pkt.isEOF()) {
             wait_key_frame = false;
@@ -327,6 +398,7 @@ void VideoThread::run()
                 if (pkt.pts >= 0)
                     qDebug("video seek: %.3f, id: %d", d.render_pts0, sync_id);
                 d.pts_history = ring<qreal>(d.pts_history.capacity());
+                d.frame_cache.clear();
                 v_a = 0;
                 continue;
             }
@@ -362,7 +434,7 @@ void VideoThread::run()
         qreal diff = dts > 0 ? dts - d.clock->value() + v_a : v_a;
         if (pkt.isEOF())
             diff = qMin<qreal>(1.0, qMax<qreal>(d.delay, 1.0/d.statistics->video_only.currentDisplayFPS()));
-        if (diff < 0 && sync_video)
+        if (diff < 0 && (sync_video || d.clock->isFreeRunning()))
             diff = 0; // this ensures no frame drop
         if (diff > kSyncThreshold) {
             nb_dec_fast++;
@@ -380,6 +452,7 @@ void VideoThread::run()
                 // ensure video will not later than 2s
                 if (diff < -2 || (nb_dec_slow > kNbSlowSkip && diff < -1.0 && !pkt.hasKeyFrame)) {
                     qDebug("video is too slow. skip decoding until next key frame.");
+                    d.statistics->pipeline().frameDropped(Statistics::Pipeline::Video);
                     // TODO: when to reset so frame drop flag can reset?
                     nb_dec_slow = 0;
                     wait_key_frame = true;
@@ -479,6 +552,7 @@ void VideoThread::run()
         }
         if (dec_opt != dec_opt_old)
             dec->setOptions(*dec_opt);
+        const qint64 decode_begin = Statistics::Pipeline::now();
         if (!dec->decode(pkt)) {
             d.pts_history.push_back(d.pts_history.back());
             //qWarning("Decode video failed. undecoded: %d/%d", dec->undecodedSize(), pkt.data.size());
@@ -515,6 +589,14 @@ void VideoThread::run()
             v_a = 0; //?
             continue;
         }
+        const qint64 decode_end = Statistics::Pipeline::now();
+        d.statistics->pipeline().record(Statistics::Pipeline::Video, Statistics::Pipeline::Decode, decode_begin, decode_end, frame.timestamp());
+        // decoding speed for adaptive buffer
+        const qreal dt = qreal(decode_end - decode_begin)/1000000.0;
+        d.decode_time = d.decode_time > 0 ? d.decode_time*0.9 + dt*0.1 : dt;
+        const qreal fps = decodeFrameRate();
+        if (fps > 0 && d.decode_time > 0)
+            d.packets.setDecodeRatio(1.0/(fps*d.decode_time));
         const double audioTS = d.clock->value()*0.02*1000UL;
         const double videoTS = frame.timestamp()*0.02*1000UL;
         double newDiff = videoTS - audioTS;
@@ -535,6 +617,13 @@ void VideoThread::run()
             frame.setTimestamp(pkt.pts); // pkt.pts is wrong. >= real timestamp
         const qreal pts = frame.timestamp();
         d.pts_history.push_back(pts);
+        // frames before seek target are cached too, so the next stepBackward() will not decode the gop again
+        if (d.cache_frames) {
+            if (dec_opt == &d.dec_opt_normal)
+                d.frame_cache.insert(frame);
+            else
+                d.frame_cache.clear(); // non-ref frames are dropped by decoder
+        }
         // seek finished because we can ensure no packet before seek decoded when render_pts0 is set
         //qDebug("pts0: %f, pts: %f, clock: %d", d.render_pts0, pts, d.clock->clockType());
         if (d.render_pts0 >= 0.0) {
@@ -555,13 +644,16 @@ void VideoThread::run()
         }
         if (skip_render) {
             qDebug("skip rendering @%.3f", pts);
+            d.statistics->pipeline().frameDropped(Statistics::Pipeline::Video);
             pkt = Packet();
             v_a = 0;
             continue;
         }
         Q_ASSERT(d.statistics);
         d.statistics->video.current_time = QTime(0, 0, 0).addMSecs(int(pts * 1000.0)); //TODO: is it expensive?
+        const qint64 filter_begin = Statistics::Pipeline::now();
         applyFilters(frame);
+        d.statistics->pipeline().record(Statistics::Pipeline::Video, Statistics::Pipeline::Filter, filter_begin, Statistics::Pipeline::now(), pts);
 
         //while can pause, processNextTask, not call outset.puase which is deperecated
         while (d.outputSet->canPauseThread()) {
@@ -594,8 +686,12 @@ void VideoThread::run()
             }
         }
         // no return even if d.stop is true. ensure frame is displayed. otherwise playing an image may be failed to display
+        const qint64 deliver_begin = Statistics::Pipeline::now();
         if (!deliverVideoFrame(frame))
             continue;
+        d.statistics->pipeline().record(Statistics::Pipeline::Video, Statistics::Pipeline::Deliver, deliver_begin, Statistics::Pipeline::now(), pts);
+        if (!sync_video && pts < d.clock->value() - kSyncThreshold)
+            d.statistics->pipeline().frameLate(Statistics::Pipeline::Video);
         //qDebug("clock.diff: %.3f", d.clock->diff());
         if (d.force_dt > 0)
             last_deliver_time = QDateTime::currentMSecsSinceEpoch();
@@ -30,6 +30,7 @@ namespace QtAV {
 
 class VideoCapture;
 class VideoFrame;
+class VideoFrameCache;
 class VideoThreadPrivate;
 class VideoThread : public AVThread
 {
@@ -46,6 +47,21 @@ public:
     void setContrast(int val);
     void setSaturation(int val);
     void setEQ(int b, int c, int s);
+    VideoFrameCache* frameCache();
+    /*!
+     * \brief setFrameCacheEnabled
+     * Decoded frames are cached only if enabled, e.g. when paused, stepping or seeking for stepBackward().
+     * The cache is cleared if disabled. Default is false.
+     */
+    void setFrameCacheEnabled(bool value);
+    bool isFrameCacheEnabled() const;
+    /*!
+     * \brief stepFromCache
+     * Show the decoded frame before/after the current one if it's cached. The thread must be paused.
+     * seekFinished() is emitted for backward step.
+     * \return false if not cached
+     */
+    bool stepFromCache(bool backward);
 
 public Q_SLOTS:
     void addCaptureTask();
@@ -19,6 +19,7 @@
     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ******************************************************************************/
 #include "VideoDecoderFFmpegBase.h"
+#include "VideoFramePool.h"
 #include "QtAV/private/AVCompat.h"
 #include "QtAV/private/factory.h"
 #include "QtAV/version.h"
@@ -47,6 +48,8 @@ class VideoDecoderFFmpeg : public VideoDecoderFFmpegBase
     Q_PROPERTY(int threads READ threads WRITE setThreads) // 0 is auto
     Q_PROPERTY(ThreadFlags thread_type READ threadFlags WRITE setThreadFlags)
     Q_PROPERTY(MotionVectorVisFlags vismv READ motionVectorVisFlags WRITE setMotionVectorVisFlags)
+    Q_PROPERTY(bool frame_pool READ framePool WRITE setFramePool) // decode into VideoFramePool buffers. set before open
+    Q_PROPERTY(bool huge_pages READ hugePages WRITE setHugePages) // process wide
     //Q_PROPERTY(BugFlags bug READ bugFlags WRITE setBugFlags)
     Q_ENUMS(StrictType)
     Q_ENUMS(DiscardType)
@@ -167,6 +170,10 @@ public:
     BugFlags bugFlags() const;
     void setHwaccel(const QString& value);
     QString hwaccel() const;
+    void setFramePool(bool value);
+    bool framePool() const;
+    void setHugePages(bool value);
+    bool hugePages() const;
 Q_SIGNALS:
     void codecNameChanged() Q_DECL_OVERRIDE;
     void hwaccelChanged();
@@ -200,6 +207,7 @@ public:
       , threads(0)
       , debug_mv(VideoDecoderFFmpeg::No)
       , bug(VideoDecoderFFmpeg::autodetect)
+      , frame_pool(true)
     {}
     bool open() Q_DECL_OVERRIDE {
         av_opt_set_int(codec_ctx, "skip_loop_filter", (int64_t)skip_loop_filter, 0);
@@ -210,6 +218,17 @@ public:
         av_opt_set_int(codec_ctx, "thread_type", (int64_t)thread_type, 0);
         av_opt_set_int(codec_ctx, "vismv", (int64_t)debug_mv, 0);
         av_opt_set_int(codec_ctx, "bug", (int64_t)bug, 0);
+#if QTAV_HAVE(AVBUFREF)
+        if (frame_pool && hwa.isEmpty()) {
+            codec_ctx->get_buffer2 = VideoFramePool::getBuffer2;
+            // deprecated in 58.134.100 (get_buffer2 must be thread safe since then) and removed in ffmpeg 5
+#if LIBAVCODEC_VERSION_INT < AV_VERSION_INT(58, 134, 100) || (defined(FF_API_THREAD_SAFE_CALLBACKS) && FF_API_THREAD_SAFE_CALLBACKS)
+            codec_ctx->thread_safe_callbacks = 1; // the pool is thread safe. avoid serializing frame threads
+#endif
+        } else {
+            codec_ctx->get_buffer2 = avcodec_default_get_buffer2;
+        }
+#endif //QTAV_HAVE(AVBUFREF)
         //CODEC_FLAG_EMU_EDGE: deprecated in ffmpeg >=? & libav>=10. always set by ffmpeg
 #if 0
         if (fast) {
@@ -251,6 +270,7 @@ public:
     int threads;
     int debug_mv;
     int bug;
+    bool frame_pool;
     QString hwa;
 };
 
@@ -400,6 +420,27 @@ QString VideoDecoderFFmpeg::hwaccel() const
     return d_func().hwa;
 }
 
+void VideoDecoderFFmpeg::setFramePool(bool value)
+{
+    DPTR_D(VideoDecoderFFmpeg);
+    d.frame_pool = value;
+}
+
+bool VideoDecoderFFmpeg::framePool() const
+{
+    return d_func().frame_pool;
+}
+
+void VideoDecoderFFmpeg::setHugePages(bool value)
+{
+    VideoFramePool::instance().setHugePages(value);
+}
+
+bool VideoDecoderFFmpeg::hugePages() const
+{
+    return VideoFramePool::instance().hugePages();
+}
+
 //namespace {
 void i18n() {
     QObject::tr("codecName");
@@ -411,6 +452,8 @@ void i18n() {
     QObject::tr("thread_type");
     QObject::tr("vismv");
     QObject::tr("bug");
+    QObject::tr("frame_pool");
+    QObject::tr("huge_pages");
 }
 //}
 } //namespace QtAV
@@ -0,0 +1,304 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#include "VideoFramePool.h"
+#include <QtCore/QMutexLocker>
+#if defined(Q_OS_LINUX)
+#include <stdlib.h>
+#include <sys/mman.h>
+#endif
+#include "utils/Logger.h"
+
+#ifndef AV_CODEC_CAP_DR1
+#define AV_CODEC_CAP_DR1 CODEC_CAP_DR1
+#endif
+
+namespace QtAV {
+
+// a block header is stored before the data in the same allocation
+struct VideoFramePool::Block {
+    Bucket *bucket;
+    Block *next;
+    bool huge;
+};
+
+struct VideoFramePool::Bucket {
+    Bucket(int s) : size(s), free(0), nb_free(0) {}
+    int size;
+    Block *free;
+    int nb_free;
+};
+
+static const int kHugePageSize = 2*1024*1024;
+
+static VideoFramePool::Block* allocBlock(int size, bool huge)
+{
+    const size_t bytes = VideoFramePool::Alignment + size;
+    VideoFramePool::Block *b = 0;
+#if defined(Q_OS_LINUX) && defined(MADV_HUGEPAGE)
+    if (huge && bytes >= (size_t)kHugePageSize) {
+        void *p = 0;
+        const size_t huge_bytes = FFALIGN(bytes, kHugePageSize);
+        if (posix_memalign(&p, kHugePageSize, huge_bytes) == 0) {
+            madvise(p, huge_bytes, MADV_HUGEPAGE); // a hint. ok if thp is disabled
+            b = (VideoFramePool::Block*)p;
+            b->huge = true;
+            return b;
+        }
+    }
+#else
+    Q_UNUSED(huge);
+#endif
+    b = (VideoFramePool::Block*)qMallocAligned(bytes, VideoFramePool::Alignment);
+    if (b)
+        b->huge = false;
+    return b;
+}
+
+static void freeBlock(VideoFramePool::Block *b)
+{
+#if defined(Q_OS_LINUX) && defined(MADV_HUGEPAGE)
+    if (b->huge) {
+        free(b);
+        return;
+    }
+#endif
+    qFreeAligned(b);
+}
+
+VideoFramePool& VideoFramePool::instance()
+{
+    // never destroyed because frames may be released after static objects are destroyed
+    static VideoFramePool *pool = new VideoFramePool();
+    return *pool;
+}
+
+VideoFramePool::VideoFramePool()
+    : huge_pages(false)
+    , max_free(16)
+    , nb_used(0)
+    , nb_total(0)
+    , nb_bytes(0)
+    , idle(MemoryBudget::FramePool)
+{}
+
+VideoFramePool::~VideoFramePool()
+{
+    foreach (Bucket *bucket, buckets) {
+        while (bucket->free) {
+            Block *b = bucket->free;
+            bucket->free = b->next;
+            freeBlock(b);
+        }
+        delete bucket;
+    }
+}
+
+void VideoFramePool::setHugePages(bool value)
+{
+    QMutexLocker lock(&mutex);
+    Q_UNUSED(lock);
+    huge_pages = value;
+}
+
+bool VideoFramePool::hugePages() const
+{
+    QMutexLocker lock(&mutex);
+    Q_UNUSED(lock);
+    return huge_pages;
+}
+
+void VideoFramePool::setMaxFreeBuffers(int value)
+{
+    QMutexLocker lock(&mutex);
+    Q_UNUSED(lock);
+    max_free = qMax(0, value);
+}
+
+int VideoFramePool::maxFreeBuffers() const
+{
+    QMutexLocker lock(&mutex);
+    Q_UNUSED(lock);
+    return max_free;
+}
+
+int VideoFramePool::buffersInUse() const
+{
+    QMutexLocker lock(&mutex);
+    Q_UNUSED(lock);
+    return nb_used;
+}
+
+int VideoFramePool::buffers() const
+{
+    QMutexLocker lock(&mutex);
+    Q_UNUSED(lock);
+    return nb_total;
+}
+
+qint64 VideoFramePool::bytes() const
+{
+    QMutexLocker lock(&mutex);
+    Q_UNUSED(lock);
+    return nb_bytes;
+}
+
+uchar* VideoFramePool::get(int size, Block **block)
+{
+    bool huge = false;
+    Bucket *bucket = 0;
+    {
+        QMutexLocker lock(&mutex);
+        Q_UNUSED(lock);
+        foreach (Bucket *bk, buckets) {
+            if (bk->size == size) {
+                bucket = bk;
+                break;
+            }
+        }
+        if (!bucket) {
+            bucket = new Bucket(size);
+            buckets.append(bucket);
+        }
+        ++nb_used;
+        if (bucket->free) {
+            Block *b = bucket->free;
+            bucket->free = b->next;
+            --bucket->nb_free;
+            idle.add(-bucket->size);
+            *block = b;
+            return (uchar*)b + Alignment;
+        }
+        huge = huge_pages;
+    }
+    // allocate out of lock
+    Block *b = allocBlock(size, huge);
+    QMutexLocker lock(&mutex);
+    Q_UNUSED(lock);
+    if (!b) {
+        --nb_used;
+        return 0;
+    }
+    b->bucket = bucket;
+    b->next = 0;
+    ++nb_total;
+    nb_bytes += size;
+    *block = b;
+    return (uchar*)b + Alignment;
+}
+
+void VideoFramePool::put(Block *b)
+{
+    Bucket *bucket = b->bucket;
+    {
+        QMutexLocker lock(&mutex);
+        Q_UNUSED(lock);
+        --nb_used;
+        if (MemoryBudget::pressure() == MemoryBudget::Normal) {
+            if (bucket->nb_free < max_free) {
+                b->next = bucket->free;
+                bucket->free = b;
+                ++bucket->nb_free;
+                idle.add(bucket->size);
+                return;
+            }
+        } else {
+            // release idle buffers of this size too. they are freed in lock, rare
+            while (bucket->free) {
+                Block *f = bucket->free;
+                bucket->free = f->next;
+                --bucket->nb_free;
+                --nb_total;
+                nb_bytes -= bucket->size;
+                idle.add(-bucket->size);
+                freeBlock(f);
+            }
+        }
+        --nb_total;
+        nb_bytes -= bucket->size;
+    }
+    freeBlock(b);
+}
+
+void VideoFramePool::release(void *opaque, uint8_t *data)
+{
+    Q_UNUSED(data);
+    instance().put((Block*)opaque);
+}
+
+#if QTAV_HAVE(AVBUFREF)
+int VideoFramePool::getBuffer2(AVCodecContext *avctx, AVFrame *frame, int flags)
+{
+    const AVPixelFormat fmt = (AVPixelFormat)frame->format;
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(fmt);
+    // palette is filled by avcodec internally
+    int no_pool = AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_PAL;
+#ifdef AV_PIX_FMT_FLAG_PSEUDOPAL
+    no_pool |= AV_PIX_FMT_FLAG_PSEUDOPAL;
+#endif
+    if (!avctx->codec || !(avctx->codec->capabilities & AV_CODEC_CAP_DR1)
+            || !desc || (desc->flags & no_pool)
+            || frame->width <= 0 || frame->height <= 0)
+        return avcodec_default_get_buffer2(avctx, frame, flags);
+    int w = frame->width;
+    int h = frame->height;
+    int stride_align[AV_NUM_DATA_POINTERS];
+    avcodec_align_dimensions2(avctx, &w, &h, stride_align);
+    int linesize[4];
+    int unaligned = 0;
+    // increase width until all line sizes are aligned. see ffmpeg update_frame_pool()
+    do {
+        if (av_image_fill_linesizes(linesize, fmt, w) < 0)
+            return avcodec_default_get_buffer2(avctx, frame, flags);
+        w += w & ~(w - 1);
+        unaligned = 0;
+        for (int i = 0; i < 4; ++i)
+            unaligned |= linesize[i] % qMax<int>(stride_align[i], Alignment);
+    } while (unaligned);
+    // planes in 1 buffer. offsets are multiple of line size, so all planes are aligned
+    uint8_t *planes[4];
+    const int size = av_image_fill_pointers(planes, fmt, h, NULL, linesize);
+    if (size < 0)
+        return avcodec_default_get_buffer2(avctx, frame, flags);
+    Block *block = 0;
+    uchar *data = instance().get(size + Padding, &block);
+    if (!data) {
+        qWarning("VideoFramePool: failed to allocate %d bytes", size + Padding);
+        return AVERROR(ENOMEM);
+    }
+    frame->buf[0] = av_buffer_create(data, size + Padding, VideoFramePool::release, block, 0);
+    if (!frame->buf[0]) {
+        instance().put(block);
+        return AVERROR(ENOMEM);
+    }
+    for (int i = 0; i < AV_NUM_DATA_POINTERS; ++i) {
+        frame->data[i] = NULL;
+        frame->linesize[i] = 0;
+    }
+    for (int i = 0; i < 4 && linesize[i]; ++i) {
+        frame->data[i] = data + (planes[i] - planes[0]);
+        frame->linesize[i] = linesize[i];
+    }
+    frame->extended_data = frame->data;
+    return 0;
+}
+#endif //QTAV_HAVE(AVBUFREF)
+} //namespace QtAV
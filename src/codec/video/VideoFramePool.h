@@ -0,0 +1,84 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#ifndef QTAV_VIDEOFRAMEPOOL_H
+#define QTAV_VIDEOFRAMEPOOL_H
+
+#include <QtCore/QMutex>
+#include <QtCore/QVector>
+#include "QtAV/MemoryBudget.h"
+#include "QtAV/private/AVCompat.h"
+
+namespace QtAV {
+
+/*!
+ * \brief The VideoFramePool class
+ * Process wide buffer pool for software video decoders, used as AVCodecContext.get_buffer2.
+ * Buffers are bucketed by size. Planes and line sizes are Alignment bytes aligned and the buffer is padded,
+ * so SIMD code, ImageConverter and OpenGL upload can use decoded planes directly.
+ * A buffer goes back to the pool when the last reference is released, e.g. the last VideoFrame is destroyed.
+ * Idle buffers are accounted in MemoryBudget, and are released instead of kept if the budget is nearly exhausted.
+ */
+class VideoFramePool
+{
+public:
+    enum { Alignment = 64, Padding = 64 };
+    struct Block; // internal
+    struct Bucket;
+    static VideoFramePool& instance();
+#if QTAV_HAVE(AVBUFREF)
+    /*!
+     * \brief getBuffer2
+     * AVCodecContext.get_buffer2 callback. avcodec_default_get_buffer2 is used if the decoder does not support
+     * direct rendering, or for hw and palette formats.
+     */
+    static int getBuffer2(AVCodecContext* avctx, AVFrame* frame, int flags);
+#endif //QTAV_HAVE(AVBUFREF)
+    /*!
+     * \brief setHugePages
+     * Use transparent huge pages for large buffers if supported (linux). Only affects buffers allocated later.
+     */
+    void setHugePages(bool value);
+    bool hugePages() const;
+    // max number of idle buffers kept for each size
+    void setMaxFreeBuffers(int value);
+    int maxFreeBuffers() const;
+    int buffersInUse() const;
+    int buffers() const; // in use + idle
+    qint64 bytes() const; // total allocated bytes
+private:
+    VideoFramePool();
+    ~VideoFramePool();
+    Q_DISABLE_COPY(VideoFramePool)
+    uchar* get(int size, Block** block);
+    void put(Block* b);
+    static void release(void* opaque, uint8_t* data);
+
+    mutable QMutex mutex;
+    QVector<Bucket*> buckets;
+    bool huge_pages;
+    int max_free;
+    int nb_used, nb_total;
+    qint64 nb_bytes;
+    MemoryBudget::Account idle;
+};
+} //namespace QtAV
+#endif // QTAV_VIDEOFRAMEPOOL_H
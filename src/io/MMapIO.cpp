@@ -0,0 +1,290 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#include "QtAV/MediaIO.h"
+#include "QtAV/private/MediaIO_p.h"
+#include "QtAV/private/mkid.h"
+#include "QtAV/private/factory.h"
+#include <QtCore/QFile>
+#include <string.h> //memcpy
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#include "utils/internal.h"
+#include "utils/Logger.h"
+
+namespace QtAV {
+// read ahead is doubled for each sequential read until max, and reset to min after a seek
+static const qint64 kReadAheadMin = 256LL*1024LL;
+static const qint64 kReadAheadMax = 8LL*1024LL*1024LL;
+// sequential bytes to tell the kernel that the access is sequential
+static const qint64 kSequentialBytes = 1024LL*1024LL;
+// the whole file is mapped on 64bit. a moving window is used on 32bit to save address space
+static const qint64 kWindowSize = sizeof(void*) >= 8 ? 0 : 64LL*1024LL*1024LL;
+static const qint64 kWindowAlign = 64LL*1024LL; // allocation granularity on windows, page size multiple on unix
+
+static const char kMMapName[] = "MMap";
+class MMapIOPrivate;
+class MMapIO Q_DECL_FINAL: public MediaIO
+{
+    DPTR_DECLARE_PRIVATE(MMapIO)
+public:
+    MMapIO();
+    QString name() const Q_DECL_OVERRIDE { return QLatin1String(kMMapName);}
+    const QStringList& protocols() const Q_DECL_OVERRIDE
+    {
+        static QStringList p = QStringList() << QStringLiteral("mmap");
+        return p;
+    }
+    bool isSeekable() const Q_DECL_OVERRIDE;
+    qint64 read(char *data, qint64 maxSize) Q_DECL_OVERRIDE;
+    bool seek(qint64 offset, int from) Q_DECL_OVERRIDE;
+    qint64 position() const Q_DECL_OVERRIDE;
+    qint64 size() const Q_DECL_OVERRIDE;
+protected:
+    void onUrlChanged() Q_DECL_OVERRIDE;
+};
+typedef MMapIO MediaIOMMap;
+static const MediaIOId MediaIOId_MMap = mkid::id32base36_4<'M','M','a','p'>::value;
+FACTORY_REGISTER(MediaIO, MMap, kMMapName)
+
+class MMapIOPrivate Q_DECL_FINAL: public MediaIOPrivate
+{
+public:
+    MMapIOPrivate()
+        : MediaIOPrivate()
+        , map(0)
+        , map_offset(0)
+        , map_size(0)
+        , pos(0)
+        , size(0)
+        , last_end(-1)
+        , ra_end(0)
+        , ra_size(kReadAheadMin)
+        , seq_bytes(0)
+        , seq_hint(false)
+        , map_failed(false)
+        , page_size(4096)
+    {
+#ifdef Q_OS_UNIX
+        const long ps = sysconf(_SC_PAGESIZE);
+        if (ps > 0)
+            page_size = ps;
+#endif
+    }
+    ~MMapIOPrivate() { close();}
+    void close() {
+        unmap();
+        if (file.isOpen())
+            file.close();
+        pos = 0;
+        size = 0;
+        map_failed = false;
+    }
+    void unmap() {
+        if (map)
+            file.unmap(map);
+        map = 0;
+        map_offset = map_size = 0;
+        last_end = -1;
+        ra_end = 0;
+        ra_size = kReadAheadMin;
+        seq_bytes = 0;
+        seq_hint = false;
+    }
+    // ensure the mapped window contains offset
+    bool mapAt(qint64 offset) {
+        if (map && offset >= map_offset && offset < map_offset + map_size)
+            return true;
+        if (map_failed || (map && kWindowSize <= 0)) // whole file is mapped
+            return false;
+        unmap();
+        qint64 start = 0;
+        qint64 len = size;
+        if (kWindowSize > 0) {
+            start = offset/kWindowAlign*kWindowAlign;
+            len = qMin(kWindowSize, size - start);
+        }
+        if (len <= 0)
+            return false;
+        map = file.map(start, len);
+        if (!map) {
+            map_failed = true;
+            qWarning() << "MMapIO failed to map [" << file.fileName() << "]: " << file.errorString();
+            return false;
+        }
+        map_offset = start;
+        map_size = len;
+        return true;
+    }
+    void advise(qint64 from, qint64 len, int advice) {
+#ifdef Q_OS_UNIX
+        from = qMax(from, map_offset);
+        len = qMin(len, map_offset + map_size - from);
+        if (!map || len <= 0)
+            return;
+        // Qt maps from an aligned offset, so the aligned address is still in the mapping
+        quintptr addr = quintptr(map + (from - map_offset));
+        const quintptr aligned = addr & ~quintptr(page_size - 1);
+        if (madvise((void*)aligned, size_t(len + qint64(addr - aligned)), advice) != 0)
+            qDebug("MMapIO madvise(%d) error", advice);
+#else
+        Q_UNUSED(from);
+        Q_UNUSED(len);
+        Q_UNUSED(advice);
+#endif
+    }
+    // demuxers read sequentially, seek to probe or index (e.g. mp4 moov at the end), then read sequentially again
+    void adviseRead(qint64 from, qint64 len) {
+#ifdef Q_OS_UNIX
+        const bool sequential = from == last_end;
+        last_end = from + len;
+        if (!sequential) {
+            if (seq_hint)
+                advise(map_offset, map_size, MADV_NORMAL);
+            seq_hint = false;
+            seq_bytes = 0;
+            ra_size = kReadAheadMin;
+            ra_end = from;
+        } else {
+            seq_bytes += len;
+            if (!seq_hint && seq_bytes >= kSequentialBytes) {
+                // aggressive kernel read ahead, and pages behind can be dropped earlier
+                advise(map_offset, map_size, MADV_SEQUENTIAL);
+                seq_hint = true;
+            }
+        }
+        // request the next range when half of the read ahead range is consumed
+        if (last_end + ra_size/2 < ra_end)
+            return;
+        const qint64 start = qMax(ra_end, last_end);
+        const qint64 end = qMin(last_end + ra_size, map_offset + map_size);
+        if (end > start)
+            advise(start, end - start, MADV_WILLNEED);
+        ra_end = end;
+        if (sequential)
+            ra_size = qMin(ra_size*2, kReadAheadMax);
+#else
+        Q_UNUSED(from);
+        Q_UNUSED(len);
+#endif
+    }
+
+    QFile file;
+    uchar *map;
+    qint64 map_offset;
+    qint64 map_size;
+    qint64 pos;
+    qint64 size;
+    qint64 last_end;
+    qint64 ra_end;
+    qint64 ra_size;
+    qint64 seq_bytes;
+    bool seq_hint;
+    bool map_failed;
+    qint64 page_size;
+};
+
+MMapIO::MMapIO() : MediaIO(*new MMapIOPrivate()) {}
+
+bool MMapIO::isSeekable() const
+{
+    return d_func().file.isOpen();
+}
+
+qint64 MMapIO::read(char *data, qint64 maxSize)
+{
+    DPTR_D(MMapIO);
+    if (!d.file.isOpen() || maxSize <= 0)
+        return 0;
+    qint64 len = qMin(maxSize, d.size - d.pos);
+    if (len <= 0)
+        return 0;
+    if (!d.mapAt(d.pos)) {
+        // not mappable, e.g. a special file
+        if (!d.file.seek(d.pos))
+            return -1;
+        len = d.file.read(data, len);
+        if (len > 0)
+            d.pos += len;
+        return len;
+    }
+    const qint64 from = d.pos;
+    qint64 done = 0;
+    while (done < len) {
+        if (!d.mapAt(d.pos))
+            break;
+        const qint64 n = qMin(len - done, d.map_offset + d.map_size - d.pos);
+        memcpy(data + done, d.map + (d.pos - d.map_offset), n);
+        done += n;
+        d.pos += n;
+    }
+    d.adviseRead(from, done);
+    return done;
+}
+
+bool MMapIO::seek(qint64 offset, int from)
+{
+    DPTR_D(MMapIO);
+    if (!d.file.isOpen())
+        return false;
+    if (from == SEEK_END)
+        offset = d.size + offset;
+    else if (from == SEEK_CUR)
+        offset = d.pos + offset;
+    if (offset < 0 || offset > d.size)
+        return false;
+    d.pos = offset;
+    return true;
+}
+
+qint64 MMapIO::position() const
+{
+    return d_func().pos;
+}
+
+qint64 MMapIO::size() const
+{
+    return d_func().size;
+}
+
+void MMapIO::onUrlChanged()
+{
+    DPTR_D(MMapIO);
+    d.close();
+    QString path(url());
+    if (path.startsWith(QLatin1String("mmap:")))
+        path = path.mid(5);
+    if (path.startsWith(QLatin1String("file:")))
+        path = Internal::Path::toLocal(path);
+    d.file.setFileName(path);
+    if (path.isEmpty())
+        return;
+    if (!d.file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Failed to open [" << d.file.fileName() << "]: " << d.file.errorString();
+        return;
+    }
+    d.size = d.file.size();
+    // map now, so a file that can not be mapped falls back to read() from the beginning
+    d.mapAt(0);
+}
+} //namespace QtAV
@@ -34,6 +34,9 @@ extern bool RegisterMediaIOQIODevice_Man();
 extern bool RegisterMediaIOQFile_Man();
 extern bool RegisterMediaIOWinRT_Man();
 extern bool RegisterMediaIOSatIP_Man();
+extern bool RegisterMediaIOMMap_Man();
+extern bool RegisterMediaIOPrefetch_Man();
+extern bool RegisterMediaIORTPTS_Man();
 
 void MediaIO::registerAll()
 {
@@ -44,6 +47,9 @@ void MediaIO::registerAll()
     RegisterMediaIOQIODevice_Man();
     RegisterMediaIOQFile_Man();
     RegisterMediaIOSatIP_Man();
+    RegisterMediaIOMMap_Man();
+    RegisterMediaIOPrefetch_Man();
+    RegisterMediaIORTPTS_Man();
 #ifdef Q_OS_WINRT
     RegisterMediaIOWinRT_Man();
 #endif
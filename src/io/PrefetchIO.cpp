@@ -0,0 +1,440 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#include "QtAV/MediaIO.h"
+#include "QtAV/private/MediaIO_p.h"
+#include "QtAV/private/mkid.h"
+#include "QtAV/private/factory.h"
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+#include <QtCore/QWaitCondition>
+#include <string.h> //memcpy
+#include "utils/Logger.h"
+
+namespace QtAV {
+static const int kCapacityDefault = 8*1024*1024;
+static const int kCapacityMin = 256*1024;
+static const qint64 kReadChunk = 64*1024; // max bytes of a source read
+static const qreal kRateWeight = 0.2; // for throughput average
+
+class PrefetchIOPrivate;
+class PrefetchIO : public MediaIO
+{
+    Q_OBJECT
+    Q_PROPERTY(QtAV::MediaIO* source READ source WRITE setSource NOTIFY sourceChanged)
+    Q_PROPERTY(int capacity READ capacity WRITE setCapacity)
+    Q_PROPERTY(qint64 buffered READ buffered)
+    Q_PROPERTY(qreal fillLevel READ fillLevel)
+    Q_PROPERTY(qreal throughput READ throughput)
+    DPTR_DECLARE_PRIVATE(PrefetchIO)
+public:
+    PrefetchIO();
+    ~PrefetchIO();
+    QString name() const Q_DECL_OVERRIDE;
+    const QStringList& protocols() const Q_DECL_OVERRIDE;
+    /*!
+     * \brief setSource
+     * The wrapped io. It's read in another thread and MUST NOT be used outside until source is changed or this is destroyed.
+     * It's owned by the caller. A source created from url "prefetch:xxx" is owned by this.
+     */
+    void setSource(MediaIO *io);
+    MediaIO* source() const;
+    /// ring buffer size in bytes. default is 8MB
+    void setCapacity(int value);
+    int capacity() const;
+    /// bytes ready after the read position
+    qint64 buffered() const;
+    /// buffered()/capacity()
+    qreal fillLevel() const;
+    /// bytes per second of reading the source
+    qreal throughput() const;
+
+    bool isSeekable() const Q_DECL_OVERRIDE;
+    bool isVariableSize() const Q_DECL_OVERRIDE;
+    QString formatForced() const Q_DECL_OVERRIDE;
+    qint64 read(char *data, qint64 maxSize) Q_DECL_OVERRIDE;
+    bool seek(qint64 offset, int from) Q_DECL_OVERRIDE;
+    qint64 position() const Q_DECL_OVERRIDE;
+    qint64 size() const Q_DECL_OVERRIDE;
+Q_SIGNALS:
+    void sourceChanged();
+protected:
+    void onUrlChanged() Q_DECL_OVERRIDE;
+};
+typedef PrefetchIO MediaIOPrefetch;
+static const MediaIOId MediaIOId_Prefetch = mkid::id32base36_6<'P','r','e','f','t','h'>::value;
+static const char kPrefetchName[] = "Prefetch";
+FACTORY_REGISTER(MediaIO, Prefetch, kPrefetchName)
+
+class PrefetchThread : public QThread
+{
+public:
+    PrefetchThread(PrefetchIOPrivate *d) : QThread(0), m_d(d) {}
+protected:
+    void run() Q_DECL_OVERRIDE;
+private:
+    PrefetchIOPrivate *m_d;
+};
+
+class PrefetchIOPrivate : public MediaIOPrivate
+{
+public:
+    PrefetchIOPrivate()
+        : MediaIOPrivate()
+        , src(0)
+        , own_src(false)
+        , seekable(false)
+        , variable_size(false)
+        , src_size(0)
+        , pos(0)
+        , buf_pos(0)
+        , buf_end(0)
+        , src_pos(0)
+        , generation(0)
+        , eof(false)
+        , error(false)
+        , stop(true)
+        , rate(0)
+        , thread(this)
+    {
+        ring.resize(kCapacityDefault);
+    }
+    ~PrefetchIOPrivate() {
+        stopThread();
+        if (own_src)
+            delete src;
+    }
+    void startThread() {
+        stopThread();
+        if (!src)
+            return;
+        // the source is used only by the thread from now on
+        seekable = src->isSeekable();
+        variable_size = src->isVariableSize();
+        format = src->formatForced();
+        src_size = src->size();
+        src_pos = src->position();
+        pos = buf_pos = buf_end = src_pos;
+        eof = error = false;
+        rate = 0;
+        stop = false;
+        thread.start();
+    }
+    void stopThread() {
+        {
+            QMutexLocker lock(&mutex);
+            Q_UNUSED(lock);
+            stop = true;
+            cond_space.wakeAll();
+            cond_data.wakeAll();
+        }
+        thread.wait();
+    }
+    // the window will start from pos. called with lock
+    void retarget() {
+        buf_pos = buf_end = pos;
+        eof = error = false;
+        ++generation;
+        cond_space.wakeAll();
+    }
+    qint64 capacity() const { return ring.size();}
+    // bytes before the read position kept for small backward seeks
+    qint64 backBytes() const { return capacity()/8;}
+    void readLoop();
+
+    MediaIO *src;
+    bool own_src;
+    // cached source info, the source is used by the thread only
+    bool seekable;
+    bool variable_size;
+    QString format;
+    qint64 src_size;
+
+    mutable QMutex mutex;
+    QWaitCondition cond_space; // wakes up the thread
+    QWaitCondition cond_data; // wakes up the reader
+    QByteArray ring; // byte at offset x is ring[x % capacity]
+    qint64 pos; // read position
+    qint64 buf_pos, buf_end; // buffered window [buf_pos, buf_end)
+    qint64 src_pos; // used by the thread only
+    int generation; // increased when the window restarts at a new position
+    bool eof;
+    bool error;
+    bool stop;
+    qreal rate;
+    PrefetchThread thread;
+};
+
+void PrefetchThread::run()
+{
+    m_d->readLoop();
+}
+
+void PrefetchIOPrivate::readLoop()
+{
+    QElapsedTimer timer;
+    for (;;) {
+        qint64 offset = 0;
+        qint64 len = 0;
+        int gen = 0;
+        char *dst = 0;
+        {
+            QMutexLocker lock(&mutex);
+            Q_UNUSED(lock);
+            for (;;) {
+                if (stop)
+                    return;
+                // drop bytes too far behind the read position
+                if (pos <= buf_end)
+                    buf_pos = qMax(buf_pos, pos - backBytes());
+                const qint64 free = capacity() - (buf_end - buf_pos);
+                if (!eof && !error && free > 0) {
+                    offset = buf_end;
+                    const qint64 index = offset % capacity();
+                    len = qMin(qMin(free, capacity() - index), kReadChunk);
+                    dst = ring.data() + index;
+                    gen = generation;
+                    break;
+                }
+                cond_space.wait(&mutex);
+            }
+        }
+        // no one else accesses [buf_end, buf_end + len) of the ring, so read into it without lock
+        bool ok = true;
+        if (src_pos != offset) {
+            ok = seekable && src->seek(offset, SEEK_SET);
+            if (ok)
+                src_pos = offset;
+            else
+                qWarning("PrefetchIO failed to seek source to %lld", offset);
+        }
+        qint64 n = 0;
+        if (ok) {
+            timer.start();
+            n = src->read(dst, len);
+            if (n > 0) {
+                src_pos += n;
+                const qint64 ns = qMax<qint64>(1LL, timer.nsecsElapsed());
+                const qreal r = qreal(n)*1e9/qreal(ns);
+                QMutexLocker lock(&mutex);
+                Q_UNUSED(lock);
+                rate = rate <= 0 ? r : rate*(1.0 - kRateWeight) + r*kRateWeight;
+            }
+        }
+        QMutexLocker lock(&mutex);
+        Q_UNUSED(lock);
+        if (gen != generation) // retargeted while reading
+            continue;
+        if (!ok || n < 0)
+            error = true;
+        else if (n == 0)
+            eof = true;
+        else
+            buf_end += n;
+        cond_data.wakeAll();
+    }
+}
+
+PrefetchIO::PrefetchIO() : MediaIO(*new PrefetchIOPrivate()) {}
+
+PrefetchIO::~PrefetchIO()
+{
+    d_func().stopThread();
+}
+
+QString PrefetchIO::name() const { return QLatin1String(kPrefetchName);}
+
+const QStringList& PrefetchIO::protocols() const
+{
+    static QStringList p = QStringList() << QStringLiteral("prefetch");
+    return p;
+}
+
+void PrefetchIO::setSource(MediaIO *io)
+{
+    DPTR_D(PrefetchIO);
+    if (d.src == io)
+        return;
+    d.stopThread();
+    if (d.own_src)
+        delete d.src;
+    d.own_src = false;
+    d.src = io;
+    d.startThread();
+    Q_EMIT sourceChanged();
+}
+
+MediaIO* PrefetchIO::source() const
+{
+    return d_func().src;
+}
+
+void PrefetchIO::setCapacity(int value)
+{
+    DPTR_D(PrefetchIO);
+    value = qMax(value, kCapacityMin);
+    if (value == d.capacity())
+        return;
+    const bool running = d.thread.isRunning();
+    const qint64 pos = d.pos;
+    d.stopThread();
+    d.ring.resize(value);
+    if (!running)
+        return;
+    d.startThread();
+    seek(pos, SEEK_SET);
+}
+
+int PrefetchIO::capacity() const
+{
+    return d_func().ring.size();
+}
+
+qint64 PrefetchIO::buffered() const
+{
+    DPTR_D(const PrefetchIO);
+    QMutexLocker lock(&d.mutex);
+    Q_UNUSED(lock);
+    return qMax<qint64>(0LL, d.buf_end - d.pos);
+}
+
+qreal PrefetchIO::fillLevel() const
+{
+    return qreal(buffered())/qreal(capacity());
+}
+
+qreal PrefetchIO::throughput() const
+{
+    DPTR_D(const PrefetchIO);
+    QMutexLocker lock(&d.mutex);
+    Q_UNUSED(lock);
+    return d.rate;
+}
+
+bool PrefetchIO::isSeekable() const
+{
+    return d_func().seekable;
+}
+
+bool PrefetchIO::isVariableSize() const
+{
+    return d_func().variable_size;
+}
+
+QString PrefetchIO::formatForced() const
+{
+    return d_func().format;
+}
+
+qint64 PrefetchIO::read(char *data, qint64 maxSize)
+{
+    DPTR_D(PrefetchIO);
+    if (!d.src || maxSize <= 0)
+        return 0;
+    QMutexLocker lock(&d.mutex);
+    Q_UNUSED(lock);
+    if (d.pos < d.buf_pos || d.pos > d.buf_end) {
+        if (!d.seekable)
+            return -1;
+        d.retarget();
+    }
+    while (d.pos == d.buf_end && !d.eof && !d.error && !d.stop)
+        d.cond_data.wait(&d.mutex);
+    if (d.pos == d.buf_end)
+        return d.error ? -1 : 0;
+    const qint64 len = qMin(maxSize, d.buf_end - d.pos);
+    const qint64 index = d.pos % d.capacity();
+    const qint64 n = qMin(len, d.capacity() - index);
+    memcpy(data, d.ring.constData() + index, n);
+    if (n < len) // wrapped
+        memcpy(data + n, d.ring.constData(), len - n);
+    d.pos += len;
+    d.cond_space.wakeAll();
+    return len;
+}
+
+bool PrefetchIO::seek(qint64 offset, int from)
+{
+    DPTR_D(PrefetchIO);
+    if (!d.src)
+        return false;
+    QMutexLocker lock(&d.mutex);
+    Q_UNUSED(lock);
+    if (from == SEEK_END) {
+        if (d.src_size <= 0)
+            return false;
+        offset = d.src_size + offset;
+    } else if (from == SEEK_CUR) {
+        offset = d.pos + offset;
+    }
+    if (offset < 0)
+        return false;
+    const bool buffered = offset >= d.buf_pos && offset <= d.buf_end;
+    if (!buffered && !d.seekable)
+        return false;
+    d.pos = offset;
+    // start reading from the new position now instead of in the next read()
+    if (!buffered)
+        d.retarget();
+    return true;
+}
+
+qint64 PrefetchIO::position() const
+{
+    return d_func().pos;
+}
+
+qint64 PrefetchIO::size() const
+{
+    return d_func().src_size;
+}
+
+void PrefetchIO::onUrlChanged()
+{
+    DPTR_D(PrefetchIO);
+    d.stopThread();
+    if (d.own_src)
+        delete d.src;
+    d.src = 0;
+    d.own_src = false;
+    QString path(url());
+    if (path.startsWith(QLatin1String("prefetch:")))
+        path = path.mid(9);
+    if (path.isEmpty())
+        return;
+    MediaIO *io = MediaIO::createForUrl(path);
+    if (!io) { // a local file path
+        io = MediaIO::create("QFile");
+        if (io)
+            io->setUrl(path);
+    }
+    if (!io) {
+        qWarning() << "PrefetchIO: no MediaIO for " << path;
+        return;
+    }
+    d.src = io;
+    d.own_src = true;
+    d.startThread();
+    Q_EMIT sourceChanged();
+}
+} //namespace QtAV
+#include "PrefetchIO.moc"
@@ -0,0 +1,431 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#include "RTPReceiver.h"
+#include <QtNetwork/QUdpSocket>
+#include <string.h> //memcpy, memset
+#if defined(Q_OS_LINUX) && !defined(Q_OS_ANDROID)
+#include <poll.h>
+#include <sys/socket.h>
+#define RTP_HAVE_RECVMMSG 1
+#endif
+#include "utils/Logger.h"
+
+namespace QtAV {
+static const int kBatch = 32; // max datagrams of 1 recvmmsg
+static const int kPollTimeout = 10; // ms. also the interval to check late packets and stop
+static const int kResync = 3000; // sequence number distance regarded as a new stream
+static const int kMaxWindow = 1024;
+
+RTPReceiver::RTPReceiver()
+    : QThread(0)
+    , m_slot_count(1024)
+    , m_slot_size(2048)
+    , m_socket(0)
+    , m_window(32)
+    , m_pending_count(0)
+    , m_max_delay(50)
+    , m_conceal(false)
+    , m_started(false)
+    , m_next(0)
+    , m_highest(0)
+    , m_gap_time(-1)
+    , m_payload(0)
+    , m_has_transit(false)
+    , m_transit(0)
+    , m_jitter_ts(0)
+    , m_cur(0)
+    , m_buffered(0)
+    , m_received(0)
+    , m_lost(0)
+    , m_reordered(0)
+    , m_late(0)
+    , m_duplicated(0)
+    , m_concealed(0)
+    , m_jitter(0)
+    , m_latency(0)
+{
+}
+
+RTPReceiver::~RTPReceiver()
+{
+    stop();
+    delete m_socket; // not started
+}
+
+void RTPReceiver::setSlots(int count, int bytes)
+{
+    if (isRunning()) {
+        qWarning("RTPReceiver: can not change slots while receiving");
+        return;
+    }
+    m_slot_count = qMax(count, 4);
+    m_slot_size = qMax(bytes, 188);
+}
+
+// (re)initialize slots and queues. not receiving
+void RTPReceiver::allocate()
+{
+    const int count = m_slot_count;
+    if (m_block.size() != count*m_slot_size)
+        m_block = QByteArray(count*m_slot_size, 0);
+    m_slots.resize(count);
+    m_ready.clear();
+    m_free.clear();
+    m_spare.clear();
+    m_spare.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        Slot &s = m_slots[i];
+        s.data = m_block.data() + i*m_slot_size;
+        s.size = s.begin = s.pos = 0;
+        s.seq = 0;
+        s.time = 0;
+        m_spare.append(&s);
+    }
+    // never full. the slot count is the limit
+    m_ready.setCapacity(count + 1);
+    m_ready.setThreshold(1);
+    m_ready.blockFull(false);
+    m_free.setCapacity(count + 1);
+    m_free.setThreshold(1);
+    m_free.blockFull(false);
+    m_cur = 0;
+    m_buffered.fetchAndStoreOrdered(0);
+}
+
+void RTPReceiver::setReorderWindow(int packets)
+{
+    if (isRunning()) {
+        qWarning("RTPReceiver: can not change reorder window while receiving");
+        return;
+    }
+    // slot of seq is seq % m_window. it must divide 65536, otherwise sequence numbers around the wrap share a slot
+    int w = 1;
+    while (w < packets && w < kMaxWindow)
+        w <<= 1;
+    m_window = w;
+}
+
+void RTPReceiver::start(QUdpSocket *socket)
+{
+    if (isRunning())
+        stop();
+    if (m_socket != socket)
+        delete m_socket;
+    m_socket = socket;
+    if (!m_socket)
+        return;
+    allocate(); // slots are allocated only if used. take back all slots
+    m_pending = QVector<Slot*>(m_window, (Slot*)0);
+    m_pending_count = 0;
+    m_started = false;
+    m_gap_time = -1;
+    m_payload = 0;
+    m_has_transit = false;
+    m_jitter_ts = 0;
+    m_ready.blockEmpty(true);
+    m_free.blockEmpty(true);
+    m_clock.start();
+    m_socket->moveToThread(this);
+    QThread::start();
+}
+
+void RTPReceiver::stop()
+{
+    if (!isRunning())
+        return;
+    requestInterruption();
+    m_free.blockEmpty(false);
+    m_ready.blockEmpty(false);
+    wait();
+    m_socket = 0; // deleted in run()
+}
+
+qint64 RTPReceiver::read(char *data, qint64 maxSize, unsigned long timeout)
+{
+    qint64 done = 0;
+    while (done < maxSize) {
+        if (!m_cur) {
+            bool ok = false;
+            // wait only for the first byte
+            m_cur = m_ready.take(done > 0 ? 0 : timeout, &ok);
+            if (!ok) {
+                m_cur = 0;
+                break;
+            }
+            m_latency.fetchAndStoreRelaxed(int(m_clock.elapsed() - m_cur->time));
+        }
+        const qint64 n = qMin<qint64>(maxSize - done, m_cur->size - m_cur->pos);
+        memcpy(data + done, m_cur->data + m_cur->pos, n);
+        m_cur->pos += n;
+        done += n;
+        if (m_cur->pos >= m_cur->size) {
+            m_free.put(m_cur);
+            m_cur = 0;
+        }
+    }
+    m_buffered.fetchAndAddOrdered(-done);
+    return done;
+}
+
+RTPReceiver::Stats RTPReceiver::stats() const
+{
+    Stats s;
+    s.received = spsc::loadAcquire(m_received);
+    s.lost = spsc::loadAcquire(m_lost);
+    s.reordered = spsc::loadAcquire(m_reordered);
+    s.late = spsc::loadAcquire(m_late);
+    s.duplicated = spsc::loadAcquire(m_duplicated);
+    s.concealed = spsc::loadAcquire(m_concealed);
+    s.jitter = qreal(spsc::loadAcquire(m_jitter))/1000.0;
+    s.latency = spsc::loadAcquire(m_latency);
+    return s;
+}
+
+RTPReceiver::Slot* RTPReceiver::acquire(unsigned long timeout)
+{
+    if (m_spare.isEmpty()) {
+        // read() is slow. datagrams stay in the socket buffer
+        bool ok = false;
+        Slot *s = m_free.take(timeout, &ok);
+        if (!ok)
+            return 0;
+        m_spare.append(s);
+    }
+    Slot *s = m_spare.takeLast();
+    s->size = s->begin = s->pos = 0;
+    return s;
+}
+
+void RTPReceiver::deliver(Slot *s)
+{
+    s->pos = s->begin;
+    m_buffered.fetchAndAddOrdered(s->size - s->begin);
+    m_ready.put(s);
+}
+
+void RTPReceiver::deliverInOrder()
+{
+    while (m_pending_count > 0) {
+        Slot *&p = m_pending[m_next % m_window];
+        if (!p)
+            break;
+        deliver(p);
+        p = 0;
+        --m_pending_count;
+        ++m_next;
+    }
+    if (m_pending_count <= 0)
+        m_gap_time = -1;
+    else if (m_gap_time < 0)
+        m_gap_time = m_clock.elapsed();
+}
+
+// give up waiting for m_next
+void RTPReceiver::skip()
+{
+    Slot *&p = m_pending[m_next % m_window];
+    if (p) {
+        deliver(p);
+        p = 0;
+        --m_pending_count;
+    } else {
+        m_lost.fetchAndAddRelaxed(1);
+        if (m_conceal)
+            conceal();
+    }
+    ++m_next;
+}
+
+void RTPReceiver::conceal()
+{
+    // assume the lost payload is as large as the latest one
+    if (m_payload <= 0 || m_payload % 188)
+        return;
+    Slot *s = acquire(0);
+    if (!s)
+        return;
+    for (int i = 0; i < m_payload; i += 188) {
+        uchar *p = (uchar*)s->data + i;
+        p[0] = 0x47;
+        p[1] = 0x1f; // pid 0x1fff
+        p[2] = 0xff;
+        p[3] = 0x10; // payload only
+        memset(p + 4, 0xff, 184);
+    }
+    s->size = m_payload;
+    s->time = m_clock.elapsed();
+    m_concealed.fetchAndAddRelaxed(1);
+    deliver(s);
+}
+
+void RTPReceiver::updateJitter(quint32 timestamp)
+{
+    const qint64 arrival = m_clock.nsecsElapsed()*9LL/100000LL; // 90kHz
+    // the timestamp wraps around
+    const qint64 transit = arrival - qint64(timestamp);
+    if (m_has_transit) {
+        const qint64 d = qAbs(qint64(qint32(quint32(transit - m_transit))));
+        m_jitter_ts += (qreal(d) - m_jitter_ts)/16.0;
+        m_jitter.fetchAndStoreRelaxed(int(m_jitter_ts*1000.0/90.0));
+    }
+    m_transit = transit;
+    m_has_transit = true;
+}
+
+void RTPReceiver::flushLate(bool all)
+{
+    if (m_pending_count <= 0)
+        return;
+    if (!all && (m_gap_time < 0 || m_clock.elapsed() - m_gap_time < m_max_delay))
+        return;
+    // skip the gap, or everything
+    do {
+        skip();
+    } while (m_pending_count > 0 && (all || !m_pending[m_next % m_window]));
+    m_gap_time = -1;
+    deliverInOrder();
+}
+
+void RTPReceiver::handle(Slot *s)
+{
+    m_received.fetchAndAddRelaxed(1);
+    const uchar *h = (const uchar*)s->data;
+    if (s->size < 12 || (h[0] >> 6) != 2) { // not rtp
+        flushLate(true);
+        s->begin = 0;
+        deliver(s);
+        return;
+    }
+    int begin = 12 + 4*(h[0] & 0x0f); // csrc
+    if ((h[0] & 0x10) && s->size >= begin + 4) // extension
+        begin += 4 + 4*((h[begin + 2] << 8) | h[begin + 3]);
+    int size = s->size;
+    if (h[0] & 0x20) // padding
+        size -= h[size - 1];
+    if (begin >= size) {
+        recycle(s);
+        return;
+    }
+    s->begin = begin;
+    s->size = size;
+    s->seq = quint16((h[2] << 8) | h[3]);
+    m_payload = size - begin;
+    updateJitter(quint32((h[4] << 24) | (h[5] << 16) | (h[6] << 8) | h[7]));
+    if (!m_started) {
+        m_started = true;
+        m_next = m_highest = s->seq;
+    }
+    int d = qint16(quint16(s->seq - m_next));
+    if (d < -kResync || d > kResync) { // sender restarted
+        flushLate(true);
+        m_next = m_highest = s->seq;
+        d = 0;
+    } else if (d < 0) {
+        m_late.fetchAndAddRelaxed(1);
+        recycle(s);
+        return;
+    }
+    // no room in the window. skip the oldest
+    while (d >= m_window) {
+        skip();
+        --d;
+    }
+    if (qint16(quint16(s->seq - m_highest)) < 0)
+        m_reordered.fetchAndAddRelaxed(1);
+    else
+        m_highest = s->seq;
+    Slot *&p = m_pending[s->seq % m_window];
+    if (p) {
+        m_duplicated.fetchAndAddRelaxed(1);
+        recycle(s);
+        return;
+    }
+    p = s;
+    ++m_pending_count;
+    deliverInOrder();
+}
+
+void RTPReceiver::run()
+{
+#if RTP_HAVE_RECVMMSG
+    const int fd = int(m_socket->socketDescriptor());
+    struct mmsghdr msgs[kBatch];
+    struct iovec iov[kBatch];
+    Slot *batch[kBatch];
+#endif
+    while (!isInterruptionRequested()) {
+        flushLate(false);
+#if RTP_HAVE_RECVMMSG
+        struct pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, kPollTimeout) <= 0)
+            continue;
+        int n = 0;
+        for (; n < kBatch; ++n) {
+            // block for the 1st slot only
+            batch[n] = acquire(n == 0 ? kPollTimeout : 0);
+            if (!batch[n])
+                break;
+            iov[n].iov_base = batch[n]->data;
+            iov[n].iov_len = m_slot_size;
+            memset(&msgs[n], 0, sizeof(msgs[n]));
+            msgs[n].msg_hdr.msg_iov = &iov[n];
+            msgs[n].msg_hdr.msg_iovlen = 1;
+        }
+        if (n == 0)
+            continue;
+        int r = recvmmsg(fd, msgs, n, MSG_DONTWAIT, 0);
+        if (r < 0)
+            r = 0;
+        const qint64 now = m_clock.elapsed();
+        for (int i = 0; i < r; ++i) {
+            batch[i]->size = int(msgs[i].msg_len);
+            batch[i]->time = now;
+            handle(batch[i]);
+        }
+        for (int i = r; i < n; ++i)
+            recycle(batch[i]);
+#else
+        if (!m_socket->hasPendingDatagrams() && !m_socket->waitForReadyRead(kPollTimeout))
+            continue;
+        while (m_socket->hasPendingDatagrams()) {
+            Slot *s = acquire(kPollTimeout);
+            if (!s)
+                break;
+            const qint64 size = m_socket->readDatagram(s->data, m_slot_size);
+            if (size <= 0) {
+                recycle(s);
+                break;
+            }
+            s->size = int(size);
+            s->time = m_clock.elapsed();
+            handle(s);
+        }
+#endif
+    }
+    flushLate(true);
+    delete m_socket;
+    m_socket = 0;
+}
+} //namespace QtAV
@@ -0,0 +1,142 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#ifndef QTAV_RTPRECEIVER_H
+#define QTAV_RTPRECEIVER_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QThread>
+#include <QtCore/QVector>
+#include "QtAV/QtAV_Global.h"
+#include "utils/SPSCQueue.h"
+
+QT_BEGIN_NAMESPACE
+class QUdpSocket;
+QT_END_NAMESPACE
+namespace QtAV {
+/*!
+ * \brief The RTPReceiver class
+ * Receives the datagrams of a bound udp socket in a thread and hands over the payloads to read().
+ * Datagrams are received into a pool of preallocated slots, in batches (recvmmsg) if supported. Filled slots are
+ * passed to read() and back through SPSCQueues, so no allocation and no lock contention happens per datagram.
+ * RTP (version 2) packets are reordered by sequence number in a window, and losses are counted. A gap is waited for
+ * at most maxDelay() ms, so maxDelay() is the latency added by the jitter buffer. A lost MPEG-TS payload can be
+ * replaced by null packets of the same size. Other datagrams, e.g. raw MPEG-TS over udp, are passed as is.
+ */
+class Q_AV_PRIVATE_EXPORT RTPReceiver : public QThread
+{
+public:
+    struct Stats {
+        qint64 received;
+        qint64 lost;        ///< sequence numbers never received
+        qint64 reordered;   ///< packets arrived after a higher sequence number and still in time
+        qint64 late;        ///< packets arrived after their sequence number was skipped. dropped
+        qint64 duplicated;
+        qint64 concealed;   ///< lost packets replaced by TS null packets
+        qreal jitter;       ///< ms. RTP interarrival jitter (RFC 3550) of 90kHz timestamps
+        int latency;        ///< ms. received -> read() of the latest read packet
+    };
+    RTPReceiver();
+    ~RTPReceiver();
+    /// default is 1024 slots of 2048 bytes, allocated in start(). not allowed while receiving
+    void setSlots(int count, int bytes);
+    /// packets, rounded up to a power of 2 (at most 1024). default is 32. not allowed while receiving
+    void setReorderWindow(int packets);
+    int reorderWindow() const { return m_window;}
+    /// how long a missing packet is waited for. default is 50ms
+    void setMaxDelay(int ms) { m_max_delay = ms;}
+    int maxDelay() const { return m_max_delay;}
+    /// replace lost MPEG-TS payloads by null packets, so byte positions and rate are kept. default is false
+    void setConcealment(bool value) { m_conceal = value;}
+    bool concealment() const { return m_conceal;}
+    /*!
+     * \brief start
+     * The socket is moved to the receiving thread and deleted when the thread finishes. Call it in the thread of socket.
+     */
+    void start(QUdpSocket *socket);
+    void stop();
+    /*!
+     * \brief read
+     * Copy at most maxSize bytes of payloads. Wait at most timeout ms for the first byte.
+     * A datagram can be read by several calls.
+     * \return bytes read. 0 if timed out or stopped
+     */
+    qint64 read(char *data, qint64 maxSize, unsigned long timeout = ULONG_MAX);
+    /// bytes of the payloads ready to read
+    qint64 buffered() const { return spsc::loadAcquire(m_buffered);}
+    Stats stats() const;
+protected:
+    void run() Q_DECL_OVERRIDE;
+private:
+    struct Slot {
+        char *data;
+        int size;
+        int begin; // payload offset
+        int pos; // read offset
+        quint16 seq;
+        qint64 time; // received
+    };
+    Slot* acquire(unsigned long timeout);
+    void recycle(Slot *s) { m_spare.append(s);}
+    void handle(Slot *s);
+    void deliver(Slot *s);
+    void deliverInOrder();
+    void skip();
+    void conceal();
+    void updateJitter(quint32 timestamp);
+    void flushLate(bool all);
+
+    void allocate();
+
+    QByteArray m_block;
+    int m_slot_count;
+    int m_slot_size;
+    QVector<Slot> m_slots;
+    QUdpSocket *m_socket;
+    SPSCQueue<Slot*> m_ready; // receiving thread => read()
+    SPSCQueue<Slot*> m_free; // read() => receiving thread
+    // receiving thread
+    QVector<Slot*> m_spare;
+    QVector<Slot*> m_pending; // reorder window. slot of seq is m_pending[seq % m_window]
+    int m_window;
+    int m_pending_count;
+    volatile int m_max_delay;
+    volatile bool m_conceal;
+    bool m_started;
+    quint16 m_next; // next sequence number to deliver
+    quint16 m_highest;
+    QElapsedTimer m_clock;
+    qint64 m_gap_time; // when a gap is found
+    int m_payload; // size of the latest rtp payload
+    bool m_has_transit;
+    qint64 m_transit; // arrival - timestamp of the previous packet, in 90kHz
+    qreal m_jitter_ts; // in 90kHz
+    // read()
+    Slot *m_cur;
+
+    spsc::AtomicInt64 m_buffered;
+    spsc::AtomicInt64 m_received, m_lost, m_reordered, m_late, m_duplicated, m_concealed;
+    QAtomicInt m_jitter; // us
+    QAtomicInt m_latency; // ms
+};
+} //namespace QtAV
+#endif // QTAV_RTPRECEIVER_H
@@ -0,0 +1,265 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#include "QtAV/MediaIO.h"
+#include "QtAV/private/MediaIO_p.h"
+#include "QtAV/private/mkid.h"
+#include "QtAV/private/factory.h"
+#include <QtCore/QUrl>
+#include <QtCore/QUrlQuery>
+#include <QtNetwork/QNetworkInterface>
+#include <QtNetwork/QUdpSocket>
+#include "RTPReceiver.h"
+#include "utils/Logger.h"
+
+namespace QtAV {
+static const int kLatencyDefault = 200;
+static const int kTimeoutDefault = 5000;
+static const int kSlots = 4096; // > reorder window + datagrams waiting for read()
+static const int kSlotSize = 2048;
+static const int kReorderWindow = 1024;
+static const int kSocketBuffer = 8*1024*1024;
+
+static const char kRTPTSName[] = "RTPTS";
+class RTPTSIOPrivate;
+class RTPTSIO : public MediaIO
+{
+    Q_OBJECT
+    Q_PROPERTY(int targetLatency READ targetLatency WRITE setTargetLatency)
+    Q_PROPERTY(int timeout READ timeout WRITE setTimeout)
+    Q_PROPERTY(qint64 packetsReceived READ packetsReceived)
+    Q_PROPERTY(qint64 packetsLost READ packetsLost)
+    Q_PROPERTY(qint64 packetsReordered READ packetsReordered)
+    Q_PROPERTY(qint64 packetsConcealed READ packetsConcealed)
+    Q_PROPERTY(qreal jitter READ jitter)
+    Q_PROPERTY(int latency READ latency)
+    DPTR_DECLARE_PRIVATE(RTPTSIO)
+public:
+    RTPTSIO();
+    ~RTPTSIO();
+    QString name() const Q_DECL_OVERRIDE { return QLatin1String(kRTPTSName);}
+    const QStringList& protocols() const Q_DECL_OVERRIDE
+    {
+        static QStringList p = QStringList() << QStringLiteral("rtp-ts") << QStringLiteral("udp-ts");
+        return p;
+    }
+    /*!
+     * \brief setTargetLatency
+     * Max time(ms) to wait for a missing RTP packet. Default is 200, or the url query "latency"
+     */
+    void setTargetLatency(int ms);
+    int targetLatency() const;
+    /// read() returns 0(end of stream) if no data in timeout ms. Default is 5000, or the url query "timeout"
+    void setTimeout(int ms);
+    int timeout() const;
+    qint64 packetsReceived() const;
+    qint64 packetsLost() const;
+    qint64 packetsReordered() const;
+    qint64 packetsConcealed() const;
+    qreal jitter() const;
+    int latency() const;
+
+    bool isSeekable() const Q_DECL_OVERRIDE { return false;}
+    qint64 read(char *data, qint64 maxSize) Q_DECL_OVERRIDE;
+    bool seek(qint64 offset, int from) Q_DECL_OVERRIDE;
+    qint64 position() const Q_DECL_OVERRIDE;
+    qint64 size() const Q_DECL_OVERRIDE { return 0;}
+    QString formatForced() const Q_DECL_OVERRIDE { return QStringLiteral("mpegts");}
+protected:
+    void onUrlChanged() Q_DECL_OVERRIDE;
+};
+typedef RTPTSIO MediaIORTPTS;
+static const MediaIOId MediaIOId_RTPTS = mkid::id32base36_5<'R','T','P','T','S'>::value;
+FACTORY_REGISTER(MediaIO, RTPTS, kRTPTSName)
+
+class RTPTSIOPrivate : public MediaIOPrivate
+{
+public:
+    RTPTSIOPrivate()
+        : MediaIOPrivate()
+        , latency(kLatencyDefault)
+        , timeout(kTimeoutDefault)
+        , pos(0)
+    {
+        receiver.setSlots(kSlots, kSlotSize);
+        receiver.setReorderWindow(kReorderWindow);
+        receiver.setMaxDelay(latency);
+        receiver.setConcealment(true);
+    }
+    QUdpSocket* open(const QUrl& url);
+
+    RTPReceiver receiver;
+    int latency;
+    int timeout;
+    qint64 pos;
+};
+
+static bool isMulticast(const QHostAddress& addr)
+{
+    if (addr.protocol() == QAbstractSocket::IPv4Protocol)
+        return (addr.toIPv4Address() >> 28) == 0xe; // 224.0.0.0/4
+    if (addr.protocol() == QAbstractSocket::IPv6Protocol)
+        return addr.toIPv6Address()[0] == 0xff;
+    return false;
+}
+
+// url: rtp-ts://[group or local address]:port[?latency=ms&timeout=ms&iface=name]. empty host or "@" means any
+QUdpSocket* RTPTSIOPrivate::open(const QUrl &url)
+{
+    const quint16 port = quint16(url.port(0));
+    if (!port) {
+        qWarning() << "RTPTSIO: no port in url " << url;
+        return 0;
+    }
+    QString host = url.host();
+    if (host == QLatin1String("@"))
+        host.clear();
+    const QHostAddress addr(host);
+    if (!host.isEmpty() && addr.isNull()) {
+        qWarning() << "RTPTSIO: invalid address " << host;
+        return 0;
+    }
+    QUdpSocket *socket = new QUdpSocket();
+    bool ok = false;
+    if (isMulticast(addr)) {
+        const QHostAddress any(addr.protocol() == QAbstractSocket::IPv6Protocol ? QHostAddress::AnyIPv6 : QHostAddress::AnyIPv4);
+        ok = socket->bind(any, port, QUdpSocket::ShareAddress | QUdpSocket::ReuseAddressHint);
+        if (ok) {
+            const QString iface = QUrlQuery(url).queryItemValue(QStringLiteral("iface"));
+            if (iface.isEmpty())
+                ok = socket->joinMulticastGroup(addr);
+            else
+                ok = socket->joinMulticastGroup(addr, QNetworkInterface::interfaceFromName(iface));
+        }
+    } else {
+        ok = socket->bind(host.isEmpty() ? QHostAddress(QHostAddress::AnyIPv4) : addr, port);
+    }
+    if (!ok) {
+        qWarning() << "RTPTSIO: failed to receive from " << url << ": " << socket->errorString();
+        delete socket;
+        return 0;
+    }
+    socket->setSocketOption(QAbstractSocket::ReceiveBufferSizeSocketOption, kSocketBuffer);
+    return socket;
+}
+
+RTPTSIO::RTPTSIO() : MediaIO(*new RTPTSIOPrivate()) {}
+
+RTPTSIO::~RTPTSIO()
+{
+    d_func().receiver.stop();
+}
+
+void RTPTSIO::setTargetLatency(int ms)
+{
+    DPTR_D(RTPTSIO);
+    d.latency = qMax(ms, 0);
+    d.receiver.setMaxDelay(d.latency);
+}
+
+int RTPTSIO::targetLatency() const
+{
+    return d_func().latency;
+}
+
+void RTPTSIO::setTimeout(int ms)
+{
+    d_func().timeout = ms;
+}
+
+int RTPTSIO::timeout() const
+{
+    return d_func().timeout;
+}
+
+qint64 RTPTSIO::packetsReceived() const
+{
+    return d_func().receiver.stats().received;
+}
+
+qint64 RTPTSIO::packetsLost() const
+{
+    return d_func().receiver.stats().lost;
+}
+
+qint64 RTPTSIO::packetsReordered() const
+{
+    return d_func().receiver.stats().reordered;
+}
+
+qint64 RTPTSIO::packetsConcealed() const
+{
+    return d_func().receiver.stats().concealed;
+}
+
+qreal RTPTSIO::jitter() const
+{
+    return d_func().receiver.stats().jitter;
+}
+
+int RTPTSIO::latency() const
+{
+    return d_func().receiver.stats().latency;
+}
+
+qint64 RTPTSIO::read(char *data, qint64 maxSize)
+{
+    DPTR_D(RTPTSIO);
+    if (!d.receiver.isRunning())
+        return -1;
+    const qint64 n = d.receiver.read(data, maxSize, d.timeout > 0 ? (unsigned long)d.timeout : ULONG_MAX);
+    d.pos += n;
+    return n;
+}
+
+bool RTPTSIO::seek(qint64 offset, int from)
+{
+    Q_UNUSED(offset);
+    Q_UNUSED(from);
+    return false;
+}
+
+qint64 RTPTSIO::position() const
+{
+    return d_func().pos;
+}
+
+void RTPTSIO::onUrlChanged()
+{
+    DPTR_D(RTPTSIO);
+    d.receiver.stop();
+    d.pos = 0;
+    if (url().isEmpty())
+        return;
+    const QUrl u(url());
+    const QUrlQuery q(u);
+    if (q.hasQueryItem(QStringLiteral("latency")))
+        setTargetLatency(q.queryItemValue(QStringLiteral("latency")).toInt());
+    if (q.hasQueryItem(QStringLiteral("timeout")))
+        setTimeout(q.queryItemValue(QStringLiteral("timeout")).toInt());
+    QUdpSocket *socket = d.open(u);
+    if (!socket)
+        return;
+    qDebug("RTPTSIO: receiving on port %d, target latency %dms", socket->localPort(), d.latency);
+    d.receiver.start(socket);
+}
+} //namespace QtAV
+#include "RTPTSIO.moc"
@@ -24,8 +24,8 @@
 #include "QtAV/private/mkid.h"
 #include "QtAV/private/factory.h"
 #include <QtCore/QFile>
+#include "RTPReceiver.h"
 #include "utils/Logger.h"
-#include <QWaitCondition>
 #include <QElapsedTimer>
 #include <QMutexLocker>
 #include <QDataStream>
@@ -33,8 +33,6 @@
 #include <QTcpSocket>
 #include <QUdpSocket>
 #include <QtDebug>
-#include <QThread>
-#include <QQueue>
 #include <QTime>
 #include <QUrl>
 
@@ -53,6 +51,11 @@ class SatIPIOPrivate;
 class SatIPIO : public MediaIO
 {
 	Q_OBJECT
+	Q_PROPERTY(qint64 packetsReceived READ packetsReceived)
+	Q_PROPERTY(qint64 packetsLost READ packetsLost)
+	Q_PROPERTY(qint64 packetsReordered READ packetsReordered)
+	Q_PROPERTY(qreal jitter READ jitter)
+	Q_PROPERTY(int latency READ latency)
 	DPTR_DECLARE_PRIVATE(SatIPIO)
 public:
 	SatIPIO();
@@ -68,12 +71,17 @@ public:
 	virtual qint64 position() const Q_DECL_OVERRIDE;
 	virtual qint64 size() const Q_DECL_OVERRIDE;
 	virtual QString formatForced() const Q_DECL_OVERRIDE;
+	/// rtp statistics of current session
+	qint64 packetsReceived() const;
+	qint64 packetsLost() const;
+	qint64 packetsReordered() const;
+	qreal jitter() const;
+	int latency() const;
 
 protected slots:
 	virtual void rtspSocketError(QAbstractSocket::SocketError socketError);
 	virtual void rtspSocketConnected();
 	virtual void rtspSocketRead();
-	virtual void udpSocketRead();
 	virtual void keepalivePing();
     virtual void rtspTeardown();
 
@@ -104,10 +112,10 @@ public:
 		rtspSocket(new QTcpSocket()),
 		rtcpSocket(new QUdpSocket()),
 		udpSocket(NULL),
-		udpThread(NULL),
 		keepalive(KEEPALIVE_INTERVAL - KEEPALIVE_MARGIN),
 		cseq(1)
 	{
+		receiver.setSlots(1024, RTSP_RECEIVE_BUFFER);
 	}
 	~SatIPIOPrivate() { 
 		rtspSocket->abort();
@@ -119,11 +127,8 @@ public:
 	QMutex rtspSocketMutex;
 	QTcpSocket *rtspSocket;
 	QUdpSocket *rtcpSocket;
-	QUdpSocket *udpSocket;
-	QThread *udpThread;
-	QQueue<QByteArray*> fifo;
-	QWaitCondition fifoWait;
-	QMutex fifoMutex;
+	QUdpSocket *udpSocket; // owned by receiver once started
+	RTPReceiver receiver;
 
 	/* RTSP state */
 	QElapsedTimer keepaliveTimer;
@@ -347,12 +352,10 @@ void SatIPIO::rtspTeardown()
 
 	d.rtspSocket->abort();
 	d.rtcpSocket->abort();
-	d.udpThread->requestInterruption();
-	d.fifoWait.wakeAll();
-	d.udpThread->quit();
-	d.udpThread->wait();
-	delete d.udpThread;
-	d.udpThread = NULL;
+	if (d.receiver.isRunning())
+		d.receiver.stop();
+	else
+		delete d.udpSocket;
 	d.udpSocket = NULL;
 }
 
@@ -382,20 +385,7 @@ void SatIPIO::onUrlChanged()
 
 	qsrand(static_cast<uint>(QTime::currentTime().msec()));
 
-	d.udpThread = new QThread();
-	d.udpThread->start();
 	d.udpSocket = new QUdpSocket();
-	d.udpSocket->setReadBufferSize(10485760);
-    if(this->thread() == d.udpSocket->thread())
-    {
-        connect(d.udpSocket, &QIODevice::readyRead, this,
-                &SatIPIO::udpSocketRead, Qt::DirectConnection);
-    }
-    else
-    {
-        connect(d.udpSocket, &QIODevice::readyRead, this,
-                &SatIPIO::udpSocketRead, Qt::QueuedConnection);
-    }
 
 	// find an unused port pair
 	do {
@@ -431,9 +421,9 @@ void SatIPIO::onUrlChanged()
 			return;
 		}
 	}
-	d.udpSocket->moveToThread(d.udpThread);
-	connect(d.udpThread, &QThread::finished, d.udpSocket,
-			&QObject::deleteLater);
+	d.udpSocket->setSocketOption(QAbstractSocket::ReceiveBufferSizeSocketOption, 10485760);
+	// receive before PLAY, so no packet is lost
+	d.receiver.start(d.udpSocket);
 
 	msg = "";
 	msg_ts << "PLAY " << d.control << " RTSP/1.0\r\n";
@@ -463,75 +453,45 @@ bool SatIPIO::isWritable() const
 	return false;
 }
 
-void SatIPIO::udpSocketRead()
+qint64 SatIPIO::read(char *data, qint64 maxSize)
 {
 	DPTR_D(SatIPIO);
-	int maxSize = RTSP_RECEIVE_BUFFER;
-	char buf[RTSP_RECEIVE_BUFFER];
+
+	if (!d.udpSocket)
+		return -1;
 
 	if (d.keepaliveTimer.elapsed() > d.keepalive * 1000) {
 		keepalivePing();
 		d.keepaliveTimer.restart();
 	}
 
-	d.fifoMutex.lock();
-	while (d.udpSocket->hasPendingDatagrams()) {
-		while (d.fifo.size() > 50 &&
-				!d.udpThread->isInterruptionRequested())
-			d.fifoWait.wait(&d.fifoMutex);
-
-		if (d.udpThread->isInterruptionRequested())
-			break;
-
-		qint64 size = d.udpSocket->readDatagram(buf, RTSP_RECEIVE_BUFFER);
-		if (size <= 12)
-			continue;
-		size -= 12;
-		QByteArray *data = new QByteArray(buf + 12, size);
-		maxSize -= size;
-		d.fifo.enqueue(data);
-		d.fifoWait.wakeAll();
-	}
-	d.fifoMutex.unlock();
+	/* Whole datagrams are not required, the rest is read next time */
+	return d.receiver.read(data, maxSize, 500);
 }
 
-qint64 SatIPIO::read(char *data, qint64 maxSize)
+qint64 SatIPIO::packetsReceived() const
 {
-	DPTR_D(SatIPIO);
-
-	d.fifoMutex.lock();
-	int read = 0;
-
-	if (!d.udpThread)
-		return -1;
+	return d_func().receiver.stats().received;
+}
 
-	while (maxSize > 0) {
-		while (d.fifo.size() == 0 && d.udpThread->isRunning())
-        {
-            d.fifoWait.wait(&d.fifoMutex,500);
-            if(d.udpSocket && !d.udpSocket->hasPendingDatagrams())
-            {
-                d.fifoWait.wakeAll();
-                d.fifoMutex.unlock();
-                return read;
-            }
-        }
-		if (!d.udpThread->isRunning())
-			break;
+qint64 SatIPIO::packetsLost() const
+{
+	return d_func().receiver.stats().lost;
+}
 
-		if (d.fifo.head()->size() > maxSize)
-			break;
+qint64 SatIPIO::packetsReordered() const
+{
+	return d_func().receiver.stats().reordered;
+}
 
-		QByteArray *buf = d.fifo.dequeue();
-		memcpy(data + read, buf->constData(), buf->size());
-		read += buf->size();
-		maxSize -= buf->size();
-		delete buf;
-	}
+qreal SatIPIO::jitter() const
+{
+	return d_func().receiver.stats().jitter;
+}
 
-	d.fifoWait.wakeAll();
-	d.fifoMutex.unlock();
-	return read;
+int SatIPIO::latency() const
+{
+	return d_func().receiver.stats().latency;
 }
 
 qint64 SatIPIO::write(const char *data, qint64 maxSize)
@@ -1,7 +1,43 @@
 #include <QtAV/MediaIO.h>
 #include <QtDebug>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QTemporaryFile>
+#include <QtCore/QThread>
 #include <QtTest/QTest>
 using namespace QtAV;
+// a slow storage stand-in. reads at most 4KB per 1ms from memory
+class ThrottledIO : public MediaIO
+{
+public:
+    ThrottledIO(const QByteArray& data) : MediaIO(), m_data(data), m_pos(0) {}
+    QString name() const { return QStringLiteral("Throttled");}
+    bool isSeekable() const { return true;}
+    qint64 read(char *data, qint64 maxSize) {
+        QThread::msleep(1);
+        const qint64 n = qMin(qMin<qint64>(maxSize, 4096), m_data.size() - m_pos);
+        if (n <= 0)
+            return 0;
+        memcpy(data, m_data.constData() + m_pos, n);
+        m_pos += n;
+        return n;
+    }
+    bool seek(qint64 offset, int from) {
+        if (from == SEEK_CUR)
+            offset += m_pos;
+        else if (from == SEEK_END)
+            offset += m_data.size();
+        if (offset < 0 || offset > m_data.size())
+            return false;
+        m_pos = offset;
+        return true;
+    }
+    qint64 position() const { return m_pos;}
+    qint64 size() const { return m_data.size();}
+private:
+    QByteArray m_data;
+    qint64 m_pos;
+};
+
 class tst_MediaIO : public QObject
 {
     Q_OBJECT
@@ -9,6 +45,8 @@ private slots:
     void create();
     void createForProtocol();
     void read();
+    void mmapRead();
+    void prefetchRead();
 };
 
 void tst_MediaIO::create() {
@@ -49,5 +87,77 @@ void tst_MediaIO::read() {
     delete in;
 }
 
+void tst_MediaIO::mmapRead() {
+    QTemporaryFile f;
+    QVERIFY(f.open());
+    QByteArray data(1024*1024 + 123, 0);
+    for (int i = 0; i < data.size(); ++i)
+        data[i] = char(i*7);
+    f.write(data);
+    f.flush();
+    MediaIO *in = MediaIO::createForUrl(QString("mmap:") + f.fileName());
+    QVERIFY(in);
+    QCOMPARE(in->name(), QString("MMap"));
+    QVERIFY(in->isSeekable());
+    QCOMPARE(in->size(), qint64(data.size()));
+    QByteArray data2(data.size(), 0);
+    qint64 n = 0;
+    while (n < data2.size()) {
+        const qint64 r = in->read(data2.data() + n, 32768);
+        QVERIFY(r > 0);
+        n += r;
+    }
+    QCOMPARE(data2, data);
+    QCOMPARE(in->read(data2.data(), 1), qint64(0));
+    QVERIFY(in->seek(-100, SEEK_END));
+    QCOMPARE(in->position(), qint64(data.size() - 100));
+    QCOMPARE(in->read(data2.data(), 1024), qint64(100));
+    QCOMPARE(data2.left(100), data.right(100));
+    delete in;
+}
+
+void tst_MediaIO::prefetchRead() {
+    QByteArray data(2*1024*1024, 0);
+    for (int i = 0; i < data.size(); ++i)
+        data[i] = char(i*13);
+    ThrottledIO src(data);
+    MediaIO *in = MediaIO::create("Prefetch");
+    QVERIFY(in);
+    in->setProperty("capacity", 512*1024);
+    in->setProperty("source", QVariant::fromValue<MediaIO*>(&src));
+    QVERIFY(in->isSeekable());
+    QCOMPARE(in->size(), qint64(data.size()));
+    // filled in background
+    QElapsedTimer t;
+    t.start();
+    while (in->property("buffered").toLongLong() < 256*1024 && t.elapsed() < 5000)
+        QThread::msleep(10);
+    QVERIFY(in->property("buffered").toLongLong() >= 256*1024);
+    QVERIFY(in->property("fillLevel").toReal() > 0);
+    QVERIFY(in->property("throughput").toReal() > 0);
+    QByteArray data2(data.size(), 0);
+    qint64 n = 0;
+    while (n < data2.size()) {
+        const qint64 r = in->read(data2.data() + n, 32768);
+        QVERIFY(r > 0);
+        n += r;
+    }
+    QCOMPARE(data2, data);
+    QCOMPARE(in->read(data2.data(), 1), qint64(0));
+    // seek out of the buffer retargets the reader
+    QVERIFY(in->seek(12345, SEEK_SET));
+    QCOMPARE(in->position(), qint64(12345));
+    QCOMPARE(in->read(data2.data(), 1000), qint64(1000));
+    QCOMPARE(data2.left(1000), data.mid(12345, 1000));
+    // seek back in the buffer
+    QVERIFY(in->seek(-500, SEEK_CUR));
+    QCOMPARE(in->read(data2.data(), 500), qint64(500));
+    QCOMPARE(data2.left(500), data.mid(12345 + 500, 500));
+    QVERIFY(in->seek(-100, SEEK_END));
+    QCOMPARE(in->read(data2.data(), 1024), qint64(100));
+    QCOMPARE(data2.left(100), data.right(100));
+    delete in; // stops reading src
+}
+
 QTEST_MAIN(tst_MediaIO)
 #include "tst_avinput.moc"
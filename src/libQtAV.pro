@@ -22,6 +22,7 @@ config_libcedarv: CONFIG *= neon config_simd #need by qt4 addSimdCompiler(). neo
 ## sse2 sse4_1 may be defined in Qt5 qmodule.pri but is not included. Qt4 defines sse and sse2
 sse4_1|config_sse4_1|contains(TARGET_ARCH_SUB, sse4.1): CONFIG *= sse4_1 config_simd
 sse2|config_sse2|contains(TARGET_ARCH_SUB, sse2): CONFIG *= sse2 config_simd
+avx2|config_avx2|contains(TARGET_ARCH_SUB, avx2): CONFIG *= avx2 config_simd
 CONFIG(debug, debug|release): DEFINES += DEBUG
 #release: DEFINES += QT_NO_DEBUG_OUTPUT
 #var with '_' can not pass to pri?
@@ -81,7 +82,12 @@ sse4_1 {
 sse2 {
   DEFINES += QTAV_HAVE_SSE2=1
   !config_simd: CONFIG *= simd
-  SSE2_SOURCES += utils/CopyFrame_SSE2.cpp
+  SSE2_SOURCES += utils/CopyFrame_SSE2.cpp utils/YUV2RGB_SSE2.cpp utils/AudioMix_SSE2.cpp
+}
+avx2 {
+  DEFINES += QTAV_HAVE_AVX2=1
+  !config_simd: CONFIG *= simd
+  AVX2_SOURCES += utils/YUV2RGB_AVX2.cpp utils/AudioMix_AVX2.cpp
 }
 
 win32 {
@@ -442,6 +448,8 @@ SOURCES += \
     subtitle/Subtitle.cpp \
     subtitle/SubtitleProcessor.cpp \
     subtitle/SubtitleProcessorFFmpeg.cpp \
+    utils/AudioMix.cpp \
+    utils/AudioMix_NEON.cpp \
     utils/GPUMemCopy.cpp \
     utils/Logger.cpp \
     AudioThread.cpp \
@@ -471,8 +479,10 @@ SOURCES += \
     filter/EncodeFilter.cpp \
     ImageConverter.cpp \
     ImageConverterFF.cpp \
+    ImageConverterSIMD.cpp \
     Packet.cpp \
     PacketBuffer.cpp \
+    PacketIndex.cpp \
     AVError.cpp \
     AVPlayer.cpp \
     AVPlayerPrivate.cpp \
@@ -483,23 +493,31 @@ SOURCES += \
     VideoFrame.cpp \
     io/MediaIO.cpp \
     io/QIODeviceIO.cpp \
+    io/MMapIO.cpp \
+    io/PrefetchIO.cpp \
+    io/RTPReceiver.cpp \
+    io/RTPTSIO.cpp \
     io/SatIPIO.cpp \
     output/audio/AudioOutput.cpp \
     output/audio/AudioOutputBackend.cpp \
     output/audio/AudioOutputNull.cpp \
+    output/audio/AudioOutputMixer.cpp \
     output/video/VideoRenderer.cpp \
     output/video/VideoOutput.cpp \
     output/video/QPainterRenderer.cpp \
     output/AVOutput.cpp \
     output/OutputSet.cpp \
     Statistics.cpp \
+    MemoryBudget.cpp \
     codec/video/VideoDecoder.cpp \
     codec/video/VideoDecoderFFmpegBase.cpp \
     codec/video/VideoDecoderFFmpeg.cpp \
+    codec/video/VideoFramePool.cpp \
     codec/video/VideoDecoderFFmpegHW.cpp \
     codec/video/VideoEncoder.cpp \
     codec/video/VideoEncoderFFmpeg.cpp \
     VideoThread.cpp \
+    VideoFrameCache.cpp \
     VideoFrameExtractor.cpp
 
 SDK_HEADERS *= \
@@ -541,6 +559,7 @@ SDK_HEADERS *= \
     QtAV/VideoFrameExtractor.h \
     QtAV/FactoryDefine.h \
     QtAV/Statistics.h \
+    QtAV/MemoryBudget.h \
     QtAV/SubImage.h \
     QtAV/Subtitle.h \
     QtAV/SubtitleFilter.h \
@@ -578,19 +597,28 @@ HEADERS *= \
     AVThread_p.h \
     AudioThread.h \
     PacketBuffer.h \
+    PacketPool.h \
+    PacketIndex.h \
     VideoThread.h \
+    VideoFrameCache.h \
     ImageConverter.h \
     ImageConverter_p.h \
     codec/video/VideoDecoderFFmpegBase.h \
+    codec/video/VideoFramePool.h \
     codec/video/VideoDecoderFFmpegHW.h \
     codec/video/VideoDecoderFFmpegHW_p.h \
     filter/FilterManager.h \
+    io/RTPReceiver.h \
     subtitle/CharsetDetector.h \
     subtitle/PlainText.h \
+    utils/AudioMix.h \
+    utils/AudioRing.h \
     utils/BlockingQueue.h \
     utils/GPUMemCopy.h \
+    utils/YUV2RGB.h \
     utils/Logger.h \
     utils/SharedPtr.h \
+    utils/SPSCQueue.h \
     utils/ring.h \
     utils/internal.h \
     output/OutputSet.h \
@@ -29,8 +29,11 @@
 #include <QtCore/QTime>
 typedef QTime QElapsedTimer;
 #endif
+#include "utils/AudioMix.h"
+#include "utils/AudioRing.h"
 #include "utils/ring.h"
 #include "utils/Logger.h"
+#include <string.h>
 
 #define AO_USE_TIMER 1
 
@@ -40,82 +43,6 @@ namespace QtAV {
 static const int kBufferSamples = 512;
 static const int kBufferCount = 8*2; // may wait too long at the beginning (oal) if too large. if buffer count is too small, can not play for high sample rate audio.
 
-typedef void (*scale_samples_func)(quint8 *dst, const quint8 *src, int nb_samples, int volume, float volumef);
-
-/// from libavfilter/af_volume begin
-static inline void scale_samples_u8(quint8 *dst, const quint8 *src, int nb_samples, int volume, float)
-{
-    for (int i = 0; i < nb_samples; i++)
-        dst[i] = av_clip_uint8(((((qint64)src[i] - 128) * volume + 128) >> 8) + 128);
-}
-
-static inline void scale_samples_u8_small(quint8 *dst, const quint8 *src, int nb_samples, int volume, float)
-{
-    for (int i = 0; i < nb_samples; i++)
-        dst[i] = av_clip_uint8((((src[i] - 128) * volume + 128) >> 8) + 128);
-}
-
-static inline void scale_samples_s16(quint8 *dst, const quint8 *src, int nb_samples, int volume, float)
-{
-    int16_t *smp_dst       = (int16_t *)dst;
-    const int16_t *smp_src = (const int16_t *)src;
-    for (int i = 0; i < nb_samples; i++)
-        smp_dst[i] = av_clip_int16(((qint64)smp_src[i] * volume + 128) >> 8);
-}
-
-static inline void scale_samples_s16_small(quint8 *dst, const quint8 *src, int nb_samples, int volume, float)
-{
-    int16_t *smp_dst       = (int16_t *)dst;
-    const int16_t *smp_src = (const int16_t *)src;
-    for (int i = 0; i < nb_samples; i++)
-        smp_dst[i] = av_clip_int16((smp_src[i] * volume + 128) >> 8);
-}
-
-static inline void scale_samples_s32(quint8 *dst, const quint8 *src, int nb_samples, int volume, float)
-{
-    qint32 *smp_dst       = (qint32 *)dst;
-    const qint32 *smp_src = (const qint32 *)src;
-    for (int i = 0; i < nb_samples; i++)
-        smp_dst[i] = av_clipl_int32((((qint64)smp_src[i] * volume + 128) >> 8));
-}
-/// from libavfilter/af_volume end
-
-//TODO: simd
-template<typename T>
-static inline void scale_samples(quint8 *dst, const quint8 *src, int nb_samples, int, float volume)
-{
-    T *smp_dst = (T *)dst;
-    const T *smp_src = (const T *)src;
-    for (int i = 0; i < nb_samples; ++i)
-        smp_dst[i] = smp_src[i] * (T)volume;
-}
-
-scale_samples_func get_scaler(AudioFormat::SampleFormat fmt, qreal vol, int* voli)
-{
-    int v = (int)(vol * 256.0 + 0.5);
-    if (voli)
-        *voli = v;
-    switch (fmt) {
-    case AudioFormat::SampleFormat_Unsigned8:
-    case AudioFormat::SampleFormat_Unsigned8Planar:
-        return v < 0x1000000 ? scale_samples_u8_small : scale_samples_u8;
-    case AudioFormat::SampleFormat_Signed16:
-    case AudioFormat::SampleFormat_Signed16Planar:
-        return v < 0x10000 ? scale_samples_s16_small : scale_samples_s16;
-    case AudioFormat::SampleFormat_Signed32:
-    case AudioFormat::SampleFormat_Signed32Planar:
-        return scale_samples_s32;
-    case AudioFormat::SampleFormat_Float:
-    case AudioFormat::SampleFormat_FloatPlanar:
-        return scale_samples<float>;
-    case AudioFormat::SampleFormat_Double:
-    case AudioFormat::SampleFormat_DoublePlanar:
-        return scale_samples<double>;
-    default:
-        return 0;
-    }
-}
-
 class AudioOutputPrivate : public AVOutputPrivate
 {
 public:
@@ -123,8 +50,8 @@ public:
         mute(false)
       , sw_volume(true)
       , sw_mute(true)
-      , volume_i(256)
       , vol(1)
+      , vol_applied(1)
       , speed(1.0)
       , nb_buffers(kBufferCount)
       , buffer_samples(kBufferSamples)
@@ -137,7 +64,7 @@ public:
       , update_backend(true)
       , index_enqueue(-1)
       , index_deuqueue(-1)
-      , frame_infos(ring<FrameInfo>(nb_buffers))
+      , frame_infos(ring<FrameInfo>(nb_buffers*2))
     {
         available = false;
     }
@@ -152,9 +79,11 @@ public:
     }
 
     struct FrameInfo {
-        FrameInfo(const QByteArray& d = QByteArray(), qreal t = 0, int us = 0) : timestamp(t), duration(us), data(d) {}
+        FrameInfo(const QByteArray& d = QByteArray(), qreal t = 0, int us = 0) : timestamp(t), duration(us), size(d.size()), end(0), data(d) {}
         qreal timestamp;
         int duration; // in us
+        int size;
+        quint32 end; // ring write position after this frame. Pull only
         QByteArray data;
     };
 
@@ -162,20 +91,31 @@ public:
         play_pos = 0;
         processed_remain = 0;
         msecs_ahead = 0;
+        vol_applied = vol;
 #if AO_USE_TIMER
         timer.invalidate();
 #endif
-        frame_infos = ring<FrameInfo>(nb_buffers);
+        audio_ring.clear();
+        // pull mode can queue more and smaller frames
+        frame_infos = ring<FrameInfo>(nb_buffers*2);
+    }
+    bool isPull() const { return backend && (backend->bufferControl() & AudioOutputBackend::Pull);}
+    // remove frames pulled by the backend
+    void releasePulled() {
+        const quint32 pos = audio_ring.readPosition();
+        while (!frame_infos.empty() && qint32(frame_infos.front().end - pos) <= 0)
+            frame_infos.pop_front();
     }
-    /// call this if sample format or volume is changed
+    bool writeRing(const QByteArray& data, qreal pts);
+    /// call this if sample format is changed
     void updateSampleScaleFunc();
     void tryVolume(qreal value);
     void tryMute(bool value);
 
     bool mute;
     bool sw_volume, sw_mute;
-    int volume_i;
     qreal vol;
+    qreal vol_applied; // software volume at the end of last buffer. volume changes are ramped from it
     qreal speed;
     AudioFormat format;
     AudioFormat requested;
@@ -189,7 +129,7 @@ public:
 #if AO_USE_TIMER
     QElapsedTimer timer;
 #endif
-    scale_samples_func scale_samples;
+    AudioScaleFunc scale_samples;
     AudioOutputBackend *backend;
     bool update_backend;
     QStringList backends;
@@ -197,11 +137,12 @@ public:
     // the index of current enqueue/dequeue
     int index_enqueue, index_deuqueue;
     ring<FrameInfo> frame_infos;
+    AudioRing audio_ring;
 };
 
 void AudioOutputPrivate::updateSampleScaleFunc()
 {
-    scale_samples = get_scaler(format.sampleFormat(), vol, &volume_i);
+    scale_samples = audioScaleFunc(format.sampleFormat());
 }
 
 AudioOutputPrivate::~AudioOutputPrivate()
@@ -225,6 +166,45 @@ void AudioOutputPrivate::playInitialData()
     backend->play();
 }
 
+bool AudioOutputPrivate::writeRing(const QByteArray &data, qreal pts)
+{
+    FrameInfo fi(QByteArray(), pts, format.durationForBytes(data.size()));
+    fi.size = data.size();
+    fi.end = audio_ring.writePosition() + quint32(data.size());
+    const char *src = data.constData();
+    int left = data.size();
+    bool queued = false;
+    quint32 read_pos = audio_ring.readPosition();
+    QElapsedTimer stall;
+    stall.start();
+    // wait here instead of in the device callback. the callback never wakes us
+    while (true) {
+        releasePulled();
+        if (!queued && frame_infos.size() < frame_infos.capacity()) {
+            frame_infos.push_back(fi);
+            queued = true;
+        }
+        if (queued) {
+            const int n = audio_ring.write(src, left);
+            src += n;
+            left -= n;
+            if (left <= 0)
+                return true;
+        }
+        if (!available)
+            return false;
+        if (audio_ring.readPosition() != read_pos) {
+            read_pos = audio_ring.readPosition();
+            stall.restart();
+        } else if (stall.elapsed() > 1000) {
+            qWarning("audio device does not read data");
+            return false;
+        }
+        uwait(qBound<qint64>(1000LL, format.durationForBytes(left)/2, 20000LL));
+    }
+    return false;
+}
+
 void AudioOutputPrivate::tryVolume(qreal value)
 {
     // if not open, try later
@@ -344,7 +324,8 @@ void AudioOutput::flush()
 void AudioOutput::clear()
 {
     DPTR_D(AudioOutput);
-    if (!d.backend || !d.backend->clear())
+    // resetStatus() drops the ring data for pull backends
+    if (!d.isPull() && (!d.backend || !d.backend->clear()))
         flush();
     d.resetStatus();
 }
@@ -363,13 +344,18 @@ bool AudioOutput::open()
     d.backend->buffer_size = bufferSize();
     d.backend->buffer_count = bufferCount();
     d.backend->format = audioFormat();
+    if (d.isPull())
+        d.audio_ring.resize(bufferSize()*bufferCount());
     // TODO: open next backend if fail and emit backendChanged()
     if (!d.backend->open())
         return false;
     d.available = true;
     d.tryVolume(volume());
     d.tryMute(isMute());
-    d.playInitialData();
+    if (d.isPull()) // the callback fills silence
+        d.backend->play();
+    else
+        d.playInitialData();
     return true;
 }
 
@@ -427,15 +413,31 @@ bool AudioOutput::receiveData(const QByteArray &data, qreal pts)
             s = 1<<((d.format.bytesPerSample() << 3)-1);
         queue_data.fill(s);
     } else {
-        if (!qFuzzyCompare(volume(), (qreal)1.0)
+        const qreal vol = volume();
+        if ((!qFuzzyCompare(vol, (qreal)1.0) || !qFuzzyCompare(d.vol_applied, (qreal)1.0))
                 && d.sw_volume
                 && d.scale_samples
                 ) {
-            // TODO: af_volume needs samples_align to get nb_samples
-            const int nb_samples = queue_data.size()/d.format.bytesPerSample();
-            quint8 *dst = (quint8*)queue_data.constData();
-            d.scale_samples(dst, dst, nb_samples, d.volume_i, volume());
+            // ramp from the volume of previous buffer to avoid zipper noise. each plane is ramped separately
+            const int nb_planes = d.format.planeCount();
+            const int plane_size = queue_data.size()/nb_planes;
+            const int nb_samples = plane_size/d.format.bytesPerSample();
+            if (nb_samples > 0) {
+                const float step = float(vol - d.vol_applied)/float(nb_samples);
+                quint8 *dst = (quint8*)queue_data.constData();
+                for (int i = 0; i < nb_planes; ++i)
+                    d.scale_samples(dst + i*plane_size, dst + i*plane_size, nb_samples, d.vol_applied, step);
+            }
+            d.vol_applied = vol;
+        }
+    }
+    if (d.isPull()) {
+        if (!d.writeRing(queue_data, pts)) {
+            qWarning("ao backend maybe not open");
+            d.resetStatus();
+            return false;
         }
+        return true;
     }
     // wait after all data processing finished to reduce time error
     if (!waitForNextBuffer()) { // TODO: wait or not parameter, set by user (async)
@@ -516,7 +518,6 @@ void AudioOutput::setVolume(qreal value)
         return;
     d.vol = value;
     Q_EMIT volumeChanged(value);
-    d.updateSampleScaleFunc();
     d.tryVolume(value);
 }
 
@@ -618,6 +619,16 @@ bool AudioOutput::waitForNextBuffer() // parameter bool wait: if no wait and no
     // openal need enqueue to a dequeued buffer! why sl crash
     bool no_wait = false;//d.canAddBuffer();
     const AudioOutputBackend::BufferControl f = d.backend->bufferControl();
+    if (f & AudioOutputBackend::Pull) {
+        const size_t queued = d.frame_infos.size();
+        const int us = d.frame_infos.front().duration;
+        d.releasePulled();
+        if (d.frame_infos.size() == queued) {
+            d.uwait(qMax(us, 1000));
+            d.releasePulled();
+        }
+        return true;
+    }
     int remove = 0;
     const AudioOutputPrivate::FrameInfo &fi(d.frame_infos.front());
     if (f & AudioOutputBackend::Blocking) {
@@ -772,6 +783,26 @@ bool AudioOutput::waitForNextBuffer() // parameter bool wait: if no wait and no
 qreal AudioOutput::timestamp() const
 {
     DPTR_D(const AudioOutput);
+    if (d.isPull()) {
+        // the position of bytes pulled by the device callback
+        const quint32 pos = d.audio_ring.readPosition();
+        qreal t = 0;
+        for (size_t i = 0; i < d.frame_infos.size(); ++i) {
+            const AudioOutputPrivate::FrameInfo &fi = d.frame_infos.at(i);
+            if (qint32(fi.end - pos) <= 0)
+                continue;
+            if (fi.timestamp <= 0)
+                return fi.timestamp;
+            const int pulled = fi.size - qint32(fi.end - pos);
+            t = fi.timestamp + qreal(d.format.durationForBytes(qMax(0, pulled)))/1000000.0;
+            break;
+        }
+        if (t <= 0 && !d.frame_infos.empty() && d.frame_infos.back().timestamp > 0)
+            t = d.frame_infos.back().timestamp + qreal(d.frame_infos.back().duration)/1000000.0;
+        // pulled data is played after the device latency
+        if (t > 0)
+            return qMax<qreal>(0, t - qreal(d.backend->getLatency())/1000000.0);
+    }
     return d.frame_infos.front().timestamp;
 }
 
@@ -801,4 +832,13 @@ void AudioOutput::onCallback()
 {
     d_func().onCallback();
 }
+
+int AudioOutput::pull(char *data, int bytes)
+{
+    DPTR_D(AudioOutput);
+    const int n = d.audio_ring.read(data, bytes);
+    if (n < bytes)
+        memset(data + n, d.format.isUnsigned() && !d.format.isFloat() ? 0x80 : 0, bytes - n);
+    return n;
+}
 } //namespace QtAV
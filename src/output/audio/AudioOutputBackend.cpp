@@ -22,6 +22,7 @@
 #include "QtAV/private/AudioOutputBackend.h"
 #include "QtAV/private/factory.h"
 #include "utils/Logger.h"
+#include <string.h>
 
 namespace QtAV {
 
@@ -69,6 +70,14 @@ void AudioOutputBackend::onCallback()
     audio->onCallback();
 }
 
+int AudioOutputBackend::pull(char *data, int bytes)
+{
+    AudioOutput *ao = audio;
+    if (ao)
+        return ao->pull(data, bytes);
+    memset(data, format.isUnsigned() && !format.isFloat() ? 0x80 : 0, bytes);
+    return 0;
+}
 
 FACTORY_DEFINE(AudioOutputBackend)
 
@@ -83,6 +92,8 @@ void AudioOutput_RegisterAll()
         return;
     extern bool RegisterAudioOutputBackendNull_Man();
     RegisterAudioOutputBackendNull_Man();
+    extern bool RegisterAudioOutputBackendMixer_Man();
+    RegisterAudioOutputBackendMixer_Man();
 #ifdef Q_OS_DARWIN
     extern bool RegisterAudioOutputBackendAudioToolbox_Man();
     RegisterAudioOutputBackendAudioToolbox_Man();
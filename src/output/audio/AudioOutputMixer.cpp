@@ -0,0 +1,438 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#include "QtAV/private/AudioOutputBackend.h"
+#include "QtAV/AudioResampler.h"
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+#include <QtCore/QWaitCondition>
+#include "QtAV/private/mkid.h"
+#include "QtAV/private/factory.h"
+#include "utils/AudioMix.h"
+#include "utils/Logger.h"
+
+namespace QtAV {
+/*!
+ * Mixer backend: every AudioOutput using "Mixer" is a client of one shared device AudioOutput.
+ * Clients are resampled to the device format and mixed on a time critical thread.
+ * The device backends are the default priority, or QTAV_AUDIO_MIXER_BACKENDS (comma separated, e.g. "null").
+ * A client buffer is reported as played (PlayedCount) when the device starts to play the mixed period after it,
+ * so AudioOutput::timestamp() and the audio clock follow the device.
+ */
+static const char kName[] = "Mixer";
+class AudioMixerEngine;
+class AudioOutputMixer Q_DECL_FINAL: public AudioOutputBackend
+{
+public:
+    AudioOutputMixer(QObject *parent = 0);
+    ~AudioOutputMixer();
+    QString name() const Q_DECL_FINAL { return QLatin1String(kName);}
+    bool open() Q_DECL_FINAL;
+    bool close() Q_DECL_FINAL;
+    BufferControl bufferControl() const Q_DECL_FINAL { return PlayedCount;}
+    bool write(const QByteArray& data) Q_DECL_FINAL;
+    bool play() Q_DECL_FINAL { return true;}
+    bool clear() Q_DECL_FINAL;
+    int getPlayedCount() Q_DECL_FINAL;
+    bool setVolume(qreal value) Q_DECL_FINAL;
+    qreal getVolume() const Q_DECL_FINAL;
+    bool setMute(bool value = true) Q_DECL_FINAL;
+    bool getMute() const Q_DECL_FINAL;
+
+    // called by the engine thread with engine locked
+    void mixTo(quint8* dst, int frames, qint64 pos, AudioScaleFunc mix);
+    void updatePlayed(qint64 pos);
+    void reset();
+private:
+    QByteArray convert(const QByteArray& data);
+
+    AudioMixerEngine *engine;
+    mutable QMutex mutex; // pending, vol and mute
+    QList<QByteArray> pending;
+    qreal vol;
+    bool mute;
+    QAtomicInt played;
+    // used by the engine
+    AudioFormat mix_format;
+    AudioResampler *resampler;
+    QByteArray converted;
+    int converted_pos;
+    qint64 appended, consumed; // frames in mix format
+    QList<qint64> chunk_ends; // end of each written buffer in appended frames
+    QList<qint64> mixed_ends; // end of each written buffer in device frames
+    float gain;
+};
+
+class AudioMixerEngine : public QThread
+{
+public:
+    AudioMixerEngine();
+    ~AudioMixerEngine();
+    /*!
+     * \brief attach
+     * Open the device if it's the first client. The device format is float with the sample rate and channels of the first client if supported.
+     */
+    bool attach(AudioOutputMixer* client, const AudioFormat& clientFormat);
+    void detach(AudioOutputMixer* client);
+    void clear(AudioOutputMixer* client);
+    AudioFormat format() const { return device_format;}
+protected:
+    void run() Q_DECL_OVERRIDE;
+private:
+    QMutex attach_mutex;
+    QMutex mutex; // clients and mixing
+    QWaitCondition cond;
+    QList<AudioOutputMixer*> clients;
+    int refs;
+    volatile bool stop;
+    bool opened;
+    AudioFormat requested_format;
+    AudioFormat device_format;
+};
+Q_GLOBAL_STATIC(AudioMixerEngine, audioMixerEngine)
+
+AudioMixerEngine::AudioMixerEngine()
+    : QThread(0)
+    , refs(0)
+    , stop(false)
+    , opened(false)
+{}
+
+AudioMixerEngine::~AudioMixerEngine()
+{
+    stop = true;
+    wait();
+}
+
+bool AudioMixerEngine::attach(AudioOutputMixer *client, const AudioFormat &clientFormat)
+{
+    QMutexLocker lock(&attach_mutex);
+    Q_UNUSED(lock);
+    if (refs == 0) {
+        requested_format = clientFormat;
+        requested_format.setSampleFormat(AudioFormat::SampleFormat_Float);
+        stop = false;
+        opened = false;
+        QMutexLocker mix_lock(&mutex);
+        Q_UNUSED(mix_lock);
+        start(QThread::TimeCriticalPriority);
+        cond.wait(&mutex); // device is opened or failed
+        if (!opened) {
+            mix_lock.unlock();
+            wait();
+            qWarning("AudioOutputMixer: failed to open device");
+            return false;
+        }
+    }
+    ++refs;
+    client->reset();
+    QMutexLocker mix_lock(&mutex);
+    Q_UNUSED(mix_lock);
+    clients.append(client);
+    return true;
+}
+
+void AudioMixerEngine::detach(AudioOutputMixer *client)
+{
+    QMutexLocker lock(&attach_mutex);
+    Q_UNUSED(lock);
+    {
+        QMutexLocker mix_lock(&mutex);
+        Q_UNUSED(mix_lock);
+        if (!clients.removeOne(client))
+            return;
+    }
+    if (--refs > 0)
+        return;
+    stop = true;
+    wait();
+}
+
+void AudioMixerEngine::clear(AudioOutputMixer *client)
+{
+    QMutexLocker lock(&mutex);
+    Q_UNUSED(lock);
+    client->reset();
+}
+
+void AudioMixerEngine::run()
+{
+    AudioOutput ao;
+    QStringList backends(AudioOutputBackend::defaultPriority());
+    const QByteArray env(qgetenv("QTAV_AUDIO_MIXER_BACKENDS"));
+    if (!env.isEmpty())
+        backends = QString::fromLatin1(env).split(QLatin1Char(','), QString::SkipEmptyParts);
+    backends.removeAll(QLatin1String(kName));
+    ao.setBackends(backends);
+    ao.setAudioFormat(requested_format);
+    {
+        QMutexLocker lock(&mutex);
+        Q_UNUSED(lock);
+        opened = ao.open();
+        device_format = ao.audioFormat();
+        cond.wakeAll();
+        if (!opened)
+            return;
+    }
+    qDebug() << "AudioOutputMixer device: " << ao.backend() << device_format;
+    AudioScaleFunc mix = audioMixFunc(device_format.sampleFormat());
+    const int frame_bytes = device_format.bytesPerFrame();
+    const int frames = qMax(1, ao.bufferSize()/frame_bytes);
+    const char silence = device_format.isUnsigned() && !device_format.isFloat() ? (char)0x80 : 0;
+    const qreal rate = device_format.sampleRate();
+    // null device does not block
+    const bool pace = ao.backend() == QLatin1String("null");
+    QElapsedTimer timer;
+    timer.start();
+    qint64 pos = 0;
+    while (!stop) {
+        QByteArray data(frames*frame_bytes, silence);
+        {
+            QMutexLocker lock(&mutex);
+            Q_UNUSED(lock);
+            foreach (AudioOutputMixer* c, clients) {
+                c->mixTo((quint8*)data.data(), frames, pos, mix);
+            }
+        }
+        ao.play(data, qreal(pos)/rate);
+        pos += frames;
+        const qint64 played = qint64(ao.timestamp()*rate + 0.5);
+        {
+            QMutexLocker lock(&mutex);
+            Q_UNUSED(lock);
+            foreach (AudioOutputMixer* c, clients) {
+                c->updatePlayed(played);
+            }
+        }
+        if (pace) {
+            const qint64 ahead = qint64(qreal(pos)*1000.0/rate) - timer.elapsed();
+            if (ahead > 0)
+                msleep(ahead);
+        }
+    }
+    ao.close();
+}
+
+typedef AudioOutputMixer AudioOutputBackendMixer;
+static const AudioOutputBackendId AudioOutputBackendId_Mixer = mkid::id32base36_5<'M', 'i', 'x', 'e', 'r'>::value;
+FACTORY_REGISTER(AudioOutputBackend, Mixer, kName)
+
+AudioOutputMixer::AudioOutputMixer(QObject *parent)
+    : AudioOutputBackend(AudioOutput::DeviceFeatures() | AudioOutput::SetVolume | AudioOutput::SetMute, parent)
+    , engine(0)
+    , vol(1.0)
+    , mute(false)
+    , played(0)
+    , resampler(0)
+    , converted_pos(0)
+    , appended(0)
+    , consumed(0)
+    , gain(1.0f)
+{}
+
+AudioOutputMixer::~AudioOutputMixer()
+{
+    close();
+    if (resampler)
+        delete resampler;
+}
+
+bool AudioOutputMixer::open()
+{
+    if (engine)
+        return true;
+    AudioMixerEngine *e = audioMixerEngine();
+    if (!e)
+        return false;
+    // the engine never uses the resampler before attach() returns
+    mix_format = AudioFormat();
+    if (!e->attach(this, format))
+        return false;
+    engine = e;
+    return true;
+}
+
+bool AudioOutputMixer::close()
+{
+    if (!engine)
+        return true;
+    engine->detach(this);
+    engine = 0;
+    QMutexLocker lock(&mutex);
+    Q_UNUSED(lock);
+    pending.clear();
+    return true;
+}
+
+bool AudioOutputMixer::write(const QByteArray &data)
+{
+    if (!engine)
+        return false;
+    QMutexLocker lock(&mutex);
+    Q_UNUSED(lock);
+    pending.append(QByteArray(data.constData(), data.size())); // data can be a raw reference to the decoded frame
+    return true;
+}
+
+bool AudioOutputMixer::clear()
+{
+    if (!engine)
+        return false;
+    engine->clear(this);
+    return true;
+}
+
+int AudioOutputMixer::getPlayedCount()
+{
+    return played.fetchAndStoreOrdered(0);
+}
+
+bool AudioOutputMixer::setVolume(qreal value)
+{
+    QMutexLocker lock(&mutex);
+    Q_UNUSED(lock);
+    vol = value;
+    return true;
+}
+
+qreal AudioOutputMixer::getVolume() const
+{
+    QMutexLocker lock(&mutex);
+    Q_UNUSED(lock);
+    return vol;
+}
+
+bool AudioOutputMixer::setMute(bool value)
+{
+    QMutexLocker lock(&mutex);
+    Q_UNUSED(lock);
+    mute = value;
+    return true;
+}
+
+bool AudioOutputMixer::getMute() const
+{
+    QMutexLocker lock(&mutex);
+    Q_UNUSED(lock);
+    return mute;
+}
+
+void AudioOutputMixer::reset()
+{
+    {
+        QMutexLocker lock(&mutex);
+        Q_UNUSED(lock);
+        pending.clear();
+        gain = mute ? 0.0f : float(vol);
+    }
+    converted.clear();
+    converted_pos = 0;
+    appended = consumed = 0;
+    chunk_ends.clear();
+    mixed_ends.clear();
+    played.fetchAndStoreOrdered(0);
+}
+
+QByteArray AudioOutputMixer::convert(const QByteArray &data)
+{
+    if (!mix_format.isValid()) {
+        mix_format = audioMixerEngine()->format();
+        if (resampler) {
+            delete resampler;
+            resampler = 0;
+        }
+        if (format != mix_format) {
+            resampler = AudioResampler::create(AudioResamplerId_FF);
+            if (!resampler)
+                resampler = AudioResampler::create(AudioResamplerId_Libav);
+            if (!resampler) {
+                qWarning("AudioOutputMixer: no audio resampler is available");
+                return QByteArray();
+            }
+            resampler->setInAudioFormat(format);
+            resampler->setOutAudioFormat(mix_format);
+        }
+    }
+    if (!resampler)
+        return data;
+    // packed formats only, see AudioOutputBackend::isSupported()
+    const quint8 *planes[] = { (const quint8*)data.constData() };
+    resampler->setInSampesPerChannel(data.size()/format.bytesPerFrame());
+    if (!resampler->convert(planes))
+        return QByteArray();
+    return resampler->outData();
+}
+
+void AudioOutputMixer::mixTo(quint8 *dst, int frames, qint64 pos, AudioScaleFunc mix)
+{
+    const int frame_bytes = audioMixerEngine()->format().bytesPerFrame();
+    const int need = frames*frame_bytes;
+    while (converted.size() - converted_pos < need) {
+        QByteArray data;
+        {
+            QMutexLocker lock(&mutex);
+            Q_UNUSED(lock);
+            if (pending.isEmpty())
+                break;
+            data = pending.takeFirst();
+        }
+        const QByteArray out(convert(data));
+        converted.remove(0, converted_pos);
+        converted_pos = 0;
+        converted.append(out);
+        appended += out.size()/frame_bytes;
+        chunk_ends.append(appended);
+    }
+    float target = 0;
+    {
+        QMutexLocker lock(&mutex);
+        Q_UNUSED(lock);
+        target = mute ? 0.0f : float(vol);
+    }
+    const int n = qMin(need, converted.size() - converted_pos)/frame_bytes;
+    if (n > 0 && mix) {
+        const int nb_samples = n*mix_format.channels();
+        // ramp to avoid zipper noise
+        mix(dst, (const quint8*)converted.constData() + converted_pos, nb_samples, gain, (target - gain)/float(nb_samples));
+        gain = target;
+    }
+    converted_pos += n*frame_bytes;
+    const qint64 consumed0 = consumed;
+    consumed += n;
+    while (!chunk_ends.isEmpty() && chunk_ends.first() <= consumed) {
+        mixed_ends.append(pos + chunk_ends.takeFirst() - consumed0);
+    }
+}
+
+void AudioOutputMixer::updatePlayed(qint64 pos)
+{
+    int n = 0;
+    while (!mixed_ends.isEmpty() && mixed_ends.first() <= pos) {
+        mixed_ends.removeFirst();
+        ++n;
+    }
+    if (n <= 0)
+        return;
+    played.fetchAndAddOrdered(n);
+    onCallback();
+}
+} //namespace QtAV
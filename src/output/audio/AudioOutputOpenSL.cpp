@@ -69,6 +69,7 @@ public:
     bool play() Q_DECL_OVERRIDE;
     //default return -1. means not the control
     int getPlayedCount() Q_DECL_OVERRIDE;
+    qint64 getLatency() Q_DECL_OVERRIDE;
     bool setVolume(qreal value) Q_DECL_OVERRIDE;
     qreal getVolume() const Q_DECL_OVERRIDE;
     bool setMute(bool value = true) Q_DECL_OVERRIDE;
@@ -80,6 +81,12 @@ public:
     static void playCallback(SLPlayItf player, void *ctx, SLuint32 event);
 private:
     SLDataFormat_PCM_EX audioFormatToSL(const AudioFormat &format);
+    // Enqueue() a part of queue_data
+    bool enqueue(const char* data, int size);
+    // Pull: fill the next buffer from AudioOutput in the callback
+    bool enqueuePulled();
+    // buffers in the device queue, including the playing one
+    SLuint32 queuedCount();
 
     SLObjectItf engineObject;
     SLEngineItf engine;
@@ -154,7 +161,9 @@ void AudioOutputOpenSL::bufferQueueCallbackAndroid(SLAndroidSimpleBufferQueueItf
     qDebug(">>>>>>>>>>>>>>bufferQueueCallback state.count=%lu .playIndex=%lu", state.count, state.playIndex);
 #endif
     AudioOutputOpenSL *ao = reinterpret_cast<AudioOutputOpenSL*>(context);
-    if (ao->bufferControl() & AudioOutputBackend::CountCallback) {
+    if (ao->bufferControl() & AudioOutputBackend::Pull) {
+        ao->enqueuePulled();
+    } else if (ao->bufferControl() & AudioOutputBackend::CountCallback) {
         ao->onCallback();
     }
 }
@@ -167,7 +176,9 @@ void AudioOutputOpenSL::bufferQueueCallback(SLBufferQueueItf bufferQueue, void *
     qDebug(">>>>>>>>>>>>>>bufferQueueCallback state.count=%lu .playIndex=%lu", state.count, state.playIndex);
 #endif
     AudioOutputOpenSL *ao = reinterpret_cast<AudioOutputOpenSL*>(context);
-    if (ao->bufferControl() & AudioOutputBackend::CountCallback) {
+    if (ao->bufferControl() & AudioOutputBackend::Pull) {
+        ao->enqueuePulled();
+    } else if (ao->bufferControl() & AudioOutputBackend::CountCallback) {
         ao->onCallback();
     }
 }
@@ -247,7 +258,7 @@ bool AudioOutputOpenSL::isSupported(AudioFormat::ChannelLayout channelLayout) co
 
 AudioOutputBackend::BufferControl AudioOutputOpenSL::bufferControl() const
 {
-    return CountCallback;//BufferControl(Callback | PlayedCount);
+    return Pull;//CountCallback;//BufferControl(Callback | PlayedCount);
 }
 
 void AudioOutputOpenSL::onCallback()
@@ -375,50 +386,86 @@ bool AudioOutputOpenSL::write(const QByteArray& data)
         queue_data_write = 0;
     memcpy((char*)queue_data.constData() + queue_data_write, data.constData(), data.size());
     //qDebug("enqueue %p, queue_data_write: %d/%d available:%d", data.constData(), queue_data_write, queue_data.size(), sem.available());
+    return enqueue(queue_data.constData() + queue_data_write, data.size());
+}
+
+bool AudioOutputOpenSL::enqueue(const char *data, int size)
+{
 #ifdef Q_OS_ANDROID
     if (m_android)
-        SL_ENSURE((*m_bufferQueueItf_android)->Enqueue(m_bufferQueueItf_android, queue_data.constData() + queue_data_write, data.size()), false);
+        SL_ENSURE((*m_bufferQueueItf_android)->Enqueue(m_bufferQueueItf_android, data, size), false);
     else
 #endif
-    SL_ENSURE((*m_bufferQueueItf)->Enqueue(m_bufferQueueItf, queue_data.constData() + queue_data_write, data.size()), false);
+    SL_ENSURE((*m_bufferQueueItf)->Enqueue(m_bufferQueueItf, data, size), false);
     buffers_queued++;
-    queue_data_write += data.size();
+    queue_data_write += size;
     if (queue_data_write == queue_data.size())
         queue_data_write = 0;
     return true;
 }
 
+bool AudioOutputOpenSL::enqueuePulled()
+{
+    if (buffer_size <= 0 || queue_data.size() < buffer_size)
+        return false;
+    if (queue_data.size() - queue_data_write < buffer_size)
+        queue_data_write = 0;
+    char *data = (char*)queue_data.constData() + queue_data_write;
+    pull(data, buffer_size);
+    return enqueue(data, buffer_size);
+}
+
 bool AudioOutputOpenSL::play()
 {
     SLuint32 state = SL_PLAYSTATE_PLAYING;
     (*m_playItf)->GetPlayState(m_playItf, &state);
     if (state == SL_PLAYSTATE_PLAYING)
         return true;
+    if (bufferControl() & Pull) {
+        // 2 buffers in device queue. others are in AudioOutput's ring
+        for (int i = 0; i < qMin(2, buffer_count); ++i)
+            enqueuePulled();
+    }
     SL_ENSURE((*m_playItf)->SetPlayState(m_playItf, SL_PLAYSTATE_PLAYING), false);
     return true;
 }
 
-int AudioOutputOpenSL::getPlayedCount()
+SLuint32 AudioOutputOpenSL::queuedCount()
 {
-    int processed = buffers_queued;
-    SLuint32 count = 0;
 #ifdef Q_OS_ANDROID
     if (m_android) {
         SLAndroidSimpleBufferQueueState state;
         (*m_bufferQueueItf_android)->GetState(m_bufferQueueItf_android, &state);
-        count = state.count;
-    } else
-#endif
-    {
-        SLBufferQueueState state;
-        (*m_bufferQueueItf)->GetState(m_bufferQueueItf, &state);
-        count = state.count;
+        return state.count;
     }
+#endif
+    SLBufferQueueState state;
+    (*m_bufferQueueItf)->GetState(m_bufferQueueItf, &state);
+    return state.count;
+}
+
+int AudioOutputOpenSL::getPlayedCount()
+{
+    int processed = buffers_queued;
+    const SLuint32 count = queuedCount();
     buffers_queued = count;
     processed -= count;
     return processed;
 }
 
+qint64 AudioOutputOpenSL::getLatency()
+{
+    // pulled buffers are enqueued with buffer_size bytes
+#ifdef Q_OS_ANDROID
+    if (m_android ? !m_bufferQueueItf_android : !m_bufferQueueItf)
+        return 0;
+#else
+    if (!m_bufferQueueItf)
+        return 0;
+#endif
+    return format.durationForBytes(int(queuedCount())*buffer_size);
+}
+
 bool AudioOutputOpenSL::setVolume(qreal value)
 {
     if (!m_volumeItf)
@@ -47,6 +47,7 @@ protected:
     bool play() Q_DECL_FINAL;
     BufferControl bufferControl() const Q_DECL_FINAL;
     int getWritableBytes() Q_DECL_FINAL;
+    qint64 getLatency() Q_DECL_FINAL;
 
     bool setVolume(qreal value) Q_DECL_FINAL;
     qreal getVolume() const Q_DECL_FINAL;
@@ -219,12 +220,23 @@ void AudioOutputPulse::latencyUpdateCallback(pa_stream *s, void *userdata)
 
 void AudioOutputPulse::writeCallback(pa_stream *s, size_t length, void *userdata)
 {
-    Q_UNUSED(s);
     // length: writable bytes. callback is called pirioddically
     AudioOutputPulse *p = reinterpret_cast<AudioOutputPulse*>(userdata);
     //qDebug("write callback: %d + %d", p->writable_size, length);
     p->writable_size = length;
-    p->onCallback();
+    // pull from the ring in mainloop thread. no lock is shared with the audio thread
+    while (length > 0) {
+        void *data = 0;
+        size_t n = length;
+        if (pa_stream_begin_write(s, &data, &n) < 0 || !data || n == 0)
+            break;
+        n = qMin(n, length);
+        p->pull((char*)data, (int)n);
+        if (pa_stream_write(s, data, n, NULL, 0LL, PA_SEEK_RELATIVE) < 0)
+            break;
+        length -= n;
+    }
+    p->writable_size = 0;
 }
 
 void AudioOutputPulse::successCallback(pa_stream *s, int success, void *userdata)
@@ -408,7 +420,7 @@ bool AudioOutputPulse::close()
 
 AudioOutputBackend::BufferControl AudioOutputPulse::bufferControl() const
 {
-    return BytesCallback;
+    return Pull;
 }
 
 int AudioOutputPulse::getWritableBytes()
@@ -423,6 +435,20 @@ int AudioOutputPulse::getWritableBytes()
     return pa_stream_writable_size(stream);
 }
 
+qint64 AudioOutputPulse::getLatency()
+{
+    if (!loop || !stream)
+        return 0;
+    ScopedPALocker palock(loop);
+    Q_UNUSED(palock);
+    // interpolated from the last timing update (PA_STREAM_INTERPOLATE_TIMING), no round trip to the server
+    pa_usec_t usec = 0;
+    int negative = 0;
+    if (pa_stream_get_latency(stream, &usec, &negative) < 0 || negative)
+        return 0;
+    return qint64(usec);
+}
+
 bool AudioOutputPulse::write(const QByteArray &data)
 {
     ScopedPALocker palock(loop);
@@ -58,6 +58,9 @@ bool VideoRenderer::receive(const VideoFrame &frame)
     setInSize(frame.width(), frame.height());
     QMutexLocker locker(&d.img_mutex);
     Q_UNUSED(locker); //TODO: double buffer for display/dec frame to avoid mutex
+    if (d.statistics)
+        d.receive_time = Statistics::Pipeline::now();
+    d.memory.set(MemoryBudget::frameBytes(frame));
     return receiveFrame(frame);
 }
 
@@ -508,6 +511,10 @@ void VideoRenderer::handlePaintEvent()
             drawFrame();
             //qDebug("render elapsed: %lld", et.elapsed());
             if (d.statistics) {
+                if (d.receive_time > 0) { // not a repaint
+                    d.statistics->pipeline().record(Statistics::Pipeline::Video, Statistics::Pipeline::Render, d.receive_time, Statistics::Pipeline::now(), d.video_frame.timestamp());
+                    d.receive_time = 0;
+                }
                 d.statistics->video_only.frameDisplayed(d.video_frame.timestamp());
                 d.statistics->video.current_time = QTime(0, 0, 0).addMSecs(int(d.video_frame.timestamp() * 1000.0));
             }
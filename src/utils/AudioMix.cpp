@@ -0,0 +1,209 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#include "AudioMix.h"
+#include "QtAV/private/AVCompat.h"
+#include <libavutil/cpu.h>
+#include <math.h>
+
+namespace QtAV {
+namespace {
+template<typename T> inline T scale_sample(T s, float g) { return s*g;}
+template<> inline quint8 scale_sample<quint8>(quint8 s, float g) { return av_clip_uint8(lrintf(((int)s - 128)*g) + 128);}
+template<> inline qint16 scale_sample<qint16>(qint16 s, float g) { return av_clip_int16(lrintf(s*g));}
+template<> inline qint32 scale_sample<qint32>(qint32 s, float g) { return av_clipl_int32(llrint((double)s*g));}
+
+template<typename T> inline T mix_sample(T d, T s, float g) { return d + s*g;}
+template<> inline quint8 mix_sample<quint8>(quint8 d, quint8 s, float g) { return av_clip_uint8(d + lrintf(((int)s - 128)*g));}
+template<> inline qint16 mix_sample<qint16>(qint16 d, qint16 s, float g) { return av_clip_int16(d + lrintf(s*g));}
+template<> inline qint32 mix_sample<qint32>(qint32 d, qint32 s, float g) { return av_clipl_int32((qint64)d + llrint((double)s*g));}
+
+template<typename T>
+void scale_c(quint8 *dst, const quint8 *src, int nb_samples, float gain, float step)
+{
+    T *d = (T*)dst;
+    const T *s = (const T*)src;
+    for (int i = 0; i < nb_samples; ++i)
+        d[i] = scale_sample<T>(s[i], gain + (float)i*step);
+}
+
+template<typename T>
+void mix_c(quint8 *dst, const quint8 *src, int nb_samples, float gain, float step)
+{
+    T *d = (T*)dst;
+    const T *s = (const T*)src;
+    for (int i = 0; i < nb_samples; ++i)
+        d[i] = mix_sample<T>(d[i], s[i], gain + (float)i*step);
+}
+
+#if QTAV_HAVE(SSE2) && defined(Q_PROCESSOR_X86)
+static bool detect_sse2()
+{
+    static bool is_sse2 = !!(av_get_cpu_flags() & AV_CPU_FLAG_SSE2);
+    return is_sse2;
+}
+#endif
+#if QTAV_HAVE(AVX2) && defined(Q_PROCESSOR_X86)
+static bool detect_avx2()
+{
+#ifdef AV_CPU_FLAG_AVX2
+    static bool is_avx2 = !!(av_get_cpu_flags() & AV_CPU_FLAG_AVX2);
+    return is_avx2;
+#else
+    return false;
+#endif
+}
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+static bool detect_neon()
+{
+#ifdef AV_CPU_FLAG_NEON
+    static bool is_neon = !!(av_get_cpu_flags() & AV_CPU_FLAG_NEON);
+    return is_neon;
+#else
+    return true;
+#endif
+}
+#endif
+
+struct Kernels {
+    int (*scale_s16)(qint16*, const qint16*, int, float, float);
+    int (*mix_s16)(qint16*, const qint16*, int, float, float);
+    int (*scale_flt)(float*, const float*, int, float, float);
+    int (*mix_flt)(float*, const float*, int, float, float);
+
+    Kernels() : scale_s16(0), mix_s16(0), scale_flt(0), mix_flt(0) {
+#if QTAV_HAVE(AVX2) && defined(Q_PROCESSOR_X86)
+        if (detect_avx2()) {
+            scale_s16 = scale_s16_avx2;
+            mix_s16 = mix_s16_avx2;
+            scale_flt = scale_flt_avx2;
+            mix_flt = mix_flt_avx2;
+            return;
+        }
+#endif
+#if QTAV_HAVE(SSE2) && defined(Q_PROCESSOR_X86)
+        if (detect_sse2()) {
+            scale_s16 = scale_s16_sse2;
+            mix_s16 = mix_s16_sse2;
+            scale_flt = scale_flt_sse2;
+            mix_flt = mix_flt_sse2;
+            return;
+        }
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+        if (detect_neon()) {
+            scale_s16 = scale_s16_neon;
+            mix_s16 = mix_s16_neon;
+            scale_flt = scale_flt_neon;
+            mix_flt = mix_flt_neon;
+            return;
+        }
+#endif
+    }
+};
+
+static const Kernels& kernels()
+{
+    static const Kernels k;
+    return k;
+}
+
+// vector kernel for the body, c for the tail
+template<typename T, bool Mix>
+inline void process(int (*kernel)(T*, const T*, int, float, float), quint8 *dst, const quint8 *src, int nb_samples, float gain, float step)
+{
+    const int n = kernel ? kernel((T*)dst, (const T*)src, nb_samples, gain, step) : 0;
+    if (n >= nb_samples)
+        return;
+    if (Mix)
+        mix_c<T>(dst + n*sizeof(T), src + n*sizeof(T), nb_samples - n, gain + (float)n*step, step);
+    else
+        scale_c<T>(dst + n*sizeof(T), src + n*sizeof(T), nb_samples - n, gain + (float)n*step, step);
+}
+
+void scale_s16(quint8 *dst, const quint8 *src, int nb_samples, float gain, float step)
+{
+    process<qint16, false>(kernels().scale_s16, dst, src, nb_samples, gain, step);
+}
+
+void mix_s16(quint8 *dst, const quint8 *src, int nb_samples, float gain, float step)
+{
+    process<qint16, true>(kernels().mix_s16, dst, src, nb_samples, gain, step);
+}
+
+void scale_flt(quint8 *dst, const quint8 *src, int nb_samples, float gain, float step)
+{
+    process<float, false>(kernels().scale_flt, dst, src, nb_samples, gain, step);
+}
+
+void mix_flt(quint8 *dst, const quint8 *src, int nb_samples, float gain, float step)
+{
+    process<float, true>(kernels().mix_flt, dst, src, nb_samples, gain, step);
+}
+} //namespace
+
+AudioScaleFunc audioScaleFunc(AudioFormat::SampleFormat fmt)
+{
+    switch (fmt) {
+    case AudioFormat::SampleFormat_Unsigned8:
+    case AudioFormat::SampleFormat_Unsigned8Planar:
+        return scale_c<quint8>;
+    case AudioFormat::SampleFormat_Signed16:
+    case AudioFormat::SampleFormat_Signed16Planar:
+        return scale_s16;
+    case AudioFormat::SampleFormat_Signed32:
+    case AudioFormat::SampleFormat_Signed32Planar:
+        return scale_c<qint32>;
+    case AudioFormat::SampleFormat_Float:
+    case AudioFormat::SampleFormat_FloatPlanar:
+        return scale_flt;
+    case AudioFormat::SampleFormat_Double:
+    case AudioFormat::SampleFormat_DoublePlanar:
+        return scale_c<double>;
+    default:
+        return 0;
+    }
+}
+
+AudioScaleFunc audioMixFunc(AudioFormat::SampleFormat fmt)
+{
+    switch (fmt) {
+    case AudioFormat::SampleFormat_Unsigned8:
+    case AudioFormat::SampleFormat_Unsigned8Planar:
+        return mix_c<quint8>;
+    case AudioFormat::SampleFormat_Signed16:
+    case AudioFormat::SampleFormat_Signed16Planar:
+        return mix_s16;
+    case AudioFormat::SampleFormat_Signed32:
+    case AudioFormat::SampleFormat_Signed32Planar:
+        return mix_c<qint32>;
+    case AudioFormat::SampleFormat_Float:
+    case AudioFormat::SampleFormat_FloatPlanar:
+        return mix_flt;
+    case AudioFormat::SampleFormat_Double:
+    case AudioFormat::SampleFormat_DoublePlanar:
+        return mix_c<double>;
+    default:
+        return 0;
+    }
+}
+} //namespace QtAV
@@ -0,0 +1,61 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#ifndef QTAV_AUDIOMIX_H
+#define QTAV_AUDIOMIX_H
+
+#include <QtAV/AudioFormat.h>
+
+namespace QtAV {
+/*!
+ * Software volume and mixing of audio samples. Samples of all channels in a plane are processed as one sequence.
+ * The gain of sample i is gain + i*step, so a volume change can be ramped over a buffer with step = (to - from)/nb_samples.
+ *   scale: dst[i] = src[i]*gain_i
+ *   mix: dst[i] = dst[i] + src[i]*gain_i
+ * Integer samples are rounded and saturated. Unsigned 8 bit samples are scaled around 128. dst can be src.
+ */
+typedef void (*AudioScaleFunc)(quint8* dst, const quint8* src, int nb_samples, float gain, float step);
+/*!
+ * \brief audioScaleFunc, audioMixFunc
+ * Return the fastest implementation for the cpu (sse2, avx2 or neon for signed 16 bit and float samples), or 0 if the
+ * sample format is not supported. Packed and planar formats use the same function.
+ */
+Q_AV_PRIVATE_EXPORT AudioScaleFunc audioScaleFunc(AudioFormat::SampleFormat fmt);
+Q_AV_PRIVATE_EXPORT AudioScaleFunc audioMixFunc(AudioFormat::SampleFormat fmt);
+
+/*!
+ * Vector kernels. Return the number of samples processed, which is a multiple of the vector width.
+ * The rest is processed by the caller starting with gain + n*step.
+ */
+int scale_s16_sse2(qint16* dst, const qint16* src, int nb_samples, float gain, float step);
+int mix_s16_sse2(qint16* dst, const qint16* src, int nb_samples, float gain, float step);
+int scale_flt_sse2(float* dst, const float* src, int nb_samples, float gain, float step);
+int mix_flt_sse2(float* dst, const float* src, int nb_samples, float gain, float step);
+int scale_s16_avx2(qint16* dst, const qint16* src, int nb_samples, float gain, float step);
+int mix_s16_avx2(qint16* dst, const qint16* src, int nb_samples, float gain, float step);
+int scale_flt_avx2(float* dst, const float* src, int nb_samples, float gain, float step);
+int mix_flt_avx2(float* dst, const float* src, int nb_samples, float gain, float step);
+int scale_s16_neon(qint16* dst, const qint16* src, int nb_samples, float gain, float step);
+int mix_s16_neon(qint16* dst, const qint16* src, int nb_samples, float gain, float step);
+int scale_flt_neon(float* dst, const float* src, int nb_samples, float gain, float step);
+int mix_flt_neon(float* dst, const float* src, int nb_samples, float gain, float step);
+} //namespace QtAV
+#endif //QTAV_AUDIOMIX_H
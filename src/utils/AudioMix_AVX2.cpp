@@ -0,0 +1,104 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+#if defined(__AVX2__) || (defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))) // vc does not define __AVX2__ without -arch:AVX2
+#include "AudioMix.h"
+#include <immintrin.h>
+
+namespace QtAV {
+namespace {
+static inline __m256 ramp8(float gain, float step) {
+    return _mm256_setr_ps(gain, gain + step, gain + 2.0f*step, gain + 3.0f*step
+                          , gain + 4.0f*step, gain + 5.0f*step, gain + 6.0f*step, gain + 7.0f*step);
+}
+// gains of 8 samples starting from sample i
+static inline __m256 gain8(__m256 ramp, float step, int i) {
+    return _mm256_add_ps(ramp, _mm256_set1_ps((float)i*step));
+}
+// 16 samples
+static inline __m256i scale16(__m256i s, __m256 g0, __m256 g1) {
+    const __m256i lo = _mm256_cvtepi16_epi32(_mm256_castsi256_si128(s));
+    const __m256i hi = _mm256_cvtepi16_epi32(_mm256_extracti128_si256(s, 1));
+    const __m256i p = _mm256_packs_epi32(_mm256_cvtps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(lo), g0))
+                                         , _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(hi), g1)));
+    return _mm256_permute4x64_epi64(p, 0xd8); // packs works in 128 bit lanes
+}
+// d + s*g of 16 samples. add in 32 bit and saturate once like mix_sample<qint16>
+static inline __m256i mix16(__m256i d, __m256i s, __m256 g0, __m256 g1) {
+    const __m256i slo = _mm256_cvtepi16_epi32(_mm256_castsi256_si128(s));
+    const __m256i shi = _mm256_cvtepi16_epi32(_mm256_extracti128_si256(s, 1));
+    const __m256i dlo = _mm256_cvtepi16_epi32(_mm256_castsi256_si128(d));
+    const __m256i dhi = _mm256_cvtepi16_epi32(_mm256_extracti128_si256(d, 1));
+    const __m256i p = _mm256_packs_epi32(_mm256_add_epi32(dlo, _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(slo), g0)))
+                                         , _mm256_add_epi32(dhi, _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(shi), g1))));
+    return _mm256_permute4x64_epi64(p, 0xd8);
+}
+} //namespace
+
+int scale_s16_avx2(qint16 *dst, const qint16 *src, int nb_samples, float gain, float step)
+{
+    const __m256 ramp = ramp8(gain, step);
+    const int n = nb_samples & ~15;
+    for (int i = 0; i < n; i += 16) {
+        const __m256i s = _mm256_loadu_si256((const __m256i*)(src + i));
+        _mm256_storeu_si256((__m256i*)(dst + i), scale16(s, gain8(ramp, step, i), gain8(ramp, step, i + 8)));
+    }
+    return n;
+}
+
+int mix_s16_avx2(qint16 *dst, const qint16 *src, int nb_samples, float gain, float step)
+{
+    const __m256 ramp = ramp8(gain, step);
+    const int n = nb_samples & ~15;
+    for (int i = 0; i < n; i += 16) {
+        const __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+        const __m256i s = _mm256_loadu_si256((const __m256i*)(src + i));
+        _mm256_storeu_si256((__m256i*)(dst + i), mix16(d, s, gain8(ramp, step, i), gain8(ramp, step, i + 8)));
+    }
+    return n;
+}
+
+int scale_flt_avx2(float *dst, const float *src, int nb_samples, float gain, float step)
+{
+    const __m256 ramp = ramp8(gain, step);
+    const int n = nb_samples & ~15;
+    for (int i = 0; i < n; i += 16) {
+        const __m256 s0 = _mm256_mul_ps(_mm256_loadu_ps(src + i), gain8(ramp, step, i));
+        const __m256 s1 = _mm256_mul_ps(_mm256_loadu_ps(src + i + 8), gain8(ramp, step, i + 8));
+        _mm256_storeu_ps(dst + i, s0);
+        _mm256_storeu_ps(dst + i + 8, s1);
+    }
+    return n;
+}
+
+int mix_flt_avx2(float *dst, const float *src, int nb_samples, float gain, float step)
+{
+    const __m256 ramp = ramp8(gain, step);
+    const int n = nb_samples & ~15;
+    for (int i = 0; i < n; i += 16) {
+        const __m256 s0 = _mm256_mul_ps(_mm256_loadu_ps(src + i), gain8(ramp, step, i));
+        const __m256 s1 = _mm256_mul_ps(_mm256_loadu_ps(src + i + 8), gain8(ramp, step, i + 8));
+        _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), s0));
+        _mm256_storeu_ps(dst + i + 8, _mm256_add_ps(_mm256_loadu_ps(dst + i + 8), s1));
+    }
+    return n;
+}
+} //namespace QtAV
+#endif
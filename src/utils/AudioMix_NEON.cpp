@@ -0,0 +1,107 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+#if defined(__ARM_NEON) || defined(__ARM_NEON__) // always on arm64, -mfpu=neon on arm
+#include "AudioMix.h"
+#include <arm_neon.h>
+
+namespace QtAV {
+namespace {
+// gains of 4 samples starting from sample i
+static inline float32x4_t gain4(float32x4_t ramp, float step, int i) {
+    return vaddq_f32(ramp, vdupq_n_f32((float)i*step));
+}
+static inline int32x4_t round_s32(float32x4_t v) {
+#ifdef __aarch64__
+    return vcvtnq_s32_f32(v);
+#else
+    // vcvtq_s32_f32 truncates. round half to even like lrintf: neon always rounds to nearest, so adding 1.5*2^23 drops the fraction
+    const float32x4_t magic = vdupq_n_f32(12582912.0f);
+    const float32x4_t r = vsubq_f32(vaddq_f32(v, magic), magic);
+    // |v| >= 2^22 is already an integer
+    return vcvtq_s32_f32(vbslq_f32(vcaltq_f32(v, vdupq_n_f32(4194304.0f)), r, v));
+#endif
+}
+// 8 samples
+static inline int16x8_t scale8(int16x8_t s, float32x4_t g0, float32x4_t g1) {
+    const float32x4_t lo = vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(s))), g0);
+    const float32x4_t hi = vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(s))), g1);
+    return vcombine_s16(vqmovn_s32(round_s32(lo)), vqmovn_s32(round_s32(hi)));
+}
+// d + s*g of 8 samples. add in 32 bit and saturate once like mix_sample<qint16>
+static inline int16x8_t mix8(int16x8_t d, int16x8_t s, float32x4_t g0, float32x4_t g1) {
+    const float32x4_t lo = vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(s))), g0);
+    const float32x4_t hi = vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(s))), g1);
+    return vcombine_s16(vqmovn_s32(vaddq_s32(vmovl_s16(vget_low_s16(d)), round_s32(lo)))
+                        , vqmovn_s32(vaddq_s32(vmovl_s16(vget_high_s16(d)), round_s32(hi))));
+}
+static inline float32x4_t ramp4(float gain, float step) {
+    const float r[4] = { gain, gain + step, gain + 2.0f*step, gain + 3.0f*step };
+    return vld1q_f32(r);
+}
+} //namespace
+
+int scale_s16_neon(qint16 *dst, const qint16 *src, int nb_samples, float gain, float step)
+{
+    const float32x4_t ramp = ramp4(gain, step);
+    const int n = nb_samples & ~7;
+    for (int i = 0; i < n; i += 8) {
+        vst1q_s16(dst + i, scale8(vld1q_s16(src + i), gain4(ramp, step, i), gain4(ramp, step, i + 4)));
+    }
+    return n;
+}
+
+int mix_s16_neon(qint16 *dst, const qint16 *src, int nb_samples, float gain, float step)
+{
+    const float32x4_t ramp = ramp4(gain, step);
+    const int n = nb_samples & ~7;
+    for (int i = 0; i < n; i += 8) {
+        vst1q_s16(dst + i, mix8(vld1q_s16(dst + i), vld1q_s16(src + i), gain4(ramp, step, i), gain4(ramp, step, i + 4)));
+    }
+    return n;
+}
+
+int scale_flt_neon(float *dst, const float *src, int nb_samples, float gain, float step)
+{
+    const float32x4_t ramp = ramp4(gain, step);
+    const int n = nb_samples & ~7;
+    for (int i = 0; i < n; i += 8) {
+        const float32x4_t s0 = vmulq_f32(vld1q_f32(src + i), gain4(ramp, step, i));
+        const float32x4_t s1 = vmulq_f32(vld1q_f32(src + i + 4), gain4(ramp, step, i + 4));
+        vst1q_f32(dst + i, s0);
+        vst1q_f32(dst + i + 4, s1);
+    }
+    return n;
+}
+
+int mix_flt_neon(float *dst, const float *src, int nb_samples, float gain, float step)
+{
+    const float32x4_t ramp = ramp4(gain, step);
+    const int n = nb_samples & ~7;
+    for (int i = 0; i < n; i += 8) {
+        const float32x4_t s0 = vmulq_f32(vld1q_f32(src + i), gain4(ramp, step, i));
+        const float32x4_t s1 = vmulq_f32(vld1q_f32(src + i + 4), gain4(ramp, step, i + 4));
+        vst1q_f32(dst + i, vaddq_f32(vld1q_f32(dst + i), s0));
+        vst1q_f32(dst + i + 4, vaddq_f32(vld1q_f32(dst + i + 4), s1));
+    }
+    return n;
+}
+} //namespace QtAV
+#endif
@@ -0,0 +1,98 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+#if defined(__SSE__) || defined(_M_IX86) || defined(_M_X64) // gcc, clang defines __SSE__, vc does not
+#include "AudioMix.h"
+#include <emmintrin.h>
+
+namespace QtAV {
+namespace {
+// gains of 4 samples starting from sample i
+static inline __m128 gain4(__m128 ramp, float step, int i) {
+    return _mm_add_ps(ramp, _mm_set1_ps((float)i*step));
+}
+// 8 samples
+static inline __m128i scale8(__m128i s, __m128 g0, __m128 g1) {
+    const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+    const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+    return _mm_packs_epi32(_mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(lo), g0))
+                           , _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(hi), g1)));
+}
+// d + s*g of 8 samples. add in 32 bit and saturate once like mix_sample<qint16>
+static inline __m128i mix8(__m128i d, __m128i s, __m128 g0, __m128 g1) {
+    const __m128i slo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+    const __m128i shi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+    const __m128i dlo = _mm_srai_epi32(_mm_unpacklo_epi16(d, d), 16);
+    const __m128i dhi = _mm_srai_epi32(_mm_unpackhi_epi16(d, d), 16);
+    return _mm_packs_epi32(_mm_add_epi32(dlo, _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(slo), g0)))
+                           , _mm_add_epi32(dhi, _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(shi), g1))));
+}
+} //namespace
+
+int scale_s16_sse2(qint16 *dst, const qint16 *src, int nb_samples, float gain, float step)
+{
+    const __m128 ramp = _mm_setr_ps(gain, gain + step, gain + 2.0f*step, gain + 3.0f*step);
+    const int n = nb_samples & ~7;
+    for (int i = 0; i < n; i += 8) {
+        const __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        _mm_storeu_si128((__m128i*)(dst + i), scale8(s, gain4(ramp, step, i), gain4(ramp, step, i + 4)));
+    }
+    return n;
+}
+
+int mix_s16_sse2(qint16 *dst, const qint16 *src, int nb_samples, float gain, float step)
+{
+    const __m128 ramp = _mm_setr_ps(gain, gain + step, gain + 2.0f*step, gain + 3.0f*step);
+    const int n = nb_samples & ~7;
+    for (int i = 0; i < n; i += 8) {
+        const __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        const __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        _mm_storeu_si128((__m128i*)(dst + i), mix8(d, s, gain4(ramp, step, i), gain4(ramp, step, i + 4)));
+    }
+    return n;
+}
+
+int scale_flt_sse2(float *dst, const float *src, int nb_samples, float gain, float step)
+{
+    const __m128 ramp = _mm_setr_ps(gain, gain + step, gain + 2.0f*step, gain + 3.0f*step);
+    const int n = nb_samples & ~7;
+    for (int i = 0; i < n; i += 8) {
+        const __m128 s0 = _mm_mul_ps(_mm_loadu_ps(src + i), gain4(ramp, step, i));
+        const __m128 s1 = _mm_mul_ps(_mm_loadu_ps(src + i + 4), gain4(ramp, step, i + 4));
+        _mm_storeu_ps(dst + i, s0);
+        _mm_storeu_ps(dst + i + 4, s1);
+    }
+    return n;
+}
+
+int mix_flt_sse2(float *dst, const float *src, int nb_samples, float gain, float step)
+{
+    const __m128 ramp = _mm_setr_ps(gain, gain + step, gain + 2.0f*step, gain + 3.0f*step);
+    const int n = nb_samples & ~7;
+    for (int i = 0; i < n; i += 8) {
+        const __m128 s0 = _mm_mul_ps(_mm_loadu_ps(src + i), gain4(ramp, step, i));
+        const __m128 s1 = _mm_mul_ps(_mm_loadu_ps(src + i + 4), gain4(ramp, step, i + 4));
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), s0));
+        _mm_storeu_ps(dst + i + 4, _mm_add_ps(_mm_loadu_ps(dst + i + 4), s1));
+    }
+    return n;
+}
+} //namespace QtAV
+#endif
@@ -0,0 +1,110 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#ifndef QTAV_AUDIORING_H
+#define QTAV_AUDIORING_H
+
+#include <string.h>
+#include <QtCore/QByteArray>
+#include "SPSCQueue.h"
+
+namespace QtAV {
+/*!
+ * \brief The AudioRing class
+ * A lock free single producer single consumer byte ring between the audio thread and the device callback.
+ * Positions are the total bytes written/read as quint32 and wrap around. Compare them by difference, e.g. qint32(a - b) > 0.
+ * read() and write() never block or allocate, so the callback thread never waits for the producer.
+ * The capacity is a power of 2, so offsets are still right after positions wrap.
+ * resize() is not thread safe. clear() can be called by the producer while the consumer is reading.
+ */
+class AudioRing
+{
+public:
+    AudioRing() : m_write(0), m_read(0), m_drop(0) {}
+    void resize(int bytes) {
+        int cap = 1;
+        while (cap < bytes)
+            cap <<= 1;
+        m_data = QByteArray(cap, 0);
+        m_write = m_read = m_drop = 0;
+    }
+    int capacity() const { return m_data.size();}
+    // producer
+    quint32 writePosition() const { return load(m_write);}
+    int writable() const { return capacity() - qint32(writePosition() - readPosition());}
+    int write(const char* data, int bytes) {
+        const quint32 w = writePosition();
+        if (capacity() <= 0)
+            return 0;
+        bytes = qMin(bytes, capacity() - qint32(w - readPosition()));
+        if (bytes <= 0)
+            return 0;
+        copy(const_cast<char*>(m_data.constData()), w, data, bytes, true);
+        storeRelease(m_write, w + quint32(bytes));
+        return bytes;
+    }
+    /// drop all written bytes. the consumer skips them on next read()
+    void clear() { storeRelease(m_drop, writePosition());}
+    // consumer
+    quint32 readPosition() const { return load(m_read);}
+    int readable() const { return qint32(writePosition() - readPosition());}
+    int read(char* dst, int bytes) {
+        quint32 r = readPosition();
+        const quint32 drop = load(m_drop);
+        if (qint32(drop - r) > 0)
+            r = drop;
+        bytes = qMin(bytes, qint32(writePosition() - r));
+        if (bytes <= 0)
+            bytes = 0;
+        else
+            copy(dst, r, m_data.constData(), bytes, false);
+        storeRelease(m_read, r + quint32(bytes));
+        return bytes;
+    }
+private:
+    // copy between the linear buffer and the ring at position pos
+    void copy(char* dst, quint32 pos, const char* src, int bytes, bool toRing) const {
+        const int cap = capacity();
+        const int offset = int(pos & quint32(cap - 1));
+        const int n = qMin(bytes, cap - offset);
+        if (toRing) {
+            memcpy(dst + offset, src, n);
+            memcpy(dst, src + n, bytes - n);
+        } else {
+            memcpy(dst, src + offset, n);
+            memcpy(dst + n, src, bytes - n);
+        }
+    }
+    // QAtomicInteger<quint32> requires Qt5.3. unsigned positions are stored as int bits, so wrapping is well defined
+    static quint32 load(const QAtomicInt &a) { return quint32(spsc::loadAcquire(a));}
+    static void storeRelease(QAtomicInt &a, quint32 v) {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+        a.storeRelease(int(v));
+#else
+        a.fetchAndStoreRelease(int(v));
+#endif
+    }
+
+    QByteArray m_data;
+    QAtomicInt m_write, m_read, m_drop;
+};
+} //namespace QtAV
+#endif //QTAV_AUDIORING_H
@@ -0,0 +1,486 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#ifndef QTAV_SPSCQUEUE_H
+#define QTAV_SPSCQUEUE_H
+
+#include <climits>
+#include <QtCore/QAtomicInt>
+#include <QtCore/QAtomicPointer>
+#include <QtCore/QMutex>
+#include <QtCore/QScopedPointer>
+#include <QtCore/QWaitCondition>
+
+namespace QtAV {
+namespace spsc {
+// Qt4 has no loadAcquire()/storeRelease()
+inline int loadAcquire(const QAtomicInt &a) {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+    return a.loadAcquire();
+#else
+    return a;
+#endif
+}
+#if QT_VERSION >= QT_VERSION_CHECK(5, 3, 0)
+typedef QAtomicInteger<qint64> AtomicInt64;
+inline qint64 loadAcquire(const AtomicInt64 &a) {
+    return a.loadAcquire();
+}
+#else
+typedef QAtomicInt AtomicInt64; //no 64bit atomic integer. enough for time in ms (24 days)
+#endif
+template<typename T>
+inline T* loadAcquire(const QAtomicPointer<T> &p) {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+    return p.loadAcquire();
+#else
+    return p;
+#endif
+}
+template<typename T>
+inline void storeRelease(QAtomicPointer<T> &p, T *v) {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+    p.storeRelease(v);
+#else
+    p.fetchAndStoreRelease(v);
+#endif
+}
+} //namespace spsc
+
+/*!
+ * \brief The SPSCQueue class
+ * A single producer single consumer queue with the same interface and semantics as BlockingQueue.
+ * Items are handed over through a linked ring of nodes without any lock shared by producer and consumer.
+ * Consumed nodes are recycled by the producer, so no allocation happens once the queue reaches its working size.
+ * put() is serialized by a producer side mutex and take()/clear() by a consumer side mutex. Each one is
+ * uncontended unless another thread calls put()/clear() (seek, step etc.), so no syscall happens in the common case.
+ * A side only parks on the wait condition if it really has to wait (take() from an empty queue, put() to a full
+ * queue with blockFull), and the other side only wakes it if it is parked.
+ */
+template <typename T>
+class SPSCQueue
+{
+public:
+    SPSCQueue();
+    virtual ~SPSCQueue();
+
+    void setCapacity(int max); //enqueue is allowed if less than capacity
+    void setThreshold(int min); //wake up and enqueue
+    /*!
+     * \brief put
+     * The same as BlockingQueue::put(). Even a 'full' queue will accept new items.
+     */
+    bool put(const T& t, unsigned long wait_timeout_ms = ULONG_MAX);
+    /*!
+     * \brief take
+     * The same as BlockingQueue::take(). Blocks only if the queue is empty and blockEmpty is set.
+     */
+    T take(unsigned long wait_timeout_ms = ULONG_MAX, bool *isValid = 0);
+    void setBlocking(bool block); //will wake if false. called when no more data can enqueue
+    void blockEmpty(bool block);
+    void blockFull(bool block);
+    void clear();
+    bool isEmpty() const;
+    bool isEnough() const; //size > thres
+    bool isFull() const; //size >= cap
+    int size() const;
+    int threshold() const;
+    int capacity() const;
+
+    class StateChangeCallback
+    {
+    public:
+        virtual ~StateChangeCallback(){}
+        virtual void call() = 0;
+    };
+    void setEmptyCallback(StateChangeCallback* call);
+    void setThresholdCallback(StateChangeCallback* call);
+    void setFullCallback(StateChangeCallback* call);
+    /// called by take() in consumer thread if the queue was full before. a producer that never blocks on put() can wait for it
+    void setNotFullCallback(StateChangeCallback* call);
+
+protected:
+    virtual bool checkFull() const;
+    virtual bool checkEmpty() const;
+    virtual bool checkEnough() const;
+    // called in producer thread after t is visible to consumer
+    virtual void onPut(const T&) {}
+    // called in consumer thread (or the thread calls clear()) after t is removed
+    virtual void onTake(const T&) {}
+    /*!
+     * \brief head
+     * The next item take() returns. Only valid in consumer context, e.g. onTake()
+     */
+    const T* head() const;
+
+    volatile bool block_empty, block_full;
+    volatile int cap, thres;
+private:
+    struct Node {
+        Node() : next(0) {}
+        T value;
+        QAtomicPointer<Node> next;
+    };
+    Node* allocNode();
+    bool dequeue(T *t);
+    void wakeProducer();
+    void wakeConsumer();
+
+    // consumer side. head is the dummy node whose value is already taken
+    QAtomicPointer<Node> m_head;
+    // producer side. [m_first, m_head_copy) are free nodes to reuse
+    Node *m_tail;
+    Node *m_first;
+    Node *m_head_copy;
+    QAtomicInt m_size;
+    QAtomicInt m_empty_waiting, m_full_waiting;
+    mutable QMutex m_put_lock, m_take_lock;
+    QWaitCondition cond_full, cond_empty;
+    QScopedPointer<StateChangeCallback> empty_callback, threshold_callback, full_callback, not_full_callback;
+};
+
+/* cap - thres = 24, about 1s
+ * if fps is large, then larger capacity and threshold is preferred
+ */
+template <typename T>
+SPSCQueue<T>::SPSCQueue()
+    : block_empty(true), block_full(true), cap(48), thres(32)
+    , m_head(0)
+    , m_tail(0)
+    , m_first(0)
+    , m_head_copy(0)
+    , m_size(0)
+    , m_empty_waiting(0)
+    , m_full_waiting(0)
+    , empty_callback(0)
+    , threshold_callback(0)
+    , full_callback(0)
+    , not_full_callback(0)
+{
+    Node *n = new Node();
+    spsc::storeRelease(m_head, n);
+    m_tail = m_first = m_head_copy = n;
+}
+
+template <typename T>
+SPSCQueue<T>::~SPSCQueue()
+{
+    Node *n = m_first;
+    while (n) {
+        Node *next = spsc::loadAcquire(n->next);
+        delete n;
+        n = next;
+    }
+}
+
+template <typename T>
+typename SPSCQueue<T>::Node* SPSCQueue<T>::allocNode()
+{
+    // nodes before head are no longer touched by consumer
+    if (m_first != m_head_copy) {
+        Node *n = m_first;
+        m_first = spsc::loadAcquire(m_first->next);
+        return n;
+    }
+    m_head_copy = spsc::loadAcquire(m_head);
+    if (m_first != m_head_copy) {
+        Node *n = m_first;
+        m_first = spsc::loadAcquire(m_first->next);
+        return n;
+    }
+    return new Node();
+}
+
+template <typename T>
+bool SPSCQueue<T>::dequeue(T *t)
+{
+    Node *h = spsc::loadAcquire(m_head);
+    Node *n = spsc::loadAcquire(h->next);
+    if (!n)
+        return false;
+    *t = n->value;
+    n->value = T(); // release the item now instead of when the node is reused
+    spsc::storeRelease(m_head, n);
+    m_size.fetchAndAddOrdered(-1);
+    return true;
+}
+
+template <typename T>
+const T* SPSCQueue<T>::head() const
+{
+    Node *n = spsc::loadAcquire(spsc::loadAcquire(m_head)->next);
+    if (!n)
+        return 0;
+    return &n->value;
+}
+
+template <typename T>
+void SPSCQueue<T>::wakeProducer()
+{
+    if (!m_full_waiting.fetchAndAddOrdered(0))
+        return;
+    QMutexLocker locker(&m_put_lock);
+    Q_UNUSED(locker);
+    cond_full.wakeAll();
+}
+
+template <typename T>
+void SPSCQueue<T>::wakeConsumer()
+{
+    if (!m_empty_waiting.fetchAndAddOrdered(0))
+        return;
+    QMutexLocker locker(&m_take_lock);
+    Q_UNUSED(locker);
+    cond_empty.wakeAll();
+}
+
+template <typename T>
+void SPSCQueue<T>::setCapacity(int max)
+{
+    cap = max;
+    if (thres > cap)
+        thres = cap;
+}
+
+template <typename T>
+void SPSCQueue<T>::setThreshold(int min)
+{
+    if (min > cap)
+        return;
+    thres = min;
+}
+
+template <typename T>
+bool SPSCQueue<T>::put(const T& t, unsigned long timeout_ms)
+{
+    bool ret = true;
+    {
+        QMutexLocker locker(&m_put_lock);
+        Q_UNUSED(locker);
+        if (checkFull()) {
+            ret = false;
+            if (full_callback) {
+                full_callback->call();
+            }
+            if (block_full) {
+                m_full_waiting.fetchAndStoreOrdered(1);
+                // consumer may take before the flag is visible
+                if (checkFull())
+                    ret = cond_full.wait(&m_put_lock, timeout_ms);
+                m_full_waiting.fetchAndStoreOrdered(0);
+            }
+        }
+        Node *n = allocNode();
+        n->value = t;
+        n->next.fetchAndStoreRelaxed(0);
+        spsc::storeRelease(m_tail->next, n);
+        m_tail = n;
+        m_size.fetchAndAddOrdered(1);
+        onPut(t); // emit bufferProgressChanged here if buffering
+    }
+    if (checkEnough())
+        wakeConsumer(); // end buffering
+    return ret;
+}
+
+template <typename T>
+T SPSCQueue<T>::take(unsigned long timeout_ms, bool *isValid)
+{
+    if (isValid) *isValid = false;
+    if (checkEmpty()) {
+        if (empty_callback) {
+            empty_callback->call();
+        }
+        if (block_empty) {
+            QMutexLocker locker(&m_take_lock);
+            Q_UNUSED(locker);
+            m_empty_waiting.fetchAndStoreOrdered(1);
+            // producer may put before the flag is visible
+            if (block_empty && !checkEnough())
+                cond_empty.wait(&m_take_lock, timeout_ms); //block when empty only
+            m_empty_waiting.fetchAndStoreOrdered(0);
+        }
+    }
+    T t;
+    bool ok = false;
+    bool was_full = false;
+    {
+        QMutexLocker locker(&m_take_lock);
+        Q_UNUSED(locker);
+        was_full = not_full_callback && checkFull();
+        ok = dequeue(&t);
+        if (ok)
+            onTake(t); // emit start buffering here if empty
+    }
+    if (!ok) {
+        if (empty_callback) {
+            empty_callback->call();
+        }
+        return T();
+    }
+    if (isValid) *isValid = true;
+    wakeProducer();
+    // no queue lock is held, so the callback can lock anything the producer holds when calling put()
+    if (was_full)
+        not_full_callback->call();
+    return t;
+}
+
+// blockXXX() can be called for every packet, so wake up only if state changes. a waiter always checks the state with lock
+template <typename T>
+void SPSCQueue<T>::setBlocking(bool block)
+{
+    blockEmpty(block);
+    blockFull(block);
+}
+
+template <typename T>
+void SPSCQueue<T>::blockEmpty(bool block)
+{
+    if (block_empty == block)
+        return;
+    block_empty = block;
+    if (!block) {
+        QMutexLocker locker(&m_take_lock);
+        Q_UNUSED(locker);
+        cond_empty.wakeAll();
+    }
+}
+
+template <typename T>
+void SPSCQueue<T>::blockFull(bool block)
+{
+    if (block_full == block)
+        return;
+    block_full = block;
+    if (!block) {
+        QMutexLocker locker(&m_put_lock);
+        Q_UNUSED(locker);
+        cond_full.wakeAll();
+    }
+}
+
+template <typename T>
+void SPSCQueue<T>::clear()
+{
+    {
+        // act as the consumer. items put after the loop are kept
+        QMutexLocker locker(&m_take_lock);
+        Q_UNUSED(locker);
+        T t;
+        bool taken = false;
+        while (dequeue(&t)) {
+            taken = true;
+            onTake(t);
+        }
+        if (!taken)
+            onTake(T());
+    }
+    wakeProducer();
+}
+
+template <typename T>
+bool SPSCQueue<T>::isEmpty() const
+{
+    return size() <= 0;
+}
+
+template <typename T>
+bool SPSCQueue<T>::isEnough() const
+{
+    return size() >= thres;
+}
+
+template <typename T>
+bool SPSCQueue<T>::isFull() const
+{
+    return size() >= cap;
+}
+
+template <typename T>
+int SPSCQueue<T>::size() const
+{
+    return spsc::loadAcquire(m_size);
+}
+
+template <typename T>
+int SPSCQueue<T>::threshold() const
+{
+    return thres;
+}
+
+template <typename T>
+int SPSCQueue<T>::capacity() const
+{
+    return cap;
+}
+
+template <typename T>
+void SPSCQueue<T>::setEmptyCallback(StateChangeCallback *call)
+{
+    QMutexLocker locker(&m_take_lock);
+    Q_UNUSED(locker);
+    empty_callback.reset(call);
+}
+
+template <typename T>
+void SPSCQueue<T>::setThresholdCallback(StateChangeCallback *call)
+{
+    QMutexLocker locker(&m_put_lock);
+    Q_UNUSED(locker);
+    threshold_callback.reset(call);
+}
+
+template <typename T>
+void SPSCQueue<T>::setFullCallback(StateChangeCallback *call)
+{
+    QMutexLocker locker(&m_put_lock);
+    Q_UNUSED(locker);
+    full_callback.reset(call);
+}
+
+template <typename T>
+void SPSCQueue<T>::setNotFullCallback(StateChangeCallback *call)
+{
+    QMutexLocker locker(&m_take_lock);
+    Q_UNUSED(locker);
+    not_full_callback.reset(call);
+}
+
+template <typename T>
+bool SPSCQueue<T>::checkFull() const
+{
+    return size() >= cap;
+}
+
+template <typename T>
+bool SPSCQueue<T>::checkEmpty() const
+{
+    return size() <= 0;
+}
+
+template <typename T>
+bool SPSCQueue<T>::checkEnough() const
+{
+    return size() >= thres && !checkEmpty();
+}
+} //namespace QtAV
+#endif // QTAV_SPSCQUEUE_H
@@ -0,0 +1,52 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#ifndef QTAV_YUV2RGB_H
+#define QTAV_YUV2RGB_H
+
+#include <QtCore/QtGlobal>
+
+namespace QtAV {
+/*!
+ * Fixed point 4:2:0 yuv => packed 4x8 bit rgb row conversion. Output pixel is (c0, c1, c2, 255), so the same
+ * kernel writes BGRA or RGBA depending on the coefficient order.
+ * For a sample depth d (8 for NV12/YUV420P, 10 for P010), channel k is
+ *   c_k = (yu[k][0]*y + yu[k][1]*u + vk[k][0]*v + vk[k][1]*(128<<(d-8))) >> (12+d-8)
+ * coefficients are Q12 for 8 bit samples, vk[k][1] is offset*32 and includes the rounding term.
+ */
+struct YUV2RGBCoeffs {
+    qint16 yu[3][2];
+    qint16 vk[3][2];
+};
+
+/*!
+ * Row kernels. u and v are chroma planes for yuv420p, u is the interleaved chroma plane and v is ignored for nv12/p010.
+ * Return the number of pixels converted, which is a multiple of the vector width. The rest is converted by the caller.
+ */
+typedef int (*YUV2RGBRowFunc)(const quint8* y, const quint8* u, const quint8* v, quint8* dst, int width, const YUV2RGBCoeffs& c);
+int yuv420p_to_rgbx_sse2(const quint8* y, const quint8* u, const quint8* v, quint8* dst, int width, const YUV2RGBCoeffs& c);
+int nv12_to_rgbx_sse2(const quint8* y, const quint8* uv, const quint8*, quint8* dst, int width, const YUV2RGBCoeffs& c);
+int p010_to_rgbx_sse2(const quint8* y, const quint8* uv, const quint8*, quint8* dst, int width, const YUV2RGBCoeffs& c);
+int yuv420p_to_rgbx_avx2(const quint8* y, const quint8* u, const quint8* v, quint8* dst, int width, const YUV2RGBCoeffs& c);
+int nv12_to_rgbx_avx2(const quint8* y, const quint8* uv, const quint8*, quint8* dst, int width, const YUV2RGBCoeffs& c);
+int p010_to_rgbx_avx2(const quint8* y, const quint8* uv, const quint8*, quint8* dst, int width, const YUV2RGBCoeffs& c);
+} //namespace QtAV
+#endif //QTAV_YUV2RGB_H
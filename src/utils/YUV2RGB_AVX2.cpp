@@ -0,0 +1,112 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+#if defined(__AVX2__) || (defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))) // vc does not define __AVX2__ without -arch:AVX2
+#include "YUV2RGB.h"
+#include <immintrin.h>
+
+namespace QtAV {
+namespace {
+struct Kernel {
+    __m256i yu[3], vk[3];
+    __m256i k;
+    __m128i shift;
+    Kernel(const YUV2RGBCoeffs& c, int depth) {
+        for (int i = 0; i < 3; ++i) {
+            yu[i] = _mm256_set1_epi32((int)(((quint32)(quint16)c.yu[i][1] << 16) | (quint16)c.yu[i][0]));
+            vk[i] = _mm256_set1_epi32((int)(((quint32)(quint16)c.vk[i][1] << 16) | (quint16)c.vk[i][0]));
+        }
+        k = _mm256_set1_epi16(128 << (depth - 8));
+        shift = _mm_cvtsi32_si128(12 + depth - 8);
+    }
+    inline __m256i channel(int i, __m256i yu_lo, __m256i yu_hi, __m256i vk_lo, __m256i vk_hi) const {
+        __m256i lo = _mm256_add_epi32(_mm256_madd_epi16(yu_lo, yu[i]), _mm256_madd_epi16(vk_lo, vk[i]));
+        __m256i hi = _mm256_add_epi32(_mm256_madd_epi16(yu_hi, yu[i]), _mm256_madd_epi16(vk_hi, vk[i]));
+        return _mm256_packs_epi32(_mm256_sra_epi32(lo, shift), _mm256_sra_epi32(hi, shift));
+    }
+    // store 16 pixels. unpack and pack work in 128bit lanes, so pixel order is restored by the final permutation
+    inline void store(quint8* dst, __m256i y, __m256i u, __m256i v) const {
+        const __m256i yu_lo = _mm256_unpacklo_epi16(y, u);
+        const __m256i yu_hi = _mm256_unpackhi_epi16(y, u);
+        const __m256i vk_lo = _mm256_unpacklo_epi16(v, k);
+        const __m256i vk_hi = _mm256_unpackhi_epi16(v, k);
+        const __m256i c0 = channel(0, yu_lo, yu_hi, vk_lo, vk_hi);
+        const __m256i c1 = channel(1, yu_lo, yu_hi, vk_lo, vk_hi);
+        const __m256i c2 = channel(2, yu_lo, yu_hi, vk_lo, vk_hi);
+        const __m256i c02 = _mm256_packus_epi16(c0, c2);
+        const __m256i c1a = _mm256_packus_epi16(c1, _mm256_set1_epi16(0xff));
+        const __m256i c01 = _mm256_unpacklo_epi8(c02, c1a);
+        const __m256i c2a = _mm256_unpackhi_epi8(c02, c1a);
+        const __m256i lo = _mm256_unpacklo_epi16(c01, c2a); // pixels 0~3, 8~11
+        const __m256i hi = _mm256_unpackhi_epi16(c01, c2a); // pixels 4~7, 12~15
+        _mm256_storeu_si256((__m256i*)dst, _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256((__m256i*)(dst + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+};
+
+// 32bit lanes of interleaved u, v => duplicated u for 2 pixels
+static inline __m256i dup_u(__m256i uv) {
+    return _mm256_or_si256(_mm256_and_si256(uv, _mm256_set1_epi32(0xffff)), _mm256_slli_epi32(uv, 16));
+}
+static inline __m256i dup_v(__m256i uv) {
+    return _mm256_or_si256(_mm256_srli_epi32(uv, 16), _mm256_and_si256(uv, _mm256_set1_epi32((int)0xffff0000)));
+}
+} //namespace
+
+int yuv420p_to_rgbx_avx2(const quint8 *y, const quint8 *u, const quint8 *v, quint8 *dst, int width, const YUV2RGBCoeffs &c)
+{
+    const Kernel K(c, 8);
+    const int n = width & ~15;
+    for (int x = 0; x < n; x += 16) {
+        const __m128i u8 = _mm_loadl_epi64((const __m128i*)(u + x/2));
+        const __m128i v8 = _mm_loadl_epi64((const __m128i*)(v + x/2));
+        const __m256i U = _mm256_cvtepu8_epi16(_mm_unpacklo_epi8(u8, u8));
+        const __m256i V = _mm256_cvtepu8_epi16(_mm_unpacklo_epi8(v8, v8));
+        const __m256i Y = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(y + x)));
+        K.store(dst + 4*x, Y, U, V);
+    }
+    return n;
+}
+
+int nv12_to_rgbx_avx2(const quint8 *y, const quint8 *uv, const quint8 *, quint8 *dst, int width, const YUV2RGBCoeffs &c)
+{
+    const Kernel K(c, 8);
+    const int n = width & ~15;
+    for (int x = 0; x < n; x += 16) {
+        const __m256i UV = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(uv + x)));
+        const __m256i Y = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(y + x)));
+        K.store(dst + 4*x, Y, dup_u(UV), dup_v(UV));
+    }
+    return n;
+}
+
+int p010_to_rgbx_avx2(const quint8 *y, const quint8 *uv, const quint8 *, quint8 *dst, int width, const YUV2RGBCoeffs &c)
+{
+    const Kernel K(c, 10);
+    const int n = width & ~15;
+    for (int x = 0; x < n; x += 16) {
+        const __m256i UV = _mm256_srli_epi16(_mm256_loadu_si256((const __m256i*)(uv + 2*x)), 6);
+        const __m256i Y = _mm256_srli_epi16(_mm256_loadu_si256((const __m256i*)(y + 2*x)), 6);
+        K.store(dst + 4*x, Y, dup_u(UV), dup_v(UV));
+    }
+    return n;
+}
+} //namespace QtAV
+#endif
@@ -0,0 +1,116 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+#if defined(__SSE__) || defined(_M_IX86) || defined(_M_X64) // gcc, clang defines __SSE__, vc does not
+#include "YUV2RGB.h"
+#include <string.h>
+#include <emmintrin.h>
+
+namespace QtAV {
+namespace {
+struct Kernel {
+    __m128i yu[3], vk[3];
+    __m128i k, shift;
+    Kernel(const YUV2RGBCoeffs& c, int depth) {
+        for (int i = 0; i < 3; ++i) {
+            yu[i] = _mm_set1_epi32((int)(((quint32)(quint16)c.yu[i][1] << 16) | (quint16)c.yu[i][0]));
+            vk[i] = _mm_set1_epi32((int)(((quint32)(quint16)c.vk[i][1] << 16) | (quint16)c.vk[i][0]));
+        }
+        k = _mm_set1_epi16(128 << (depth - 8));
+        shift = _mm_cvtsi32_si128(12 + depth - 8);
+    }
+    // y, u, v: 8 16bit samples
+    inline __m128i channel(int i, __m128i yu_lo, __m128i yu_hi, __m128i vk_lo, __m128i vk_hi) const {
+        __m128i lo = _mm_add_epi32(_mm_madd_epi16(yu_lo, yu[i]), _mm_madd_epi16(vk_lo, vk[i]));
+        __m128i hi = _mm_add_epi32(_mm_madd_epi16(yu_hi, yu[i]), _mm_madd_epi16(vk_hi, vk[i]));
+        return _mm_packs_epi32(_mm_sra_epi32(lo, shift), _mm_sra_epi32(hi, shift));
+    }
+    // store 8 pixels
+    inline void store(quint8* dst, __m128i y, __m128i u, __m128i v) const {
+        const __m128i yu_lo = _mm_unpacklo_epi16(y, u);
+        const __m128i yu_hi = _mm_unpackhi_epi16(y, u);
+        const __m128i vk_lo = _mm_unpacklo_epi16(v, k);
+        const __m128i vk_hi = _mm_unpackhi_epi16(v, k);
+        const __m128i c0 = channel(0, yu_lo, yu_hi, vk_lo, vk_hi);
+        const __m128i c1 = channel(1, yu_lo, yu_hi, vk_lo, vk_hi);
+        const __m128i c2 = channel(2, yu_lo, yu_hi, vk_lo, vk_hi);
+        const __m128i c02 = _mm_packus_epi16(c0, c2);
+        const __m128i c1a = _mm_packus_epi16(c1, _mm_set1_epi16(0xff));
+        const __m128i c01 = _mm_unpacklo_epi8(c02, c1a);
+        const __m128i c2a = _mm_unpackhi_epi8(c02, c1a);
+        _mm_storeu_si128((__m128i*)dst, _mm_unpacklo_epi16(c01, c2a));
+        _mm_storeu_si128((__m128i*)(dst + 16), _mm_unpackhi_epi16(c01, c2a));
+    }
+};
+
+// 32bit lanes of interleaved u, v => duplicated u for 2 pixels
+static inline __m128i dup_u(__m128i uv) {
+    return _mm_or_si128(_mm_and_si128(uv, _mm_set1_epi32(0xffff)), _mm_slli_epi32(uv, 16));
+}
+static inline __m128i dup_v(__m128i uv) {
+    return _mm_or_si128(_mm_srli_epi32(uv, 16), _mm_and_si128(uv, _mm_set1_epi32((int)0xffff0000)));
+}
+} //namespace
+
+int yuv420p_to_rgbx_sse2(const quint8 *y, const quint8 *u, const quint8 *v, quint8 *dst, int width, const YUV2RGBCoeffs &c)
+{
+    const Kernel K(c, 8);
+    const __m128i zero = _mm_setzero_si128();
+    const int n = width & ~7;
+    for (int x = 0; x < n; x += 8) {
+        int u4, v4;
+        memcpy(&u4, u + x/2, 4);
+        memcpy(&v4, v + x/2, 4);
+        __m128i U = _mm_cvtsi32_si128(u4);
+        __m128i V = _mm_cvtsi32_si128(v4);
+        U = _mm_unpacklo_epi8(_mm_unpacklo_epi8(U, U), zero);
+        V = _mm_unpacklo_epi8(_mm_unpacklo_epi8(V, V), zero);
+        const __m128i Y = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(y + x)), zero);
+        K.store(dst + 4*x, Y, U, V);
+    }
+    return n;
+}
+
+int nv12_to_rgbx_sse2(const quint8 *y, const quint8 *uv, const quint8 *, quint8 *dst, int width, const YUV2RGBCoeffs &c)
+{
+    const Kernel K(c, 8);
+    const __m128i zero = _mm_setzero_si128();
+    const int n = width & ~7;
+    for (int x = 0; x < n; x += 8) {
+        const __m128i UV = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(uv + x)), zero);
+        const __m128i Y = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(y + x)), zero);
+        K.store(dst + 4*x, Y, dup_u(UV), dup_v(UV));
+    }
+    return n;
+}
+
+int p010_to_rgbx_sse2(const quint8 *y, const quint8 *uv, const quint8 *, quint8 *dst, int width, const YUV2RGBCoeffs &c)
+{
+    const Kernel K(c, 10);
+    const int n = width & ~7;
+    for (int x = 0; x < n; x += 8) {
+        const __m128i UV = _mm_srli_epi16(_mm_loadu_si128((const __m128i*)(uv + 2*x)), 6);
+        const __m128i Y = _mm_srli_epi16(_mm_loadu_si128((const __m128i*)(y + 2*x)), 6);
+        K.store(dst + 4*x, Y, dup_u(UV), dup_v(UV));
+    }
+    return n;
+}
+} //namespace QtAV
+#endif
@@ -0,0 +1,11 @@
+CONFIG -= app_bundle
+CONFIG += console
+TEMPLATE = app
+TARGET = audiomix
+
+PROJECTROOT = $$PWD/../..
+include($$PROJECTROOT/src/libQtAV.pri)
+preparePaths($$OUT_PWD/../../out)
+INCLUDEPATH += $$PROJECTROOT/src # internal utils/AudioMix.h
+
+SOURCES += main.cpp
@@ -0,0 +1,90 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#include <math.h>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QVector>
+#include "utils/AudioMix.h"
+
+/*
+ * audioScaleFunc() and audioMixFunc() for signed 16 bit samples are compared with the C reference: the vector body
+ * (sse2, avx2 or neon) and the C tail must round and saturate the same way, also if gain > 1 saturates.
+ * Lengths are not multiples of the vector width, so both the vector kernel and the tail are used.
+ * usage: audiomix
+ */
+using namespace QtAV;
+
+static qint16 clip16(long v) { return qint16(qBound<long>(-32768, v, 32767));}
+static qint16 scale_ref(qint16 s, float g) { return clip16(lrintf(s*g));}
+static qint16 mix_ref(qint16 d, qint16 s, float g) { return clip16(d + lrintf(s*g));}
+
+// gain of sample i is gain + i*step. returns the number of samples different from the reference
+static int test(bool mix, int n, float gain, float step)
+{
+    QVector<qint16> src(n), dst(n), ref(n);
+    qsrand(n);
+    for (int i = 0; i < n; ++i) {
+        src[i] = qint16(qrand() % 65536 - 32768);
+        dst[i] = qint16(qrand() % 65536 - 32768);
+    }
+    // d + s*g overflows int16 before the final saturation in some lanes
+    if (n > 1) {
+        src[0] = 20000;
+        dst[0] = -20000;
+        src[1] = -32768;
+        dst[1] = 32767;
+    }
+    for (int i = 0; i < n; ++i) {
+        const float g = gain + (float)i*step;
+        ref[i] = mix ? mix_ref(dst[i], src[i], g) : scale_ref(src[i], g);
+    }
+    AudioScaleFunc f = mix ? audioMixFunc(AudioFormat::SampleFormat_Signed16) : audioScaleFunc(AudioFormat::SampleFormat_Signed16);
+    f((quint8*)dst.data(), (const quint8*)src.constData(), n, gain, step);
+    int bad = 0;
+    for (int i = 0; i < n; ++i) {
+        // the vector ramp may differ from gain + i*step in the last float bit
+        const int tolerance = step == 0.0f ? 0 : 1;
+        if (qAbs(int(dst[i]) - int(ref[i])) > tolerance) {
+            if (bad++ < 4)
+                qWarning("%s n=%d gain=%f step=%g: sample %d is %d, expect %d", mix ? "mix" : "scale", n, gain, step, i, dst[i], ref[i]);
+        }
+    }
+    return bad;
+}
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+    const int lengths[] = { 1, 7, 15, 37, 1023 };
+    const float gains[] = { 0.5f, 1.0f, 1.5f, 2.0f, 8.0f };
+    int bad = 0;
+    for (size_t i = 0; i < sizeof(lengths)/sizeof(lengths[0]); ++i) {
+        for (size_t j = 0; j < sizeof(gains)/sizeof(gains[0]); ++j) {
+            bad += test(false, lengths[i], gains[j], 0);
+            bad += test(true, lengths[i], gains[j], 0);
+        }
+        // volume ramp to > 1
+        bad += test(false, lengths[i], 0.5f, 2.0f/(float)lengths[i]);
+        bad += test(true, lengths[i], 0.5f, 2.0f/(float)lengths[i]);
+    }
+    qDebug("%s: %d different samples", bad ? "FAIL" : "PASS", bad);
+    return bad ? 1 : 0;
+}
@@ -0,0 +1,128 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#include <QtCore/qmath.h>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QStringList>
+#include <QtCore/QThread>
+#include <QtAV/AudioOutput.h>
+#include <QtDebug>
+
+using namespace QtAV;
+const int kFrames = 512;
+
+void help() {
+    qDebug("parameters: [-n clients] [-d seconds] [-sink null|Pulse|...]");
+    qDebug("clients use the Mixer backend. odd clients are 48000Hz to test resampling, even clients are 44100Hz.");
+}
+
+class Client : public QThread
+{
+public:
+    Client(int index, int msecs)
+        : QThread(0)
+        , id(index)
+        , duration(msecs)
+        , ok(false)
+        , pts(0)
+        , ao_pts(0)
+    {}
+    int id;
+    int duration;
+    bool ok;
+    qreal pts;
+    qreal ao_pts;
+protected:
+    void run() {
+        AudioOutput ao;
+        ao.setBackends(QStringList() << QLatin1String("Mixer"));
+        AudioFormat af;
+        af.setChannels(2);
+        af.setSampleFormat(AudioFormat::SampleFormat_Signed16);
+        af.setSampleRate(id % 2 ? 48000 : 44100);
+        ao.setAudioFormat(af);
+        ao.setBufferSamples(kFrames);
+        ao.setVolume(1.0/qreal(id + 1));
+        if (!ao.open()) {
+            qWarning("client %d: open audio error", id);
+            return;
+        }
+        QByteArray data(af.bytesPerFrame()*kFrames, 0);
+        const qreal freq = 220.0*(id + 1);
+        qint64 n = 0;
+        QElapsedTimer timer;
+        timer.start();
+        while (timer.elapsed() < duration) {
+            qint16 *d = (qint16*)data.data();
+            for (int k = 0; k < kFrames; ++k, ++n) {
+                const qint16 s = qint16(8000.0*sin(2.0*M_PI*freq*qreal(n)/qreal(af.sampleRate())));
+                *d++ = s;
+                *d++ = s;
+            }
+            ao.play(data, pts);
+            pts += qreal(kFrames)/qreal(af.sampleRate());
+            ao_pts = ao.timestamp();
+        }
+        ao.close();
+        ok = true;
+    }
+};
+
+int main(int argc, char** argv)
+{
+    help();
+    QCoreApplication app(argc, argv);
+    int nb_clients = 4;
+    int seconds = 3;
+    QByteArray sink("null");
+    int idx = app.arguments().indexOf(QLatin1String("-n"));
+    if (idx > 0)
+        nb_clients = app.arguments().at(idx+1).toInt();
+    idx = app.arguments().indexOf(QLatin1String("-d"));
+    if (idx > 0)
+        seconds = app.arguments().at(idx+1).toInt();
+    idx = app.arguments().indexOf(QLatin1String("-sink"));
+    if (idx > 0)
+        sink = app.arguments().at(idx+1).toLatin1();
+    qputenv("QTAV_AUDIO_MIXER_BACKENDS", sink);
+    if (!AudioOutput::backendsAvailable().contains(QLatin1String("Mixer"))) {
+        qWarning("Mixer backend is not available");
+        return -1;
+    }
+    QList<Client*> clients;
+    for (int i = 0; i < nb_clients; ++i) {
+        clients.append(new Client(i, seconds*1000));
+        clients.last()->start();
+    }
+    int ret = 0;
+    foreach (Client* c, clients) {
+        c->wait();
+        // the device plays in real time, so the client is paced by the mixer
+        const qreal lag = c->pts - c->ao_pts;
+        qDebug("client %d: written %.3fs, played %.3fs, lag %.3fs", c->id, c->pts, c->ao_pts, lag);
+        if (!c->ok || c->pts > qreal(seconds) + 1.0 || lag < 0 || lag > 1.0)
+            ret = 1;
+        delete c;
+    }
+    qDebug("%s", ret ? "FAIL" : "PASS");
+    return ret;
+}
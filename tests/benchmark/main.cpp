@@ -0,0 +1,374 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#include <algorithm>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <QtCore/QAtomicInt>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDir>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+#include <QtAV/AVDemuxer.h>
+#include <QtAV/AVMuxer.h>
+#include <QtAV/LibAVFilter.h>
+#include <QtAV/Packet.h>
+#include <QtAV/Statistics.h>
+#include <QtAV/VideoDecoder.h>
+#include <QtAV/VideoEncoder.h>
+#include <QtAV/VideoFrame.h>
+
+/*
+ * headless benchmark. synthetic clips are encoded and muxed locally, then demuxed, decoded, converted to rgb32 and filtered.
+ * every stage is measured separately: frames/s, p50/p99 per frame latency, c++ allocations and process RSS.
+ * no media file or gpu is required.
+ * usage: benchmark [-n frames] [-s WxH,...] [-c codec,...] [-vf filter] [-d work_dir] [-o result.json]
+ * default: -n 100 -s 640x360,1280x720,1920x1080 -c libx264,mpeg4,rawvideo -vf hflip. result is written to stdout
+ */
+using namespace QtAV;
+
+// count c++ allocations, including Qt and QtAV. buffers allocated by FFmpeg are not counted
+static QAtomicInt g_allocs;
+
+void* operator new(std::size_t size)
+{
+    g_allocs.ref();
+    void *p = malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) Q_DECL_NOTHROW
+{
+    free(p);
+}
+
+// kB. -1 if not supported
+static qint64 memoryStatus(const char* key)
+{
+#ifdef Q_OS_LINUX
+    QFile f(QString::fromLatin1("/proc/self/status"));
+    if (!f.open(QIODevice::ReadOnly))
+        return -1;
+    const QByteArray k(key);
+    foreach (const QByteArray& line, f.readAll().split('\n')) {
+        if (line.startsWith(k))
+            return line.mid(k.size()).trimmed().split(' ').first().toLongLong();
+    }
+#else
+    Q_UNUSED(key);
+#endif
+    return -1;
+}
+
+class Stage
+{
+public:
+    Stage() : total(0), allocs(0) {}
+    void begin() {
+        allocs -= g_allocs.load();
+        timer.start();
+    }
+    // frame: false if nothing is produced, the time is added to the last frame, e.g. flush
+    void end(bool frame = true) {
+        const qint64 ns = timer.nsecsElapsed();
+        allocs += g_allocs.load();
+        total += ns;
+        if (frame)
+            ns_per_frame.append(ns);
+        else if (!ns_per_frame.isEmpty())
+            ns_per_frame.last() += ns;
+    }
+    QJsonObject toJson() const {
+        QJsonObject o;
+        const int n = ns_per_frame.size();
+        o[QStringLiteral("frames")] = n;
+        o[QStringLiteral("total_ms")] = double(total)/1e6;
+        o[QStringLiteral("fps")] = total > 0 ? double(n)*1e9/double(total) : 0.0;
+        QVector<qint64> v(ns_per_frame);
+        std::sort(v.begin(), v.end());
+        o[QStringLiteral("p50_ms")] = percentile(v, 0.5);
+        o[QStringLiteral("p99_ms")] = percentile(v, 0.99);
+        o[QStringLiteral("max_ms")] = v.isEmpty() ? 0.0 : double(v.last())/1e6;
+        o[QStringLiteral("allocations")] = allocs;
+        o[QStringLiteral("allocations_per_frame")] = n > 0 ? double(allocs)/double(n) : 0.0;
+        o[QStringLiteral("rss_kb")] = double(memoryStatus("VmRSS:"));
+        return o;
+    }
+private:
+    static double percentile(const QVector<qint64>& sorted, double q) {
+        if (sorted.isEmpty())
+            return 0;
+        const int i = qMin(sorted.size() - 1, int(q*double(sorted.size() - 1) + 0.5));
+        return double(sorted[i])/1e6;
+    }
+
+    QElapsedTimer timer;
+    qint64 total;
+    int allocs;
+    QVector<qint64> ns_per_frame;
+};
+
+// moving yuv420p gradient, so that encoders have motion to estimate
+static VideoFrame syntheticFrame(int w, int h, int index)
+{
+    const int uv_w = (w + 1)/2, uv_h = (h + 1)/2;
+    QByteArray data(w*h + 2*uv_w*uv_h, 0);
+    uchar *y = (uchar*)data.data();
+    uchar *u = y + w*h;
+    uchar *v = u + uv_w*uv_h;
+    for (int j = 0; j < h; ++j) {
+        for (int i = 0; i < w; ++i)
+            y[j*w + i] = (i + j + index*4) & 0xff;
+    }
+    for (int j = 0; j < uv_h; ++j) {
+        for (int i = 0; i < uv_w; ++i) {
+            u[j*uv_w + i] = (i*2 + index) & 0xff;
+            v[j*uv_w + i] = (j*2 - index) & 0xff;
+        }
+    }
+    VideoFrame frame(w, h, VideoFormat::Format_YUV420P, data);
+    frame.setBits(y, 0);
+    frame.setBits(u, 1);
+    frame.setBits(v, 2);
+    frame.setBytesPerLine(w, 0);
+    frame.setBytesPerLine(uv_w, 1);
+    frame.setBytesPerLine(uv_w, 2);
+    return frame;
+}
+
+static bool generate(const QString& file, const QString& codec, int w, int h, int frames, Stage* encode, Stage* mux_stage)
+{
+    QScopedPointer<VideoEncoder> venc(VideoEncoder::create("FFmpeg"));
+    if (!venc)
+        return false;
+    venc->setCodecName(codec);
+    venc->setWidth(w);
+    venc->setHeight(h);
+    venc->setPixelFormat(VideoFormat::Format_YUV420P);
+    venc->setFrameRate(25);
+    venc->setBitRate(w*h*4);
+    if (!venc->open()) {
+        qWarning("failed to open encoder %s", codec.toUtf8().constData());
+        return false;
+    }
+    AVMuxer mux;
+    mux.setMedia(file);
+    mux.copyProperties(venc.data());
+    if (!mux.open()) {
+        qWarning("failed to open muxer for %s", file.toUtf8().constData());
+        return false;
+    }
+    for (int i = 0; i < frames; ++i) {
+        VideoFrame frame(syntheticFrame(w, h, i));
+        frame.setTimestamp(qreal(i)/venc->frameRate());
+        encode->begin();
+        const bool ok = venc->encode(frame);
+        encode->end();
+        if (!ok)
+            continue;
+        mux_stage->begin();
+        mux.writeVideo(venc->encoded());
+        mux_stage->end();
+    }
+    // delayed packets
+    for (;;) {
+        encode->begin();
+        const bool ok = venc->encode();
+        encode->end(false);
+        if (!ok)
+            break;
+        mux_stage->begin();
+        mux.writeVideo(venc->encoded());
+        mux_stage->end();
+    }
+    mux_stage->begin();
+    mux.close();
+    mux_stage->end(false);
+    venc->close();
+    return true;
+}
+
+static QJsonObject run(const QString& file, const QString& vf, Stage* demux_stage, Stage* decode, Stage* convert, Stage* filter_stage)
+{
+    QJsonObject result;
+    AVDemuxer demux;
+    demux.setMedia(file);
+    if (!demux.load()) {
+        result[QStringLiteral("error")] = QStringLiteral("failed to load");
+        return result;
+    }
+    // demux all packets first, so that decoding is not affected by io
+    QVector<Packet> packets;
+    const int vstream = demux.videoStream();
+    int errors = 0;
+    for (;;) {
+        demux_stage->begin();
+        const bool ok = demux.readFrame();
+        const bool eof = !ok && (demux.atEnd() || ++errors > 16);
+        const bool video = ok && demux.stream() == vstream;
+        if (video)
+            packets.append(demux.packet());
+        demux_stage->end(video);
+        if (eof)
+            break;
+    }
+    packets.append(Packet::createEOF());
+    QScopedPointer<VideoDecoder> dec(VideoDecoder::create(VideoDecoderId_FFmpeg));
+    dec->setCodecContext(demux.videoCodecContext());
+    if (!dec->open()) {
+        result[QStringLiteral("error")] = QStringLiteral("failed to open decoder");
+        return result;
+    }
+    VideoFrameConverter conv;
+    Statistics statistics;
+    QScopedPointer<LibAVFilterVideo> filter;
+    if (!vf.isEmpty() && !LibAVFilter::videoFilters().isEmpty()) {
+        filter.reset(new LibAVFilterVideo());
+        filter->setOptions(vf);
+    }
+    foreach (const Packet& pkt, packets) {
+        for (;;) {
+            decode->begin();
+            VideoFrame frame;
+            if (dec->decode(pkt))
+                frame = dec->frame();
+            decode->end(frame.isValid());
+            if (!frame.isValid())
+                break;
+            convert->begin();
+            const VideoFrame rgb(conv.convert(frame, VideoFormat::Format_RGB32));
+            convert->end(rgb.isValid());
+            if (filter) {
+                filter_stage->begin();
+                filter->apply(&statistics, &frame);
+                filter_stage->end();
+            }
+            if (!pkt.isEOF())
+                break;
+        }
+    }
+    dec->close();
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    setLogLevel(LogWarning);
+    setFFmpegLogLevel("error");
+    int n = 100;
+    QStringList sizes = QString::fromLatin1("640x360,1280x720,1920x1080").split(QLatin1Char(','));
+    QStringList codecs = QString::fromLatin1("libx264,mpeg4,rawvideo").split(QLatin1Char(','));
+    QString vf = QString::fromLatin1("hflip");
+    QString dir = QDir::tempPath() + QString::fromLatin1("/qtav-benchmark");
+    QString out;
+    int idx = a.arguments().indexOf(QLatin1String("-n"));
+    if (idx > 0)
+        n = a.arguments().at(idx + 1).toInt();
+    idx = a.arguments().indexOf(QLatin1String("-s"));
+    if (idx > 0)
+        sizes = a.arguments().at(idx + 1).split(QLatin1Char(','));
+    idx = a.arguments().indexOf(QLatin1String("-c"));
+    if (idx > 0)
+        codecs = a.arguments().at(idx + 1).split(QLatin1Char(','));
+    idx = a.arguments().indexOf(QLatin1String("-vf"));
+    if (idx > 0)
+        vf = a.arguments().at(idx + 1);
+    idx = a.arguments().indexOf(QLatin1String("-d"));
+    if (idx > 0)
+        dir = a.arguments().at(idx + 1);
+    idx = a.arguments().indexOf(QLatin1String("-o"));
+    if (idx > 0)
+        out = a.arguments().at(idx + 1);
+    if (n <= 0 || !QDir().mkpath(dir)) {
+        qWarning("usage: benchmark [-n frames] [-s WxH,...] [-c codec,...] [-vf filter] [-d work_dir] [-o result.json]");
+        return 1;
+    }
+    const QStringList encoders(VideoEncoder::supportedCodecs());
+    QJsonArray clips;
+    foreach (const QString& codec, codecs) {
+        foreach (const QString& size, sizes) {
+            const QStringList wh(size.split(QLatin1Char('x')));
+            const int w = wh.size() == 2 ? wh.at(0).toInt() : 0;
+            const int h = wh.size() == 2 ? wh.at(1).toInt() : 0;
+            QJsonObject clip;
+            clip[QStringLiteral("codec")] = codec;
+            clip[QStringLiteral("size")] = size;
+            if (w <= 0 || h <= 0 || !encoders.contains(codec)) {
+                clip[QStringLiteral("error")] = w <= 0 || h <= 0 ? QStringLiteral("bad size") : QStringLiteral("encoder not found");
+                clips.append(clip);
+                continue;
+            }
+            // nut can store every codec including raw video
+            const QString file(QStringLiteral("%1/%2_%3.nut").arg(dir).arg(codec).arg(size));
+            fprintf(stderr, "%s %s...\n", codec.toUtf8().constData(), size.toUtf8().constData());
+            Stage encode, mux, demux, decode, convert, filter;
+            if (!generate(file, codec, w, h, n, &encode, &mux)) {
+                clip[QStringLiteral("error")] = QStringLiteral("failed to generate");
+                clips.append(clip);
+                continue;
+            }
+            clip[QStringLiteral("file_size")] = double(QFileInfo(file).size());
+            const QJsonObject r(run(file, vf, &demux, &decode, &convert, &filter));
+            if (r.contains(QStringLiteral("error")))
+                clip[QStringLiteral("error")] = r[QStringLiteral("error")];
+            QJsonObject stages;
+            stages[QStringLiteral("encode")] = encode.toJson();
+            stages[QStringLiteral("mux")] = mux.toJson();
+            stages[QStringLiteral("demux")] = demux.toJson();
+            stages[QStringLiteral("decode")] = decode.toJson();
+            stages[QStringLiteral("convert")] = convert.toJson();
+            stages[QStringLiteral("filter")] = filter.toJson();
+            clip[QStringLiteral("stages")] = stages;
+            clips.append(clip);
+            QFile::remove(file);
+        }
+    }
+    QJsonObject root;
+    root[QStringLiteral("qtav")] = QtAV_Version_String_Long();
+    root[QStringLiteral("ffmpeg")] = aboutFFmpeg_PlainText();
+    root[QStringLiteral("frames")] = n;
+    root[QStringLiteral("filter")] = vf;
+    root[QStringLiteral("clips")] = clips;
+    root[QStringLiteral("peak_rss_kb")] = double(memoryStatus("VmHWM:"));
+    const QByteArray json(QJsonDocument(root).toJson());
+    if (out.isEmpty()) {
+        fwrite(json.constData(), 1, json.size(), stdout);
+        fflush(stdout);
+        return 0;
+    }
+    QFile f(out);
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning("can not write %s", out.toUtf8().constData());
+        return 1;
+    }
+    f.write(json);
+    return 0;
+}
@@ -0,0 +1,157 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDataStream>
+#include <QtCore/QDir>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QEventLoop>
+#include <QtCore/QFile>
+#include <QtCore/QStringList>
+#include <QtCore/QTimer>
+#include <QtCore/qmath.h>
+#include <QtAV/AVPlayer.h>
+#include <QtDebug>
+
+using namespace QtAV;
+
+void help() {
+    qDebug("parameters: -i video [-a audio] [-ao null|Pulse|...]");
+    qDebug("play the video with an external audio track and seek. a 60s wav is generated if no audio is given.");
+    qDebug("fails if a seek does not finish in 2s, playback does not go on after a seek, or the end is not reached in time");
+}
+
+// 16bit stereo 440Hz sine. duration: s
+static bool writeWav(const QString& path, int duration)
+{
+    QFile f(path);
+    if (!f.open(QIODevice::WriteOnly))
+        return false;
+    const int rate = 44100, channels = 2, bytes = duration*rate*channels*2;
+    QDataStream s(&f);
+    s.setByteOrder(QDataStream::LittleEndian);
+    s.writeRawData("RIFF", 4);
+    s << quint32(36 + bytes);
+    s.writeRawData("WAVEfmt ", 8);
+    s << quint32(16) << quint16(1) << quint16(channels) << quint32(rate) << quint32(rate*channels*2) << quint16(channels*2) << quint16(16);
+    s.writeRawData("data", 4);
+    s << quint32(bytes);
+    for (int i = 0; i < duration*rate; ++i) {
+        const qint16 v = qint16(8000.0*qSin(2.0*M_PI*440.0*qreal(i)/qreal(rate)));
+        s << v << v;
+    }
+    return s.status() == QDataStream::Ok;
+}
+
+// run event loop until signal of obj is emitted or msecs elapsed. return false if timed out
+static bool waitFor(QObject* obj, const char* signal, int msecs)
+{
+    QEventLoop loop;
+    QTimer timer;
+    timer.setSingleShot(true);
+    QObject::connect(&timer, SIGNAL(timeout()), &loop, SLOT(quit()));
+    QObject::connect(obj, signal, &loop, SLOT(quit()));
+    timer.start(msecs);
+    loop.exec();
+    return timer.isActive();
+}
+
+static void sleepEventLoop(int msecs)
+{
+    QEventLoop loop;
+    QTimer::singleShot(msecs, &loop, SLOT(quit()));
+    loop.exec();
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    help();
+    QString file;
+    int idx = a.arguments().indexOf(QLatin1String("-i"));
+    if (idx > 0)
+        file = a.arguments().at(idx + 1);
+    if (file.isEmpty())
+        return 0;
+    QString audio;
+    idx = a.arguments().indexOf(QLatin1String("-a"));
+    if (idx > 0)
+        audio = a.arguments().at(idx + 1);
+    if (audio.isEmpty()) {
+        audio = QDir::temp().filePath(QString::fromLatin1("qtav_externalaudio.wav"));
+        if (!writeWav(audio, 60)) {
+            qWarning("can not write %s", qPrintable(audio));
+            return 1;
+        }
+    }
+    QString ao = QString::fromLatin1("null");
+    idx = a.arguments().indexOf(QLatin1String("-ao"));
+    if (idx > 0)
+        ao = a.arguments().at(idx + 1);
+
+    AVPlayer player;
+    player.audio()->setBackends(QStringList() << ao);
+    player.setFile(file);
+    player.setExternalAudio(audio);
+    player.setNotifyInterval(100);
+    player.play();
+    if (!player.isPlaying() && !waitFor(&player, SIGNAL(started()), 5000)) {
+        qWarning("playback does not start");
+        return 1;
+    }
+    const qint64 duration = qMin<qint64>(player.duration(), 60000);
+    if (duration < 6000) {
+        qWarning("video is too short: %lldms", duration);
+        return 1;
+    }
+    int failed = 0;
+    const qreal targets[] = { 0.7, 0.2, 0.5, 0.1 };
+    for (size_t i = 0; i < sizeof(targets)/sizeof(targets[0]); ++i) {
+        const qint64 t = qint64(targets[i]*qreal(duration));
+        QElapsedTimer timer;
+        timer.start();
+        player.seek(t);
+        if (!waitFor(&player, SIGNAL(seekFinished(qint64)), 2000)) {
+            qWarning("seek to %lldms does not finish in 2s", t);
+            failed++;
+            continue;
+        }
+        const qint64 seek_time = timer.elapsed();
+        const qint64 pos0 = player.position();
+        // audio clock stops if external audio is not put after seek
+        sleepEventLoop(1500);
+        const qint64 played = player.position() - pos0;
+        qDebug("seek to %lldms: finished in %lldms at %lldms, played %lldms in 1.5s", t, seek_time, pos0, played);
+        if (played < 500) {
+            qWarning("playback does not go on after seek to %lldms", t);
+            failed++;
+        }
+    }
+    // the end of video waits for external audio, then stops
+    player.seek(player.duration() - 2000);
+    if (player.isPlaying() && !waitFor(&player, SIGNAL(stopped()), 8000)) {
+        qWarning("playback does not stop at the end");
+        failed++;
+    }
+    player.stop();
+    qDebug("%d failures", failed);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,10 @@
+CONFIG -= app_bundle
+TEMPLATE = app
+TARGET = imageconverter
+
+PROJECTROOT = $$PWD/../..
+include($$PROJECTROOT/src/libQtAV.pri)
+preparePaths($$OUT_PWD/../../out)
+INCLUDEPATH += $$PROJECTROOT/src # internal ImageConverter.h
+
+SOURCES += main.cpp
@@ -0,0 +1,219 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+#include <QtAV/VideoFrame.h>
+#include "ImageConverter.h"
+
+/*
+ * sliced ImageConverterFF (libswscale) benchmark. converts the same frame with 1, 2, 4 and 8 threads.
+ * Then ImageConverterSIMD is compared with ImageConverterFF: result must be the same within +-1, and time of both is printed.
+ * usage: imageconverter [-n frames] [-s WxH] [-f out_format] (default: -n 100 -s 3840x2160 -f rgb32)
+ */
+using namespace QtAV;
+
+// planes of a 4:2:0 test frame: random luma, smooth chroma (swscale may interpolate chroma)
+class Frame420
+{
+public:
+    Frame420(const char* format, int w, int h) : fmt(QLatin1String(format)), width(w), height(h) {
+        const bool p010 = fmt.name() == QLatin1String("p010le");
+        const bool nv12 = p010 || fmt.name() == QLatin1String("nv12");
+        const int bps = p010 ? 2 : 1;
+        const int uv_w = (w + 1)/2, uv_h = (h + 1)/2;
+        planes.resize(nv12 ? 2 : 3);
+        stride.resize(planes.size());
+        planes[0] = QByteArray(w*h*bps, 0);
+        stride[0] = w*bps;
+        for (int i = 1; i < planes.size(); ++i) {
+            stride[i] = (nv12 ? 2*uv_w : uv_w)*bps;
+            planes[i] = QByteArray(stride[i]*uv_h, 0);
+        }
+        qsrand(1);
+        for (int j = 0; j < h; ++j) {
+            for (int i = 0; i < w; ++i)
+                setSample(0, j*w + i, 16 + qrand() % 220);
+        }
+        for (int j = 0; j < uv_h; ++j) {
+            for (int i = 0; i < uv_w; ++i) {
+                const int u = 16 + i*224/uv_w, v = 16 + j*224/uv_h;
+                if (nv12) {
+                    setSample(1, j*2*uv_w + 2*i, u);
+                    setSample(1, j*2*uv_w + 2*i + 1, v);
+                } else {
+                    setSample(1, j*uv_w + i, u);
+                    setSample(2, j*uv_w + i, v);
+                }
+            }
+        }
+        for (int i = 0; i < planes.size(); ++i)
+            src[i] = (const quint8*)planes[i].constData();
+    }
+    bool convert(ImageConverter *conv, const VideoFormat& out) const {
+        conv->setInFormat(fmt.pixelFormatFFmpeg());
+        conv->setOutFormat(out.pixelFormatFFmpeg());
+        conv->setInSize(width, height);
+        conv->setOutSize(width, height);
+        conv->setInRange(ColorRange_Limited);
+        conv->setInColorSpace(ColorSpace_BT601);
+        return conv->convert(src, stride.constData());
+    }
+
+    VideoFormat fmt;
+    int width, height;
+private:
+    void setSample(int plane, int i, int value8) {
+        if (fmt.name() == QLatin1String("p010le")) {
+            const quint16 v = quint16(value8 << 8); // msb aligned
+            planes[plane][2*i] = char(v & 0xff);
+            planes[plane][2*i + 1] = char(v >> 8);
+        } else {
+            planes[plane][i] = char(value8);
+        }
+    }
+    QVector<QByteArray> planes;
+    QVector<int> stride;
+    const quint8* src[4];
+};
+
+// returns false if ImageConverterSIMD and ImageConverterFF results differ by more than 1
+static bool compareSIMD(int n, int w, int h)
+{
+    if (!ImageConverterSIMD::isAvailable()) {
+        printf("no SIMD kernel built or supported by the cpu. VideoFrameConverter uses ImageConverterFF\n");
+        return true;
+    }
+    bool ok = true;
+    const char* formats[] = { "yuv420p", "nv12", "p010le" };
+    const VideoFormat::PixelFormat outs[] = { VideoFormat::Format_BGRA32, VideoFormat::Format_RGBA32 };
+    for (size_t f = 0; f < sizeof(formats)/sizeof(formats[0]); ++f) {
+        const Frame420 frame(formats[f], w, h);
+        if (!frame.fmt.isValid())
+            continue;
+        for (size_t o = 0; o < sizeof(outs)/sizeof(outs[0]); ++o) {
+            const VideoFormat out(outs[o]);
+            ImageConverterSIMD simd;
+            ImageConverterFF sws;
+            if (!frame.convert(&simd, out) || !frame.convert(&sws, out)) {
+                qWarning("%s => %s conversion error", formats[f], out.name().toUtf8().constData());
+                ok = false;
+                continue;
+            }
+            int max_diff = 0;
+            qint64 nb_bad = 0;
+            for (int j = 0; j < h; ++j) {
+                const quint8 *a = simd.outPlanes()[0] + j*simd.outLineSizes()[0];
+                const quint8 *b = sws.outPlanes()[0] + j*sws.outLineSizes()[0];
+                for (int i = 0; i < 4*w; ++i) {
+                    const int diff = qAbs(int(a[i]) - int(b[i]));
+                    max_diff = qMax(max_diff, diff);
+                    if (diff > 1)
+                        ++nb_bad;
+                }
+            }
+            QElapsedTimer timer;
+            timer.start();
+            for (int i = 0; i < n; ++i)
+                frame.convert(&simd, out);
+            const qint64 t_simd = qMax<qint64>(1, timer.restart());
+            for (int i = 0; i < n; ++i)
+                frame.convert(&sws, out);
+            const qint64 t_sws = qMax<qint64>(1, timer.elapsed());
+            printf("%s => %s: max diff: %d, %lld values differ by more than 1. SIMD: %.2f ms/frame, swscale: %.2f ms/frame, speedup: %.2f\n"
+                   , formats[f], out.name().toUtf8().constData(), max_diff, nb_bad
+                   , qreal(t_simd)/qreal(n), qreal(t_sws)/qreal(n), qreal(t_sws)/qreal(t_simd));
+            if (nb_bad > 0)
+                ok = false;
+        }
+    }
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    int n = 100;
+    int w = 3840, h = 2160;
+    VideoFormat::PixelFormat fmt_out = VideoFormat::Format_RGB32;
+    int idx = a.arguments().indexOf(QLatin1String("-n"));
+    if (idx > 0)
+        n = a.arguments().at(idx + 1).toInt();
+    idx = a.arguments().indexOf(QLatin1String("-s"));
+    if (idx > 0) {
+        const QStringList wh = a.arguments().at(idx + 1).split(QLatin1Char('x'));
+        if (wh.size() == 2) {
+            w = wh.at(0).toInt();
+            h = wh.at(1).toInt();
+        }
+    }
+    idx = a.arguments().indexOf(QLatin1String("-f"));
+    if (idx > 0)
+        fmt_out = VideoFormat(a.arguments().at(idx + 1)).pixelFormat();
+    if (n <= 0 || w <= 0 || h <= 0 || fmt_out == VideoFormat::Format_Invalid) {
+        qWarning("usage: imageconverter [-n frames] [-s WxH] [-f out_format]");
+        return 1;
+    }
+    // yuv420p gradient
+    const VideoFormat fmt(VideoFormat::Format_YUV420P);
+    const int uv_w = (w + 1)/2, uv_h = (h + 1)/2;
+    QByteArray data(w*h + 2*uv_w*uv_h, 0);
+    uchar *y = (uchar*)data.data();
+    for (int j = 0; j < h; ++j) {
+        for (int i = 0; i < w; ++i)
+            y[j*w + i] = (i + j) & 0xff;
+    }
+    memset(y + w*h, 64, uv_w*uv_h);
+    memset(y + w*h + uv_w*uv_h, 192, uv_w*uv_h);
+    const quint8* const src[] = { y, y + w*h, y + w*h + uv_w*uv_h };
+    const int src_stride[] = { w, uv_w, uv_w };
+
+    printf("%s %dx%d => %s, %d frames\n", fmt.name().toUtf8().constData(), w, h, VideoFormat(fmt_out).name().toUtf8().constData(), n);
+    qint64 t1 = 0;
+    const int threads[] = { 1, 2, 4, 8 };
+    for (size_t k = 0; k < sizeof(threads)/sizeof(threads[0]); ++k) {
+        // not VideoFrameConverter, it may select another backend
+        ImageConverterFF conv;
+        conv.setThreads(threads[k]);
+        conv.setInFormat(fmt.pixelFormatFFmpeg());
+        conv.setOutFormat(VideoFormat(fmt_out).pixelFormatFFmpeg());
+        conv.setInSize(w, h);
+        conv.setOutSize(w, h);
+        if (!conv.convert(src, src_stride)) { // warm up: create contexts, allocate output
+            qWarning("conversion error");
+            return 1;
+        }
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < n; ++i)
+            conv.convert(src, src_stride);
+        const qint64 t = qMax<qint64>(1, timer.elapsed());
+        if (threads[k] == 1)
+            t1 = t;
+        printf("threads: %d, %lld ms, %.2f ms/frame, speedup: %.2f\n", threads[k], t, qreal(t)/qreal(n), qreal(t1)/qreal(t));
+    }
+    fflush(0);
+    const bool simd_ok = compareSIMD(n, w, h);
+    fflush(0);
+    return simd_ok ? 0 : 1;
+}
@@ -0,0 +1,170 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QEventLoop>
+#include <QtCore/QFile>
+#include <QtCore/QStringList>
+#include <QtCore/QThread>
+#include <QtCore/QTimer>
+#include <QtNetwork/QHostAddress>
+#include <QtNetwork/QUdpSocket>
+#include <QtAV/AVClock.h>
+#include <QtAV/AVPlayer.h>
+#include <QtDebug>
+
+using namespace QtAV;
+static const int kTsPacket = 188;
+static const int kTsPerDatagram = 7;
+
+void help() {
+    qDebug("parameters: -i file.ts [-p port] [-d seconds] [-t target_ms] [-ao null|Pulse|...]");
+    qDebug("a local sender streams the mpegts file over udp in realtime paced by PCR, and the player plays it in live mode.");
+    qDebug("fails if the average latency reported in the last half is larger than 2x target");
+}
+
+// returns PCR in seconds, or -1 if no PCR in the TS packet
+static qreal tsPCR(const uchar* p)
+{
+    if (p[0] != 0x47 || !(p[3] & 0x20) || p[4] < 7 || !(p[5] & 0x10))
+        return -1;
+    const quint64 base = (quint64(p[6]) << 25) | (quint64(p[7]) << 17) | (quint64(p[8]) << 9) | (quint64(p[9]) << 1) | (quint64(p[10]) >> 7);
+    return qreal(base)/90000.0;
+}
+
+// a stand-in of a live source: send TS packets in realtime
+class Sender : public QThread
+{
+public:
+    Sender(const QString& file, quint16 port, int msecs)
+        : QThread(0)
+        , path(file)
+        , udp_port(port)
+        , duration(msecs)
+        , datagrams(0)
+    {}
+    QString path;
+    quint16 udp_port;
+    int duration;
+    int datagrams;
+protected:
+    void run() {
+        QFile f(path);
+        if (!f.open(QIODevice::ReadOnly)) {
+            qWarning("can not open %s", qPrintable(path));
+            return;
+        }
+        QUdpSocket udp;
+        QElapsedTimer timer;
+        timer.start();
+        qreal pcr0 = -1, last_pcr = -1;
+        QByteArray dgram;
+        char ts[kTsPacket];
+        while (timer.elapsed() < duration && f.read(ts, kTsPacket) == kTsPacket) {
+            const qreal pcr = tsPCR((const uchar*)ts);
+            if (pcr >= 0) {
+                if (last_pcr < 0 || pcr < last_pcr) // start or discontinuity
+                    pcr0 = pcr - qreal(timer.elapsed())/1000.0;
+                last_pcr = pcr;
+                const qint64 wait = qint64((pcr - pcr0)*1000.0) - timer.elapsed();
+                if (wait > 0) {
+                    if (!dgram.isEmpty()) {
+                        udp.writeDatagram(dgram, QHostAddress::LocalHost, udp_port);
+                        datagrams++;
+                        dgram.clear();
+                    }
+                    msleep(wait);
+                }
+            }
+            dgram.append(ts, kTsPacket);
+            if (dgram.size() < kTsPacket*kTsPerDatagram)
+                continue;
+            udp.writeDatagram(dgram, QHostAddress::LocalHost, udp_port);
+            datagrams++;
+            dgram.clear();
+        }
+    }
+};
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    help();
+    QString file;
+    int idx = a.arguments().indexOf(QLatin1String("-i"));
+    if (idx > 0)
+        file = a.arguments().at(idx + 1);
+    if (file.isEmpty())
+        return 0;
+    quint16 port = 12345;
+    idx = a.arguments().indexOf(QLatin1String("-p"));
+    if (idx > 0)
+        port = a.arguments().at(idx + 1).toUShort();
+    int duration = 20000;
+    idx = a.arguments().indexOf(QLatin1String("-d"));
+    if (idx > 0)
+        duration = a.arguments().at(idx + 1).toInt()*1000;
+    int target = 500;
+    idx = a.arguments().indexOf(QLatin1String("-t"));
+    if (idx > 0)
+        target = a.arguments().at(idx + 1).toInt();
+    QString ao = QString::fromLatin1("null");
+    idx = a.arguments().indexOf(QLatin1String("-ao"));
+    if (idx > 0)
+        ao = a.arguments().at(idx + 1);
+
+    AVPlayer player;
+    player.audio()->setBackends(QStringList() << ao);
+    player.setLiveMode(true);
+    player.setLiveLatencyTarget(target);
+    player.setFile(QString::fromLatin1("udp://127.0.0.1:%1").arg(port));
+    player.setNotifyInterval(100);
+    Sender sender(file, port, duration);
+    sender.start();
+    player.play(); // blocks until stream info is probed
+    QElapsedTimer timer;
+    timer.start();
+    qint64 sum = 0;
+    int count = 0, max = -1;
+    while (!sender.isFinished()) {
+        QEventLoop loop;
+        QTimer::singleShot(200, &loop, SLOT(quit()));
+        loop.exec();
+        const int latency = player.liveLatency();
+        if (latency < 0)
+            continue;
+        if (timer.elapsed() > duration/2) {
+            sum += latency;
+            count++;
+            max = qMax(max, latency);
+        }
+        qDebug("%.1fs latency: %dms, speed: %.2f", qreal(timer.elapsed())/1000.0, latency, player.masterClock()->speed());
+    }
+    player.stop();
+    if (!count) {
+        qWarning("no latency is reported. datagrams sent: %d", sender.datagrams);
+        return 1;
+    }
+    const int avg = int(sum/count);
+    qDebug("latency in the last half. average: %dms, max: %dms, target: %dms", avg, max, target);
+    return avg <= 2*target ? 0 : 1;
+}
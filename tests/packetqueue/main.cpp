@@ -0,0 +1,182 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#include <stdio.h>
+#include <QtCore/QBuffer>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDataStream>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QQueue>
+#include <QtCore/QStringList>
+#include <QtCore/QThread>
+#include <QtAV/AVDemuxer.h>
+#include <QtAV/Packet.h>
+#include "utils/BlockingQueue.h"
+#include "utils/SPSCQueue.h"
+
+/*
+ * packet queue micro benchmark. compares BlockingQueue (used by PacketBuffer before) and SPSCQueue.
+ * 1 producer thread puts packets and 1 consumer thread takes packets, like demux thread and a/v thread.
+ * Then demuxed packets go through a queue to check AVDemuxer packet pool misses stop growing after warm-up.
+ * usage: packetqueue [-n packets] [-p players]
+ */
+using namespace QtAV;
+
+template<class Q>
+class Consumer : public QThread
+{
+public:
+    Consumer(Q *q, int n) : taken(0), queue(q), count(n) {}
+    int taken;
+protected:
+    void run() {
+        bool valid = false;
+        while (taken < count) {
+            Packet pkt = queue->take(ULONG_MAX, &valid);
+            if (valid)
+                taken++;
+        }
+    }
+private:
+    Q *queue;
+    int count;
+};
+
+template<class Q>
+class Producer : public QThread
+{
+public:
+    Producer(Q *q, int n) : queue(q), count(n) {}
+protected:
+    void run() {
+        Packet pkt;
+        pkt.data = QByteArray(1024, 0);
+        pkt.duration = 0.04;
+        for (int i = 0; i < count; ++i) {
+            pkt.pts = pkt.dts = qreal(i)*pkt.duration;
+            queue->put(pkt);
+        }
+    }
+private:
+    Q *queue;
+    int count;
+};
+
+// returns elapsed ms of n_players pairs running concurrently
+template<class Q>
+qint64 run(int n_packets, int n_players)
+{
+    QList<Q*> queues;
+    QList<QThread*> threads;
+    for (int i = 0; i < n_players; ++i) {
+        Q *q = new Q();
+        q->setCapacity(48);
+        q->setThreshold(1);
+        queues.append(q);
+        threads.append(new Consumer<Q>(q, n_packets));
+        threads.append(new Producer<Q>(q, n_packets));
+    }
+    QElapsedTimer timer;
+    timer.start();
+    foreach (QThread *t, threads) {
+        t->start();
+    }
+    foreach (QThread *t, threads) {
+        t->wait();
+    }
+    const qint64 elapsed = timer.elapsed();
+    qDeleteAll(threads);
+    qDeleteAll(queues);
+    return elapsed;
+}
+
+// 10s 44.1kHz s16 stereo silence
+static QByteArray createWav()
+{
+    const int rate = 44100, channels = 2, bytes = 10*rate*channels*2;
+    QByteArray wav;
+    QDataStream s(&wav, QIODevice::WriteOnly);
+    s.setByteOrder(QDataStream::LittleEndian);
+    s.writeRawData("RIFF", 4);
+    s << quint32(36 + bytes);
+    s.writeRawData("WAVEfmt ", 8);
+    s << quint32(16) << quint16(1) << quint16(channels) << quint32(rate) << quint32(rate*channels*2) << quint16(channels*2) << quint16(16);
+    s.writeRawData("data", 4);
+    s << quint32(bytes);
+    wav.append(QByteArray(bytes, 0));
+    return wav;
+}
+
+// returns false if packet storage is still allocated after warm-up
+static bool checkPacketPool()
+{
+    QByteArray wav(createWav());
+    QBuffer dev(&wav);
+    dev.open(QIODevice::ReadOnly);
+    AVDemuxer demuxer;
+    demuxer.setMedia(&dev);
+    if (!demuxer.load()) {
+        qWarning("failed to load wav");
+        return false;
+    }
+    // packets in decoder queue. the oldest one is released after decoded
+    QQueue<Packet> queue;
+    const int kWarmUp = 128;
+    int n = 0;
+    qint64 misses = 0;
+    while (demuxer.readFrame()) {
+        queue.enqueue(demuxer.packet());
+        if (queue.size() > 48)
+            queue.dequeue();
+        if (++n == kWarmUp)
+            misses = demuxer.packetPoolMisses();
+    }
+    printf("packet pool: %d packets, %lld hits, %lld misses, %lld misses after %d packets\n", n, demuxer.packetPoolHits(), demuxer.packetPoolMisses(), demuxer.packetPoolMisses() - misses, kWarmUp);
+    fflush(0);
+    return n > kWarmUp && demuxer.packetPoolMisses() == misses;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    int n_packets = 1000000;
+    int n_players = 1;
+    int idx = a.arguments().indexOf(QLatin1String("-n"));
+    if (idx > 0)
+        n_packets = a.arguments().at(idx + 1).toInt();
+    idx = a.arguments().indexOf(QLatin1String("-p"));
+    if (idx > 0)
+        n_players = a.arguments().at(idx + 1).toInt();
+    if (n_packets <= 0 || n_players <= 0) {
+        qWarning("usage: packetqueue [-n packets] [-p players]");
+        return 1;
+    }
+    const qint64 t_blocking = run<BlockingQueue<Packet, QQueue> >(n_packets, n_players);
+    printf("BlockingQueue: %d players x %d packets: %lld ms, %.1f packets/ms\n", n_players, n_packets, t_blocking, qreal(n_packets*n_players)/qreal(qMax<qint64>(1, t_blocking)));
+    const qint64 t_spsc = run<SPSCQueue<Packet> >(n_packets, n_players);
+    printf("SPSCQueue:     %d players x %d packets: %lld ms, %.1f packets/ms\n", n_players, n_packets, t_spsc, qreal(n_packets*n_players)/qreal(qMax<qint64>(1, t_spsc)));
+    fflush(0);
+    if (!checkPacketPool()) {
+        qWarning("packet pool misses still grow after warm-up");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,216 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QStringList>
+#include <QtCore/QThread>
+#include <QtNetwork/QUdpSocket>
+#include <QtAV/MediaIO.h>
+#include <QtAV/Statistics.h>
+#include "RTPReceiver.h"
+
+/*
+ * RTPReceiver and "RTPTS" MediaIO test over loopback. A local udp sender stands in for a SAT>IP server or a
+ * multicast source: it sends RTP packets of 7 TS packets, swaps every 50th packet with the next one and drops every 97th packet.
+ * Payloads must be read in order, and lost/reordered packets are counted. "RTPTS" must replace lost packets by TS null packets.
+ * usage: rtpreceiver [-n packets]
+ */
+using namespace QtAV;
+
+static const int kPayload = 7*188;
+
+class Sender : public QThread
+{
+public:
+    Sender(quint16 p, int n) : dropped(0), swapped(0), port(p), count(n) {}
+    int dropped;
+    int swapped;
+protected:
+    void run() {
+        QUdpSocket s;
+        QByteArray pkt(12 + kPayload, 0x47);
+        memset(pkt.data(), 0, 12);
+        QByteArray next;
+        QElapsedTimer t;
+        t.start();
+        for (int i = 0; i < count; ++i) {
+            if (i % 97 == 96) {
+                dropped++;
+                continue;
+            }
+            const quint16 seq = quint16(i);
+            pkt[0] = char(0x80); // version 2
+            pkt[1] = char(33); // MP2T
+            pkt[2] = char(seq >> 8);
+            pkt[3] = char(seq & 0xff);
+            const quint32 ts = quint32(t.nsecsElapsed()*9LL/100000LL); // 90kHz send time
+            pkt[4] = char(ts >> 24);
+            pkt[5] = char(ts >> 16);
+            pkt[6] = char(ts >> 8);
+            pkt[7] = char(ts);
+            memcpy(pkt.data() + 12, &i, sizeof(i));
+            if (i % 50 == 0 && i + 1 < count && (i + 1) % 97 != 96) {
+                next = pkt; // send after the next one
+                swapped++;
+                continue;
+            }
+            s.writeDatagram(pkt, QHostAddress::LocalHost, port);
+            if (!next.isEmpty()) {
+                s.writeDatagram(next, QHostAddress::LocalHost, port);
+                next.clear();
+            }
+            if (i % 64 == 0) // do not overflow the socket buffer
+                QThread::msleep(1);
+        }
+    }
+private:
+    quint16 port;
+    int count;
+};
+
+static bool isNullPayload(const char* p)
+{
+    return (uchar)p[0] == 0x47 && (uchar)p[1] == 0x1f && (uchar)p[2] == 0xff;
+}
+
+// checks the order of read payloads
+class Reader
+{
+public:
+    Reader() : bytes(0), concealed(0), errors(0), m_expected(0) {}
+    void append(const char* data, qint64 n) {
+        bytes += n;
+        m_payload.append(data, int(n));
+        while (m_payload.size() >= kPayload) {
+            if (isNullPayload(m_payload.constData())) {
+                concealed++;
+                m_payload.remove(0, kPayload);
+                m_expected++;
+                continue;
+            }
+            int i = 0;
+            memcpy(&i, m_payload.constData(), sizeof(i));
+            m_payload.remove(0, kPayload);
+            if (m_expected % 97 == 96 && i != m_expected)
+                m_expected++;
+            if (i != m_expected) {
+                if (errors++ < 10)
+                    qWarning("packet %d is read, but %d is expected", i, m_expected);
+                m_expected = i;
+            }
+            m_expected++;
+        }
+    }
+    qint64 bytes;
+    int concealed;
+    int errors;
+private:
+    int m_expected;
+    QByteArray m_payload;
+};
+
+// sequence numbers wrap after 65535 packets. window is rounded up to a power of 2, so slots are not shared at the wrap
+static int testReceiver(int n_packets, int window)
+{
+    QUdpSocket *socket = new QUdpSocket();
+    if (!socket->bind(QHostAddress::LocalHost, 0)) {
+        qWarning("bind error: %s", socket->errorString().toUtf8().constData());
+        return 1;
+    }
+    socket->setSocketOption(QAbstractSocket::ReceiveBufferSizeSocketOption, 8*1024*1024);
+    RTPReceiver receiver;
+    receiver.setReorderWindow(window);
+    receiver.start(socket);
+    Sender sender(socket->localPort(), n_packets);
+    QElapsedTimer timer;
+    timer.start();
+    sender.start();
+    QByteArray buf(32768, 0);
+    Reader reader;
+    for (;;) {
+        const qint64 n = receiver.read(buf.data(), buf.size(), 1000);
+        if (n <= 0) // timed out. all are received
+            break;
+        reader.append(buf.constData(), n);
+    }
+    sender.wait();
+    const qint64 elapsed = timer.elapsed() - 1000;
+    receiver.stop();
+    const RTPReceiver::Stats st = receiver.stats();
+    printf("RTPReceiver(window %d): %lld bytes in %lld ms. received: %lld, lost: %lld, reordered: %lld, late: %lld, duplicated: %lld, jitter: %.3fms\n"
+           , receiver.reorderWindow(), reader.bytes, elapsed, st.received, st.lost, st.reordered, st.late, st.duplicated, st.jitter);
+    printf("sent: %d, dropped: %d, swapped: %d, order errors: %d\n", n_packets - sender.dropped, sender.dropped, sender.swapped, reader.errors);
+    fflush(0);
+    if (reader.errors > 0 || st.reordered != sender.swapped || st.received != n_packets - sender.dropped)
+        return 1;
+    return 0;
+}
+
+static int testMediaIO(int n_packets)
+{
+    quint16 port = 0;
+    {
+        QUdpSocket s;
+        s.bind(QHostAddress::LocalHost, 0);
+        port = s.localPort();
+    }
+    MediaIO *io = MediaIO::createForUrl(QString::fromLatin1("rtp-ts://127.0.0.1:%1?latency=50&timeout=1000").arg(port));
+    if (!io) {
+        qWarning("no MediaIO for rtp-ts");
+        return 1;
+    }
+    Statistics::Network net(io);
+    Sender sender(port, n_packets);
+    sender.start();
+    QByteArray buf(32768, 0);
+    Reader reader;
+    for (;;) {
+        const qint64 n = io->read(buf.data(), buf.size());
+        if (n <= 0)
+            break;
+        reader.append(buf.constData(), n);
+    }
+    sender.wait();
+    const qint64 concealed = io->property("packetsConcealed").toLongLong();
+    printf("RTPTS: %lld bytes. received: %lld, lost: %lld, reordered: %lld, concealed: %lld(%d read), jitter: %.3fms, latency: %dms\n"
+           , reader.bytes, net.packetsReceived(), net.packetsLost(), net.packetsReordered(), concealed, reader.concealed, net.jitter(), net.latency());
+    fflush(0);
+    const bool ok = net.isAvailable() && reader.errors == 0 && net.packetsLost() == concealed && concealed == reader.concealed
+            && net.packetsReordered() == sender.swapped;
+    delete io;
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    int n_packets = 100000;
+    const int idx = a.arguments().indexOf(QLatin1String("-n"));
+    if (idx > 0)
+        n_packets = a.arguments().at(idx + 1).toInt();
+    if (n_packets <= 0) {
+        qWarning("usage: rtpreceiver [-n packets]");
+        return 1;
+    }
+    const int ret = testReceiver(n_packets, 32) | testReceiver(n_packets, 100);
+    return ret | testMediaIO(n_packets);
+}
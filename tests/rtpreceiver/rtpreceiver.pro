@@ -0,0 +1,12 @@
+CONFIG -= app_bundle
+CONFIG += console
+TEMPLATE = app
+TARGET = rtpreceiver
+QT += network
+
+PROJECTROOT = $$PWD/../..
+include($$PROJECTROOT/src/libQtAV.pri)
+preparePaths($$OUT_PWD/../../out)
+INCLUDEPATH += $$PROJECTROOT/src $$PROJECTROOT/src/io # internal headers
+
+SOURCES += main.cpp
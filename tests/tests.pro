@@ -2,10 +2,19 @@ TEMPLATE = subdirs
 
 SUBDIRS += \
     ao \
+    audiomix \
+    audiomixer \
     decoder \
+    externalaudio \
+    imageconverter \
+    livestream \
+    packetqueue \
+    rtpreceiver \
     subtitle \
     transcode
 
+greaterThan(QT_MAJOR_VERSION, 4): SUBDIRS += benchmark
+
 !no-widgets {
   SUBDIRS += \
     extract \